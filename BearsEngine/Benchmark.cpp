@@ -0,0 +1,1485 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glad/glad.h"
+#include "GLFW/glfw3.h"
+#include "glm/glm.hpp"
+#include "glm/gtc/constants.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "BlockCompressor.h"
+#include "Camera.h"
+#include "CubeMap.h"
+#include "GeometryCodec.h"
+#include "JpegDecoder.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "MeshBatch.h"
+#include "MeshCache.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "MeshParser.h"
+#include "MeshSimplifier.h"
+#include "MipGenerator.h"
+#include "ParametricSurface.h"
+#include "ResourceManager.h"
+#include "Shader.h"
+#include "SphereMesh.h"
+#include "TextureCache.h"
+#include "TextureLoader.h"
+#include "TexturePacker.h"
+#include "stb_image.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	double _secondsSince(Clock::time_point p_start)
+	{
+		return std::chrono::duration<double>(Clock::now() - p_start).count();
+	}
+
+	// The parser MeshGrid used before the mapped loader, kept as the reference
+	void _parseWithIfstream(const char* p_vertexPath, const char* p_trianglePath, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles)
+	{
+		std::ifstream vertexFile(p_vertexPath);
+		std::ifstream triangleFile(p_trianglePath);
+
+		float x, y, z, nx, ny, nz;
+		float uv[2];
+
+		while (vertexFile >> x >> y >> z >> nx >> ny >> nz)
+		{
+			p_vertices.push_back(x);
+			p_vertices.push_back(y);
+			p_vertices.push_back(z);
+			p_vertices.push_back(nx);
+			p_vertices.push_back(ny);
+			p_vertices.push_back(nz);
+
+			MeshParser::SphericalTexCoord(x, y, z, uv);
+			p_vertices.push_back(uv[0]);
+			p_vertices.push_back(uv[1]);
+		}
+
+		unsigned int index0, index1, index2;
+
+		while (triangleFile >> index0 >> index1 >> index2)
+		{
+			p_triangles.push_back(index0);
+			p_triangles.push_back(index1);
+			p_triangles.push_back(index2);
+		}
+	}
+
+	void _parseWithMappedFile(const char* p_vertexPath, const char* p_trianglePath, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles)
+	{
+		MappedFile vertexFile(p_vertexPath);
+		MappedFile triangleFile(p_trianglePath);
+
+		MeshParser::ParseVertices(vertexFile.Data(), vertexFile.End(), p_vertices);
+		MeshParser::ParseTriangles(triangleFile.Data(), triangleFile.End(), p_triangles);
+	}
+
+	// the parsers may round the last bit differently, so compare with a small tolerance
+	bool _sameVertices(const std::vector<float>& p_a, const std::vector<float>& p_b)
+	{
+		if (p_a.size() != p_b.size())
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < p_a.size(); ++i)
+		{
+			if (std::fabs(p_a[i] - p_b[i]) > 1e-6f * (1.0f + std::fabs(p_a[i])))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Meshes on a square grid in front of the camera, from 5 units away into the distance
+	std::vector<glm::vec3> _lodScene(int p_noOfMeshes)
+	{
+		const int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(p_noOfMeshes))));
+		std::vector<glm::vec3> positions;
+		for (int i = 0; i < p_noOfMeshes; ++i)
+		{
+			positions.push_back(glm::vec3((i % columns - columns / 2) * 3.0f, 0.0f, -5.0f - (i / columns) * 3.0f));
+		}
+		return positions;
+	}
+
+	// The sphere generator MeshGrid used before ParametricSurface, kept as the reference
+	void _createSphereReference(unsigned int p_noOfXSeg, unsigned int p_noOfYSeg, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles)
+	{
+		for (unsigned int y = 0; y <= p_noOfYSeg; ++y)
+		{
+			for (unsigned int x = 0; x <= p_noOfXSeg; ++x)
+			{
+				float xSegments = static_cast<float>(x) / static_cast<float>(p_noOfXSeg);
+				float ySegments = static_cast<float>(y) / static_cast<float>(p_noOfYSeg);
+
+				float xPos = std::cos(xSegments * 2.0f * glm::pi<float>()) * std::sin(ySegments * glm::pi<float>());
+				float yPos = std::cos(ySegments * glm::pi<float>());
+				float zPos = std::sin(xSegments * 2.0f * glm::pi<float>()) * std::sin(ySegments * glm::pi<float>());
+
+				p_vertices.push_back(xPos);
+				p_vertices.push_back(yPos);
+				p_vertices.push_back(zPos);
+				p_vertices.push_back(xPos);
+				p_vertices.push_back(yPos);
+				p_vertices.push_back(zPos);
+				p_vertices.push_back(1.0f - xSegments);
+				p_vertices.push_back(ySegments);
+			}
+		}
+
+		for (unsigned int y = 0; y < p_noOfYSeg; ++y)
+		{
+			for (unsigned int x = 0; x < p_noOfXSeg; ++x)
+			{
+				unsigned int topLeft = y * (p_noOfXSeg + 1) + x;
+				unsigned int bottomLeft = (y + 1) * (p_noOfXSeg + 1) + x;
+
+				p_triangles.push_back(topLeft);
+				p_triangles.push_back(topLeft + 1);
+				p_triangles.push_back(bottomLeft);
+
+				p_triangles.push_back(topLeft + 1);
+				p_triangles.push_back(bottomLeft + 1);
+				p_triangles.push_back(bottomLeft);
+			}
+		}
+	}
+
+	// Best of p_repeat runs of ParametricSurface::Generate into vectors that already have the size,
+	// so only the generation itself is measured
+	template <typename Surface>
+	double _timeSurface(const Surface& p_surface, unsigned int p_noOfXSeg, unsigned int p_noOfYSeg, int p_repeat, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles)
+	{
+		double best = 0.0;
+		for (int i = 0; i < p_repeat; ++i)
+		{
+			Clock::time_point start = Clock::now();
+			ParametricSurface::Generate(p_surface, p_noOfXSeg, p_noOfYSeg, p_vertices, p_triangles);
+			const double seconds = _secondsSince(start);
+			best = i == 0 || seconds < best ? seconds : best;
+		}
+		return best;
+	}
+
+	// Smallest resolution whose mesh stays within p_maxError, assuming the error shrinks as the
+	// resolution grows; leaves that mesh in the vectors
+	unsigned int _resolutionForError(SphereMesh::Tessellation p_tessellation, double p_maxError, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles)
+	{
+		auto fits = [&](unsigned int p_resolution)
+		{
+			SphereMesh::Generate(p_tessellation, p_resolution, p_vertices, p_triangles);
+			return SphereMesh::MaxError(p_vertices, p_triangles) <= p_maxError;
+		};
+
+		// a 2 x 1 UV sphere has only pole vertices and no area, so start above it
+		unsigned int high = 2;
+		while (!fits(high))
+		{
+			high *= 2;
+		}
+		unsigned int low = high / 2;
+		while (high - low > 1)
+		{
+			const unsigned int middle = (low + high) / 2;
+			(fits(middle) ? high : low) = middle;
+		}
+		fits(high);
+		return high;
+	}
+
+	// Mip chain the way TextureLoader built it before MipGenerator: scalar 2 x 2 box filter
+	// on the sRGB values, the last column or row of an odd level reused
+	void _boxMipsReference(std::vector<MipLevel>& p_levels)
+	{
+		while (p_levels.back().width > 1 || p_levels.back().height > 1)
+		{
+			const MipLevel& source = p_levels.back();
+			MipLevel level{ std::max(1, source.width / 2), std::max(1, source.height / 2), {} };
+			level.texels.resize(static_cast<size_t>(level.width) * level.height * 3);
+
+			for (int y = 0; y < level.height; ++y)
+			{
+				const unsigned char* row0 = source.texels.data() + static_cast<size_t>(std::min(2 * y, source.height - 1)) * source.width * 3;
+				const unsigned char* row1 = source.texels.data() + static_cast<size_t>(std::min(2 * y + 1, source.height - 1)) * source.width * 3;
+				unsigned char* out = level.texels.data() + static_cast<size_t>(y) * level.width * 3;
+				for (int x = 0; x < level.width; ++x)
+				{
+					const int x0 = std::min(2 * x, source.width - 1) * 3;
+					const int x1 = std::min(2 * x + 1, source.width - 1) * 3;
+					for (int c = 0; c < 3; ++c)
+					{
+						out[x * 3 + c] = static_cast<unsigned char>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+					}
+				}
+			}
+			p_levels.push_back(std::move(level));
+		}
+	}
+
+	void _printThroughput(const char* p_name, double p_seconds, double p_bytes, int p_repeat)
+	{
+		double perRun = p_seconds / p_repeat;
+		std::cout << "  " << p_name << ": " << perRun * 1000.0 << " ms/run, "
+			<< p_bytes / perRun / (1024.0 * 1024.0) << " MB/s" << std::endl;
+	}
+}
+
+namespace Benchmark
+{
+	int Run(int argc, char* argv[])
+	{
+		// argv[1] is "--bench"
+		const char* name = argc > 2 ? argv[2] : "";
+
+		if (std::strcmp(name, "parse") == 0)
+		{
+			const char* vertexPath = argc > 3 ? argv[3] : "vertices.txt";
+			const char* trianglePath = argc > 4 ? argv[4] : "triangles.txt";
+			int repeat = argc > 5 ? std::atoi(argv[5]) : 20;
+			return RunParse(vertexPath, trianglePath, repeat > 0 ? repeat : 1);
+		}
+
+		if (std::strcmp(name, "import") == 0)
+		{
+			const char* vertexPath = argc > 3 ? argv[3] : "vertices.txt";
+			const char* trianglePath = argc > 4 ? argv[4] : "triangles.txt";
+			int repeat = argc > 5 ? std::atoi(argv[5]) : 20;
+			return RunImport(vertexPath, trianglePath, repeat > 0 ? repeat : 1);
+		}
+
+		if (std::strcmp(name, "optimize") == 0)
+		{
+			const char* vertexPath = argc > 3 ? argv[3] : "vertices.txt";
+			const char* trianglePath = argc > 4 ? argv[4] : "triangles.txt";
+			return RunOptimize(vertexPath, trianglePath);
+		}
+
+		if (std::strcmp(name, "lod") == 0)
+		{
+			const char* vertexPath = argc > 3 ? argv[3] : "vertices.txt";
+			const char* trianglePath = argc > 4 ? argv[4] : "triangles.txt";
+			int noOfMeshes = argc > 5 ? std::atoi(argv[5]) : 1000;
+			int noOfFrames = argc > 6 ? std::atoi(argv[6]) : 100;
+			return RunLod(vertexPath, trianglePath, noOfMeshes > 0 ? noOfMeshes : 1, noOfFrames > 0 ? noOfFrames : 1);
+		}
+
+		if (std::strcmp(name, "meshlet") == 0)
+		{
+			const char* vertexPath = argc > 3 ? argv[3] : "vertices.txt";
+			const char* trianglePath = argc > 4 ? argv[4] : "triangles.txt";
+			int repeat = argc > 5 ? std::atoi(argv[5]) : 1000;
+			return RunMeshlet(vertexPath, trianglePath, repeat > 0 ? repeat : 1);
+		}
+
+		if (std::strcmp(name, "codec") == 0)
+		{
+			const char* vertexPath = argc > 3 ? argv[3] : "vertices.txt";
+			const char* trianglePath = argc > 4 ? argv[4] : "triangles.txt";
+			int repeat = argc > 5 ? std::atoi(argv[5]) : 100;
+			return RunCodec(vertexPath, trianglePath, repeat > 0 ? repeat : 1);
+		}
+
+		if (std::strcmp(name, "surface") == 0)
+		{
+			int noOfXSeg = argc > 3 ? std::atoi(argv[3]) : 4096;
+			int noOfYSeg = argc > 4 ? std::atoi(argv[4]) : 4096;
+			int repeat = argc > 5 ? std::atoi(argv[5]) : 3;
+			return RunSurface(noOfXSeg > 0 ? noOfXSeg : 1, noOfYSeg > 0 ? noOfYSeg : 1, repeat > 0 ? repeat : 1);
+		}
+
+		if (std::strcmp(name, "spheres") == 0)
+		{
+			return RunSphereError();
+		}
+
+		if (std::strcmp(name, "compress") == 0)
+		{
+			const char* imagePath = argc > 3 ? argv[3] : "Textures\\earth.jpg";
+			int repeat = argc > 4 ? std::atoi(argv[4]) : 3;
+			return RunCompress(imagePath, repeat > 0 ? repeat : 1);
+		}
+
+		if (std::strcmp(name, "mips") == 0)
+		{
+			const char* imagePath = argc > 3 ? argv[3] : "Textures\\earth.jpg";
+			int repeat = argc > 4 ? std::atoi(argv[4]) : 3;
+			return RunMips(imagePath, repeat > 0 ? repeat : 1);
+		}
+
+		if (std::strcmp(name, "jpeg") == 0)
+		{
+			const char* imagePath = argc > 3 ? argv[3] : "Textures\\earth.jpg";
+			int repeat = argc > 4 ? std::atoi(argv[4]) : 5;
+			return RunJpeg(imagePath, repeat > 0 ? repeat : 1);
+		}
+
+		if (std::strcmp(name, "batch") == 0)
+		{
+			int noOfObjects = argc > 3 ? std::atoi(argv[3]) : 512;
+			int noOfFrames = argc > 4 ? std::atoi(argv[4]) : 100;
+			return RunBatch(noOfObjects > 0 ? noOfObjects : 1, noOfFrames > 0 ? noOfFrames : 1);
+		}
+
+		if (std::strcmp(name, "resources") == 0)
+		{
+			return RunResources(argc > 3 ? argv[3] : nullptr);
+		}
+
+		if (std::strcmp(name, "cubemap") == 0)
+		{
+			const char* imagePath = argc > 3 ? argv[3] : "Textures\\earth.jpg";
+			int repeat = argc > 4 ? std::atoi(argv[4]) : 3;
+			return RunCubeMap(imagePath, repeat > 0 ? repeat : 1);
+		}
+
+		std::cout << "Usage: BearsEngine --bench <benchmark> [arguments]" << std::endl;
+		std::cout << "  parse [vertices.txt] [triangles.txt] [repeat]" << std::endl;
+		std::cout << "  import [vertices.txt] [triangles.txt] [repeat]" << std::endl;
+		std::cout << "  optimize [vertices.txt] [triangles.txt]" << std::endl;
+		std::cout << "  lod [vertices.txt] [triangles.txt] [meshes] [frames]" << std::endl;
+		std::cout << "  meshlet [vertices.txt] [triangles.txt] [repeat]" << std::endl;
+		std::cout << "  codec [vertices.txt] [triangles.txt] [repeat]" << std::endl;
+		std::cout << "  surface [x segments] [y segments] [repeat]" << std::endl;
+		std::cout << "  spheres" << std::endl;
+		std::cout << "  compress [image] [repeat]" << std::endl;
+		std::cout << "  mips [image] [repeat]" << std::endl;
+		std::cout << "  jpeg [image] [repeat]" << std::endl;
+		std::cout << "  batch [objects] [frames]" << std::endl;
+		std::cout << "  resources [mesh.obj]" << std::endl;
+		std::cout << "  cubemap [image] [repeat]" << std::endl;
+		return 1;
+	}
+
+	int RunParse(const char* p_vertexPath, const char* p_trianglePath, int p_repeat)
+	{
+		double bytes = 0.0;
+		{
+			MappedFile vertexFile(p_vertexPath);
+			MappedFile triangleFile(p_trianglePath);
+			if (!vertexFile.IsOpen() || !triangleFile.IsOpen())
+			{
+				std::cout << "Cannot open " << p_vertexPath << " or " << p_trianglePath << std::endl;
+				return 1;
+			}
+			bytes = static_cast<double>(vertexFile.Size() + triangleFile.Size());
+		}
+
+		std::vector<float> referenceVertices, vertices;
+		std::vector<unsigned int> referenceTriangles, triangles;
+
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < p_repeat; ++i)
+		{
+			referenceVertices.clear();
+			referenceTriangles.clear();
+			referenceVertices.shrink_to_fit();
+			referenceTriangles.shrink_to_fit();
+			_parseWithIfstream(p_vertexPath, p_trianglePath, referenceVertices, referenceTriangles);
+		}
+		double ifstreamSeconds = _secondsSince(start);
+
+		start = Clock::now();
+		for (int i = 0; i < p_repeat; ++i)
+		{
+			vertices.clear();
+			triangles.clear();
+			vertices.shrink_to_fit();
+			triangles.shrink_to_fit();
+			_parseWithMappedFile(p_vertexPath, p_trianglePath, vertices, triangles);
+		}
+		double mappedSeconds = _secondsSince(start);
+
+		std::cout << "Parse " << p_vertexPath << " + " << p_trianglePath << " (" << bytes / (1024.0 * 1024.0) << " MB, "
+			<< vertices.size() / MeshParser::FLOATS_PER_VERTEX << " vertices, " << triangles.size() / 3 << " triangles)" << std::endl;
+		_printThroughput("ifstream", ifstreamSeconds, bytes, p_repeat);
+		_printThroughput("mapped  ", mappedSeconds, bytes, p_repeat);
+		std::cout << "  speedup: " << ifstreamSeconds / mappedSeconds << "x" << std::endl;
+
+		if (!_sameVertices(vertices, referenceVertices) || triangles != referenceTriangles)
+		{
+			std::cout << "  WARNING: parsers disagree" << std::endl;
+			return 1;
+		}
+
+		return 0;
+	}
+
+	int RunImport(const char* p_vertexPath, const char* p_trianglePath, int p_repeat)
+	{
+		MappedFile vertexFile(p_vertexPath);
+		MappedFile triangleFile(p_trianglePath);
+		if (!vertexFile.IsOpen() || !triangleFile.IsOpen())
+		{
+			std::cout << "Cannot open " << p_vertexPath << " or " << p_trianglePath << std::endl;
+			return 1;
+		}
+
+		const double bytes = static_cast<double>(vertexFile.Size() + triangleFile.Size());
+
+		std::vector<float> serialVertices, vertices;
+		std::vector<unsigned int> serialTriangles, triangles;
+
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < p_repeat; ++i)
+		{
+			serialVertices.clear();
+			serialTriangles.clear();
+			MeshParser::ParseVertices(vertexFile.Data(), vertexFile.End(), serialVertices);
+			MeshParser::ParseTriangles(triangleFile.Data(), triangleFile.End(), serialTriangles);
+		}
+		const double serialSeconds = _secondsSince(start);
+
+		std::cout << "Import " << p_vertexPath << " + " << p_trianglePath << " (" << bytes / (1024.0 * 1024.0) << " MB)" << std::endl;
+		_printThroughput("serial    ", serialSeconds, bytes, p_repeat);
+
+		int result = 0;
+		const unsigned int threadCounts[] = { 1, 2, 4, 8, 16 };
+		for (unsigned int noOfThreads : threadCounts)
+		{
+			// the calling thread works as well, so the pool gets one worker less
+			ThreadPool pool(noOfThreads - 1);
+
+			start = Clock::now();
+			for (int i = 0; i < p_repeat; ++i)
+			{
+				vertices.clear();
+				triangles.clear();
+				MeshParser::ParseVerticesParallel(vertexFile.Data(), vertexFile.End(), vertices, pool);
+				MeshParser::ParseTrianglesParallel(triangleFile.Data(), triangleFile.End(), triangles, pool);
+			}
+			const double seconds = _secondsSince(start);
+
+			std::string name = std::to_string(noOfThreads) + (noOfThreads == 1 ? " thread " : " threads");
+			name.resize(10, ' ');
+			_printThroughput(name.c_str(), seconds, bytes, p_repeat);
+			std::cout << "    speedup over serial: " << serialSeconds / seconds << "x" << std::endl;
+
+			// same parser on both paths, so the results must match bit for bit
+			if (vertices != serialVertices || triangles != serialTriangles)
+			{
+				std::cout << "  WARNING: parallel import differs from the serial path" << std::endl;
+				result = 1;
+			}
+		}
+
+		return result;
+	}
+
+	int RunOptimize(const char* p_vertexPath, const char* p_trianglePath)
+	{
+		MappedFile vertexFile(p_vertexPath);
+		MappedFile triangleFile(p_trianglePath);
+		if (!vertexFile.IsOpen() || !triangleFile.IsOpen())
+		{
+			std::cout << "Cannot open " << p_vertexPath << " or " << p_trianglePath << std::endl;
+			return 1;
+		}
+
+		std::vector<float> vertices;
+		std::vector<unsigned int> triangles;
+		MeshParser::ParseVertices(vertexFile.Data(), vertexFile.End(), vertices);
+		MeshParser::ParseTriangles(triangleFile.Data(), triangleFile.End(), triangles);
+
+		const size_t floatsPerVertex = MeshParser::FLOATS_PER_VERTEX;
+		auto report = [&](const char* p_name)
+		{
+			const size_t noOfVertices = vertices.size() / floatsPerVertex;
+			VertexCacheStats fifo16 = MeshOptimizer::AnalyzeVertexCache(triangles, noOfVertices, 16);
+			VertexCacheStats fifo32 = MeshOptimizer::AnalyzeVertexCache(triangles, noOfVertices, 32);
+			OverdrawStats overdraw = MeshOptimizer::AnalyzeOverdraw(triangles, vertices, floatsPerVertex);
+			std::cout << "  " << p_name << ": ACMR " << fifo16.acmr << " (FIFO 16) / " << fifo32.acmr << " (FIFO 32), ATVR "
+				<< fifo16.atvr << " / " << fifo32.atvr << ", overdraw " << overdraw.overdraw << std::endl;
+		};
+
+		std::cout << "Optimize " << p_vertexPath << " + " << p_trianglePath << " (" << vertices.size() / floatsPerVertex << " vertices, "
+			<< triangles.size() / 3 << " triangles)" << std::endl;
+		report("input    ");
+
+		Clock::time_point start = Clock::now();
+		MeshOptimizer::OptimizeVertexCache(triangles, vertices.size() / floatsPerVertex);
+		const double cacheSeconds = _secondsSince(start);
+		report("vcache   ");
+
+		start = Clock::now();
+		MeshOptimizer::OptimizeOverdraw(triangles, vertices, floatsPerVertex);
+		const double overdrawSeconds = _secondsSince(start);
+		report("overdraw ");
+		// meshes only get this pass with MeshOptions::optimizeOverdraw
+
+		start = Clock::now();
+		MeshOptimizer::OptimizeVertexFetch(vertices, triangles, floatsPerVertex);
+		const double fetchSeconds = _secondsSince(start);
+		report("vfetch   ");
+
+		std::cout << "  time: vcache " << cacheSeconds * 1000.0 << " ms, overdraw " << overdrawSeconds * 1000.0
+			<< " ms, vfetch " << fetchSeconds * 1000.0 << " ms" << std::endl;
+		return 0;
+	}
+
+	int RunLod(const char* p_vertexPath, const char* p_trianglePath, int p_noOfMeshes, int p_noOfFrames)
+	{
+		MappedFile vertexFile(p_vertexPath);
+		MappedFile triangleFile(p_trianglePath);
+		if (!vertexFile.IsOpen() || !triangleFile.IsOpen())
+		{
+			std::cout << "Cannot open " << p_vertexPath << " or " << p_trianglePath << std::endl;
+			return 1;
+		}
+
+		std::vector<float> vertices;
+		std::vector<unsigned int> triangles;
+		MeshParser::ParseVertices(vertexFile.Data(), vertexFile.End(), vertices);
+		MeshParser::ParseTriangles(triangleFile.Data(), triangleFile.End(), triangles);
+
+		const float ratios[] = { 0.5f, 0.25f, 0.125f };
+		Clock::time_point start = Clock::now();
+		std::vector<MeshLod> lods = MeshSimplifier::BuildLodChain(vertices, MeshParser::FLOATS_PER_VERTEX, triangles, ratios, 3);
+		const double buildSeconds = _secondsSince(start);
+
+		std::cout << "LOD " << p_vertexPath << " + " << p_trianglePath << " (" << vertices.size() / MeshParser::FLOATS_PER_VERTEX << " vertices), built in "
+			<< buildSeconds * 1000.0 << " ms" << std::endl;
+		for (size_t i = 0; i < lods.size(); ++i)
+		{
+			std::cout << "  level " << i << ": " << lods[i].indexCount / 3 << " triangles, error " << lods[i].error << std::endl;
+		}
+
+		// same selection as MeshGrid::Render for a 900 pixel high viewport and the default camera
+		glm::vec3 minimum(vertices[0], vertices[1], vertices[2]), maximum = minimum;
+		for (size_t i = 0; i < vertices.size(); i += MeshParser::FLOATS_PER_VERTEX)
+		{
+			minimum = glm::min(minimum, glm::vec3(vertices[i], vertices[i + 1], vertices[i + 2]));
+			maximum = glm::max(maximum, glm::vec3(vertices[i], vertices[i + 1], vertices[i + 2]));
+		}
+		const float radius = glm::length(maximum - minimum) * 0.5f;
+		const float viewportHeight = 900.0f;
+		Camera camera(glm::vec3(0.0f));
+
+		std::vector<glm::vec3> scene = _lodScene(p_noOfMeshes);
+		std::vector<size_t> meshesPerLevel(lods.size(), 0);
+		size_t fullTriangles = 0, lodTriangles = 0;
+		for (const glm::vec3& position : scene)
+		{
+			const float distance = glm::length(position - camera.Position) - radius;
+			size_t level = distance > 0.0f ? MeshSimplifier::SelectLod(lods, MeshSimplifier::PixelsPerUnit(distance, glm::radians(camera.Zoom), viewportHeight), 1.0f) : 0;
+			++meshesPerLevel[level];
+			fullTriangles += lods[0].indexCount / 3;
+			lodTriangles += lods[level].indexCount / 3;
+		}
+
+		std::cout << "Scene of " << p_noOfMeshes << " meshes: " << fullTriangles << " triangles per frame at full detail, " << lodTriangles
+			<< " with LOD (" << 100.0 * lodTriangles / fullTriangles << "%)" << std::endl;
+		for (size_t i = 0; i < lods.size(); ++i)
+		{
+			std::cout << "  level " << i << ": " << meshesPerLevel[i] << " meshes" << std::endl;
+		}
+
+		// draw timing needs a GL context, which a headless machine may not have
+		if (!glfwInit())
+		{
+			std::cout << "No GL context, draw timing skipped" << std::endl;
+			return 0;
+		}
+
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		GLFWwindow* window = glfwCreateWindow(1200, static_cast<int>(viewportHeight), "Benchmark", NULL, NULL);
+		if (!window)
+		{
+			std::cout << "No GL context, draw timing skipped" << std::endl;
+			glfwTerminate();
+			return 0;
+		}
+
+		glfwMakeContextCurrent(window);
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		{
+			std::cout << "Failed to initialize GLAD" << std::endl;
+			glfwDestroyWindow(window);
+			glfwTerminate();
+			return 1;
+		}
+
+		{
+			Shader shader("ShaderCode\\sphere.vs", "ShaderCode\\sphere.fs");
+			MeshOptions options;
+			options.generateLods = true;
+			MeshGrid mesh(p_vertexPath, p_trianglePath, "Textures\\earth.jpg", options);
+
+			shader.Use();
+			shader.SetVec3("lightColor", 1.0f, 1.0f, 1.0f);
+			shader.SetVec3("lightPos", glm::vec3(1.2f, 1.0f, 2.0f));
+			shader.SetVec3("viewPos", camera.Position);
+			const glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), 1200.0f / viewportHeight, 0.1f, 1000.0f);
+			shader.SetMat4("projection", projection);
+			shader.SetMat4("view", camera.GetViewMatrix());
+
+			glViewport(0, 0, 1200, static_cast<int>(viewportHeight));
+			glEnable(GL_DEPTH_TEST);
+			glEnable(GL_CULL_FACE);
+
+			for (int useLod = 0; useLod < 2; ++useLod)
+			{
+				mesh.SetCamera(useLod ? &camera : nullptr, projection, viewportHeight);
+
+				double triangleCount = 0.0;
+				start = Clock::now();
+				for (int frame = 0; frame < p_noOfFrames; ++frame)
+				{
+					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+					for (const glm::vec3& position : scene)
+					{
+						mesh.SetModelMatrix(glm::translate(glm::mat4(1.0f), position));
+						mesh.Render(shader);
+						triangleCount += mesh.RenderedTriangles();
+					}
+					glFinish();
+				}
+				const double seconds = _secondsSince(start);
+
+				std::cout << (useLod ? "  LOD : " : "  full: ") << seconds / p_noOfFrames * 1000.0 << " ms/frame, "
+					<< triangleCount / p_noOfFrames / 1e6 << " M triangles/frame, " << triangleCount / seconds / 1e6 << " M triangles/s" << std::endl;
+			}
+		}
+
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		return 0;
+	}
+
+	int RunMeshlet(const char* p_vertexPath, const char* p_trianglePath, int p_repeat)
+	{
+		MappedFile vertexFile(p_vertexPath);
+		MappedFile triangleFile(p_trianglePath);
+		if (!vertexFile.IsOpen() || !triangleFile.IsOpen())
+		{
+			std::cout << "Cannot open " << p_vertexPath << " or " << p_trianglePath << std::endl;
+			return 1;
+		}
+
+		std::vector<float> vertices;
+		std::vector<unsigned int> triangles;
+		MeshParser::ParseVertices(vertexFile.Data(), vertexFile.End(), vertices);
+		MeshParser::ParseTriangles(triangleFile.Data(), triangleFile.End(), triangles);
+
+		Clock::time_point start = Clock::now();
+		std::vector<Meshlet> meshlets = MeshletBuilder::Build(vertices, MeshParser::FLOATS_PER_VERTEX, triangles, 0, triangles.size());
+		const double buildSeconds = _secondsSince(start);
+
+		// unique vertices per meshlet
+		std::vector<size_t> lastMeshlet(vertices.size() / MeshParser::FLOATS_PER_VERTEX, meshlets.size());
+		size_t meshletVertices = 0;
+		for (size_t m = 0; m < meshlets.size(); ++m)
+		{
+			for (unsigned int i = meshlets[m].indexOffset; i < meshlets[m].indexOffset + meshlets[m].indexCount; ++i)
+			{
+				meshletVertices += lastMeshlet[triangles[i]] != m;
+				lastMeshlet[triangles[i]] = m;
+			}
+		}
+
+		const size_t noOfTriangles = triangles.size() / 3;
+		std::cout << "Meshlets " << p_vertexPath << " + " << p_trianglePath << ": " << meshlets.size() << " meshlets in " << buildSeconds * 1000.0
+			<< " ms, " << static_cast<double>(noOfTriangles) / meshlets.size() << " triangles and "
+			<< static_cast<double>(meshletVertices) / meshlets.size() << " vertices on average" << std::endl;
+
+		// the globe setup of main.cpp: camera 3 units from the center, 45 degree field of view
+		const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+		const int noOfViews = 8;
+		for (int view = 0; view < noOfViews; ++view)
+		{
+			const float angle = glm::two_pi<float>() * view / noOfViews;
+			const glm::vec3 cameraPosition(3.0f * std::sin(angle), view % 2 ? 1.0f : 0.0f, 3.0f * std::cos(angle));
+			const glm::mat4 viewProjection = projection * glm::lookAt(cameraPosition, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+			glm::vec4 planes[6];
+			size_t keptTriangles = 0;
+			size_t ranges = 0;
+
+			start = Clock::now();
+			for (int i = 0; i < p_repeat; ++i)
+			{
+				MeshletBuilder::ExtractFrustum(viewProjection, planes);
+				keptTriangles = 0;
+				ranges = 0;
+				unsigned int nextIndex = 0;
+				for (const Meshlet& meshlet : meshlets)
+				{
+					if (MeshletBuilder::IsVisible(meshlet, planes, cameraPosition))
+					{
+						ranges += meshlet.indexOffset != nextIndex || ranges == 0;
+						nextIndex = meshlet.indexOffset + meshlet.indexCount;
+						keptTriangles += meshlet.indexCount / 3;
+					}
+				}
+			}
+			const double seconds = _secondsSince(start) / p_repeat;
+
+			std::cout << "  view " << view << ": " << keptTriangles << " of " << noOfTriangles << " triangles (" << 100.0 * keptTriangles / noOfTriangles
+				<< "%) in " << ranges << " ranges, culled in " << seconds * 1e6 << " us" << std::endl;
+		}
+
+		return 0;
+	}
+
+	int RunCodec(const char* p_vertexPath, const char* p_trianglePath, int p_repeat)
+	{
+		MappedFile vertexFile(p_vertexPath);
+		MappedFile triangleFile(p_trianglePath);
+		if (!vertexFile.IsOpen() || !triangleFile.IsOpen())
+		{
+			std::cout << "Cannot open " << p_vertexPath << " or " << p_trianglePath << std::endl;
+			return 1;
+		}
+
+		std::vector<float> vertices;
+		std::vector<unsigned int> triangles;
+
+		Clock::time_point start = Clock::now();
+		MeshParser::ParseVertices(vertexFile.Data(), vertexFile.End(), vertices);
+		MeshParser::ParseTriangles(triangleFile.Data(), triangleFile.End(), triangles);
+		const double textSeconds = _secondsSince(start);
+
+		const size_t floatsPerVertex = MeshParser::FLOATS_PER_VERTEX;
+		const size_t stride = floatsPerVertex * sizeof(float);
+		const double textBytes = static_cast<double>(vertexFile.Size() + triangleFile.Size());
+		const double rawBytes = static_cast<double>(vertices.size() * sizeof(float) + triangles.size() * sizeof(unsigned int));
+
+		std::cout << "Codec " << p_vertexPath << " + " << p_trianglePath << " (" << vertices.size() / floatsPerVertex << " vertices, " << triangles.size() / 3 << " triangles)" << std::endl;
+		std::cout << "  text: " << textBytes / 1024.0 << " KB, parsed in " << textSeconds * 1000.0 << " ms ("
+			<< rawBytes / textSeconds / (1024.0 * 1024.0 * 1024.0) << " GB/s of output)" << std::endl;
+		std::cout << "  raw : " << rawBytes / 1024.0 << " KB" << std::endl;
+
+		int result = 0;
+		auto report = [&](const char* p_name)
+		{
+			// the vertex fetch optimization drops unreferenced vertices
+			const size_t noOfVertices = vertices.size() / floatsPerVertex;
+			std::vector<uint8_t> encodedVertices, encodedIndices;
+
+			start = Clock::now();
+			GeometryCodec::EncodeVertices(vertices.data(), noOfVertices, stride, encodedVertices);
+			GeometryCodec::EncodeIndices(triangles.data(), triangles.size(), encodedIndices);
+			const double encodeSeconds = _secondsSince(start);
+
+			std::vector<float> decodedVertices(vertices.size());
+			std::vector<unsigned int> decodedTriangles(triangles.size());
+			bool valid = true;
+
+			start = Clock::now();
+			for (int i = 0; i < p_repeat; ++i)
+			{
+				valid &= GeometryCodec::DecodeVertices(decodedVertices.data(), noOfVertices, stride, encodedVertices.data(), encodedVertices.size());
+			}
+			const double vertexSeconds = _secondsSince(start) / p_repeat;
+
+			start = Clock::now();
+			for (int i = 0; i < p_repeat; ++i)
+			{
+				valid &= GeometryCodec::DecodeIndices(decodedTriangles.data(), triangles.size(), encodedIndices.data(), encodedIndices.size());
+			}
+			const double indexSeconds = _secondsSince(start) / p_repeat;
+
+			// the copy a raw cache costs before the upload, for comparison
+			start = Clock::now();
+			for (int i = 0; i < p_repeat; ++i)
+			{
+				memcpy(decodedVertices.data(), vertices.data(), vertices.size() * sizeof(float));
+				memcpy(decodedTriangles.data(), triangles.data(), triangles.size() * sizeof(unsigned int));
+			}
+			const double copySeconds = _secondsSince(start) / p_repeat;
+
+			const double vertexBytes = static_cast<double>(vertices.size() * sizeof(float));
+			const double indexBytes = static_cast<double>(triangles.size() * sizeof(unsigned int));
+			const double gigabyte = 1024.0 * 1024.0 * 1024.0;
+			const double encodedBytes = static_cast<double>(encodedVertices.size() + encodedIndices.size());
+
+			std::cout << "  " << p_name << ": " << encodedBytes / 1024.0 << " KB (" << rawBytes / encodedBytes << "x smaller than raw, "
+				<< textBytes / encodedBytes << "x smaller than text), vertices " << 8.0 * encodedVertices.size() / noOfVertices << " bits/vertex, indices "
+				<< 8.0 * encodedIndices.size() / (triangles.size() / 3) << " bits/triangle" << std::endl;
+			std::cout << "    encode " << encodeSeconds * 1000.0 << " ms, decode vertices " << vertexBytes / vertexSeconds / gigabyte << " GB/s, indices "
+				<< indexBytes / indexSeconds / gigabyte << " GB/s, total " << (vertexSeconds + indexSeconds) * 1000.0 << " ms (memcpy "
+				<< copySeconds * 1000.0 << " ms, text parse " << textSeconds * 1000.0 << " ms)" << std::endl;
+
+			// vertices come back bit exact, triangles may be rotated
+			valid &= memcmp(decodedVertices.data(), vertices.data(), vertices.size() * sizeof(float)) == 0;
+			GeometryCodec::DecodeIndices(decodedTriangles.data(), triangles.size(), encodedIndices.data(), encodedIndices.size());
+			for (size_t i = 0; valid && i < triangles.size(); i += 3)
+			{
+				const unsigned int* a = &triangles[i];
+				const unsigned int* b = &decodedTriangles[i];
+				valid = (a[0] == b[0] && a[1] == b[1] && a[2] == b[2]) || (a[0] == b[1] && a[1] == b[2] && a[2] == b[0]) || (a[0] == b[2] && a[1] == b[0] && a[2] == b[1]);
+			}
+
+			if (!valid)
+			{
+				std::cout << "    WARNING: decoded geometry differs from the input" << std::endl;
+				result = 1;
+			}
+		};
+
+		report("input    ");
+
+		MeshOptimizer::OptimizeVertexCache(triangles, vertices.size() / floatsPerVertex);
+		MeshOptimizer::OptimizeVertexFetch(vertices, triangles, floatsPerVertex);
+		report("optimized");
+
+		return result;
+	}
+
+	int RunSurface(unsigned int p_noOfXSeg, unsigned int p_noOfYSeg, int p_repeat)
+	{
+		const size_t noOfVertices = ParametricSurface::VertexCount(p_noOfXSeg, p_noOfYSeg);
+		const size_t noOfIndices = ParametricSurface::IndexCount(p_noOfXSeg, p_noOfYSeg);
+		const double megabytes = (noOfVertices * ParametricSurface::FLOATS_PER_VERTEX * sizeof(float) + noOfIndices * sizeof(unsigned int)) / (1024.0 * 1024.0);
+
+		std::cout << "Surface " << p_noOfXSeg << "x" << p_noOfYSeg << " segments (" << noOfVertices << " vertices, " << noOfIndices / 3 << " triangles, "
+			<< megabytes << " MB), " << ThreadPool::Shared().NoOfWorkers() + 1 << " threads" << std::endl;
+
+		// the first run also allocates and first touches the buffers
+		std::vector<float> vertices;
+		std::vector<unsigned int> triangles;
+		Clock::time_point start = Clock::now();
+		ParametricSurface::Generate(ParametricSurface::Sphere(), p_noOfXSeg, p_noOfYSeg, vertices, triangles);
+		const double allocatingSeconds = _secondsSince(start);
+		const double sphereSeconds = _timeSurface(ParametricSurface::Sphere(), p_noOfXSeg, p_noOfYSeg, p_repeat, vertices, triangles);
+
+		std::vector<float> referenceVertices;
+		std::vector<unsigned int> referenceTriangles;
+		start = Clock::now();
+		_createSphereReference(p_noOfXSeg, p_noOfYSeg, referenceVertices, referenceTriangles);
+		const double referenceSeconds = _secondsSince(start);
+
+		std::cout << "  sphere, per vertex sin/cos + push_back: " << referenceSeconds * 1000.0 << " ms" << std::endl;
+		std::cout << "  sphere into new vectors               : " << allocatingSeconds * 1000.0 << " ms (" << referenceSeconds / allocatingSeconds << "x)" << std::endl;
+		std::cout << "  sphere                                : " << sphereSeconds * 1000.0 << " ms (" << referenceSeconds / sphereSeconds << "x)" << std::endl;
+
+		// the tables are computed in double, so only rounding differences are expected
+		float largestError = 0.0f;
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			largestError = std::max(largestError, std::abs(vertices[i] - referenceVertices[i]));
+		}
+		std::cout << "  largest difference to the reference: " << largestError << std::endl;
+
+		std::vector<float>().swap(referenceVertices);
+		std::vector<unsigned int>().swap(referenceTriangles);
+
+		const double ellipsoidSeconds = _timeSurface(ParametricSurface::Ellipsoid(1.0f, 0.8f, 0.6f), p_noOfXSeg, p_noOfYSeg, p_repeat, vertices, triangles);
+		std::cout << "  ellipsoid                             : " << ellipsoidSeconds * 1000.0 << " ms" << std::endl;
+		const double torusSeconds = _timeSurface(ParametricSurface::Torus(1.0f, 0.3f), p_noOfXSeg, p_noOfYSeg, p_repeat, vertices, triangles);
+		std::cout << "  torus                                 : " << torusSeconds * 1000.0 << " ms" << std::endl;
+		const double wgs84Seconds = _timeSurface(ParametricSurface::Wgs84(), p_noOfXSeg, p_noOfYSeg, p_repeat, vertices, triangles);
+		std::cout << "  WGS84                                 : " << wgs84Seconds * 1000.0 << " ms" << std::endl;
+
+		return largestError < 1e-5f ? 0 : 1;
+	}
+
+	int RunSphereError()
+	{
+		const SphereMesh::Tessellation tessellations[] = { SphereMesh::Tessellation::UvSphere, SphereMesh::Tessellation::Icosphere,
+			SphereMesh::Tessellation::NormalizedCube, SphereMesh::Tessellation::SpherifiedCube };
+		const char* names[] = { "UV sphere      ", "icosphere      ", "normalized cube", "spherified cube" };
+		const double maxErrors[] = { 1e-2, 1e-3, 1e-4, 1e-5 };
+		const double EARTH_RADIUS_KM = 6371.0;
+
+		std::cout << "Triangles needed to stay within a max distance to the unit sphere" << std::endl;
+		std::vector<float> vertices;
+		std::vector<unsigned int> triangles;
+		for (double maxError : maxErrors)
+		{
+			std::cout << "  max error " << maxError << " (" << maxError * EARTH_RADIUS_KM << " km on the earth)" << std::endl;
+			size_t uvTriangles = 0;
+			for (int i = 0; i < 4; ++i)
+			{
+				const unsigned int resolution = _resolutionForError(tessellations[i], maxError, vertices, triangles);
+				const size_t noOfTriangles = triangles.size() / 3;
+				uvTriangles = i == 0 ? noOfTriangles : uvTriangles;
+				std::cout << "    " << names[i] << ": resolution " << resolution << ", " << noOfTriangles << " triangles, "
+					<< vertices.size() / ParametricSurface::FLOATS_PER_VERTEX << " vertices, "
+					<< 100.0 * noOfTriangles / uvTriangles << "% of the UV sphere" << std::endl;
+			}
+		}
+		return 0;
+	}
+
+	int RunCompress(const char* p_imagePath, int p_repeat)
+	{
+		MappedFile file(p_imagePath);
+		if (!file.IsOpen())
+		{
+			std::cout << "Cannot open " << p_imagePath << std::endl;
+			return 1;
+		}
+
+		Clock::time_point start = Clock::now();
+		int width, height, nrChannels;
+		unsigned char* decoded = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.Data()), static_cast<int>(file.Size()), &width, &height, &nrChannels, 4);
+		const double decodeSeconds = _secondsSince(start);
+		if (!decoded)
+		{
+			std::cout << "Cannot decode " << p_imagePath << std::endl;
+			return 1;
+		}
+		std::vector<unsigned char> texels(decoded, decoded + static_cast<size_t>(width) * height * 4);
+		stbi_image_free(decoded);
+
+		const double sourceBytes = static_cast<double>(texels.size());
+		std::cout << "Compress " << p_imagePath << " (" << width << " x " << height << "), decoded in " << decodeSeconds * 1000.0 << " ms, "
+			<< width * height * 3 / (1024.0 * 1024.0) << " MB as RGB" << std::endl;
+
+		const BlockFormat formats[] = { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC7, BlockFormat::ETC2 };
+		std::vector<std::vector<unsigned char>> blocks;
+		for (BlockFormat format : formats)
+		{
+			blocks.emplace_back(BlockCompressor::CompressedSize(format, width, height));
+			start = Clock::now();
+			for (int i = 0; i < p_repeat; ++i)
+			{
+				BlockCompressor::Compress(format, texels.data(), width, height, 4, blocks.back().data());
+			}
+			_printThroughput(BlockCompressor::Name(format), _secondsSince(start), sourceBytes, p_repeat);
+			std::cout << "    " << blocks.back().size() / (1024.0 * 1024.0) << " MB" << std::endl;
+		}
+
+		// what a load with a warm cache costs instead of the image decode
+		const std::string cachePath = TextureCache::PathFor(p_imagePath) + ".bench";
+		CompressedImage image{ BlockFormat::BC7, width, height, 1, { blocks[2] } };
+		if (TextureCache::Write(cachePath.c_str(), 0, image))
+		{
+			start = Clock::now();
+			for (int i = 0; i < p_repeat; ++i)
+			{
+				TextureCache::Read(cachePath.c_str(), 0, BlockFormat::BC7, image);
+			}
+			std::cout << "  bc7 cache read: " << _secondsSince(start) / p_repeat * 1000.0 << " ms (image decode " << decodeSeconds * 1000.0 << " ms)" << std::endl;
+			std::remove(cachePath.c_str());
+		}
+
+		// quality needs a decoder, so the GL decodes the blocks
+		if (!glfwInit())
+		{
+			std::cout << "No GL context, PSNR skipped" << std::endl;
+			return 0;
+		}
+
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		GLFWwindow* window = glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+		if (!window)
+		{
+			std::cout << "No GL context, PSNR skipped" << std::endl;
+			glfwTerminate();
+			return 0;
+		}
+
+		glfwMakeContextCurrent(window);
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		{
+			std::cout << "Failed to initialize GLAD" << std::endl;
+			glfwDestroyWindow(window);
+			glfwTerminate();
+			return 1;
+		}
+
+		std::vector<unsigned char> result(texels.size());
+		for (size_t i = 0; i < blocks.size(); ++i)
+		{
+			unsigned int texture;
+			glGenTextures(1, &texture);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			while (glGetError() != GL_NO_ERROR)
+			{
+			}
+			glCompressedTexImage2D(GL_TEXTURE_2D, 0, BlockCompressor::GlFormat(formats[i]), width, height, 0, static_cast<GLsizei>(blocks[i].size()), blocks[i].data());
+			if (glGetError() != GL_NO_ERROR)
+			{
+				std::cout << "  " << BlockCompressor::Name(formats[i]) << ": not supported by the GL" << std::endl;
+				glDeleteTextures(1, &texture);
+				continue;
+			}
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+			glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, result.data());
+			glDeleteTextures(1, &texture);
+
+			// over the color channels only, the alpha of most images is opaque
+			double squaredError = 0.0;
+			for (size_t t = 0; t < texels.size(); t += 4)
+			{
+				for (size_t c = 0; c < 3; ++c)
+				{
+					const double delta = static_cast<double>(texels[t + c]) - result[t + c];
+					squaredError += delta * delta;
+				}
+			}
+			const double meanSquaredError = squaredError / (texels.size() / 4 * 3);
+			std::cout << "  " << BlockCompressor::Name(formats[i]) << ": PSNR " << 10.0 * std::log10(255.0 * 255.0 / std::max(meanSquaredError, 1e-10)) << " dB" << std::endl;
+		}
+
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		return 0;
+	}
+
+	int RunMips(const char* p_imagePath, int p_repeat)
+	{
+		int width, height, nrChannels;
+		unsigned char* decoded = stbi_load(p_imagePath, &width, &height, &nrChannels, 3);
+		if (!decoded)
+		{
+			std::cout << "Cannot decode " << p_imagePath << std::endl;
+			return 1;
+		}
+		const MipLevel source{ width, height, std::vector<unsigned char>(decoded, decoded + static_cast<size_t>(width) * height * 3) };
+		stbi_image_free(decoded);
+
+		std::cout << "Mips of " << p_imagePath << " (" << width << " x " << height << ")" << std::endl;
+
+		std::vector<MipLevel> reference;
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < p_repeat; ++i)
+		{
+			reference.assign(1, source);
+			_boxMipsReference(reference);
+		}
+		const double referenceSeconds = _secondsSince(start) / p_repeat;
+		std::cout << "  scalar 2 x 2 box: " << referenceSeconds * 1000.0 << " ms" << std::endl;
+
+		const MipFilter filters[] = { MipFilter::Box, MipFilter::Kaiser, MipFilter::Lanczos };
+		const char* names[] = { "box    ", "Kaiser ", "Lanczos" };
+		std::vector<MipLevel> levels;
+		for (int f = 0; f < 3; ++f)
+		{
+			for (bool srgb : { false, true })
+			{
+				MipOptions options;
+				options.filter = filters[f];
+				options.srgb = srgb;
+				start = Clock::now();
+				for (int i = 0; i < p_repeat; ++i)
+				{
+					levels.assign(1, source);
+					MipGenerator::Generate(levels, 3, options);
+				}
+				const double seconds = _secondsSince(start) / p_repeat;
+				std::cout << "  " << names[f] << (srgb ? ", linear light: " : ", sRGB values: ") << seconds * 1000.0 << " ms (" << referenceSeconds / seconds << "x)" << std::endl;
+			}
+		}
+
+		// the box filter on sRGB values matches the old loop up to rounding, apart from the wrap
+		// at the seam and odd sizes, which the old loop handled by repeating the last column
+		MipOptions options;
+		options.filter = MipFilter::Box;
+		options.srgb = false;
+		options.wrapX = false;
+		levels.assign(1, source);
+		MipGenerator::Generate(levels, 3, options);
+		int largestDifference = 0;
+		for (size_t i = 0; i < reference[1].texels.size(); ++i)
+		{
+			largestDifference = std::max(largestDifference, std::abs(reference[1].texels[i] - levels[1].texels[i]));
+		}
+		std::cout << "  largest difference of level 1 to the old loop: " << largestDifference << std::endl;
+		return largestDifference <= 1 ? 0 : 1;
+	}
+
+	int RunJpeg(const char* p_imagePath, int p_repeat)
+	{
+		MappedFile file(p_imagePath);
+		const unsigned char* data = reinterpret_cast<const unsigned char*>(file.Data());
+		JpegInfo info;
+		if (!file.IsOpen() || !JpegDecoder::Inspect(data, file.Size(), info))
+		{
+			std::cout << "Cannot read " << p_imagePath << " as a JPEG" << std::endl;
+			return 1;
+		}
+		std::cout << "Decode " << p_imagePath << " (" << info.width << " x " << info.height << ", " << info.components << " components, "
+			<< file.Size() / (1024.0 * 1024.0) << " MB)" << std::endl;
+		if (!info.supported)
+		{
+			std::cout << "  progressive, arithmetic coded, 12 bit or CMYK, left to stb_image" << std::endl;
+			return 1;
+		}
+
+		int width = 0, height = 0, nrChannels;
+		unsigned char* reference = nullptr;
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < p_repeat; ++i)
+		{
+			stbi_image_free(reference);
+			reference = stbi_load_from_memory(data, static_cast<int>(file.Size()), &width, &height, &nrChannels, 3);
+		}
+		const double stbSeconds = _secondsSince(start) / p_repeat;
+		if (!reference)
+		{
+			std::cout << "  stb_image cannot decode it" << std::endl;
+			return 1;
+		}
+		std::cout << "  stb_image: " << stbSeconds * 1000.0 << " ms" << std::endl;
+
+		// the file as it is, then with a restart marker every MCU row unless it has them already
+		std::vector<unsigned char> restarted;
+		const bool restart = info.restartInterval == 0 && JpegDecoder::Restart(data, file.Size(), 0, restarted);
+
+		int result = 0;
+		for (int pass = 0; pass < (restart ? 2 : 1); ++pass)
+		{
+			const unsigned char* jpeg = pass == 0 ? data : restarted.data();
+			const size_t size = pass == 0 ? file.Size() : restarted.size();
+			std::cout << (pass == 0 ? (info.restartInterval ? "  with restart markers every " + std::to_string(info.restartInterval) + " MCUs" : std::string("  without restart markers")) :
+				"  restart markers added, " + std::to_string(size - file.Size()) + " bytes more") << std::endl;
+
+			const unsigned int threadCounts[] = { 1, 2, 4, 8, 16 };
+			for (unsigned int noOfThreads : threadCounts)
+			{
+				// the calling thread works as well, so the pool gets one worker less
+				ThreadPool pool(noOfThreads - 1);
+				std::vector<unsigned char> texels;
+				int decodedWidth, decodedHeight;
+				bool decoded = true;
+				start = Clock::now();
+				for (int i = 0; i < p_repeat && decoded; ++i)
+				{
+					decoded = JpegDecoder::Decode(jpeg, size, 3, decodedWidth, decodedHeight, texels, pool);
+				}
+				const double seconds = _secondsSince(start) / p_repeat;
+				if (!decoded || decodedWidth != width || decodedHeight != height)
+				{
+					std::cout << "  JpegDecoder failed" << std::endl;
+					result = 1;
+					break;
+				}
+
+				// same IDCT and color conversion as stb_image; only its right edge of horizontally
+				// halved chroma differs, where it weighs the farther sample more
+				int largestDifference = 0;
+				size_t differing = 0;
+				for (size_t t = 0; t < texels.size(); ++t)
+				{
+					const int difference = std::abs(texels[t] - reference[t]);
+					largestDifference = std::max(largestDifference, difference);
+					differing += difference != 0;
+				}
+				std::string name = std::to_string(noOfThreads) + (noOfThreads == 1 ? " thread: " : " threads: ");
+				name.resize(12, ' ');
+				std::cout << "    " << name << seconds * 1000.0 << " ms (" << stbSeconds / seconds << "x), " << differing << " values differ, by at most "
+					<< largestDifference << std::endl;
+			}
+		}
+		stbi_image_free(reference);
+		return result;
+	}
+
+	int RunBatch(int p_noOfObjects, int p_noOfFrames)
+	{
+		if (!glfwInit())
+		{
+			std::cout << "No GL context, batch benchmark skipped" << std::endl;
+			return 0;
+		}
+
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		const float viewportHeight = 900.0f;
+		GLFWwindow* window = glfwCreateWindow(1200, static_cast<int>(viewportHeight), "Benchmark", NULL, NULL);
+		if (!window)
+		{
+			std::cout << "No GL context, batch benchmark skipped" << std::endl;
+			glfwTerminate();
+			return 0;
+		}
+
+		glfwMakeContextCurrent(window);
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		{
+			std::cout << "Failed to initialize GLAD" << std::endl;
+			glfwDestroyWindow(window);
+			glfwTerminate();
+			return 1;
+		}
+
+		{
+			// every 8th object gets a 512 x 256 image, which go into one array, the others 32 to
+			// 128 texels square ones for the atlases; each image a different flat color
+			std::vector<MipLevel> images;
+			for (int i = 0; i < p_noOfObjects; ++i)
+			{
+				const int width = i % 8 == 0 ? 512 : 32 << (i % 3);
+				const int height = i % 8 == 0 ? 256 : width;
+				const unsigned char color[3] = { static_cast<unsigned char>(i * 37), static_cast<unsigned char>(i * 101), static_cast<unsigned char>(i * 173) };
+				MipLevel image{ width, height, std::vector<unsigned char>(static_cast<size_t>(width) * height * 3) };
+				for (size_t t = 0; t < image.texels.size(); ++t)
+				{
+					image.texels[t] = color[t % 3];
+				}
+				images.push_back(std::move(image));
+			}
+
+			std::vector<unsigned int> textures(p_noOfObjects);
+			glGenTextures(p_noOfObjects, textures.data());
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			for (int i = 0; i < p_noOfObjects; ++i)
+			{
+				glBindTexture(GL_TEXTURE_2D, textures[i]);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, images[i].width, images[i].height, 0, GL_RGB, GL_UNSIGNED_BYTE, images[i].texels.data());
+				glGenerateMipmap(GL_TEXTURE_2D);
+			}
+
+			TexturePacker packer;
+			Clock::time_point start = Clock::now();
+			for (MipLevel& image : images)
+			{
+				packer.Add(std::move(image));
+			}
+			packer.Build();
+			std::cout << "Batch of " << p_noOfObjects << " spheres: packed into " << packer.Textures().size() << " arrays (" << packer.AtlasPages() << " atlas pages, "
+				<< packer.Bytes() / (1024.0 * 1024.0) << " MB) in " << _secondsSince(start) * 1000.0 << " ms" << std::endl;
+
+			MeshOptions options;
+			options.proceduralSphere = true;
+			MeshGrid mesh(16u, 8u, nullptr, options);
+			Shader shader("ShaderCode\\sphere.vs", "ShaderCode\\sphere.fs");
+			Shader packedShader("ShaderCode\\sphere.vs", "ShaderCode\\sphere_packed.fs");
+
+			Camera camera(glm::vec3(0.0f));
+			const glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), 1200.0f / viewportHeight, 0.1f, 1000.0f);
+			for (Shader* program : { &shader, &packedShader })
+			{
+				program->Use();
+				program->SetVec3("lightColor", 1.0f, 1.0f, 1.0f);
+				program->SetVec3("lightPos", glm::vec3(1.2f, 1.0f, 2.0f));
+				program->SetVec3("viewPos", camera.Position);
+				program->SetMat4("projection", projection);
+				program->SetMat4("view", camera.GetViewMatrix());
+			}
+			mesh.SetCamera(&camera, projection, viewportHeight);
+
+			glViewport(0, 0, 1200, static_cast<int>(viewportHeight));
+			glEnable(GL_DEPTH_TEST);
+			glEnable(GL_CULL_FACE);
+
+			const std::vector<glm::vec3> scene = _lodScene(p_noOfObjects);
+			MeshBatch batch;
+			const char* names[] = { "texture per object ", "packed, draw each  ", "packed, MeshBatch  " };
+			for (int method = 0; method < 3; ++method)
+			{
+				unsigned int draws = 0;
+				start = Clock::now();
+				for (int frame = 0; frame < p_noOfFrames; ++frame)
+				{
+					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+					for (int i = 0; i < p_noOfObjects; ++i)
+					{
+						const glm::mat4 model = glm::translate(glm::mat4(1.0f), scene[i]);
+						if (method == 2)
+						{
+							batch.Add(mesh, model, packer.Get(i));
+							continue;
+						}
+						if (method == 0)
+						{
+							glBindTexture(GL_TEXTURE_2D, textures[i]);
+						}
+						else
+						{
+							mesh.SetPackedTexture(packer.Get(i));
+						}
+						mesh.SetModelMatrix(model);
+						mesh.Render(method == 0 ? shader : packedShader);
+					}
+					if (method == 2)
+					{
+						batch.Render(packedShader, camera.Position);
+					}
+					draws = method == 2 ? batch.Draws() : static_cast<unsigned int>(p_noOfObjects);
+					glFinish();
+				}
+				const double seconds = _secondsSince(start);
+				std::cout << "  " << names[method] << seconds / p_noOfFrames * 1000.0 << " ms/frame, " << draws << " draws" << std::endl;
+			}
+
+			glDeleteTextures(p_noOfObjects, textures.data());
+		}
+
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		return 0;
+	}
+
+	int RunResources(const char* p_meshPath)
+	{
+		// a tetrahedron, unless a mesh was given
+		std::string meshPath = p_meshPath ? p_meshPath : "";
+		if (meshPath.empty())
+		{
+			meshPath = (std::filesystem::temp_directory_path() / "BearsEngineResources.obj").string();
+			std::ofstream obj(meshPath);
+			obj << "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 0 0 1\nf 1 3 2\nf 1 2 4\nf 1 4 3\nf 2 3 4\n";
+		}
+
+		if (!glfwInit())
+		{
+			std::cout << "No GL context, resources check skipped" << std::endl;
+			return 0;
+		}
+
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		GLFWwindow* window = glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+		if (!window)
+		{
+			std::cout << "No GL context, resources check skipped" << std::endl;
+			glfwTerminate();
+			return 0;
+		}
+
+		glfwMakeContextCurrent(window);
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		{
+			std::cout << "Failed to initialize GLAD" << std::endl;
+			glfwDestroyWindow(window);
+			glfwTerminate();
+			return 1;
+		}
+
+		int failures = 0;
+		const auto check = [&failures](bool p_passed, const char* p_what)
+		{
+			std::cout << "  " << (p_passed ? "ok    " : "FAILED") << " " << p_what << std::endl;
+			failures += p_passed ? 0 : 1;
+		};
+
+		std::cout << "Resources of " << meshPath << std::endl;
+		ResourceManager& resources = ResourceManager::Shared();
+		const size_t before = resources.Resources().size();
+		{
+			// packed texture meshes have no texture path at all
+			MeshHandle untextured = resources.Mesh(meshPath.c_str(), nullptr);
+			MeshHandle untexturedAgain = resources.Mesh(meshPath.c_str(), nullptr);
+			check(untextured && untextured == untexturedAgain, "mesh without a texture is shared");
+
+			MeshHandle textured = resources.Mesh(meshPath.c_str(), "Textures\\earth.jpg");
+			check(textured && textured != untextured, "mesh with a texture is another entry");
+			check(resources.Resources().size() == before + 3, "two meshes and one texture listed");
+		}
+		TextureLoader::Shared().Finish();
+		check(resources.Resources().size() == before, "nothing left after the last handles");
+
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		if (!p_meshPath)
+		{
+			std::error_code error;
+			std::filesystem::remove(meshPath, error);
+			std::filesystem::remove(MeshCache::PathFor(meshPath.c_str()), error);
+		}
+		return failures ? 1 : 0;
+	}
+
+	int RunCubeMap(const char* p_imagePath, int p_repeat)
+	{
+		int width, height, nrChannels;
+		unsigned char* decoded = stbi_load(p_imagePath, &width, &height, &nrChannels, 3);
+		if (!decoded)
+		{
+			std::cout << "Cannot decode " << p_imagePath << std::endl;
+			return 1;
+		}
+		const MipLevel source{ width, height, std::vector<unsigned char>(decoded, decoded + static_cast<size_t>(width) * height * 3) };
+		stbi_image_free(decoded);
+
+		const int size = CubeMap::FaceSize(width);
+		const size_t equirectTexels = static_cast<size_t>(width) * height;
+		const size_t cubeTexels = static_cast<size_t>(size) * size * CubeMap::FACES;
+		std::cout << "Cube map of " << p_imagePath << " (" << width << " x " << height << ", " << equirectTexels << " texels)" << std::endl;
+		std::cout << "  6 faces of " << size << " x " << size << ": " << cubeTexels << " texels (" << 100.0 * cubeTexels / equirectTexels << "%)" << std::endl;
+
+		MipOptions options;
+		MipLevel cube;
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < p_repeat; ++i)
+		{
+			cube = CubeMap::FromEquirect(source, 3, size, options);
+		}
+		std::cout << "  reprojection: " << _secondsSince(start) / p_repeat * 1000.0 << " ms on " << ThreadPool::Shared().NoOfWorkers() + 1 << " threads" << std::endl;
+
+		std::vector<MipLevel> levels(1, cube);
+		start = Clock::now();
+		CubeMap::GenerateMips(levels, 3, options);
+		size_t chainTexels = 0;
+		for (const MipLevel& level : levels)
+		{
+			chainTexels += static_cast<size_t>(level.width) * level.height;
+		}
+		std::cout << "  " << levels.size() << " mip levels: " << _secondsSince(start) * 1000.0 << " ms, " << chainTexels << " texels" << std::endl;
+
+		// back to the equirectangular image, bilinear inside the faces; the rows near the poles
+		// held more texels than the faces keep there, so they are reported apart
+		double squaredError = 0.0, squaredErrorAll = 0.0;
+		size_t count = 0, countAll = 0;
+		for (int y = 0; y < height; ++y)
+		{
+			const double v = (y + 0.5) / height;
+			const double theta = v * glm::pi<double>();
+			const bool temperate = std::abs(v - 0.5) < 1.0 / 3.0;
+			for (int x = 0; x < width; ++x)
+			{
+				const double phi = (1.0 - (x + 0.5) / width) * 2.0 * glm::pi<double>();
+				const glm::vec3 direction(static_cast<float>(std::sin(theta) * std::cos(phi)), static_cast<float>(std::cos(theta)), static_cast<float>(std::sin(theta) * std::sin(phi)));
+				float s, t;
+				const int face = CubeMap::FaceOf(direction, s, t);
+				const float fx = s * size - 0.5f, fy = t * size - 0.5f;
+				const int x0 = std::clamp(static_cast<int>(std::floor(fx)), 0, size - 1), y0 = std::clamp(static_cast<int>(std::floor(fy)), 0, size - 1);
+				const int x1 = std::min(x0 + 1, size - 1), y1 = std::min(y0 + 1, size - 1);
+				const float ax = std::clamp(fx - x0, 0.0f, 1.0f), ay = std::clamp(fy - y0, 0.0f, 1.0f);
+				for (int c = 0; c < 3; ++c)
+				{
+					const auto texel = [&](int p_x, int p_y) { return static_cast<float>(cube.texels[((static_cast<size_t>(face) * size + p_y) * size + p_x) * 3 + c]); };
+					const float value = (1.0f - ay) * ((1.0f - ax) * texel(x0, y0) + ax * texel(x1, y0)) + ay * ((1.0f - ax) * texel(x0, y1) + ax * texel(x1, y1));
+					const double error = value - source.texels[(static_cast<size_t>(y) * width + x) * 3 + c];
+					squaredErrorAll += error * error;
+					++countAll;
+					if (temperate)
+					{
+						squaredError += error * error;
+						++count;
+					}
+				}
+			}
+		}
+		std::cout << "  round trip PSNR: " << 10.0 * std::log10(255.0 * 255.0 / std::max(squaredError / std::max<size_t>(count, 1), 1e-10)) << " dB within 60 degrees of the equator, "
+			<< 10.0 * std::log10(255.0 * 255.0 / std::max(squaredErrorAll / countAll, 1e-10)) << " dB overall" << std::endl;
+		return 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+// Command line benchmarks, started with "BearsEngine --bench <name> [arguments]".
+// They run without creating a window and print their results to stdout.
+namespace Benchmark
+{
+	// Returns the process exit code
+	int Run(int argc, char* argv[]);
+
+	// Text mesh parse throughput: the old ifstream parser against the mapped parser
+	int RunParse(const char* p_vertexPath, const char* p_trianglePath, int p_repeat);
+
+	// Chunked parallel import scaling over 1, 2, 4, 8 and 16 threads
+	int RunImport(const char* p_vertexPath, const char* p_trianglePath, int p_repeat);
+
+	// ACMR/ATVR and overdraw of a text mesh before and after MeshOptimizer
+	int RunOptimize(const char* p_vertexPath, const char* p_trianglePath);
+
+	// LOD chain of a text mesh, then triangles per frame for a scene of many meshes with and
+	// without level selection. Draw times are measured in a hidden window when GL is available.
+	int RunLod(const char* p_vertexPath, const char* p_trianglePath, int p_noOfMeshes, int p_noOfFrames);
+
+	// Meshlet clustering of a text mesh and how many triangles survive CPU culling from views
+	// around it
+	int RunMeshlet(const char* p_vertexPath, const char* p_trianglePath, int p_repeat);
+
+	// GeometryCodec size and decode speed against the raw cache blocks and the text files, for the
+	// mesh as loaded and after MeshOptimizer
+	int RunCodec(const char* p_vertexPath, const char* p_trianglePath, int p_repeat);
+
+	// ParametricSurface generation time for every surface against the old per-vertex sphere loop
+	int RunSurface(unsigned int p_noOfXSeg, unsigned int p_noOfYSeg, int p_repeat);
+
+	// Triangles each SphereMesh tessellation needs to stay within the same max geometric error
+	int RunSphereError();
+
+	// BlockCompressor encode speed and size of an image in every format, the KTX2 cache read
+	// against decoding the image, and PSNR of what the GL decodes when a context is available
+	int RunCompress(const char* p_imagePath, int p_repeat);
+
+	// MipGenerator chain time for every filter against the old scalar 2 x 2 box loop
+	int RunMips(const char* p_imagePath, int p_repeat);
+
+	// Decode only: stb_image against JpegDecoder over 1 to 16 threads, for the file as it is and
+	// with restart markers added by JpegDecoder::Restart
+	int RunJpeg(const char* p_imagePath, int p_repeat);
+
+	// Draw time of differently textured spheres: a texture bind and draw per object, packed
+	// textures drawn one by one, and packed textures drawn instanced through MeshBatch
+	int RunBatch(int p_noOfObjects, int p_noOfFrames);
+
+	// ResourceManager sharing of a mesh with and without a texture: same key same handle, and
+	// nothing left once the handles are gone. Fails with exit code 1; writes a small OBJ to the
+	// temp directory without p_meshPath.
+	int RunResources(const char* p_meshPath);
+
+	// CubeMap reprojection of an equirectangular image: texels against the source, time, and PSNR
+	// of sampling the faces back at the texels of the source
+	int RunCubeMap(const char* p_imagePath, int p_repeat);
+}
\ No newline at end of file
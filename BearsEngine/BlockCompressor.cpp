@@ -0,0 +1,743 @@
+#include "BlockCompressor.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "ThreadPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCKCOMPRESSOR_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// GL_EXT_texture_compression_s3tc, GL_ARB_texture_compression_bptc and GL 4.3 / ES 3.0 enums
+	constexpr unsigned int GL_COMPRESSED_RGB_S3TC_DXT1 = 0x83F0;
+	constexpr unsigned int GL_COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+	constexpr unsigned int GL_COMPRESSED_RGBA_BPTC_UNORM = 0x8E8C;
+	constexpr unsigned int GL_COMPRESSED_RGB8_ETC2 = 0x9274;
+
+	// interpolation weights of 4 bit BC7 indices, out of 64
+	constexpr int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// ETC1 intensity modifiers; a pixel index adds +a, +b, -a or -b of its table
+	constexpr int ETC_MODIFIERS[8][2] = { { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 } };
+
+	// 4 x 4 texels in row-major order, one array per channel so four texels fit into a register
+	struct Block
+	{
+		alignas(16) float channel[4][16];
+	};
+
+	// RGBA color with channels from 0 to 255
+	struct Color
+	{
+		float value[4];
+	};
+
+	void _fetchBlock(const unsigned char* p_texels, int p_width, int p_height, int p_channels, int p_blockX, int p_blockY, Block& p_block)
+	{
+		for (int y = 0; y < 4; ++y)
+		{
+			const int sourceY = std::min(p_blockY * 4 + y, p_height - 1);
+			for (int x = 0; x < 4; ++x)
+			{
+				const int sourceX = std::min(p_blockX * 4 + x, p_width - 1);
+				const unsigned char* texel = p_texels + (static_cast<size_t>(sourceY) * p_width + sourceX) * p_channels;
+				p_block.channel[0][y * 4 + x] = texel[0];
+				p_block.channel[1][y * 4 + x] = texel[1];
+				p_block.channel[2][y * 4 + x] = texel[2];
+				p_block.channel[3][y * 4 + x] = p_channels == 4 ? texel[3] : 255.0f;
+			}
+		}
+	}
+
+	// Picks the nearest palette entry for every texel over the first p_channels channels and
+	// returns the summed squared error
+	float _selectIndices(const Block& p_block, int p_channels, const Color* p_palette, int p_paletteSize, uint8_t* p_indices)
+	{
+#ifdef BLOCKCOMPRESSOR_SSE2
+		float total = 0.0f;
+		for (int group = 0; group < 16; group += 4)
+		{
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int entry = 0; entry < p_paletteSize; ++entry)
+			{
+				__m128 distance = _mm_setzero_ps();
+				for (int c = 0; c < p_channels; ++c)
+				{
+					const __m128 delta = _mm_sub_ps(_mm_load_ps(p_block.channel[c] + group), _mm_set1_ps(p_palette[entry].value[c]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(delta, delta));
+				}
+				const __m128 closer = _mm_cmplt_ps(distance, best);
+				best = _mm_min_ps(distance, best);
+				const __m128i mask = _mm_castps_si128(closer);
+				bestIndex = _mm_or_si128(_mm_and_si128(mask, _mm_set1_epi32(entry)), _mm_andnot_si128(mask, bestIndex));
+			}
+
+			alignas(16) float errors[4];
+			alignas(16) int32_t indices[4];
+			_mm_store_ps(errors, best);
+			_mm_store_si128(reinterpret_cast<__m128i*>(indices), bestIndex);
+			for (int i = 0; i < 4; ++i)
+			{
+				p_indices[group + i] = static_cast<uint8_t>(indices[i]);
+				total += errors[i];
+			}
+		}
+		return total;
+#else
+		float total = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			float best = FLT_MAX;
+			for (int entry = 0; entry < p_paletteSize; ++entry)
+			{
+				float distance = 0.0f;
+				for (int c = 0; c < p_channels; ++c)
+				{
+					const float delta = p_block.channel[c][i] - p_palette[entry].value[c];
+					distance += delta * delta;
+				}
+				if (distance < best)
+				{
+					best = distance;
+					p_indices[i] = static_cast<uint8_t>(entry);
+				}
+			}
+			total += best;
+		}
+		return total;
+#endif
+	}
+
+	// Endpoints on the principal axis of the texels, spanning their projections onto it
+	void _principalEndpoints(const Block& p_block, int p_channels, Color& p_low, Color& p_high)
+	{
+		float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int c = 0; c < p_channels; ++c)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				mean[c] += p_block.channel[c][i];
+			}
+			mean[c] /= 16.0f;
+		}
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int a = 0; a < p_channels; ++a)
+			{
+				for (int b = a; b < p_channels; ++b)
+				{
+					covariance[a][b] += (p_block.channel[a][i] - mean[a]) * (p_block.channel[b][i] - mean[b]);
+				}
+			}
+		}
+		for (int a = 0; a < p_channels; ++a)
+		{
+			for (int b = 0; b < a; ++b)
+			{
+				covariance[a][b] = covariance[b][a];
+			}
+		}
+
+		// a few rounds of power iteration are plenty for a 16 texel block
+		float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			float length = 0.0f;
+			for (int a = 0; a < p_channels; ++a)
+			{
+				for (int b = 0; b < p_channels; ++b)
+				{
+					next[a] += covariance[a][b] * axis[b];
+				}
+				length = std::max(length, std::fabs(next[a]));
+			}
+			if (length < 1e-6f)
+			{
+				break;
+			}
+			for (int a = 0; a < p_channels; ++a)
+			{
+				axis[a] = next[a] / length;
+			}
+		}
+
+		float squaredLength = 0.0f;
+		for (int c = 0; c < p_channels; ++c)
+		{
+			squaredLength += axis[c] * axis[c];
+		}
+
+		float low = 0.0f;
+		float high = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			float t = 0.0f;
+			for (int c = 0; c < p_channels; ++c)
+			{
+				t += (p_block.channel[c][i] - mean[c]) * axis[c];
+			}
+			low = std::min(low, t);
+			high = std::max(high, t);
+		}
+
+		for (int c = 0; c < 4; ++c)
+		{
+			const float direction = c < p_channels ? axis[c] / squaredLength : 0.0f;
+			const float center = c < p_channels ? mean[c] : 255.0f;
+			p_low.value[c] = std::clamp(center + low * direction, 0.0f, 255.0f);
+			p_high.value[c] = std::clamp(center + high * direction, 0.0f, 255.0f);
+		}
+	}
+
+	// Least squares endpoints for fixed indices, each texel being p_weights[index] of the way
+	// from p_low to p_high. Leaves the endpoints alone if all texels use the same weight.
+	void _refineEndpoints(const Block& p_block, int p_channels, const uint8_t* p_indices, const float* p_weights, Color& p_low, Color& p_high)
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float bx[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; ++i)
+		{
+			const float b = p_weights[p_indices[i]];
+			const float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = 0; c < p_channels; ++c)
+			{
+				ax[c] += a * p_block.channel[c][i];
+				bx[c] += b * p_block.channel[c][i];
+			}
+		}
+
+		const float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-3f)
+		{
+			return;
+		}
+		for (int c = 0; c < p_channels; ++c)
+		{
+			p_low.value[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+			p_high.value[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+		}
+	}
+
+	inline int _quantize(float p_value, int p_maximum)
+	{
+		return std::clamp(static_cast<int>(p_value * p_maximum / 255.0f + 0.5f), 0, p_maximum);
+	}
+
+	inline uint16_t _to565(const Color& p_color)
+	{
+		return static_cast<uint16_t>((_quantize(p_color.value[0], 31) << 11) | (_quantize(p_color.value[1], 63) << 5) | _quantize(p_color.value[2], 31));
+	}
+
+	inline Color _from565(uint16_t p_color)
+	{
+		const int r = (p_color >> 11) & 31;
+		const int g = (p_color >> 5) & 63;
+		const int b = p_color & 31;
+		return Color{ { static_cast<float>((r << 3) | (r >> 2)), static_cast<float>((g << 2) | (g >> 4)), static_cast<float>((b << 3) | (b >> 2)), 255.0f } };
+	}
+
+	inline void _write16(unsigned char* p_out, uint16_t p_value)
+	{
+		p_out[0] = static_cast<unsigned char>(p_value);
+		p_out[1] = static_cast<unsigned char>(p_value >> 8);
+	}
+
+	// Four color BC1 block, also the color half of BC3 which ignores the endpoint order
+	void _encodeBC1(const Block& p_block, unsigned char* p_out)
+	{
+		// weight of the second endpoint for the indices 0 to 3
+		constexpr float WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+		Color first, second;
+		_principalEndpoints(p_block, 3, second, first);
+
+		float bestError = FLT_MAX;
+		uint16_t bestColors[2] = { 0, 0 };
+		uint8_t bestIndices[16] = {};
+
+		for (int iteration = 0; iteration < 2; ++iteration)
+		{
+			uint16_t color0 = _to565(first);
+			uint16_t color1 = _to565(second);
+			// the four color mode needs color0 > color1; equal endpoints decode the same in both modes
+			if (color0 < color1)
+			{
+				std::swap(color0, color1);
+			}
+
+			const Color endpoint0 = _from565(color0);
+			const Color endpoint1 = _from565(color1);
+			Color palette[4] = { endpoint0, endpoint1 };
+			for (int c = 0; c < 3; ++c)
+			{
+				palette[2].value[c] = (2.0f * endpoint0.value[c] + endpoint1.value[c]) / 3.0f;
+				palette[3].value[c] = (endpoint0.value[c] + 2.0f * endpoint1.value[c]) / 3.0f;
+			}
+
+			uint8_t indices[16];
+			const float error = _selectIndices(p_block, 3, palette, color0 == color1 ? 1 : 4, indices);
+			if (error < bestError)
+			{
+				bestError = error;
+				bestColors[0] = color0;
+				bestColors[1] = color1;
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+			if (error == 0.0f)
+			{
+				break;
+			}
+
+			first = endpoint0;
+			second = endpoint1;
+			_refineEndpoints(p_block, 3, indices, WEIGHTS, first, second);
+		}
+
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			bits |= static_cast<uint32_t>(bestIndices[i]) << (2 * i);
+		}
+		_write16(p_out, bestColors[0]);
+		_write16(p_out + 2, bestColors[1]);
+		for (int i = 0; i < 4; ++i)
+		{
+			p_out[4 + i] = static_cast<unsigned char>(bits >> (8 * i));
+		}
+	}
+
+	// BC3 alpha half in the eight value mode, alpha0 > alpha1
+	void _encodeBC3Alpha(const Block& p_block, unsigned char* p_out)
+	{
+		const float* alpha = p_block.channel[3];
+		const int high = static_cast<int>(*std::max_element(alpha, alpha + 16));
+		const int low = static_cast<int>(*std::min_element(alpha, alpha + 16));
+
+		p_out[0] = static_cast<unsigned char>(high);
+		p_out[1] = static_cast<unsigned char>(low);
+
+		uint64_t bits = 0;
+		if (high != low)
+		{
+			int palette[8] = { high, low };
+			for (int i = 1; i < 7; ++i)
+			{
+				palette[i + 1] = ((7 - i) * high + i * low + 3) / 7;
+			}
+
+			for (int i = 0; i < 16; ++i)
+			{
+				int bestIndex = 0;
+				int bestError = INT32_MAX;
+				for (int entry = 0; entry < 8; ++entry)
+				{
+					const int error = std::abs(static_cast<int>(alpha[i]) - palette[entry]);
+					if (error < bestError)
+					{
+						bestError = error;
+						bestIndex = entry;
+					}
+				}
+				bits |= static_cast<uint64_t>(bestIndex) << (3 * i);
+			}
+		}
+		for (int i = 0; i < 6; ++i)
+		{
+			p_out[2 + i] = static_cast<unsigned char>(bits >> (8 * i));
+		}
+	}
+
+	// Little endian bit stream of a 128 bit BC7 block
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(unsigned char* p_out)
+			: m_out(p_out)
+		{
+			memset(m_out, 0, 16);
+		}
+
+		void Put(uint32_t p_value, int p_bits)
+		{
+			for (int i = 0; i < p_bits; ++i, ++m_position)
+			{
+				m_out[m_position >> 3] |= static_cast<unsigned char>(((p_value >> i) & 1u) << (m_position & 7));
+			}
+		}
+
+	private:
+		unsigned char* m_out;
+		int m_position = 0;
+	};
+
+	// Quantizes an endpoint to 7 bits per channel plus the shared p-bit that fits it best
+	void _quantizeBC7Endpoint(const Color& p_color, int p_quantized[4], int& p_pBit)
+	{
+		float bestError = FLT_MAX;
+		for (int pBit = 0; pBit < 2; ++pBit)
+		{
+			int quantized[4];
+			float error = 0.0f;
+			for (int c = 0; c < 4; ++c)
+			{
+				quantized[c] = std::clamp(static_cast<int>((p_color.value[c] - pBit) / 2.0f + 0.5f), 0, 127);
+				const float delta = static_cast<float>((quantized[c] << 1) | pBit) - p_color.value[c];
+				error += delta * delta;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				p_pBit = pBit;
+				memcpy(p_quantized, quantized, sizeof(quantized));
+			}
+		}
+	}
+
+	// BC7 mode 6: one subset, RGBA endpoints of 7 bits plus a p-bit, 4 bit indices
+	void _encodeBC7(const Block& p_block, unsigned char* p_out)
+	{
+		float weights[16];
+		for (int i = 0; i < 16; ++i)
+		{
+			weights[i] = BC7_WEIGHTS[i] / 64.0f;
+		}
+
+		Color low, high;
+		_principalEndpoints(p_block, 4, low, high);
+
+		float bestError = FLT_MAX;
+		int bestEndpoints[2][4] = {};
+		int bestPBits[2] = { 0, 0 };
+		uint8_t bestIndices[16] = {};
+
+		for (int iteration = 0; iteration < 2; ++iteration)
+		{
+			int endpoints[2][4];
+			int pBits[2];
+			_quantizeBC7Endpoint(low, endpoints[0], pBits[0]);
+			_quantizeBC7Endpoint(high, endpoints[1], pBits[1]);
+
+			int expanded[2][4];
+			for (int e = 0; e < 2; ++e)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					expanded[e][c] = (endpoints[e][c] << 1) | pBits[e];
+				}
+			}
+
+			Color palette[16];
+			for (int i = 0; i < 16; ++i)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					palette[i].value[c] = static_cast<float>(((64 - BC7_WEIGHTS[i]) * expanded[0][c] + BC7_WEIGHTS[i] * expanded[1][c] + 32) >> 6);
+				}
+			}
+
+			uint8_t indices[16];
+			const float error = _selectIndices(p_block, 4, palette, 16, indices);
+			if (error < bestError)
+			{
+				bestError = error;
+				memcpy(bestEndpoints, endpoints, sizeof(endpoints));
+				memcpy(bestPBits, pBits, sizeof(pBits));
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+			if (error == 0.0f)
+			{
+				break;
+			}
+
+			for (int c = 0; c < 4; ++c)
+			{
+				low.value[c] = static_cast<float>(expanded[0][c]);
+				high.value[c] = static_cast<float>(expanded[1][c]);
+			}
+			_refineEndpoints(p_block, 4, indices, weights, low, high);
+		}
+
+		// the anchor index is stored without its top bit, so it has to be below 8
+		if (bestIndices[0] >= 8)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				std::swap(bestEndpoints[0][c], bestEndpoints[1][c]);
+			}
+			std::swap(bestPBits[0], bestPBits[1]);
+			for (int i = 0; i < 16; ++i)
+			{
+				bestIndices[i] = static_cast<uint8_t>(15 - bestIndices[i]);
+			}
+		}
+
+		BitWriter writer(p_out);
+		writer.Put(1u << 6, 7);
+		for (int c = 0; c < 4; ++c)
+		{
+			writer.Put(bestEndpoints[0][c], 7);
+			writer.Put(bestEndpoints[1][c], 7);
+		}
+		writer.Put(bestPBits[0], 1);
+		writer.Put(bestPBits[1], 1);
+		writer.Put(bestIndices[0], 3);
+		for (int i = 1; i < 16; ++i)
+		{
+			writer.Put(bestIndices[i], 4);
+		}
+	}
+
+	// Best modifier table and pixel indices for one half of an ETC1 block around p_base
+	int _encodeEtcSubblock(const Block& p_block, const int* p_texels, const int p_base[3], int& p_table, uint8_t* p_indices)
+	{
+		int bestError = INT32_MAX;
+		for (int table = 0; table < 8; ++table)
+		{
+			const int modifiers[4] = { ETC_MODIFIERS[table][0], ETC_MODIFIERS[table][1], -ETC_MODIFIERS[table][0], -ETC_MODIFIERS[table][1] };
+			int error = 0;
+			uint8_t indices[8];
+			for (int i = 0; i < 8 && error < bestError; ++i)
+			{
+				const int texel = p_texels[i];
+				int texelError = INT32_MAX;
+				for (int m = 0; m < 4; ++m)
+				{
+					int distance = 0;
+					for (int c = 0; c < 3; ++c)
+					{
+						const int delta = std::clamp(p_base[c] + modifiers[m], 0, 255) - static_cast<int>(p_block.channel[c][texel]);
+						distance += delta * delta;
+					}
+					if (distance < texelError)
+					{
+						texelError = distance;
+						indices[i] = static_cast<uint8_t>(m);
+					}
+				}
+				error += texelError;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				p_table = table;
+				memcpy(p_indices, indices, sizeof(indices));
+			}
+		}
+		return bestError;
+	}
+
+	// ETC2 RGB block restricted to the ETC1 individual and differential modes
+	void _encodeETC2(const Block& p_block, unsigned char* p_out)
+	{
+		int bestError = INT32_MAX;
+		uint64_t bestBits = 0;
+
+		for (int flip = 0; flip < 2; ++flip)
+		{
+			// texels of both halves: left and right columns, or top and bottom rows when flipped
+			int texels[2][8];
+			int counts[2] = { 0, 0 };
+			for (int i = 0; i < 16; ++i)
+			{
+				const int half = flip ? (i / 4) / 2 : (i % 4) / 2;
+				texels[half][counts[half]++] = i;
+			}
+
+			float average[2][3] = {};
+			for (int half = 0; half < 2; ++half)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					for (int i = 0; i < 8; ++i)
+					{
+						average[half][c] += p_block.channel[c][texels[half][i]];
+					}
+					average[half][c] /= 8.0f;
+				}
+			}
+
+			for (int differential = 0; differential < 2; ++differential)
+			{
+				int stored[2][3];
+				int base[2][3];
+				bool representable = true;
+				for (int half = 0; half < 2; ++half)
+				{
+					for (int c = 0; c < 3; ++c)
+					{
+						if (differential)
+						{
+							stored[half][c] = _quantize(average[half][c], 31);
+							base[half][c] = (stored[half][c] << 3) | (stored[half][c] >> 2);
+						}
+						else
+						{
+							stored[half][c] = _quantize(average[half][c], 15);
+							base[half][c] = stored[half][c] * 17;
+						}
+					}
+				}
+				if (differential)
+				{
+					for (int c = 0; c < 3; ++c)
+					{
+						const int delta = stored[1][c] - stored[0][c];
+						representable = representable && delta >= -4 && delta <= 3;
+					}
+				}
+				if (!representable)
+				{
+					continue;
+				}
+
+				int tables[2];
+				uint8_t indices[2][8];
+				const int error = _encodeEtcSubblock(p_block, texels[0], base[0], tables[0], indices[0]) + _encodeEtcSubblock(p_block, texels[1], base[1], tables[1], indices[1]);
+				if (error >= bestError)
+				{
+					continue;
+				}
+				bestError = error;
+
+				uint64_t bits = 0;
+				for (int c = 0; c < 3; ++c)
+				{
+					const int shift = 59 - 8 * c;
+					if (differential)
+					{
+						bits |= static_cast<uint64_t>(stored[0][c]) << shift;
+						bits |= static_cast<uint64_t>((stored[1][c] - stored[0][c]) & 7) << (shift - 3);
+					}
+					else
+					{
+						bits |= static_cast<uint64_t>(stored[0][c]) << (shift + 1);
+						bits |= static_cast<uint64_t>(stored[1][c]) << (shift - 3);
+					}
+				}
+				bits |= static_cast<uint64_t>(tables[0]) << 37;
+				bits |= static_cast<uint64_t>(tables[1]) << 34;
+				bits |= static_cast<uint64_t>(differential) << 33;
+				bits |= static_cast<uint64_t>(flip) << 32;
+
+				// pixel indices are stored column-major, most significant bits in the upper half
+				for (int half = 0; half < 2; ++half)
+				{
+					for (int i = 0; i < 8; ++i)
+					{
+						const int texel = texels[half][i];
+						const int position = (texel % 4) * 4 + texel / 4;
+						bits |= static_cast<uint64_t>(indices[half][i] >> 1) << (16 + position);
+						bits |= static_cast<uint64_t>(indices[half][i] & 1) << position;
+					}
+				}
+				bestBits = bits;
+			}
+		}
+
+		for (int i = 0; i < 8; ++i)
+		{
+			p_out[i] = static_cast<unsigned char>(bestBits >> (56 - 8 * i));
+		}
+	}
+}
+
+size_t BlockCompressor::BlockBytes(BlockFormat p_format)
+{
+	return p_format == BlockFormat::BC1 || p_format == BlockFormat::ETC2 ? 8 : 16;
+}
+
+size_t BlockCompressor::CompressedSize(BlockFormat p_format, int p_width, int p_height)
+{
+	return static_cast<size_t>((p_width + 3) / 4) * ((p_height + 3) / 4) * BlockBytes(p_format);
+}
+
+unsigned int BlockCompressor::GlFormat(BlockFormat p_format)
+{
+	switch (p_format)
+	{
+	case BlockFormat::BC1:
+		return GL_COMPRESSED_RGB_S3TC_DXT1;
+	case BlockFormat::BC3:
+		return GL_COMPRESSED_RGBA_S3TC_DXT5;
+	case BlockFormat::BC7:
+		return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	default:
+		return GL_COMPRESSED_RGB8_ETC2;
+	}
+}
+
+const char* BlockCompressor::Name(BlockFormat p_format)
+{
+	switch (p_format)
+	{
+	case BlockFormat::BC1:
+		return "bc1";
+	case BlockFormat::BC3:
+		return "bc3";
+	case BlockFormat::BC7:
+		return "bc7";
+	default:
+		return "etc2";
+	}
+}
+
+bool BlockCompressor::FromName(const char* p_name, BlockFormat& p_format)
+{
+	for (BlockFormat format : { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC7, BlockFormat::ETC2 })
+	{
+		if (std::strcmp(p_name, Name(format)) == 0)
+		{
+			p_format = format;
+			return true;
+		}
+	}
+	return false;
+}
+
+void BlockCompressor::Compress(BlockFormat p_format, const unsigned char* p_texels, int p_width, int p_height, int p_channels, unsigned char* p_blocks)
+{
+	const int blocksX = (p_width + 3) / 4;
+	const int blocksY = (p_height + 3) / 4;
+	const size_t blockBytes = BlockBytes(p_format);
+
+	ThreadPool::Shared().ParallelFor(blocksY, [&](size_t p_blockY)
+	{
+		Block block;
+		unsigned char* out = p_blocks + p_blockY * blocksX * blockBytes;
+		for (int blockX = 0; blockX < blocksX; ++blockX, out += blockBytes)
+		{
+			_fetchBlock(p_texels, p_width, p_height, p_channels, blockX, static_cast<int>(p_blockY), block);
+			switch (p_format)
+			{
+			case BlockFormat::BC1:
+				_encodeBC1(block, out);
+				break;
+			case BlockFormat::BC3:
+				_encodeBC3Alpha(block, out);
+				_encodeBC1(block, out + 8);
+				break;
+			case BlockFormat::BC7:
+				_encodeBC7(block, out);
+				break;
+			case BlockFormat::ETC2:
+				_encodeETC2(block, out);
+				break;
+			}
+		}
+	});
+}
\ No newline at end of file
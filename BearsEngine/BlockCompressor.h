@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+// GPU block compression formats, all of them 4 x 4 texel blocks
+enum class BlockFormat
+{
+	BC1,	// RGB in 8 bytes: two 565 endpoints, 2 bit indices
+	BC3,	// RGBA in 16 bytes: 8 bytes of interpolated alpha, then a BC1 color block
+	BC7,	// RGBA in 16 bytes; the encoder only uses mode 6 (one subset, 4 bit indices)
+	ETC2	// RGB in 8 bytes; the encoder only uses the ETC1 compatible individual and differential modes
+};
+
+namespace BlockCompressor
+{
+	size_t BlockBytes(BlockFormat p_format);
+	size_t CompressedSize(BlockFormat p_format, int p_width, int p_height);
+
+	// Internal format for glCompressedTexImage2D
+	unsigned int GlFormat(BlockFormat p_format);
+	// "bc1", "bc3", "bc7" or "etc2"
+	const char* Name(BlockFormat p_format);
+	bool FromName(const char* p_name, BlockFormat& p_format);
+
+	// Compresses p_width x p_height texels of p_channels (3 or 4) bytes into row-major blocks.
+	// Partial blocks at the right and bottom edge repeat the last column and row. Block rows
+	// spread over ThreadPool::Shared, so it can be called from a pool task as well.
+	void Compress(BlockFormat p_format, const unsigned char* p_texels, int p_width, int p_height, int p_channels, unsigned char* p_blocks);
+}
\ No newline at end of file
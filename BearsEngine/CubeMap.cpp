@@ -0,0 +1,295 @@
+#include "CubeMap.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ThreadPool.h"
+
+namespace
+{
+	// face rows reprojected by one task
+	constexpr int BAND_ROWS = 16;
+	// entries of the table from linear values in [0, 1] back to sRGB
+	constexpr int ENCODE_STEPS = 16384;
+
+	constexpr double PI = 3.14159265358979323846;
+
+	struct Tables
+	{
+		float srgbToLinear[256];
+		unsigned char linearToSrgb[ENCODE_STEPS + 1];
+	};
+
+	const Tables& _tables()
+	{
+		static const Tables tables = []()
+		{
+			Tables result;
+			for (int i = 0; i < 256; ++i)
+			{
+				const double value = i / 255.0;
+				result.srgbToLinear[i] = static_cast<float>(value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4));
+			}
+			for (int i = 0; i <= ENCODE_STEPS; ++i)
+			{
+				const double value = static_cast<double>(i) / ENCODE_STEPS;
+				const double srgb = value <= 0.0031308 ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+				result.linearToSrgb[i] = static_cast<unsigned char>(srgb * 255.0 + 0.5);
+			}
+			return result;
+		}();
+		return tables;
+	}
+
+	// atan2 to about 1e-5 radians, a thousandth of a texel across a 16384 texel row, without the
+	// cost of the library call in the inner loop of the reprojection
+	float _atan2(float p_y, float p_x)
+	{
+		const float ax = std::fabs(p_x);
+		const float ay = std::fabs(p_y);
+		const float largest = std::max(ax, ay);
+		if (largest == 0.0f)
+		{
+			return 0.0f;
+		}
+		const float a = std::min(ax, ay) / largest;
+		const float a2 = a * a;
+		float r = ((((-0.0117212f * a2 + 0.05265332f) * a2 - 0.11643287f) * a2 + 0.19354346f) * a2 - 0.33262347f) * a2 + 0.99997726f;
+		r *= a;
+		if (ay > ax)
+		{
+			r = static_cast<float>(PI / 2.0) - r;
+		}
+		if (p_x < 0.0f)
+		{
+			r = static_cast<float>(PI) - r;
+		}
+		return p_y < 0.0f ? -r : r;
+	}
+
+	// Running sums along every row of the image, as values in [0, 1] (linear light for sRGB),
+	// so the average over any span of a row takes two lookups however wide it is
+	class RowSums
+	{
+	public:
+		RowSums(const MipLevel& p_image, int p_channels, bool p_srgb)
+			: m_width(p_image.width), m_channels(p_channels), m_sums(static_cast<size_t>(p_image.width + 1) * p_image.height * p_channels)
+		{
+			const Tables& tables = _tables();
+			ThreadPool::Shared().ParallelFor(p_image.height, [this, &p_image, p_srgb, &tables](size_t p_row)
+			{
+				const unsigned char* texel = &p_image.texels[p_row * m_width * m_channels];
+				float* sums = &m_sums[p_row * (m_width + 1) * m_channels];
+				for (int c = 0; c < m_channels; ++c)
+				{
+					sums[c] = 0.0f;
+				}
+				for (int x = 0; x < m_width; ++x, texel += m_channels, sums += m_channels)
+				{
+					for (int c = 0; c < m_channels; ++c)
+					{
+						// alpha is averaged as it is
+						const float value = p_srgb && c < 3 ? tables.srgbToLinear[texel[c]] : texel[c] / 255.0f;
+						sums[m_channels + c] = sums[c] + value;
+					}
+				}
+			});
+		}
+
+		// Where a span of a row starts or ends: whole turns around the row, then the texel and how far into it
+		struct Position
+		{
+			float turns;
+			int texel;
+			float fraction;
+		};
+
+		// The span is in texels, texel i covering [i, i + 1), and wraps around the longitude seam
+		Position At(float p_x) const
+		{
+			const float turns = std::floor(p_x / m_width);
+			const float x = p_x - turns * m_width;
+			const int texel = std::min(static_cast<int>(x), m_width - 1);
+			return Position{ turns, texel, x - texel };
+		}
+
+		// Adds p_weight times the average of row p_row between p_from and p_to to p_out
+		void Accumulate(int p_row, const Position& p_from, const Position& p_to, float p_weight, float* p_out) const
+		{
+			const float* sums = &m_sums[static_cast<size_t>(p_row) * (m_width + 1) * m_channels];
+			const float* total = sums + m_width * m_channels;
+			const float* from = sums + p_from.texel * m_channels;
+			const float* to = sums + p_to.texel * m_channels;
+			const float length = (p_to.turns - p_from.turns) * m_width + (p_to.texel + p_to.fraction) - (p_from.texel + p_from.fraction);
+			const float scale = p_weight / length;
+			for (int c = 0; c < m_channels; ++c)
+			{
+				const float end = p_to.turns * total[c] + to[c] + p_to.fraction * (to[m_channels + c] - to[c]);
+				const float start = p_from.turns * total[c] + from[c] + p_from.fraction * (from[m_channels + c] - from[c]);
+				p_out[c] += (end - start) * scale;
+			}
+		}
+
+	private:
+		int m_width;
+		int m_channels;
+		std::vector<float> m_sums;
+	};
+}
+
+namespace CubeMap
+{
+	int FaceSize(int p_equirectWidth)
+	{
+		const int size = std::max(1, p_equirectWidth / 4);
+		return size >= 4 ? size & ~3 : size;
+	}
+
+	glm::vec3 Direction(int p_face, float p_s, float p_t)
+	{
+		const float sc = 2.0f * p_s - 1.0f;
+		const float tc = 2.0f * p_t - 1.0f;
+		switch (p_face)
+		{
+		case 0:
+			return glm::vec3(1.0f, -tc, -sc);
+		case 1:
+			return glm::vec3(-1.0f, -tc, sc);
+		case 2:
+			return glm::vec3(sc, 1.0f, tc);
+		case 3:
+			return glm::vec3(sc, -1.0f, -tc);
+		case 4:
+			return glm::vec3(sc, -tc, 1.0f);
+		default:
+			return glm::vec3(-sc, -tc, -1.0f);
+		}
+	}
+
+	int FaceOf(const glm::vec3& p_direction, float& p_s, float& p_t)
+	{
+		const glm::vec3 size = glm::abs(p_direction);
+		int face;
+		float sc, tc, major;
+		if (size.x >= size.y && size.x >= size.z)
+		{
+			face = p_direction.x > 0.0f ? 0 : 1;
+			sc = p_direction.x > 0.0f ? -p_direction.z : p_direction.z;
+			tc = -p_direction.y;
+			major = size.x;
+		}
+		else if (size.y >= size.z)
+		{
+			face = p_direction.y > 0.0f ? 2 : 3;
+			sc = p_direction.x;
+			tc = p_direction.y > 0.0f ? p_direction.z : -p_direction.z;
+			major = size.y;
+		}
+		else
+		{
+			face = p_direction.z > 0.0f ? 4 : 5;
+			sc = p_direction.z > 0.0f ? p_direction.x : -p_direction.x;
+			tc = -p_direction.y;
+			major = size.z;
+		}
+		p_s = 0.5f * (sc / major + 1.0f);
+		p_t = 0.5f * (tc / major + 1.0f);
+		return face;
+	}
+
+	glm::vec2 EquirectUv(const glm::vec3& p_direction)
+	{
+		// the angle from the north pole without normalizing for acos
+		const float horizontal = std::sqrt(p_direction.x * p_direction.x + p_direction.z * p_direction.z);
+		float u = 1.0f - _atan2(p_direction.z, p_direction.x) / static_cast<float>(2.0 * PI);
+		u -= std::floor(u);
+		return glm::vec2(u, _atan2(horizontal, p_direction.y) / static_cast<float>(PI));
+	}
+
+	MipLevel FromEquirect(const MipLevel& p_equirect, int p_channels, int p_faceSize, const MipOptions& p_options)
+	{
+		const RowSums rows(p_equirect, p_channels, p_options.srgb);
+		const Tables& tables = _tables();
+		const int size = p_faceSize;
+		const int width = p_equirect.width;
+		const int height = p_equirect.height;
+
+		MipLevel cube{ size, size * FACES, std::vector<unsigned char>(static_cast<size_t>(size) * size * FACES * p_channels) };
+		const int noOfBands = (size * FACES + BAND_ROWS - 1) / BAND_ROWS;
+		ThreadPool::Shared().ParallelFor(noOfBands, [&](size_t p_band)
+		{
+			const int firstRow = static_cast<int>(p_band) * BAND_ROWS;
+			const int lastRow = std::min(firstRow + BAND_ROWS, size * FACES);
+			for (int row = firstRow; row < lastRow; ++row)
+			{
+				const int face = row / size;
+				const int y = row - face * size;
+				unsigned char* out = &cube.texels[static_cast<size_t>(row) * size * p_channels];
+				for (int x = 0; x < size; ++x, out += p_channels)
+				{
+					float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+					for (int sample = 0; sample < 4; ++sample)
+					{
+						const float s = (x + 0.25f + 0.5f * (sample & 1)) / size;
+						const float t = (y + 0.25f + 0.5f * (sample >> 1)) / size;
+						const glm::vec3 direction = Direction(face, s, t);
+						const float length = glm::length(direction);
+						const glm::vec2 uv = EquirectUv(direction);
+
+						// half a texel of the face seen from the center, widened along the row
+						// by the shrinking circle of latitude
+						const float angle = 1.0f / (size * length);
+						const float latitudeSine = direction.y / length;
+						const float circle = std::sqrt(std::max(0.0f, 1.0f - latitudeSine * latitudeSine));
+						const float span = std::clamp(angle * width / static_cast<float>(2.0 * PI) / std::max(circle, 1e-6f), 1.0f, static_cast<float>(width));
+						const float center = uv.x * width;
+						const RowSums::Position from = rows.At(center - 0.5f * span);
+						const RowSums::Position to = rows.At(center + 0.5f * span);
+
+						// linear between the two rows around it
+						const float rowPosition = uv.y * height - 0.5f;
+						const int row0 = static_cast<int>(std::floor(rowPosition));
+						const float weight = rowPosition - row0;
+						rows.Accumulate(std::clamp(row0, 0, height - 1), from, to, 0.25f * (1.0f - weight), sum);
+						rows.Accumulate(std::clamp(row0 + 1, 0, height - 1), from, to, 0.25f * weight, sum);
+					}
+
+					for (int c = 0; c < p_channels; ++c)
+					{
+						const float value = std::clamp(sum[c], 0.0f, 1.0f);
+						out[c] = p_options.srgb && c < 3 ? tables.linearToSrgb[static_cast<int>(value * ENCODE_STEPS + 0.5f)] : static_cast<unsigned char>(value * 255.0f + 0.5f);
+					}
+				}
+			}
+		});
+		return cube;
+	}
+
+	void GenerateMips(std::vector<MipLevel>& p_levels, int p_channels, const MipOptions& p_options)
+	{
+		MipOptions options = p_options;
+		options.wrapX = false;
+		options.wrapY = false;
+
+		const int size = p_levels[0].width;
+		const size_t faceBytes = static_cast<size_t>(size) * size * p_channels;
+		std::vector<std::vector<MipLevel>> faces(FACES);
+		for (int face = 0; face < FACES; ++face)
+		{
+			const auto first = p_levels[0].texels.begin() + face * faceBytes;
+			faces[face].push_back(MipLevel{ size, size, std::vector<unsigned char>(first, first + faceBytes) });
+			MipGenerator::Generate(faces[face], p_channels, options);
+		}
+
+		for (size_t level = 1; level < faces[0].size(); ++level)
+		{
+			const int levelSize = faces[0][level].width;
+			MipLevel stacked{ levelSize, levelSize * FACES, {} };
+			for (int face = 0; face < FACES; ++face)
+			{
+				stacked.texels.insert(stacked.texels.end(), faces[face][level].texels.begin(), faces[face][level].texels.end());
+			}
+			p_levels.push_back(std::move(stacked));
+		}
+	}
+}
\ No newline at end of file
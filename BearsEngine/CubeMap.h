@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "MipGenerator.h"
+
+// Cube maps reprojected from equirectangular images like earth.jpg, to be sampled by direction
+// (sphere_cube.fs). A face of a quarter of the equirectangular width keeps the texel density
+// along the equator with 6 / 8 of the texels, since the poles are no longer stretched over a
+// whole row each, and filtering across the faces has no longitude seam.
+//
+// The faces are in the order of GL_TEXTURE_CUBE_MAP_POSITIVE_X + i (+X, -X, +Y, -Y, +Z, -Z),
+// with the rows the way the GL addresses them, one after another in a single MipLevel of
+// size x 6 * size texels.
+namespace CubeMap
+{
+	constexpr int FACES = 6;
+
+	// A quarter of p_equirectWidth, rounded down to a multiple of 4 for block compression
+	int FaceSize(int p_equirectWidth);
+
+	// Direction through the point p_s, p_t in [0, 1] of a face, and back the way the GL picks the face
+	glm::vec3 Direction(int p_face, float p_s, float p_t);
+	int FaceOf(const glm::vec3& p_direction, float& p_s, float& p_t);
+	// Equirectangular texture coordinates of a direction, the mapping of ParametricSurface::Sphere
+	// and SphereMesh
+	glm::vec2 EquirectUv(const glm::vec3& p_direction);
+
+	// Reprojects an 8 bit RGB or RGBA equirectangular image, in bands of rows spread over
+	// ThreadPool::Shared. Every cube texel averages 2 x 2 directions, each of them the image
+	// row around it over the longitudes it covers, so the oversampled texels towards the poles
+	// are filtered instead of skipped. RGB is averaged as linear light with p_options.srgb.
+	MipLevel FromEquirect(const MipLevel& p_equirect, int p_channels, int p_faceSize, const MipOptions& p_options);
+
+	// MipGenerator::Generate for stacked faces: every face is filtered on its own, clamped at its edges
+	void GenerateMips(std::vector<MipLevel>& p_levels, int p_channels, const MipOptions& p_options);
+}
\ No newline at end of file
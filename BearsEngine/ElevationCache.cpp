@@ -0,0 +1,349 @@
+#include "ElevationCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unordered_set>
+
+#include "ThreadPool.h"
+#include "stb_image.h"
+
+namespace
+{
+	constexpr unsigned int LAST_SAMPLE = ElevationCache::TILE_SIZE - 1;
+
+	std::string _headerPath(const std::string& p_root)
+	{
+		return p_root + "/pyramid.txt";
+	}
+
+	unsigned int _level(uint64_t p_key)
+	{
+		return static_cast<unsigned int>(p_key >> 56);
+	}
+
+	uint32_t _x(uint64_t p_key)
+	{
+		return static_cast<uint32_t>(p_key >> 28) & 0x0FFFFFFFu;
+	}
+
+	uint32_t _y(uint64_t p_key)
+	{
+		return static_cast<uint32_t>(p_key) & 0x0FFFFFFFu;
+	}
+
+	// Source heightmap sample under texture coordinates (p_u, p_v): bilinear when a sample covers
+	// less than a pixel, else the mean of the p_footprint x p_footprint pixels around it
+	float _sampleSource(const uint16_t* p_pixels, int p_width, int p_height, double p_u, double p_v, int p_footprint)
+	{
+		const double x = p_u * p_width - 0.5;
+		const double y = p_v * p_height - 0.5;
+		auto pixel = [&](int p_x, int p_y)
+		{
+			// longitude wraps, latitude stops at the poles
+			p_x = ((p_x % p_width) + p_width) % p_width;
+			p_y = std::clamp(p_y, 0, p_height - 1);
+			return static_cast<float>(p_pixels[static_cast<size_t>(p_y) * p_width + p_x]);
+		};
+
+		if (p_footprint <= 1)
+		{
+			const int x0 = static_cast<int>(std::floor(x));
+			const int y0 = static_cast<int>(std::floor(y));
+			const float fx = static_cast<float>(x - x0);
+			const float fy = static_cast<float>(y - y0);
+			const float top = pixel(x0, y0) * (1.0f - fx) + pixel(x0 + 1, y0) * fx;
+			const float bottom = pixel(x0, y0 + 1) * (1.0f - fx) + pixel(x0 + 1, y0 + 1) * fx;
+			return top * (1.0f - fy) + bottom * fy;
+		}
+
+		const int x0 = static_cast<int>(std::lround(x)) - p_footprint / 2;
+		const int y0 = static_cast<int>(std::lround(y)) - p_footprint / 2;
+		double sum = 0.0;
+		for (int j = 0; j < p_footprint; ++j)
+		{
+			for (int i = 0; i < p_footprint; ++i)
+			{
+				sum += pixel(x0 + i, y0 + j);
+			}
+		}
+		return static_cast<float>(sum / (p_footprint * p_footprint));
+	}
+}
+
+ElevationCache::ElevationCache(const char* p_root, size_t p_budgetBytes)
+	: m_root(p_root), m_budgetBytes(p_budgetBytes)
+{
+	std::ifstream header(_headerPath(m_root));
+	std::string name;
+	ElevationPyramid pyramid;
+	while (header >> name)
+	{
+		if (name == "levels")
+		{
+			header >> pyramid.levels;
+		}
+		else if (name == "minHeight")
+		{
+			header >> pyramid.minHeight;
+		}
+		else if (name == "maxHeight")
+		{
+			header >> pyramid.maxHeight;
+		}
+	}
+
+	// keys hold 28 bits per tile coordinate
+	if (pyramid.levels == 0 || pyramid.levels > 27)
+	{
+		std::cout << "Failed to open elevation pyramid " << p_root << std::endl;
+		return;
+	}
+
+	m_pyramid = pyramid;
+	m_loader = std::thread(&ElevationCache::_loaderLoop, this);
+}
+
+ElevationCache::~ElevationCache()
+{
+	if (m_loader.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_condition.notify_one();
+		m_loader.join();
+	}
+}
+
+uint64_t ElevationCache::Key(unsigned int p_level, uint32_t p_x, uint32_t p_y)
+{
+	return static_cast<uint64_t>(p_level) << 56 | static_cast<uint64_t>(p_x) << 28 | p_y;
+}
+
+std::string ElevationCache::_tilePath(uint64_t p_key) const
+{
+	return m_root + "/" + std::to_string(_level(p_key)) + "/" + std::to_string(_x(p_key)) + "_" + std::to_string(_y(p_key)) + ".r16";
+}
+
+void ElevationCache::_loaderLoop()
+{
+	for (;;)
+	{
+		Loaded tile;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_loading = UINT64_MAX;
+			m_condition.wait(lock, [this] { return m_stopping || !m_pending.empty(); });
+			if (m_stopping)
+			{
+				return;
+			}
+			tile.key = m_pending.back().key;
+			m_pending.pop_back();
+			m_loading = tile.key;
+		}
+
+		// a missing or short file is cached as an empty tile, so it is not asked for again
+		std::ifstream file(_tilePath(tile.key), std::ios::binary);
+		if (file.is_open())
+		{
+			tile.samples.resize(TILE_SIZE * TILE_SIZE);
+			if (!file.read(reinterpret_cast<char*>(tile.samples.data()), TILE_BYTES))
+			{
+				tile.samples.clear();
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_loaded.push_back(std::move(tile));
+	}
+}
+
+void ElevationCache::Request(std::vector<ElevationTileRequest>& p_requests)
+{
+	std::stable_sort(p_requests.begin(), p_requests.end(), [](const ElevationTileRequest& p_a, const ElevationTileRequest& p_b) { return p_a.priority < p_b.priority; });
+
+	// the nearest tiles that fit into the budget; asking for more would only evict the nearest again
+	const size_t capacity = std::max<size_t>(m_budgetBytes / TILE_BYTES, 1);
+	std::unordered_set<uint64_t> wanted;
+	std::vector<ElevationTileRequest> pending;
+	for (const ElevationTileRequest& request : p_requests)
+	{
+		if (!wanted.insert(request.key).second)
+		{
+			continue;
+		}
+		if (wanted.size() > capacity)
+		{
+			break;
+		}
+
+		auto found = m_tiles.find(request.key);
+		if (found != m_tiles.end())
+		{
+			m_lru.splice(m_lru.begin(), m_lru, found->second.lruPosition);
+		}
+		else
+		{
+			pending.push_back(request);
+		}
+	}
+	std::reverse(pending.begin(), pending.end());
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		pending.erase(std::remove_if(pending.begin(), pending.end(), [this](const ElevationTileRequest& p_request) { return p_request.key == m_loading; }), pending.end());
+		m_pending.swap(pending);
+	}
+	m_condition.notify_one();
+}
+
+unsigned int ElevationCache::Poll()
+{
+	std::vector<Loaded> loaded;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		loaded.swap(m_loaded);
+	}
+
+	unsigned int noOfNewTiles = 0;
+	for (Loaded& tile : loaded)
+	{
+		if (m_tiles.count(tile.key))
+		{
+			continue;
+		}
+		m_lru.push_front(tile.key);
+		m_bytes += tile.samples.size() * sizeof(uint16_t);
+		m_tiles[tile.key] = Tile{ std::move(tile.samples), m_lru.begin() };
+		++noOfNewTiles;
+	}
+
+	while (m_bytes > m_budgetBytes && !m_lru.empty())
+	{
+		auto oldest = m_tiles.find(m_lru.back());
+		m_bytes -= oldest->second.samples.size() * sizeof(uint16_t);
+		m_tiles.erase(oldest);
+		m_lru.pop_back();
+	}
+	return noOfNewTiles;
+}
+
+size_t ElevationCache::PendingTiles()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pending.size() + (m_loading != UINT64_MAX ? 1 : 0);
+}
+
+float ElevationCache::Height(double p_u, double p_v, unsigned int p_level) const
+{
+	if (!IsOpen())
+	{
+		return 0.0f;
+	}
+
+	p_u -= std::floor(p_u);
+	p_v = std::clamp(p_v, 0.0, 1.0);
+	for (int level = static_cast<int>(std::min(p_level, m_pyramid.levels - 1)); level >= 0; --level)
+	{
+		const double tileU = p_u * TilesX(level);
+		const double tileV = p_v * TilesY(level);
+		const uint32_t x = std::min(static_cast<uint32_t>(tileU), TilesX(level) - 1);
+		const uint32_t y = std::min(static_cast<uint32_t>(tileV), TilesY(level) - 1);
+
+		auto found = m_tiles.find(Key(level, x, y));
+		if (found == m_tiles.end() || found->second.samples.empty())
+		{
+			continue;
+		}
+
+		const double s = (tileU - x) * LAST_SAMPLE;
+		const double t = (tileV - y) * LAST_SAMPLE;
+		const unsigned int i = std::min(static_cast<unsigned int>(s), LAST_SAMPLE - 1);
+		const unsigned int j = std::min(static_cast<unsigned int>(t), LAST_SAMPLE - 1);
+		const float fs = static_cast<float>(s - i);
+		const float ft = static_cast<float>(t - j);
+
+		const uint16_t* row = found->second.samples.data() + j * TILE_SIZE + i;
+		const float top = row[0] * (1.0f - fs) + row[1] * fs;
+		const float bottom = row[TILE_SIZE] * (1.0f - fs) + row[TILE_SIZE + 1] * fs;
+		const float sample = top * (1.0f - ft) + bottom * ft;
+		return m_pyramid.minHeight + sample / 65535.0f * (m_pyramid.maxHeight - m_pyramid.minHeight);
+	}
+	return 0.0f;
+}
+
+bool ElevationCache::BuildPyramid(const char* p_heightmapPath, const char* p_root, unsigned int p_levels, float p_minHeight, float p_maxHeight)
+{
+	int width, height, nrChannels;
+	uint16_t* pixels = stbi_load_16(p_heightmapPath, &width, &height, &nrChannels, 1);
+	if (!pixels)
+	{
+		std::cout << "Failed to load heightmap " << p_heightmapPath << std::endl;
+		return false;
+	}
+
+	if (p_levels == 0)
+	{
+		while (p_levels < 27 && static_cast<size_t>(TilesX(p_levels)) * LAST_SAMPLE < static_cast<size_t>(width))
+		{
+			++p_levels;
+		}
+		++p_levels;
+	}
+
+	const std::string root(p_root);
+	bool written = true;
+	std::vector<uint16_t> samples;
+	for (unsigned int level = 0; level < p_levels && written; ++level)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(root + "/" + std::to_string(level), error);
+
+		const unsigned int tilesX = TilesX(level);
+		const int footprint = std::max(1, static_cast<int>(std::lround(static_cast<double>(width) / (static_cast<double>(tilesX) * LAST_SAMPLE))));
+
+		// one row of tiles at a time keeps the staging memory at a few MB on deep levels
+		samples.resize(static_cast<size_t>(tilesX) * TILE_SIZE * TILE_SIZE);
+		for (unsigned int y = 0; y < TilesY(level) && written; ++y)
+		{
+			ThreadPool::Shared().ParallelFor(tilesX, [&](size_t p_x)
+			{
+				uint16_t* tile = samples.data() + p_x * TILE_SIZE * TILE_SIZE;
+				for (unsigned int t = 0; t < TILE_SIZE; ++t)
+				{
+					const double v = (y + static_cast<double>(t) / LAST_SAMPLE) / TilesY(level);
+					for (unsigned int s = 0; s < TILE_SIZE; ++s)
+					{
+						const double u = (p_x + static_cast<double>(s) / LAST_SAMPLE) / tilesX;
+						tile[t * TILE_SIZE + s] = static_cast<uint16_t>(std::lround(_sampleSource(pixels, width, height, u, v, footprint)));
+					}
+				}
+			});
+
+			for (unsigned int x = 0; x < tilesX && written; ++x)
+			{
+				const std::string path = root + "/" + std::to_string(level) + "/" + std::to_string(x) + "_" + std::to_string(y) + ".r16";
+				std::ofstream file(path, std::ios::binary | std::ios::trunc);
+				file.write(reinterpret_cast<const char*>(samples.data() + static_cast<size_t>(x) * TILE_SIZE * TILE_SIZE), TILE_BYTES);
+				written = file.good();
+			}
+		}
+	}
+	stbi_image_free(pixels);
+
+	if (!written)
+	{
+		std::cout << "Failed to write elevation tiles to " << p_root << std::endl;
+		return false;
+	}
+
+	// written last, so a pyramid that is cut short is never opened
+	std::ofstream header(_headerPath(root), std::ios::trunc);
+	header << "levels " << p_levels << "\nminHeight " << p_minHeight << "\nmaxHeight " << p_maxHeight << "\n";
+	return header.good();
+}
\ No newline at end of file
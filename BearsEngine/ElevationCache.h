@@ -0,0 +1,114 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Header of a tile pyramid, stored as text in <root>/pyramid.txt
+struct ElevationPyramid
+{
+	unsigned int levels = 0;
+	// heights in meters of the samples 0 and 65535
+	float minHeight = 0.0f;
+	float maxHeight = 0.0f;
+};
+
+// Tile wanted by the renderer; lower priorities are loaded first
+struct ElevationTileRequest
+{
+	uint64_t key;
+	float priority;
+};
+
+// Height pyramid over the equirectangular texture space of the earth texture. Level z has
+// 2^(z + 1) x 2^z tiles of TILE_SIZE x TILE_SIZE unsigned 16 bit samples, stored raw in
+// <root>/<z>/<x>_<y>.r16. The samples of a tile include both of its edges, so neighbouring
+// tiles share their border samples and bilinear filtering never needs a second tile.
+//
+// Tiles are read by one background thread in order of priority and kept in an LRU cache of at
+// most the budget in bytes. Request, Poll and the destructor belong to the render thread;
+// Height and IsResident may be called from any thread as long as neither of the first two runs.
+class ElevationCache
+{
+public:
+	static constexpr unsigned int TILE_SIZE = 256;
+	static constexpr size_t TILE_BYTES = TILE_SIZE * TILE_SIZE * sizeof(uint16_t);
+
+	// Reads the pyramid header and starts the loading thread
+	ElevationCache(const char* p_root, size_t p_budgetBytes);
+	~ElevationCache();
+
+	ElevationCache(const ElevationCache&) = delete;
+	ElevationCache& operator=(const ElevationCache&) = delete;
+
+	bool IsOpen() const { return m_pyramid.levels != 0; }
+	const ElevationPyramid& Pyramid() const { return m_pyramid; }
+
+	static uint64_t Key(unsigned int p_level, uint32_t p_x, uint32_t p_y);
+	static unsigned int TilesX(unsigned int p_level) { return 2u << p_level; }
+	static unsigned int TilesY(unsigned int p_level) { return 1u << p_level; }
+
+	// Replaces the tiles wanted from disk. Requests missing from the list are cancelled unless
+	// their tile is being read already, and resident tiles in it count as used for the LRU.
+	// Only as many tiles as fit into the budget are kept, in order of priority.
+	void Request(std::vector<ElevationTileRequest>& p_requests);
+	// Moves finished tiles into the cache and evicts the least recently used ones above the
+	// budget. Returns the number of new tiles.
+	unsigned int Poll();
+
+	// Height in meters at texture coordinates (p_u, p_v), bilinear on the deepest resident
+	// level up to p_level; 0 without any resident tile
+	float Height(double p_u, double p_v, unsigned int p_level) const;
+	// Whether the tile is in the cache; a tile missing from the pyramid counts as resident
+	bool IsResident(uint64_t p_key) const { return m_tiles.count(p_key) != 0; }
+
+	size_t ResidentTiles() const { return m_tiles.size(); }
+	size_t ResidentBytes() const { return m_bytes; }
+	size_t PendingTiles();
+
+	// Cuts a 16 bit grayscale equirectangular heightmap (any format stb_image reads) into a
+	// pyramid under p_root. p_levels 0 picks the level where a sample is about a source pixel.
+	// Coarser levels average the source pixels under each sample.
+	static bool BuildPyramid(const char* p_heightmapPath, const char* p_root, unsigned int p_levels, float p_minHeight, float p_maxHeight);
+
+private:
+	struct Tile
+	{
+		// empty if the tile is not part of the pyramid
+		std::vector<uint16_t> samples;
+		std::list<uint64_t>::iterator lruPosition;
+	};
+
+	struct Loaded
+	{
+		uint64_t key;
+		std::vector<uint16_t> samples;
+	};
+
+	void _loaderLoop();
+	std::string _tilePath(uint64_t p_key) const;
+
+	std::string m_root;
+	ElevationPyramid m_pyramid;
+	size_t m_budgetBytes;
+
+	// render thread only
+	std::unordered_map<uint64_t, Tile> m_tiles;
+	std::list<uint64_t> m_lru;
+	size_t m_bytes = 0;
+
+	// shared with the loader; m_pending is sorted by descending priority and read from the back
+	std::thread m_loader;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::vector<ElevationTileRequest> m_pending;
+	std::vector<Loaded> m_loaded;
+	uint64_t m_loading = UINT64_MAX;
+	bool m_stopping = false;
+};
\ No newline at end of file
@@ -0,0 +1,591 @@
+#include "GeometryCodec.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GEOMETRYCODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// vertices per block; every channel of a block is coded separately
+	constexpr size_t BLOCK_VERTICES = 256;
+	constexpr size_t GROUP_SIZE = 16;
+
+	// the 2 bit group header selects 0, 2, 4 or 8 bits per byte
+	constexpr size_t GROUP_BYTES[4] = { 0, 4, 8, 16 };
+
+	// edge and vertex FIFOs of the index codec; a code byte addresses 15 edges and 14 vertices
+	constexpr size_t FIFO_SIZE = 16;
+	constexpr unsigned int EDGE_MISS = 15;
+	constexpr unsigned int VERTEX_NEXT = 0;
+	constexpr unsigned int VERTEX_EXPLICIT = 15;
+
+	constexpr unsigned int INVALID = 0xFFFFFFFFu;
+
+	inline uint32_t _zigzag(uint32_t p_value)
+	{
+		return (p_value << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(p_value) >> 31);
+	}
+
+	inline uint32_t _unzigzag(uint32_t p_value)
+	{
+		return (p_value >> 1) ^ (0u - (p_value & 1u));
+	}
+
+	void _packGroup(const uint8_t* p_values, unsigned int p_code, std::vector<uint8_t>& p_encoded)
+	{
+		switch (p_code)
+		{
+		case 1:
+			for (size_t k = 0; k < 4; ++k)
+			{
+				p_encoded.push_back(static_cast<uint8_t>(p_values[4 * k] << 6 | p_values[4 * k + 1] << 4 | p_values[4 * k + 2] << 2 | p_values[4 * k + 3]));
+			}
+			break;
+		case 2:
+			for (size_t k = 0; k < 8; ++k)
+			{
+				p_encoded.push_back(static_cast<uint8_t>(p_values[2 * k] << 4 | p_values[2 * k + 1]));
+			}
+			break;
+		case 3:
+			p_encoded.insert(p_encoded.end(), p_values, p_values + GROUP_SIZE);
+			break;
+		default:
+			break;
+		}
+	}
+
+#ifdef GEOMETRYCODEC_SSE2
+	// byte k of the low 4 bytes holds the values 4k..4k+3 from the top bits down
+	inline __m128i _unpack2(__m128i p_bytes)
+	{
+		const __m128i mask = _mm_set1_epi8(3);
+		__m128i v0 = _mm_and_si128(_mm_srli_epi16(p_bytes, 6), mask);
+		__m128i v1 = _mm_and_si128(_mm_srli_epi16(p_bytes, 4), mask);
+		__m128i v2 = _mm_and_si128(_mm_srli_epi16(p_bytes, 2), mask);
+		__m128i v3 = _mm_and_si128(p_bytes, mask);
+		return _mm_unpacklo_epi16(_mm_unpacklo_epi8(v0, v1), _mm_unpacklo_epi8(v2, v3));
+	}
+
+	// byte k of the low 8 bytes holds the values 2k (high nibble) and 2k+1
+	inline __m128i _unpack4(__m128i p_bytes)
+	{
+		const __m128i mask = _mm_set1_epi8(15);
+		return _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(p_bytes, 4), mask), _mm_and_si128(p_bytes, mask));
+	}
+#endif
+
+	// Unpacks the groups of one byte plane into p_plane; returns nullptr on truncated data
+	const uint8_t* _decodePlane(const uint8_t* p_cursor, const uint8_t* p_end, size_t p_noOfGroups, uint8_t* p_plane)
+	{
+		const uint8_t* header = p_cursor;
+		p_cursor += (p_noOfGroups + 3) / 4;
+		if (p_cursor > p_end)
+		{
+			return nullptr;
+		}
+
+		for (size_t group = 0; group < p_noOfGroups; ++group)
+		{
+			const unsigned int code = (header[group / 4] >> (6 - 2 * (group % 4))) & 3;
+			if (static_cast<size_t>(p_end - p_cursor) < GROUP_BYTES[code])
+			{
+				return nullptr;
+			}
+
+			uint8_t* out = p_plane + group * GROUP_SIZE;
+
+#ifdef GEOMETRYCODEC_SSE2
+			__m128i values;
+			switch (code)
+			{
+			case 0:
+				values = _mm_setzero_si128();
+				break;
+			case 1:
+			{
+				int packed;
+				memcpy(&packed, p_cursor, sizeof(packed));
+				values = _unpack2(_mm_cvtsi32_si128(packed));
+				break;
+			}
+			case 2:
+				values = _unpack4(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p_cursor)));
+				break;
+			default:
+				values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_cursor));
+				break;
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out), values);
+#else
+			switch (code)
+			{
+			case 0:
+				memset(out, 0, GROUP_SIZE);
+				break;
+			case 1:
+				for (size_t i = 0; i < GROUP_SIZE; ++i)
+				{
+					out[i] = (p_cursor[i / 4] >> (6 - 2 * (i % 4))) & 3;
+				}
+				break;
+			case 2:
+				for (size_t i = 0; i < GROUP_SIZE; ++i)
+				{
+					out[i] = (p_cursor[i / 2] >> (i % 2 ? 0 : 4)) & 15;
+				}
+				break;
+			default:
+				memcpy(out, p_cursor, GROUP_SIZE);
+				break;
+			}
+#endif
+			p_cursor += GROUP_BYTES[code];
+		}
+
+		return p_cursor;
+	}
+
+	// Joins the four byte planes of one channel and undoes zigzag and delta coding. Writes whole
+	// groups, the padding of the last group repeats the last value.
+	void _decodeChannel(const uint8_t (*p_planes)[BLOCK_VERTICES], size_t p_noOfGroups, uint32_t& p_previous, uint32_t* p_values)
+	{
+#ifdef GEOMETRYCODEC_SSE2
+		__m128i carry = _mm_set1_epi32(static_cast<int>(p_previous));
+		const __m128i one = _mm_set1_epi32(1);
+
+		for (size_t first = 0; first < p_noOfGroups * GROUP_SIZE; first += GROUP_SIZE)
+		{
+			__m128i p0 = _mm_load_si128(reinterpret_cast<const __m128i*>(p_planes[0] + first));
+			__m128i p1 = _mm_load_si128(reinterpret_cast<const __m128i*>(p_planes[1] + first));
+			__m128i p2 = _mm_load_si128(reinterpret_cast<const __m128i*>(p_planes[2] + first));
+			__m128i p3 = _mm_load_si128(reinterpret_cast<const __m128i*>(p_planes[3] + first));
+
+			// transpose the byte planes into 32 bit values, four vertices per register
+			__m128i low01 = _mm_unpacklo_epi8(p0, p1);
+			__m128i high01 = _mm_unpackhi_epi8(p0, p1);
+			__m128i low23 = _mm_unpacklo_epi8(p2, p3);
+			__m128i high23 = _mm_unpackhi_epi8(p2, p3);
+			__m128i words[4] = { _mm_unpacklo_epi16(low01, low23), _mm_unpackhi_epi16(low01, low23), _mm_unpacklo_epi16(high01, high23), _mm_unpackhi_epi16(high01, high23) };
+
+			for (int i = 0; i < 4; ++i)
+			{
+				__m128i delta = _mm_xor_si128(_mm_srli_epi32(words[i], 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(words[i], one)));
+
+				// prefix sum of the deltas plus the last value of the previous four
+				delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 4));
+				delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 8));
+				carry = _mm_add_epi32(delta, carry);
+				_mm_store_si128(reinterpret_cast<__m128i*>(p_values + first + i * 4), carry);
+				carry = _mm_shuffle_epi32(carry, 0xFF);
+			}
+		}
+
+		p_previous = static_cast<uint32_t>(_mm_cvtsi128_si32(carry));
+#else
+		for (size_t i = 0; i < p_noOfGroups * GROUP_SIZE; ++i)
+		{
+			uint32_t zigzag = p_planes[0][i] | p_planes[1][i] << 8 | p_planes[2][i] << 16 | static_cast<uint32_t>(p_planes[3][i]) << 24;
+			p_previous += _unzigzag(zigzag);
+			p_values[i] = p_previous;
+		}
+#endif
+	}
+
+	// Interleaves the decoded channels (BLOCK_VERTICES values each) into vertices
+	void _interleave(const uint32_t* p_values, size_t p_noOfChannels, size_t p_noOfVertices, uint8_t* p_destination, size_t p_stride)
+	{
+		size_t channel = 0;
+
+#ifdef GEOMETRYCODEC_SSE2
+		// four channels of four vertices at a time, transposed so every vertex gets one 16 byte store
+		for (; channel + 4 <= p_noOfChannels; channel += 4)
+		{
+			const uint32_t* values = p_values + channel * BLOCK_VERTICES;
+			uint8_t* destination = p_destination + channel * sizeof(uint32_t);
+
+			for (size_t first = 0; first < p_noOfVertices; first += 4)
+			{
+				__m128i c0 = _mm_load_si128(reinterpret_cast<const __m128i*>(values + first));
+				__m128i c1 = _mm_load_si128(reinterpret_cast<const __m128i*>(values + BLOCK_VERTICES + first));
+				__m128i c2 = _mm_load_si128(reinterpret_cast<const __m128i*>(values + 2 * BLOCK_VERTICES + first));
+				__m128i c3 = _mm_load_si128(reinterpret_cast<const __m128i*>(values + 3 * BLOCK_VERTICES + first));
+
+				__m128i low01 = _mm_unpacklo_epi32(c0, c1);
+				__m128i high01 = _mm_unpackhi_epi32(c0, c1);
+				__m128i low23 = _mm_unpacklo_epi32(c2, c3);
+				__m128i high23 = _mm_unpackhi_epi32(c2, c3);
+				__m128i vertices[4] = { _mm_unpacklo_epi64(low01, low23), _mm_unpackhi_epi64(low01, low23), _mm_unpacklo_epi64(high01, high23), _mm_unpackhi_epi64(high01, high23) };
+
+				const size_t count = p_noOfVertices - first < 4 ? p_noOfVertices - first : 4;
+				for (size_t i = 0; i < count; ++i)
+				{
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + (first + i) * p_stride), vertices[i]);
+				}
+			}
+		}
+#endif
+
+		for (; channel < p_noOfChannels; ++channel)
+		{
+			for (size_t i = 0; i < p_noOfVertices; ++i)
+			{
+				memcpy(p_destination + i * p_stride + channel * sizeof(uint32_t), p_values + channel * BLOCK_VERTICES + i, sizeof(uint32_t));
+			}
+		}
+	}
+
+	// Recently used edges and vertices, shared by the index encoder and decoder
+	struct IndexFifo
+	{
+		unsigned int edges[FIFO_SIZE][2];
+		unsigned int vertices[FIFO_SIZE];
+		size_t edgeHead = 0;
+		size_t vertexHead = 0;
+		unsigned int next = 0;
+
+		IndexFifo()
+		{
+			memset(edges, 0xFF, sizeof(edges));
+			memset(vertices, 0xFF, sizeof(vertices));
+		}
+
+		int FindEdge(unsigned int p_a, unsigned int p_b) const
+		{
+			for (unsigned int i = 0; i < EDGE_MISS; ++i)
+			{
+				const unsigned int* edge = edges[(edgeHead - 1 - i) & (FIFO_SIZE - 1)];
+				if (edge[0] == p_a && edge[1] == p_b)
+				{
+					return static_cast<int>(i);
+				}
+			}
+			return -1;
+		}
+
+		int FindVertex(unsigned int p_vertex) const
+		{
+			for (unsigned int i = 0; i < VERTEX_EXPLICIT - 1; ++i)
+			{
+				if (vertices[(vertexHead - 1 - i) & (FIFO_SIZE - 1)] == p_vertex)
+				{
+					return static_cast<int>(i);
+				}
+			}
+			return -1;
+		}
+
+		unsigned int Edge(unsigned int p_index, int p_end) const
+		{
+			return edges[(edgeHead - 1 - p_index) & (FIFO_SIZE - 1)][p_end];
+		}
+
+		unsigned int Vertex(unsigned int p_index) const
+		{
+			return vertices[(vertexHead - 1 - p_index) & (FIFO_SIZE - 1)];
+		}
+
+		void PushEdge(unsigned int p_a, unsigned int p_b)
+		{
+			unsigned int* edge = edges[edgeHead++ & (FIFO_SIZE - 1)];
+			edge[0] = p_a;
+			edge[1] = p_b;
+		}
+
+		void PushVertex(unsigned int p_vertex)
+		{
+			vertices[vertexHead++ & (FIFO_SIZE - 1)] = p_vertex;
+		}
+	};
+
+	void _writeVarint(uint32_t p_value, std::vector<uint8_t>& p_encoded)
+	{
+		while (p_value >= 0x80)
+		{
+			p_encoded.push_back(static_cast<uint8_t>(p_value | 0x80));
+			p_value >>= 7;
+		}
+		p_encoded.push_back(static_cast<uint8_t>(p_value));
+	}
+
+	inline bool _readVarint(const uint8_t*& p_cursor, const uint8_t* p_end, uint32_t& p_value)
+	{
+		p_value = 0;
+		for (int shift = 0; shift < 35; shift += 7)
+		{
+			if (p_cursor == p_end)
+			{
+				return false;
+			}
+			uint8_t byte = *p_cursor++;
+			p_value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+namespace GeometryCodec
+{
+	void EncodeVertices(const void* p_vertices, size_t p_noOfVertices, size_t p_stride, std::vector<uint8_t>& p_encoded)
+	{
+		const uint8_t* vertices = static_cast<const uint8_t*>(p_vertices);
+		const size_t noOfChannels = p_stride / sizeof(uint32_t);
+		std::vector<uint32_t> previous(noOfChannels, 0);
+		uint32_t zigzag[BLOCK_VERTICES];
+		uint8_t plane[BLOCK_VERTICES];
+
+		p_encoded.clear();
+
+		for (size_t blockStart = 0; blockStart < p_noOfVertices; blockStart += BLOCK_VERTICES)
+		{
+			const size_t noOfVertices = p_noOfVertices - blockStart < BLOCK_VERTICES ? p_noOfVertices - blockStart : BLOCK_VERTICES;
+			const size_t noOfGroups = (noOfVertices + GROUP_SIZE - 1) / GROUP_SIZE;
+
+			for (size_t channel = 0; channel < noOfChannels; ++channel)
+			{
+				for (size_t i = 0; i < noOfGroups * GROUP_SIZE; ++i)
+				{
+					// the padding of the last group repeats the last value, so its delta is 0
+					uint32_t value = previous[channel];
+					if (i < noOfVertices)
+					{
+						memcpy(&value, vertices + (blockStart + i) * p_stride + channel * sizeof(uint32_t), sizeof(uint32_t));
+					}
+					zigzag[i] = _zigzag(value - previous[channel]);
+					previous[channel] = value;
+				}
+
+				for (int shift = 0; shift < 32; shift += 8)
+				{
+					for (size_t i = 0; i < noOfGroups * GROUP_SIZE; ++i)
+					{
+						plane[i] = static_cast<uint8_t>(zigzag[i] >> shift);
+					}
+
+					const size_t header = p_encoded.size();
+					p_encoded.resize(header + (noOfGroups + 3) / 4, 0);
+
+					for (size_t group = 0; group < noOfGroups; ++group)
+					{
+						uint8_t bits = 0;
+						for (size_t i = 0; i < GROUP_SIZE; ++i)
+						{
+							bits |= plane[group * GROUP_SIZE + i];
+						}
+
+						const unsigned int code = bits == 0 ? 0 : (bits < 4 ? 1 : (bits < 16 ? 2 : 3));
+						p_encoded[header + group / 4] |= static_cast<uint8_t>(code << (6 - 2 * (group % 4)));
+						_packGroup(plane + group * GROUP_SIZE, code, p_encoded);
+					}
+				}
+			}
+		}
+	}
+
+	bool DecodeVertices(void* p_destination, size_t p_noOfVertices, size_t p_stride, const uint8_t* p_encoded, size_t p_size)
+	{
+		uint8_t* destination = static_cast<uint8_t*>(p_destination);
+		const size_t noOfChannels = p_stride / sizeof(uint32_t);
+		std::vector<uint32_t> previous(noOfChannels, 0);
+		alignas(16) uint8_t planes[4][BLOCK_VERTICES];
+
+		// one block of decoded values per channel, 16 byte aligned for the SSE2 loads
+		std::vector<uint32_t> storage(noOfChannels * BLOCK_VERTICES + 4);
+		uint32_t* values = storage.data() + ((16 - reinterpret_cast<uintptr_t>(storage.data()) % 16) % 16) / sizeof(uint32_t);
+
+		const uint8_t* cursor = p_encoded;
+		const uint8_t* end = p_encoded + p_size;
+
+		for (size_t blockStart = 0; blockStart < p_noOfVertices; blockStart += BLOCK_VERTICES)
+		{
+			const size_t noOfVertices = p_noOfVertices - blockStart < BLOCK_VERTICES ? p_noOfVertices - blockStart : BLOCK_VERTICES;
+			const size_t noOfGroups = (noOfVertices + GROUP_SIZE - 1) / GROUP_SIZE;
+
+			for (size_t channel = 0; channel < noOfChannels; ++channel)
+			{
+				for (int plane = 0; plane < 4 && cursor; ++plane)
+				{
+					cursor = _decodePlane(cursor, end, noOfGroups, planes[plane]);
+				}
+				if (!cursor)
+				{
+					return false;
+				}
+
+				_decodeChannel(planes, noOfGroups, previous[channel], values + channel * BLOCK_VERTICES);
+			}
+
+			_interleave(values, noOfChannels, noOfVertices, destination + blockStart * p_stride, p_stride);
+		}
+
+		return cursor == end;
+	}
+
+	void EncodeIndices(const unsigned int* p_indices, size_t p_noOfIndices, std::vector<uint8_t>& p_encoded)
+	{
+		const size_t noOfTriangles = p_noOfIndices / 3;
+		IndexFifo fifo;
+		std::vector<uint8_t> data;
+
+		// one code byte per triangle, followed by the varints of vertices that missed the FIFOs
+		p_encoded.assign(noOfTriangles, 0);
+
+		for (size_t t = 0; t < noOfTriangles; ++t)
+		{
+			const unsigned int* triangle = p_indices + t * 3;
+
+			// any rotation keeps the winding, pick one whose first edge is in the FIFO
+			int edge = -1;
+			unsigned int a = 0, b = 0, c = 0;
+			for (int rotation = 0; rotation < 3 && edge < 0; ++rotation)
+			{
+				a = triangle[rotation];
+				b = triangle[(rotation + 1) % 3];
+				c = triangle[(rotation + 2) % 3];
+				edge = fifo.FindEdge(a, b);
+			}
+
+			if (edge >= 0)
+			{
+				unsigned int vertexCode;
+				int vertex = fifo.FindVertex(c);
+				if (c == fifo.next)
+				{
+					vertexCode = VERTEX_NEXT;
+					++fifo.next;
+				}
+				else if (vertex >= 0)
+				{
+					vertexCode = 1 + static_cast<unsigned int>(vertex);
+				}
+				else
+				{
+					vertexCode = VERTEX_EXPLICIT;
+					_writeVarint(_zigzag(c - fifo.next), data);
+				}
+
+				p_encoded[t] = static_cast<uint8_t>(edge << 4 | vertexCode);
+
+				// the neighbours across the two new edges see them reversed
+				fifo.PushEdge(c, b);
+				fifo.PushEdge(a, c);
+				fifo.PushVertex(c);
+			}
+			else
+			{
+				a = triangle[0];
+				b = triangle[1];
+				c = triangle[2];
+				p_encoded[t] = static_cast<uint8_t>(EDGE_MISS << 4);
+
+				const unsigned int corners[3] = { a, b, c };
+				for (unsigned int corner : corners)
+				{
+					_writeVarint(_zigzag(corner - fifo.next), data);
+					fifo.next += corner == fifo.next;
+				}
+
+				fifo.PushEdge(b, a);
+				fifo.PushEdge(c, b);
+				fifo.PushEdge(a, c);
+				fifo.PushVertex(a);
+				fifo.PushVertex(b);
+				fifo.PushVertex(c);
+			}
+		}
+
+		p_encoded.insert(p_encoded.end(), data.begin(), data.end());
+	}
+
+	bool DecodeIndices(unsigned int* p_destination, size_t p_noOfIndices, const uint8_t* p_encoded, size_t p_size)
+	{
+		const size_t noOfTriangles = p_noOfIndices / 3;
+		if (p_size < noOfTriangles)
+		{
+			return false;
+		}
+
+		IndexFifo fifo;
+		const uint8_t* codes = p_encoded;
+		const uint8_t* cursor = p_encoded + noOfTriangles;
+		const uint8_t* end = p_encoded + p_size;
+
+		for (size_t t = 0; t < noOfTriangles; ++t)
+		{
+			const unsigned int edge = codes[t] >> 4;
+			const unsigned int vertexCode = codes[t] & 15;
+			unsigned int a, b, c;
+
+			if (edge != EDGE_MISS)
+			{
+				a = fifo.Edge(edge, 0);
+				b = fifo.Edge(edge, 1);
+
+				if (vertexCode == VERTEX_NEXT)
+				{
+					c = fifo.next++;
+				}
+				else if (vertexCode != VERTEX_EXPLICIT)
+				{
+					c = fifo.Vertex(vertexCode - 1);
+				}
+				else
+				{
+					uint32_t value;
+					if (!_readVarint(cursor, end, value))
+					{
+						return false;
+					}
+					c = fifo.next + _unzigzag(value);
+				}
+
+				fifo.PushEdge(c, b);
+				fifo.PushEdge(a, c);
+				fifo.PushVertex(c);
+			}
+			else
+			{
+				unsigned int corners[3];
+				for (unsigned int& corner : corners)
+				{
+					uint32_t value;
+					if (!_readVarint(cursor, end, value))
+					{
+						return false;
+					}
+					corner = fifo.next + _unzigzag(value);
+					fifo.next += corner == fifo.next;
+				}
+				a = corners[0];
+				b = corners[1];
+				c = corners[2];
+
+				fifo.PushEdge(b, a);
+				fifo.PushEdge(c, b);
+				fifo.PushEdge(a, c);
+				fifo.PushVertex(a);
+				fifo.PushVertex(b);
+				fifo.PushVertex(c);
+			}
+
+			// an edge or vertex code pointing at an empty FIFO slot means corrupt data
+			if (a == INVALID || b == INVALID || c == INVALID)
+			{
+				return false;
+			}
+
+			p_destination[t * 3] = a;
+			p_destination[t * 3 + 1] = b;
+			p_destination[t * 3 + 2] = c;
+		}
+
+		return cursor == end;
+	}
+}
\ No newline at end of file
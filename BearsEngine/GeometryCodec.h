@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Lossless compression of vertex and index buffers for the .bmesh cache.
+//
+// Vertices are treated as 32 bit channels. Every channel is delta coded against the previous
+// vertex, zigzag mapped so small negative deltas stay small, and split into byte planes. Each
+// plane is stored in groups of 16 bytes packed with 0, 2, 4 or 8 bits per byte, which makes
+// runs of similar vertices cheap and can be unpacked 16 bytes at a time with SSE2.
+//
+// Triangle lists are coded one code byte per triangle against a FIFO of recently seen edges and
+// vertices, so a triangle that shares an edge with a recent one and whose third vertex is new or
+// recent costs a single byte. Triangles may come back rotated, the winding is kept.
+namespace GeometryCodec
+{
+	// p_stride has to be a multiple of 4
+	void EncodeVertices(const void* p_vertices, size_t p_noOfVertices, size_t p_stride, std::vector<uint8_t>& p_encoded);
+	// Returns false if the data is truncated or malformed
+	bool DecodeVertices(void* p_destination, size_t p_noOfVertices, size_t p_stride, const uint8_t* p_encoded, size_t p_size);
+
+	// p_noOfIndices has to be a multiple of 3
+	void EncodeIndices(const unsigned int* p_indices, size_t p_noOfIndices, std::vector<uint8_t>& p_encoded);
+	bool DecodeIndices(unsigned int* p_destination, size_t p_noOfIndices, const uint8_t* p_encoded, size_t p_size);
+}
\ No newline at end of file
@@ -0,0 +1,1383 @@
+#include "JpegDecoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JPEGDECODER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// bits of the stream looked up at once when decoding a Huffman code
+	constexpr int FAST_BITS = 9;
+	// MCU rows of coefficients handed to the IDCT at once when the scan has no restart markers
+	constexpr int BAND_MCU_ROWS = 2;
+	// image rows upsampled and color converted by one task
+	constexpr int BAND_ROWS = 64;
+	// tasks per thread the restart intervals are split into
+	constexpr size_t TASKS_PER_THREAD = 4;
+
+	// natural order index of each zigzag position; runs past the end of a damaged block land on 63
+	const unsigned char ZIGZAG[64 + 16] =
+	{
+		0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+		12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+		35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+		58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+		63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63
+	};
+
+	// 12 bit fixed point, rounded the way stb_image rounds its IDCT constants
+	constexpr int _fixed(double p_value)
+	{
+		return static_cast<int>(p_value * 4096.0 + 0.5);
+	}
+
+	// YCbCr to RGB in the 4 fractional bits the SSE2 path works in, as 16 bit multipliers of
+	// the chroma shifted up by 8
+	constexpr int CR_TO_R = _fixed(1.40200);
+	constexpr int CB_TO_G = -_fixed(0.34414);
+	constexpr int CR_TO_G = -_fixed(0.71414);
+	constexpr int CB_TO_B = _fixed(1.77200);
+
+	struct HuffmanTable
+	{
+		// codes of up to FAST_BITS bits by the next FAST_BITS bits of the stream: length (0 for
+		// longer codes) and symbol
+		unsigned char fastLength[1 << FAST_BITS];
+		unsigned char fastSymbol[1 << FAST_BITS];
+		// AC codes whose value fits in FAST_BITS as well: value << 8 | run << 4 | bits used
+		int16_t fastAc[1 << FAST_BITS];
+		// longer codes: one past the last code of each length left aligned to 16 bits, and the
+		// symbol index minus the code
+		uint32_t maxCode[18];
+		int delta[17];
+		unsigned char symbols[256];
+		// the other direction for Restart; length 0 for symbols the table does not have
+		uint16_t code[256];
+		unsigned char length[256];
+		bool defined = false;
+	};
+
+	struct Component
+	{
+		int id = 0;
+		int h = 1;
+		int v = 1;
+		int quant = 0;
+		int dcTable = 0;
+		int acTable = 0;
+		// samples the image covers, and blocks of the plane, which is padded to whole MCUs
+		int width = 0;
+		int height = 0;
+		int blocksX = 0;
+		int blocksY = 0;
+		std::unique_ptr<unsigned char[]> plane;
+	};
+
+	struct Frame
+	{
+		JpegInfo info;
+		std::vector<Component> components;
+		int hMax = 1;
+		int vMax = 1;
+		int mcusX = 0;
+		int mcusY = 0;
+		int blocksPerMcu = 0;
+		// samples are RGB already: Adobe marker without transform, or components named R, G, B
+		bool rgb = false;
+		uint16_t quant[4][64] = {};
+		HuffmanTable dc[4];
+		HuffmanTable ac[4];
+		// the scan: components in scan order, where its header starts and its entropy coded data
+		std::vector<int> scan;
+		const unsigned char* scanHeader = nullptr;
+		const unsigned char* entropy = nullptr;
+		const unsigned char* end = nullptr;
+		// DRI segments before the scan, which Restart leaves out
+		std::vector<std::pair<const unsigned char*, const unsigned char*>> restartSegments;
+	};
+
+	bool _buildTable(const unsigned char* p_counts, const unsigned char* p_symbols, HuffmanTable& p_table)
+	{
+		std::memset(p_table.fastLength, 0, sizeof(p_table.fastLength));
+		std::memset(p_table.fastAc, 0, sizeof(p_table.fastAc));
+		std::memset(p_table.length, 0, sizeof(p_table.length));
+
+		// canonical codes, shortest first (C.2)
+		uint32_t code = 0;
+		int index = 0;
+		for (int length = 1; length <= 16; ++length)
+		{
+			p_table.delta[length] = index - static_cast<int>(code);
+			for (int i = 0; i < p_counts[length - 1]; ++i, ++index, ++code)
+			{
+				if (code >= (1u << length))
+				{
+					return false;
+				}
+				const unsigned char symbol = p_symbols[index];
+				p_table.symbols[index] = symbol;
+				p_table.code[symbol] = static_cast<uint16_t>(code);
+				p_table.length[symbol] = static_cast<unsigned char>(length);
+				if (length <= FAST_BITS)
+				{
+					const uint32_t first = code << (FAST_BITS - length);
+					for (uint32_t j = 0; j < (1u << (FAST_BITS - length)); ++j)
+					{
+						p_table.fastLength[first + j] = static_cast<unsigned char>(length);
+						p_table.fastSymbol[first + j] = symbol;
+					}
+				}
+			}
+			p_table.maxCode[length] = code << (16 - length);
+			code <<= 1;
+		}
+		p_table.maxCode[17] = UINT32_MAX;
+
+		for (int i = 0; i < (1 << FAST_BITS); ++i)
+		{
+			const int length = p_table.fastLength[i];
+			const int run = p_table.fastSymbol[i] >> 4;
+			const int size = p_table.fastSymbol[i] & 15;
+			if (length == 0 || size == 0 || length + size > FAST_BITS)
+			{
+				continue;
+			}
+			int value = ((i << length) & ((1 << FAST_BITS) - 1)) >> (FAST_BITS - size);
+			if (value < (1 << (size - 1)))
+			{
+				value -= (1 << size) - 1;
+			}
+			if (value >= -128 && value <= 127)
+			{
+				p_table.fastAc[i] = static_cast<int16_t>(value * 256 + run * 16 + length + size);
+			}
+		}
+
+		p_table.defined = true;
+		return true;
+	}
+
+	// Entropy coded bytes of one restart interval, most significant bit first
+	class BitReader
+	{
+	public:
+		BitReader() = default;
+		BitReader(const unsigned char* p_begin, const unsigned char* p_end) : m_cursor(p_begin), m_end(p_end) {}
+
+		// Keeps at least 32 bits buffered, enough for a code and its value; a marker or the end
+		// of the data feeds zeros
+		void Fill()
+		{
+			while (m_count <= 56)
+			{
+				unsigned int byte = 0;
+				if (m_cursor < m_end)
+				{
+					byte = *m_cursor;
+					if (byte != 0xFF)
+					{
+						++m_cursor;
+					}
+					else if (m_cursor + 1 < m_end && m_cursor[1] == 0x00)
+					{
+						m_cursor += 2;
+					}
+					else
+					{
+						byte = 0;
+						m_end = m_cursor;
+					}
+				}
+				m_bits |= static_cast<uint64_t>(byte) << (56 - m_count);
+				m_count += 8;
+			}
+		}
+
+		void Ensure()
+		{
+			if (m_count < 32)
+			{
+				Fill();
+			}
+		}
+
+		unsigned int Peek(int p_bits) const { return static_cast<unsigned int>(m_bits >> (64 - p_bits)); }
+
+		void Skip(int p_bits)
+		{
+			m_bits <<= p_bits;
+			m_count -= p_bits;
+		}
+
+		// Next symbol, -1 for a code the table does not have
+		int Decode(const HuffmanTable& p_table)
+		{
+			const unsigned int fast = Peek(FAST_BITS);
+			if (const int length = p_table.fastLength[fast])
+			{
+				Skip(length);
+				return p_table.fastSymbol[fast];
+			}
+
+			const uint32_t code = Peek(16);
+			int length = FAST_BITS + 1;
+			while (code >= p_table.maxCode[length])
+			{
+				++length;
+			}
+			if (length > 16)
+			{
+				return -1;
+			}
+			Skip(length);
+			return p_table.symbols[(code >> (16 - length)) + p_table.delta[length]];
+		}
+
+		// p_bits bits as a signed value (F.2.2.1, EXTEND)
+		int Receive(int p_bits)
+		{
+			if (p_bits == 0)
+			{
+				return 0;
+			}
+			const int value = static_cast<int>(Peek(p_bits));
+			Skip(p_bits);
+			return value < (1 << (p_bits - 1)) ? value - (1 << p_bits) + 1 : value;
+		}
+
+	private:
+		const unsigned char* m_cursor = nullptr;
+		const unsigned char* m_end = nullptr;
+		uint64_t m_bits = 0;
+		int m_count = 0;
+	};
+
+	// One block into dequantized coefficients in natural order
+	bool _decodeBlock(BitReader& p_reader, const HuffmanTable& p_dc, const HuffmanTable& p_ac, const uint16_t* p_quant, int& p_predictor, int16_t* p_coefficients)
+	{
+		std::memset(p_coefficients, 0, 64 * sizeof(int16_t));
+
+		p_reader.Ensure();
+		const int size = p_reader.Decode(p_dc);
+		if (size < 0 || size > 15)
+		{
+			return false;
+		}
+		p_predictor += p_reader.Receive(size);
+		p_coefficients[0] = static_cast<int16_t>(p_predictor * p_quant[0]);
+
+		int k = 1;
+		while (k < 64)
+		{
+			p_reader.Ensure();
+			const int fast = p_ac.fastAc[p_reader.Peek(FAST_BITS)];
+			if (fast)
+			{
+				k += (fast >> 4) & 15;
+				p_reader.Skip(fast & 15);
+				const int position = ZIGZAG[k++];
+				p_coefficients[position] = static_cast<int16_t>((fast >> 8) * p_quant[position]);
+				continue;
+			}
+
+			const int symbol = p_reader.Decode(p_ac);
+			if (symbol < 0)
+			{
+				return false;
+			}
+			const int run = symbol >> 4;
+			const int bits = symbol & 15;
+			if (bits == 0)
+			{
+				// end of block, or a run of 16 zeros
+				if (symbol != 0xF0)
+				{
+					break;
+				}
+				k += 16;
+				continue;
+			}
+			k += run;
+			const int position = ZIGZAG[k++];
+			p_coefficients[position] = static_cast<int16_t>(p_reader.Receive(bits) * p_quant[position]);
+		}
+		return true;
+	}
+	// A block whose AC coefficients are all zero, at the value the full IDCT gives it
+	void _fillBlock(int p_dc, unsigned char* p_out, int p_stride)
+	{
+		const int column = std::clamp(p_dc * 4, -32768, 32767);
+		const int value = std::clamp((column * 4096 + 65536 + (128 << 17)) >> 17, 0, 255);
+		for (int y = 0; y < 8; ++y)
+		{
+			std::memset(p_out + static_cast<size_t>(y) * p_stride, value, 8);
+		}
+	}
+
+#ifdef JPEGDECODER_SSE2
+	// 32 bit lanes of eight 16 bit values
+	struct Wide
+	{
+		__m128i lo;
+		__m128i hi;
+	};
+
+	Wide _add(const Wide& p_a, const Wide& p_b)
+	{
+		return Wide{ _mm_add_epi32(p_a.lo, p_b.lo), _mm_add_epi32(p_a.hi, p_b.hi) };
+	}
+
+	Wide _sub(const Wide& p_a, const Wide& p_b)
+	{
+		return Wide{ _mm_sub_epi32(p_a.lo, p_b.lo), _mm_sub_epi32(p_a.hi, p_b.hi) };
+	}
+
+	// p_x * p_a + p_y * p_b in every lane
+	Wide _rotate(__m128i p_x, __m128i p_y, int p_a, int p_b)
+	{
+		const __m128i constants = _mm_setr_epi16(static_cast<short>(p_a), static_cast<short>(p_b), static_cast<short>(p_a), static_cast<short>(p_b),
+			static_cast<short>(p_a), static_cast<short>(p_b), static_cast<short>(p_a), static_cast<short>(p_b));
+		return Wide{ _mm_madd_epi16(_mm_unpacklo_epi16(p_x, p_y), constants), _mm_madd_epi16(_mm_unpackhi_epi16(p_x, p_y), constants) };
+	}
+
+	// p_x * 4096 plus p_bias, sign extended
+	Wide _widen(__m128i p_x, __m128i p_bias)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		return Wide{ _mm_add_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(zero, p_x), 4), p_bias), _mm_add_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(zero, p_x), 4), p_bias) };
+	}
+
+	__m128i _narrow(const Wide& p_x, __m128i p_shift)
+	{
+		return _mm_packs_epi32(_mm_sra_epi32(p_x.lo, p_shift), _mm_sra_epi32(p_x.hi, p_shift));
+	}
+
+	// The 1D IDCT of _idct1d down all eight lanes of the rows at once
+	void _idctPass(__m128i* p_rows, int p_bias, int p_shift)
+	{
+		const __m128i bias = _mm_set1_epi32(p_bias);
+		const __m128i shift = _mm_cvtsi32_si128(p_shift);
+
+		const Wide t2 = _rotate(p_rows[2], p_rows[6], _fixed(0.5411961), _fixed(0.5411961) + _fixed(-1.847759065));
+		const Wide t3 = _rotate(p_rows[2], p_rows[6], _fixed(0.5411961) + _fixed(0.765366865), _fixed(0.5411961));
+		const Wide t0 = _widen(_mm_add_epi16(p_rows[0], p_rows[4]), bias);
+		const Wide t1 = _widen(_mm_sub_epi16(p_rows[0], p_rows[4]), bias);
+		const Wide even0 = _add(t0, t3);
+		const Wide even3 = _sub(t0, t3);
+		const Wide even1 = _add(t1, t2);
+		const Wide even2 = _sub(t1, t2);
+
+		const __m128i sum17 = _mm_add_epi16(p_rows[1], p_rows[7]);
+		const __m128i sum35 = _mm_add_epi16(p_rows[3], p_rows[5]);
+		const Wide y4 = _rotate(sum17, sum35, _fixed(1.175875602) + _fixed(-0.899976223), _fixed(1.175875602));
+		const Wide y5 = _rotate(sum17, sum35, _fixed(1.175875602), _fixed(1.175875602) + _fixed(-2.562915447));
+		const Wide odd0 = _add(_rotate(p_rows[7], p_rows[3], _fixed(-1.961570560) + _fixed(0.298631336), _fixed(-1.961570560)), y4);
+		const Wide odd2 = _add(_rotate(p_rows[7], p_rows[3], _fixed(-1.961570560), _fixed(-1.961570560) + _fixed(3.072711026)), y5);
+		const Wide odd1 = _add(_rotate(p_rows[5], p_rows[1], _fixed(-0.390180644) + _fixed(2.053119869), _fixed(-0.390180644)), y5);
+		const Wide odd3 = _add(_rotate(p_rows[5], p_rows[1], _fixed(-0.390180644), _fixed(-0.390180644) + _fixed(1.501321110)), y4);
+
+		p_rows[0] = _narrow(_add(even0, odd3), shift);
+		p_rows[7] = _narrow(_sub(even0, odd3), shift);
+		p_rows[1] = _narrow(_add(even1, odd2), shift);
+		p_rows[6] = _narrow(_sub(even1, odd2), shift);
+		p_rows[2] = _narrow(_add(even2, odd1), shift);
+		p_rows[5] = _narrow(_sub(even2, odd1), shift);
+		p_rows[3] = _narrow(_add(even3, odd0), shift);
+		p_rows[4] = _narrow(_sub(even3, odd0), shift);
+	}
+
+	void _transpose(__m128i* p_rows)
+	{
+		const __m128i a0 = _mm_unpacklo_epi16(p_rows[0], p_rows[1]);
+		const __m128i a1 = _mm_unpackhi_epi16(p_rows[0], p_rows[1]);
+		const __m128i a2 = _mm_unpacklo_epi16(p_rows[2], p_rows[3]);
+		const __m128i a3 = _mm_unpackhi_epi16(p_rows[2], p_rows[3]);
+		const __m128i a4 = _mm_unpacklo_epi16(p_rows[4], p_rows[5]);
+		const __m128i a5 = _mm_unpackhi_epi16(p_rows[4], p_rows[5]);
+		const __m128i a6 = _mm_unpacklo_epi16(p_rows[6], p_rows[7]);
+		const __m128i a7 = _mm_unpackhi_epi16(p_rows[6], p_rows[7]);
+		const __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+		const __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+		const __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+		const __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+		const __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+		const __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+		const __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+		const __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+		p_rows[0] = _mm_unpacklo_epi64(b0, b4);
+		p_rows[1] = _mm_unpackhi_epi64(b0, b4);
+		p_rows[2] = _mm_unpacklo_epi64(b1, b5);
+		p_rows[3] = _mm_unpackhi_epi64(b1, b5);
+		p_rows[4] = _mm_unpacklo_epi64(b2, b6);
+		p_rows[5] = _mm_unpackhi_epi64(b2, b6);
+		p_rows[6] = _mm_unpacklo_epi64(b3, b7);
+		p_rows[7] = _mm_unpackhi_epi64(b3, b7);
+	}
+#else
+	// One dimension of the IDCT of jidctint.c in 12 bit fixed point, as stb_image has it: output
+	// i is p_even[i] + p_odd[3 - i], output 7 - i is p_even[i] - p_odd[3 - i]
+	void _idct1d(int p_s0, int p_s1, int p_s2, int p_s3, int p_s4, int p_s5, int p_s6, int p_s7, int p_bias, int* p_even, int* p_odd)
+	{
+		const int p1 = (p_s2 + p_s6) * _fixed(0.5411961);
+		const int t2 = p1 + p_s6 * _fixed(-1.847759065);
+		const int t3 = p1 + p_s2 * _fixed(0.765366865);
+		const int t0 = (p_s0 + p_s4) * 4096 + p_bias;
+		const int t1 = (p_s0 - p_s4) * 4096 + p_bias;
+		p_even[0] = t0 + t3;
+		p_even[3] = t0 - t3;
+		p_even[1] = t1 + t2;
+		p_even[2] = t1 - t2;
+
+		const int p5 = (p_s1 + p_s3 + p_s5 + p_s7) * _fixed(1.175875602);
+		const int y4 = p5 + (p_s1 + p_s7) * _fixed(-0.899976223);
+		const int y5 = p5 + (p_s3 + p_s5) * _fixed(-2.562915447);
+		const int p3 = (p_s3 + p_s7) * _fixed(-1.961570560);
+		const int p4 = (p_s1 + p_s5) * _fixed(-0.390180644);
+		p_odd[0] = p_s7 * _fixed(0.298631336) + y4 + p3;
+		p_odd[1] = p_s5 * _fixed(2.053119869) + y5 + p4;
+		p_odd[2] = p_s3 * _fixed(3.072711026) + y5 + p3;
+		p_odd[3] = p_s1 * _fixed(1.501321110) + y4 + p4;
+	}
+#endif
+
+	// Dequantized coefficients to 8 x 8 samples; the columns keep 2 bits more than the samples
+	void _idct(const int16_t* p_coefficients, unsigned char* p_out, int p_stride)
+	{
+#ifdef JPEGDECODER_SSE2
+		__m128i rows[8];
+		__m128i ac = _mm_setzero_si128();
+		for (int i = 0; i < 8; ++i)
+		{
+			rows[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_coefficients + i * 8));
+			ac = _mm_or_si128(ac, rows[i]);
+		}
+		ac = _mm_and_si128(ac, _mm_setr_epi16(0, -1, -1, -1, -1, -1, -1, -1));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(ac, _mm_setzero_si128())) == 0xFFFF)
+		{
+			// the DC lane of the other rows is part of the AC
+			bool flat = true;
+			for (int i = 1; i < 8 && flat; ++i)
+			{
+				flat = p_coefficients[i * 8] == 0;
+			}
+			if (flat)
+			{
+				_fillBlock(p_coefficients[0], p_out, p_stride);
+				return;
+			}
+		}
+
+		_idctPass(rows, 512, 10);
+		_transpose(rows);
+		_idctPass(rows, 65536 + (128 << 17), 17);
+		_transpose(rows);
+		for (int i = 0; i < 8; i += 2)
+		{
+			const __m128i samples = _mm_packus_epi16(rows[i], rows[i + 1]);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(p_out + static_cast<size_t>(i) * p_stride), samples);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(p_out + static_cast<size_t>(i + 1) * p_stride), _mm_unpackhi_epi64(samples, samples));
+		}
+#else
+		bool flat = true;
+		for (int i = 1; i < 64 && flat; ++i)
+		{
+			flat = p_coefficients[i] == 0;
+		}
+		if (flat)
+		{
+			_fillBlock(p_coefficients[0], p_out, p_stride);
+			return;
+		}
+
+		int columns[64];
+		int even[4], odd[4];
+		for (int x = 0; x < 8; ++x)
+		{
+			const int16_t* in = p_coefficients + x;
+			_idct1d(in[0], in[8], in[16], in[24], in[32], in[40], in[48], in[56], 512, even, odd);
+			for (int i = 0; i < 4; ++i)
+			{
+				columns[i * 8 + x] = (even[i] + odd[3 - i]) >> 10;
+				columns[(7 - i) * 8 + x] = (even[i] - odd[3 - i]) >> 10;
+			}
+		}
+		for (int y = 0; y < 8; ++y)
+		{
+			const int* in = columns + y * 8;
+			// rounding and the level shift of 128 ride along in the bias
+			_idct1d(in[0], in[1], in[2], in[3], in[4], in[5], in[6], in[7], 65536 + (128 << 17), even, odd);
+			unsigned char* out = p_out + static_cast<size_t>(y) * p_stride;
+			for (int i = 0; i < 4; ++i)
+			{
+				out[i] = static_cast<unsigned char>(std::clamp((even[i] + odd[3 - i]) >> 17, 0, 255));
+				out[7 - i] = static_cast<unsigned char>(std::clamp((even[i] - odd[3 - i]) >> 17, 0, 255));
+			}
+		}
+#endif
+	}
+
+	uint16_t _read16(const unsigned char* p_bytes)
+	{
+		return static_cast<uint16_t>(p_bytes[0] << 8 | p_bytes[1]);
+	}
+
+	bool _parseFrame(const unsigned char* p_segment, const unsigned char* p_end, bool p_sequential, Frame& p_frame)
+	{
+		JpegInfo& info = p_frame.info;
+		if (p_end - p_segment < 6 || p_end - p_segment < 6 + 3 * p_segment[5])
+		{
+			return false;
+		}
+		info.height = _read16(p_segment + 1);
+		info.width = _read16(p_segment + 3);
+		info.components = p_segment[5];
+		// a height of 0 comes later in a DNL marker, which nothing writes any more
+		info.supported = p_sequential && p_segment[0] == 8 && info.width > 0 && info.height > 0 && (info.components == 1 || info.components == 3);
+
+		p_frame.components.resize(info.components);
+		for (int i = 0; i < info.components; ++i)
+		{
+			Component& component = p_frame.components[i];
+			const unsigned char* bytes = p_segment + 6 + 3 * i;
+			component.id = bytes[0];
+			component.h = bytes[1] >> 4;
+			component.v = bytes[1] & 15;
+			component.quant = bytes[2];
+			if (component.h < 1 || component.h > 4 || component.v < 1 || component.v > 4 || component.quant > 3)
+			{
+				return false;
+			}
+			p_frame.hMax = std::max(p_frame.hMax, component.h);
+			p_frame.vMax = std::max(p_frame.vMax, component.v);
+		}
+		if (!info.supported)
+		{
+			return true;
+		}
+
+		for (Component& component : p_frame.components)
+		{
+			info.supported = info.supported && p_frame.hMax % component.h == 0 && p_frame.vMax % component.v == 0;
+			component.width = (info.width * component.h + p_frame.hMax - 1) / p_frame.hMax;
+			component.height = (info.height * component.v + p_frame.vMax - 1) / p_frame.vMax;
+		}
+		if (info.components == 1)
+		{
+			// a scan of one component has a block per MCU (A.2.2)
+			Component& component = p_frame.components[0];
+			p_frame.mcusX = component.blocksX = (component.width + 7) / 8;
+			p_frame.mcusY = component.blocksY = (component.height + 7) / 8;
+			p_frame.blocksPerMcu = 1;
+			return true;
+		}
+		p_frame.mcusX = (info.width + 8 * p_frame.hMax - 1) / (8 * p_frame.hMax);
+		p_frame.mcusY = (info.height + 8 * p_frame.vMax - 1) / (8 * p_frame.vMax);
+		p_frame.blocksPerMcu = 0;
+		for (Component& component : p_frame.components)
+		{
+			component.blocksX = p_frame.mcusX * component.h;
+			component.blocksY = p_frame.mcusY * component.v;
+			p_frame.blocksPerMcu += component.h * component.v;
+		}
+		return true;
+	}
+
+	bool _parseScan(const unsigned char* p_segment, const unsigned char* p_end, Frame& p_frame)
+	{
+		const int count = p_end - p_segment > 0 ? p_segment[0] : 0;
+		if (count == 0 || p_end - p_segment < 4 + 2 * count)
+		{
+			return false;
+		}
+		for (int i = 0; i < count; ++i)
+		{
+			const auto found = std::find_if(p_frame.components.begin(), p_frame.components.end(), [&](const Component& p_component) { return p_component.id == p_segment[1 + 2 * i]; });
+			if (found == p_frame.components.end())
+			{
+				return false;
+			}
+			found->dcTable = p_segment[2 + 2 * i] >> 4;
+			found->acTable = p_segment[2 + 2 * i] & 15;
+			if (found->dcTable > 3 || found->acTable > 3)
+			{
+				return false;
+			}
+			p_frame.scan.push_back(static_cast<int>(found - p_frame.components.begin()));
+			p_frame.info.supported = p_frame.info.supported && p_frame.dc[found->dcTable].defined && p_frame.ac[found->acTable].defined;
+		}
+
+		// every component in the one scan, with all coefficients (baseline files written in
+		// several scans are rare enough to leave to stb_image)
+		const unsigned char* selection = p_segment + 1 + 2 * count;
+		p_frame.info.supported = p_frame.info.supported && count == p_frame.info.components && selection[0] == 0 && selection[1] == 63 && selection[2] == 0;
+		return true;
+	}
+
+	// Reads the segments up to the first scan. False if the data is not a JPEG or its headers
+	// are damaged; the frame is complete if info.supported is set.
+	bool _parse(const unsigned char* p_data, size_t p_size, Frame& p_frame)
+	{
+		if (p_size < 4 || p_data[0] != 0xFF || p_data[1] != 0xD8)
+		{
+			return false;
+		}
+
+		const unsigned char* end = p_data + p_size;
+		const unsigned char* cursor = p_data + 2;
+		bool frame = false;
+		bool adobe = false;
+		int transform = 1;
+		while (true)
+		{
+			// fill bytes may come before a marker
+			while (end - cursor >= 2 && cursor[0] == 0xFF && cursor[1] == 0xFF)
+			{
+				++cursor;
+			}
+			if (end - cursor < 4 || cursor[0] != 0xFF)
+			{
+				return false;
+			}
+			const int marker = cursor[1];
+			const unsigned char* segment = cursor + 4;
+			const unsigned char* next = cursor + 2 + _read16(cursor + 2);
+			if (next < segment || next > end)
+			{
+				return false;
+			}
+
+			if (marker == 0xC0 || marker == 0xC1)
+			{
+				if (frame || !_parseFrame(segment, next, true, p_frame))
+				{
+					return false;
+				}
+				frame = true;
+			}
+			else if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+			{
+				// progressive, lossless or arithmetic coded
+				return !frame && _parseFrame(segment, next, false, p_frame);
+			}
+			else if (marker == 0xC4)
+			{
+				for (const unsigned char* table = segment; table < next;)
+				{
+					int total = 0;
+					for (int i = 0; i < 16 && next - table >= 17; ++i)
+					{
+						total += table[1 + i];
+					}
+					const int tableClass = table[0] >> 4;
+					const int id = table[0] & 15;
+					if (next - table < 17 + total || total > 256 || tableClass > 1 || id > 3 || !_buildTable(table + 1, table + 17, (tableClass ? p_frame.ac : p_frame.dc)[id]))
+					{
+						return false;
+					}
+					table += 17 + total;
+				}
+			}
+			else if (marker == 0xDB)
+			{
+				for (const unsigned char* table = segment; table < next;)
+				{
+					const int precision = table[0] >> 4;
+					const int id = table[0] & 15;
+					if (precision > 1 || id > 3 || next - table < (precision ? 129 : 65))
+					{
+						return false;
+					}
+					for (int i = 0; i < 64; ++i)
+					{
+						p_frame.quant[id][ZIGZAG[i]] = precision ? _read16(table + 1 + 2 * i) : table[1 + i];
+					}
+					table += precision ? 129 : 65;
+				}
+			}
+			else if (marker == 0xDD)
+			{
+				if (next - segment < 2)
+				{
+					return false;
+				}
+				p_frame.info.restartInterval = _read16(segment);
+				p_frame.restartSegments.push_back({ cursor, next });
+			}
+			else if (marker == 0xEE && next - segment >= 12 && std::memcmp(segment, "Adobe", 5) == 0)
+			{
+				adobe = true;
+				transform = segment[11];
+			}
+			else if (marker == 0xDA)
+			{
+				if (!frame || !_parseScan(segment, next, p_frame))
+				{
+					return false;
+				}
+				p_frame.scanHeader = cursor;
+				p_frame.entropy = next;
+				p_frame.end = end;
+
+				const std::vector<Component>& components = p_frame.components;
+				p_frame.rgb = components.size() == 3 && (adobe ? transform == 0 : components[0].id == 'R' && components[1].id == 'G' && components[2].id == 'B');
+				return true;
+			}
+			else if (marker == 0xD9)
+			{
+				return false;
+			}
+			cursor = next;
+		}
+	}
+
+	// Start of every restart interval, found by the markers between them; a single interval
+	// without them
+	bool _findIntervals(const Frame& p_frame, std::vector<const unsigned char*>& p_intervals)
+	{
+		p_intervals.assign(1, p_frame.entropy);
+		const size_t interval = p_frame.info.restartInterval;
+		if (interval == 0)
+		{
+			return true;
+		}
+
+		const size_t count = (static_cast<size_t>(p_frame.mcusX) * p_frame.mcusY + interval - 1) / interval;
+		const unsigned char* cursor = p_frame.entropy;
+		while (p_intervals.size() < count)
+		{
+			cursor = static_cast<const unsigned char*>(std::memchr(cursor, 0xFF, p_frame.end - cursor));
+			if (!cursor || p_frame.end - cursor < 2)
+			{
+				return false;
+			}
+			if (cursor[1] >= 0xD0 && cursor[1] <= 0xD7)
+			{
+				cursor += 2;
+				p_intervals.push_back(cursor);
+			}
+			else if (cursor[1] == 0x00 || cursor[1] == 0xFF)
+			{
+				// a stuffed 0xFF, or fill before a marker
+				cursor += cursor[1] == 0x00 ? 2 : 1;
+			}
+			else
+			{
+				// the scan ended early
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Entropy decodes the MCUs of the scan in order, starting at restart interval p_interval
+	class McuReader
+	{
+	public:
+		McuReader(const Frame& p_frame, const std::vector<const unsigned char*>& p_intervals, size_t p_interval)
+			: m_frame(p_frame), m_intervals(p_intervals), m_interval(p_interval)
+		{
+		}
+
+		// Blocks of the next MCU in scan order, blocksPerMcu * 64 coefficients
+		bool Next(int16_t* p_coefficients)
+		{
+			if (m_left == 0)
+			{
+				if (m_interval >= m_intervals.size())
+				{
+					return false;
+				}
+				m_reader = BitReader(m_intervals[m_interval], m_interval + 1 < m_intervals.size() ? m_intervals[m_interval + 1] : m_frame.end);
+				m_left = m_frame.info.restartInterval > 0 ? m_frame.info.restartInterval : INT_MAX;
+				std::fill(std::begin(m_predictors), std::end(m_predictors), 0);
+				++m_interval;
+			}
+			--m_left;
+
+			for (int index : m_frame.scan)
+			{
+				const Component& component = m_frame.components[index];
+				const int blocks = m_frame.components.size() == 1 ? 1 : component.h * component.v;
+				for (int block = 0; block < blocks; ++block, p_coefficients += 64)
+				{
+					if (!_decodeBlock(m_reader, m_frame.dc[component.dcTable], m_frame.ac[component.acTable], m_frame.quant[component.quant], m_predictors[index], p_coefficients))
+					{
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+	private:
+		const Frame& m_frame;
+		const std::vector<const unsigned char*>& m_intervals;
+		size_t m_interval;
+		BitReader m_reader;
+		int m_left = 0;
+		int m_predictors[3] = {};
+	};
+
+	// Inverse transforms the blocks of one MCU into the component planes
+	void _transformMcu(const Frame& p_frame, int p_mcuX, int p_mcuY, const int16_t* p_coefficients)
+	{
+		const bool single = p_frame.components.size() == 1;
+		for (int index : p_frame.scan)
+		{
+			const Component& component = p_frame.components[index];
+			const int stride = component.blocksX * 8;
+			const int h = single ? 1 : component.h;
+			const int v = single ? 1 : component.v;
+			for (int y = 0; y < v; ++y)
+			{
+				unsigned char* row = component.plane.get() + static_cast<size_t>(p_mcuY * v + y) * 8 * stride;
+				for (int x = 0; x < h; ++x, p_coefficients += 64)
+				{
+					_idct(p_coefficients, row + (p_mcuX * h + x) * 8, stride);
+				}
+			}
+		}
+	}
+
+	// Every restart interval can be entropy decoded on its own, so runs of them go to the pool
+	bool _decodeIntervals(const Frame& p_frame, const std::vector<const unsigned char*>& p_intervals, ThreadPool& p_pool)
+	{
+		const size_t mcus = static_cast<size_t>(p_frame.mcusX) * p_frame.mcusY;
+		const size_t interval = p_frame.info.restartInterval;
+		const size_t tasks = std::min(p_intervals.size(), (p_pool.NoOfWorkers() + 1) * TASKS_PER_THREAD);
+		std::atomic<bool> failed{ false };
+		p_pool.ParallelFor(tasks, [&](size_t p_task)
+		{
+			const size_t first = p_intervals.size() * p_task / tasks;
+			const size_t last = std::min(p_intervals.size() * (p_task + 1) / tasks * interval, mcus);
+			std::vector<int16_t> coefficients(static_cast<size_t>(p_frame.blocksPerMcu) * 64);
+			McuReader reader(p_frame, p_intervals, first);
+			for (size_t mcu = first * interval; mcu < last; ++mcu)
+			{
+				if (!reader.Next(coefficients.data()))
+				{
+					failed = true;
+					return;
+				}
+				_transformMcu(p_frame, static_cast<int>(mcu % p_frame.mcusX), static_cast<int>(mcu / p_frame.mcusX), coefficients.data());
+			}
+		});
+		return !failed;
+	}
+
+	// Without restart markers the Huffman decode is one pass; index 0 of the ParallelFor runs
+	// it and queues bands of coefficients, the others take them off for the IDCT. If they fall
+	// behind or the pool is busy elsewhere, the decoding thread transforms a band itself.
+	bool _decodeSequential(const Frame& p_frame, const std::vector<const unsigned char*>& p_intervals, ThreadPool& p_pool)
+	{
+		struct Band
+		{
+			int firstRow;
+			std::vector<int16_t> coefficients;
+		};
+		std::mutex mutex;
+		std::condition_variable ready;
+		std::deque<Band> bands;
+		std::vector<std::vector<int16_t>> spare;
+		bool finished = false;
+		bool failed = false;
+
+		const size_t threads = p_pool.NoOfWorkers() + 1;
+		const size_t mcuValues = static_cast<size_t>(p_frame.blocksPerMcu) * 64;
+		auto transform = [&](const Band& p_band)
+		{
+			const int lastRow = std::min(p_band.firstRow + BAND_MCU_ROWS, p_frame.mcusY);
+			const int16_t* coefficients = p_band.coefficients.data();
+			for (int y = p_band.firstRow; y < lastRow; ++y)
+			{
+				for (int x = 0; x < p_frame.mcusX; ++x, coefficients += mcuValues)
+				{
+					_transformMcu(p_frame, x, y, coefficients);
+				}
+			}
+		};
+		auto drain = [&]()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while (true)
+			{
+				ready.wait(lock, [&]() { return !bands.empty() || finished; });
+				if (bands.empty())
+				{
+					return;
+				}
+				Band band = std::move(bands.front());
+				bands.pop_front();
+				lock.unlock();
+				transform(band);
+				lock.lock();
+				spare.push_back(std::move(band.coefficients));
+			}
+		};
+
+		p_pool.ParallelFor(threads, [&](size_t p_index)
+		{
+			if (p_index > 0)
+			{
+				drain();
+				return;
+			}
+
+			McuReader reader(p_frame, p_intervals, 0);
+			for (int row = 0; row < p_frame.mcusY && !failed; row += BAND_MCU_ROWS)
+			{
+				Band band{ row, {} };
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (!spare.empty())
+					{
+						band.coefficients = std::move(spare.back());
+						spare.pop_back();
+					}
+				}
+				const int rows = std::min(BAND_MCU_ROWS, p_frame.mcusY - row);
+				band.coefficients.resize(static_cast<size_t>(rows) * p_frame.mcusX * mcuValues);
+				for (size_t mcu = 0; mcu < static_cast<size_t>(rows) * p_frame.mcusX && !failed; ++mcu)
+				{
+					failed = !reader.Next(band.coefficients.data() + mcu * mcuValues);
+				}
+
+				std::unique_lock<std::mutex> lock(mutex);
+				if (bands.size() >= 2 * threads)
+				{
+					Band oldest = std::move(bands.front());
+					bands.pop_front();
+					lock.unlock();
+					transform(oldest);
+					lock.lock();
+					spare.push_back(std::move(oldest.coefficients));
+				}
+				bands.push_back(std::move(band));
+				ready.notify_one();
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				finished = true;
+			}
+			ready.notify_all();
+			drain();
+		});
+		return !failed;
+	}
+
+	// Row p_y of a component at the full width of the image. Chroma at half resolution is
+	// interpolated with the triangle filter stb_image uses, other factors repeat samples.
+	const unsigned char* _componentRow(const Frame& p_frame, const Component& p_component, int p_y, unsigned char* p_scratch)
+	{
+		const bool single = p_frame.components.size() == 1;
+		const int ratioX = single ? 1 : p_frame.hMax / p_component.h;
+		const int ratioY = single ? 1 : p_frame.vMax / p_component.v;
+		const size_t stride = static_cast<size_t>(p_component.blocksX) * 8;
+		const unsigned char* near = p_component.plane.get() + (p_y / ratioY) * stride;
+		if (ratioX == 1 && ratioY == 1)
+		{
+			return near;
+		}
+
+		// the neighbouring row on the side of p_y
+		const unsigned char* far = near;
+		if (ratioY == 2)
+		{
+			const int row = p_y / 2 + ((p_y & 1) ? 1 : -1);
+			far = p_component.plane.get() + std::clamp(row, 0, p_component.height - 1) * stride;
+		}
+
+		const int width = p_component.width;
+		if (ratioX == 2 && ratioY == 2)
+		{
+			int t1 = 3 * near[0] + far[0];
+			p_scratch[0] = static_cast<unsigned char>((t1 + 2) >> 2);
+			for (int x = 1; x < width; ++x)
+			{
+				const int t0 = t1;
+				t1 = 3 * near[x] + far[x];
+				p_scratch[2 * x - 1] = static_cast<unsigned char>((3 * t0 + t1 + 8) >> 4);
+				p_scratch[2 * x] = static_cast<unsigned char>((3 * t1 + t0 + 8) >> 4);
+			}
+			p_scratch[2 * width - 1] = static_cast<unsigned char>((t1 + 2) >> 2);
+		}
+		else if (ratioX == 2 && ratioY == 1)
+		{
+			p_scratch[0] = near[0];
+			for (int x = 0; x + 1 < width; ++x)
+			{
+				p_scratch[2 * x + 1] = static_cast<unsigned char>((3 * near[x] + near[x + 1] + 2) >> 2);
+				p_scratch[2 * x + 2] = static_cast<unsigned char>((near[x] + 3 * near[x + 1] + 2) >> 2);
+			}
+			p_scratch[2 * width - 1] = near[width - 1];
+		}
+		else if (ratioX == 1 && ratioY == 2)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				p_scratch[x] = static_cast<unsigned char>((3 * near[x] + far[x] + 2) >> 2);
+			}
+		}
+		else
+		{
+			for (int x = 0; x < p_frame.info.width; ++x)
+			{
+				p_scratch[x] = near[x / ratioX];
+			}
+		}
+		return p_scratch;
+	}
+
+	// A row of YCbCr as RGB or RGBA, in the 4 fractional bits of the SSE2 path on both paths
+	void _ycbcrToRgb(const unsigned char* p_y, const unsigned char* p_cb, const unsigned char* p_cr, int p_count, int p_channels, unsigned char* p_out)
+	{
+		int x = 0;
+#ifdef JPEGDECODER_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i half = _mm_set1_epi16(128);
+		const __m128i rounding = _mm_set1_epi16(8);
+		const __m128i alpha = _mm_set1_epi16(255);
+		for (; x + 8 <= p_count; x += 8)
+		{
+			const __m128i luma = _mm_add_epi16(_mm_slli_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p_y + x)), zero), 4), rounding);
+			const __m128i cb = _mm_slli_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p_cb + x)), zero), half), 8);
+			const __m128i cr = _mm_slli_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p_cr + x)), zero), half), 8);
+			const __m128i r = _mm_srai_epi16(_mm_add_epi16(luma, _mm_mulhi_epi16(cr, _mm_set1_epi16(CR_TO_R))), 4);
+			const __m128i g = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(luma, _mm_mulhi_epi16(cb, _mm_set1_epi16(CB_TO_G))), _mm_mulhi_epi16(cr, _mm_set1_epi16(CR_TO_G))), 4);
+			const __m128i b = _mm_srai_epi16(_mm_add_epi16(luma, _mm_mulhi_epi16(cb, _mm_set1_epi16(CB_TO_B))), 4);
+
+			// r g pairs and b a pairs, then whole pixels
+			const __m128i rb = _mm_packus_epi16(r, b);
+			const __m128i ga = _mm_packus_epi16(g, alpha);
+			const __m128i rg = _mm_unpacklo_epi8(rb, ga);
+			const __m128i ba = _mm_unpackhi_epi8(rb, ga);
+			if (p_channels == 4)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(p_out), _mm_unpacklo_epi16(rg, ba));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(p_out + 16), _mm_unpackhi_epi16(rg, ba));
+				p_out += 32;
+				continue;
+			}
+			alignas(16) unsigned char pixels[32];
+			_mm_store_si128(reinterpret_cast<__m128i*>(pixels), _mm_unpacklo_epi16(rg, ba));
+			_mm_store_si128(reinterpret_cast<__m128i*>(pixels + 16), _mm_unpackhi_epi16(rg, ba));
+			for (int i = 0; i < 8; ++i, p_out += 3)
+			{
+				p_out[0] = pixels[4 * i];
+				p_out[1] = pixels[4 * i + 1];
+				p_out[2] = pixels[4 * i + 2];
+			}
+		}
+#endif
+		for (; x < p_count; ++x, p_out += p_channels)
+		{
+			const int luma = p_y[x] * 16 + 8;
+			const int cb = (p_cb[x] - 128) * 256;
+			const int cr = (p_cr[x] - 128) * 256;
+			p_out[0] = static_cast<unsigned char>(std::clamp((luma + ((cr * CR_TO_R) >> 16)) >> 4, 0, 255));
+			p_out[1] = static_cast<unsigned char>(std::clamp((luma + ((cb * CB_TO_G) >> 16) + ((cr * CR_TO_G) >> 16)) >> 4, 0, 255));
+			p_out[2] = static_cast<unsigned char>(std::clamp((luma + ((cb * CB_TO_B) >> 16)) >> 4, 0, 255));
+			if (p_channels == 4)
+			{
+				p_out[3] = 255;
+			}
+		}
+	}
+
+	void _convertRows(const Frame& p_frame, int p_firstRow, int p_lastRow, int p_channels, unsigned char* p_texels)
+	{
+		const int width = p_frame.info.width;
+		const size_t components = p_frame.components.size();
+		size_t scratchSize = 0;
+		for (const Component& component : p_frame.components)
+		{
+			scratchSize = std::max(scratchSize, static_cast<size_t>(component.blocksX) * 8 * (p_frame.hMax / component.h));
+		}
+		std::vector<unsigned char> scratch(scratchSize * components);
+
+		for (int y = p_firstRow; y < p_lastRow; ++y)
+		{
+			const unsigned char* rows[3];
+			for (size_t c = 0; c < components; ++c)
+			{
+				rows[c] = _componentRow(p_frame, p_frame.components[c], y, scratch.data() + c * scratchSize);
+			}
+
+			unsigned char* out = p_texels + static_cast<size_t>(y) * width * p_channels;
+			if (components == 3 && !p_frame.rgb)
+			{
+				_ycbcrToRgb(rows[0], rows[1], rows[2], width, p_channels, out);
+				continue;
+			}
+			for (int x = 0; x < width; ++x, out += p_channels)
+			{
+				out[0] = rows[0][x];
+				out[1] = rows[components == 3 ? 1 : 0][x];
+				out[2] = rows[components == 3 ? 2 : 0][x];
+				if (p_channels == 4)
+				{
+					out[3] = 255;
+				}
+			}
+		}
+	}
+
+	// Huffman codes written back, with 0xFF bytes stuffed and the last byte padded with ones
+	class BitWriter
+	{
+	public:
+		BitWriter(std::vector<unsigned char>& p_out) : m_out(p_out) {}
+
+		void Put(uint32_t p_bits, int p_count)
+		{
+			m_bits = (m_bits << p_count) | (p_bits & ((1u << p_count) - 1));
+			m_count += p_count;
+			while (m_count >= 8)
+			{
+				m_count -= 8;
+				const unsigned char byte = static_cast<unsigned char>(m_bits >> m_count);
+				m_out.push_back(byte);
+				if (byte == 0xFF)
+				{
+					m_out.push_back(0x00);
+				}
+			}
+		}
+
+		void Flush()
+		{
+			if (m_count > 0)
+			{
+				Put(0xFF, 8 - m_count);
+			}
+		}
+
+	private:
+		std::vector<unsigned char>& m_out;
+		uint64_t m_bits = 0;
+		int m_count = 0;
+	};
+
+	// A symbol carrying the bit length of p_value, then the bits of p_value (F.1.2)
+	bool _encodeValue(BitWriter& p_writer, const HuffmanTable& p_table, int p_run, int p_value)
+	{
+		int size = 0;
+		while ((std::abs(p_value) >> size) != 0)
+		{
+			++size;
+		}
+		const int symbol = p_run << 4 | size;
+		if (size > 15 || p_table.length[symbol] == 0)
+		{
+			return false;
+		}
+		p_writer.Put(p_table.code[symbol], p_table.length[symbol]);
+		p_writer.Put(static_cast<uint32_t>(p_value < 0 ? p_value + (1 << size) - 1 : p_value), size);
+		return true;
+	}
+
+	bool _encodeBlock(BitWriter& p_writer, const HuffmanTable& p_dc, const HuffmanTable& p_ac, const int16_t* p_coefficients, int& p_predictor)
+	{
+		if (!_encodeValue(p_writer, p_dc, 0, p_coefficients[0] - p_predictor))
+		{
+			return false;
+		}
+		p_predictor = p_coefficients[0];
+
+		int run = 0;
+		for (int k = 1; k < 64; ++k)
+		{
+			const int value = p_coefficients[ZIGZAG[k]];
+			if (value == 0)
+			{
+				++run;
+				continue;
+			}
+			for (; run > 15; run -= 16)
+			{
+				if (p_ac.length[0xF0] == 0)
+				{
+					return false;
+				}
+				p_writer.Put(p_ac.code[0xF0], p_ac.length[0xF0]);
+			}
+			if (!_encodeValue(p_writer, p_ac, run, value))
+			{
+				return false;
+			}
+			run = 0;
+		}
+		if (run > 0)
+		{
+			if (p_ac.length[0x00] == 0)
+			{
+				return false;
+			}
+			p_writer.Put(p_ac.code[0x00], p_ac.length[0x00]);
+		}
+		return true;
+	}
+}
+
+bool JpegDecoder::Inspect(const unsigned char* p_data, size_t p_size, JpegInfo& p_info)
+{
+	std::unique_ptr<Frame> frame = std::make_unique<Frame>();
+	if (!_parse(p_data, p_size, *frame) || frame->info.components == 0)
+	{
+		return false;
+	}
+	p_info = frame->info;
+	return true;
+}
+
+bool JpegDecoder::Decode(const unsigned char* p_data, size_t p_size, int p_channels, int& p_width, int& p_height, std::vector<unsigned char>& p_texels)
+{
+	return Decode(p_data, p_size, p_channels, p_width, p_height, p_texels, ThreadPool::Shared());
+}
+
+bool JpegDecoder::Decode(const unsigned char* p_data, size_t p_size, int p_channels, int& p_width, int& p_height, std::vector<unsigned char>& p_texels, ThreadPool& p_pool)
+{
+	std::unique_ptr<Frame> frame = std::make_unique<Frame>();
+	std::vector<const unsigned char*> intervals;
+	if ((p_channels != 3 && p_channels != 4) || !_parse(p_data, p_size, *frame) || !frame->info.supported || !_findIntervals(*frame, intervals))
+	{
+		return false;
+	}
+	for (Component& component : frame->components)
+	{
+		component.plane.reset(new (std::nothrow) unsigned char[static_cast<size_t>(component.blocksX) * component.blocksY * 64]);
+		if (!component.plane)
+		{
+			return false;
+		}
+	}
+
+	// enough intervals to keep every thread busy, or one entropy decoding thread feeding the rest
+	const size_t threads = p_pool.NoOfWorkers() + 1;
+	if (!(intervals.size() >= 2 * threads ? _decodeIntervals(*frame, intervals, p_pool) : _decodeSequential(*frame, intervals, p_pool)))
+	{
+		return false;
+	}
+
+	const JpegInfo& info = frame->info;
+	p_texels.resize(static_cast<size_t>(info.width) * info.height * p_channels);
+	p_pool.ParallelFor((info.height + BAND_ROWS - 1) / BAND_ROWS, [&](size_t p_band)
+	{
+		const int firstRow = static_cast<int>(p_band) * BAND_ROWS;
+		_convertRows(*frame, firstRow, std::min(firstRow + BAND_ROWS, info.height), p_channels, p_texels.data());
+	});
+	p_width = info.width;
+	p_height = info.height;
+	return true;
+}
+
+bool JpegDecoder::Restart(const unsigned char* p_data, size_t p_size, int p_mcusPerInterval, std::vector<unsigned char>& p_out)
+{
+	std::unique_ptr<Frame> frame = std::make_unique<Frame>();
+	std::vector<const unsigned char*> intervals;
+	if (!_parse(p_data, p_size, *frame) || !frame->info.supported || !_findIntervals(*frame, intervals))
+	{
+		return false;
+	}
+	const int interval = p_mcusPerInterval > 0 ? p_mcusPerInterval : frame->mcusX;
+	if (interval > 0xFFFF)
+	{
+		return false;
+	}
+	// the coefficients as they are stored
+	for (uint16_t (&table)[64] : frame->quant)
+	{
+		std::fill(std::begin(table), std::end(table), static_cast<uint16_t>(1));
+	}
+
+	// the headers with a new DRI segment in place of any old one
+	p_out.clear();
+	const unsigned char* copied = p_data;
+	for (const auto& [begin, end] : frame->restartSegments)
+	{
+		p_out.insert(p_out.end(), copied, begin);
+		copied = end;
+	}
+	p_out.insert(p_out.end(), copied, frame->scanHeader);
+	const unsigned char restart[] = { 0xFF, 0xDD, 0x00, 0x04, static_cast<unsigned char>(interval >> 8), static_cast<unsigned char>(interval & 0xFF) };
+	p_out.insert(p_out.end(), std::begin(restart), std::end(restart));
+	p_out.insert(p_out.end(), frame->scanHeader, frame->entropy);
+
+	BitWriter writer(p_out);
+	McuReader reader(*frame, intervals, 0);
+	std::vector<int16_t> coefficients(static_cast<size_t>(frame->blocksPerMcu) * 64);
+	int predictors[3] = {};
+	const size_t mcus = static_cast<size_t>(frame->mcusX) * frame->mcusY;
+	for (size_t mcu = 0; mcu < mcus; ++mcu)
+	{
+		if (mcu > 0 && mcu % interval == 0)
+		{
+			writer.Flush();
+			p_out.push_back(0xFF);
+			p_out.push_back(static_cast<unsigned char>(0xD0 + (mcu / interval - 1) % 8));
+			std::fill(std::begin(predictors), std::end(predictors), 0);
+		}
+		if (!reader.Next(coefficients.data()))
+		{
+			return false;
+		}
+
+		const int16_t* block = coefficients.data();
+		for (int index : frame->scan)
+		{
+			const Component& component = frame->components[index];
+			const int blocks = frame->components.size() == 1 ? 1 : component.h * component.v;
+			for (int i = 0; i < blocks; ++i, block += 64)
+			{
+				// a DC difference the tables of an optimized file never needed has no code
+				if (!_encodeBlock(writer, frame->dc[component.dcTable], frame->ac[component.acTable], block, predictors[index]))
+				{
+					std::cout << "The Huffman tables of the image have no code for a restarted block" << std::endl;
+					return false;
+				}
+			}
+		}
+	}
+	writer.Flush();
+	p_out.push_back(0xFF);
+	p_out.push_back(0xD9);
+	return true;
+}
+
+
+bool JpegDecoder::RestartFile(const char* p_imagePath, const char* p_outPath, int p_mcusPerInterval)
+{
+	MappedFile file(p_imagePath);
+	std::vector<unsigned char> restarted;
+	if (!file.IsOpen() || !Restart(reinterpret_cast<const unsigned char*>(file.Data()), file.Size(), p_mcusPerInterval, restarted))
+	{
+		std::cout << "Cannot add restart markers to " << p_imagePath << std::endl;
+		return false;
+	}
+
+	std::ofstream out(p_outPath, std::ios::binary);
+	out.write(reinterpret_cast<const char*>(restarted.data()), static_cast<std::streamsize>(restarted.size()));
+	if (!out)
+	{
+		std::cout << "Cannot write " << p_outPath << std::endl;
+		return false;
+	}
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class ThreadPool;
+
+// What the frame and scan headers of a JPEG say, without decoding it
+struct JpegInfo
+{
+	int width = 0;
+	int height = 0;
+	int components = 0;
+	// MCUs between restart markers, 0 without them
+	int restartInterval = 0;
+	// false for progressive, arithmetic coded, 12 bit or CMYK files, which stb_image decodes instead
+	bool supported = false;
+};
+
+// Decoder for the sequential Huffman coded JPEGs textures come as, gray or YCbCr with any
+// chroma subsampling. Blocks are dequantized and inverse transformed straight into component
+// planes, then upsampled like stb_image does and converted to RGB, with SSE2 for the IDCT and
+// the color conversion where available.
+//
+// With restart markers every interval can be entropy decoded on its own, so the intervals are
+// spread over the pool. Without them the Huffman decode stays on one thread and hands bands of
+// coefficients to the others for the IDCT; Restart adds markers to such a file losslessly.
+namespace JpegDecoder
+{
+	// Reads the headers up to the first scan; false if p_data is not a JPEG at all
+	bool Inspect(const unsigned char* p_data, size_t p_size, JpegInfo& p_info);
+
+	// Decodes into tightly packed rows of 3 (RGB) or 4 (RGBA, alpha 255) channels. Returns false
+	// for files that are not supported or are damaged, so the caller can fall back to stb_image.
+	bool Decode(const unsigned char* p_data, size_t p_size, int p_channels, int& p_width, int& p_height, std::vector<unsigned char>& p_texels);
+	bool Decode(const unsigned char* p_data, size_t p_size, int p_channels, int& p_width, int& p_height, std::vector<unsigned char>& p_texels, ThreadPool& p_pool);
+
+	// Writes the same image with a restart marker every p_mcusPerInterval MCUs, 0 for one per
+	// MCU row. The pixels stay the same: the coefficients are Huffman coded again with the
+	// tables of the file, which fails only if an optimized table lacks a code this needs.
+	bool Restart(const unsigned char* p_data, size_t p_size, int p_mcusPerInterval, std::vector<unsigned char>& p_out);
+	bool RestartFile(const char* p_imagePath, const char* p_outPath, int p_mcusPerInterval);
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const char* p_path)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(p_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+	m_file = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		_close();
+		return;
+	}
+	m_size = static_cast<size_t>(size.QuadPart);
+
+	// an empty file cannot be mapped, but it is still a valid (empty) file
+	if (m_size == 0)
+	{
+		m_isOpen = true;
+		return;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		_close();
+		return;
+	}
+	m_mapping = mapping;
+
+	m_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+	m_file = open(p_path, O_RDONLY);
+	if (m_file < 0)
+	{
+		return;
+	}
+
+	struct stat info;
+	if (fstat(m_file, &info) != 0)
+	{
+		_close();
+		return;
+	}
+	m_size = static_cast<size_t>(info.st_size);
+
+	if (m_size == 0)
+	{
+		m_isOpen = true;
+		return;
+	}
+
+	void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+	if (data != MAP_FAILED)
+	{
+		madvise(data, m_size, MADV_SEQUENTIAL);
+		m_data = static_cast<const char*>(data);
+	}
+#endif
+
+	if (m_data == nullptr)
+	{
+		_close();
+		return;
+	}
+
+	m_isOpen = true;
+}
+
+MappedFile::~MappedFile()
+{
+	_close();
+}
+
+void MappedFile::_close()
+{
+#ifdef _WIN32
+	if (m_data)
+	{
+		UnmapViewOfFile(m_data);
+	}
+
+	if (m_mapping)
+	{
+		CloseHandle(m_mapping);
+	}
+
+	if (m_file)
+	{
+		CloseHandle(m_file);
+	}
+
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	if (m_data)
+	{
+		munmap(const_cast<char*>(m_data), m_size);
+	}
+
+	if (m_file >= 0)
+	{
+		close(m_file);
+	}
+
+	m_file = -1;
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+	m_isOpen = false;
+}
\ No newline at end of file
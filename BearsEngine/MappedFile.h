@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+// Read-only view of a whole file mapped into memory.
+// The pointer returned by Data() stays valid for the lifetime of the object.
+class MappedFile
+{
+public:
+	MappedFile(const char* p_path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool IsOpen() const { return m_isOpen; }
+	const char* Data() const { return m_data; }
+	const char* End() const { return m_data + m_size; }
+	size_t Size() const { return m_size; }
+
+private:
+	void _close();
+
+	bool m_isOpen = false;
+	const char* m_data = nullptr;
+	size_t m_size = 0;
+
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#else
+	int m_file = -1;
+#endif
+};
\ No newline at end of file
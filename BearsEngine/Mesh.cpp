@@ -1,13 +1,37 @@
 #include "Mesh.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
 #include <vector>
-#include <fstream>
 
 #include "glad/glad.h"
 #include "GLFW/glfw3.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/constants.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "Camera.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+#include "MeshParser.h"
+#include "MeshSimplifier.h"
+#include "MeshWelder.h"
+#include "ParametricSurface.h"
+#include "ResidencyManager.h"
+#include "ResourceManager.h"
+#include "VertexQuantizer.h"
+#include "ThreadPool.h"
 
 #ifndef IMAGES_H
 #define IMAGES_H
@@ -17,227 +41,905 @@
 
 #endif // IMAGES_H
 
-MeshGrid::MeshGrid(const char* p_vertexPath, const char* p_trianglePath, const char* p_texturePath)
+// Everything a MeshGrid needs from disk, produced without touching GL so it can run on the load
+// worker. The GL thread copies it into buffers afterwards; the texture streams in on its own
+// through TextureLoader.
+struct MeshLoad
 {
 	std::vector<float> vertices;
 	std::vector<unsigned int> triangles;
+	std::vector<MeshLod> lods;
+	std::vector<Meshlet> meshlets;
+	// an up to date raw cache is uploaded straight from its mapped pages instead of the vectors
+	std::unique_ptr<MeshCache> cache;
+	size_t noOfFloats = 0;
+	size_t noOfIndices = 0;
+	bool valid = false;
+	// grid of a procedural sphere, which has neither VBO nor EBO (0 for any other mesh)
+	unsigned int proceduralXSeg = 0;
+	unsigned int proceduralYSeg = 0;
+
+	// VBO and EBO contents, pointing into the vectors, the cache or quantized
+	QuantizedMesh quantized;
+	bool compact = false;
+	const void* vertexData = nullptr;
+	size_t vertexBytes = 0;
+	const void* indexData = nullptr;
+	size_t indexBytes = 0;
+	unsigned int indexType = GL_UNSIGNED_INT;
+	glm::vec3 boundsCenter = glm::vec3(0.0f);
+	float boundsRadius = 0.0f;
+	// filled when this load welded the geometry, reported on the GL thread when it is adopted
+	WeldStats weld;
+
+	// set by the worker once everything above is filled
+	std::atomic<bool> ready{ false };
+
+	// GL objects and progress of the upload, only touched on the GL thread
+	unsigned int VAO = 0, VBO = 0, EBO = 0;
+	size_t uploadedVertexBytes = 0;
+	size_t uploadedIndexBytes = 0;
+};
+
+namespace
+{
+	// Share of the full triangle count kept by each coarser level
+	const float LOD_RATIOS[] = { 0.5f, 0.25f, 0.125f };
 
-	_readVerticesAndIndices(p_vertexPath, p_trianglePath, vertices, triangles);
+	// Segments of the sphere drawn while an asynchronous load is running
+	const unsigned int PLACEHOLDER_X_SEGMENTS = 16;
+	const unsigned int PLACEHOLDER_Y_SEGMENTS = 8;
 
-	_generateBuffers(vertices, triangles);
+	// Bytes the uploads of finished asynchronous loads may still use this frame, see MeshGrid::BeginFrame
+	size_t uploadBytesLeft = SIZE_MAX;
 
-	_createTexture(p_texturePath);
+	// Loads run one after another on their own worker, parsing still spreads over ThreadPool::Shared
+	ThreadPool& _loadWorker()
+	{
+		static ThreadPool worker(1);
+		return worker;
+	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-}
+	// Folds the options that change the processed geometry into the cache key
+	uint64_t _processingHash(const MeshOptions& p_options, uint64_t p_seed)
+	{
+		const float processing[7] = { p_options.weldVertices ? 1.0f : 0.0f, p_options.weldEpsilon, p_options.optimizeMesh ? 1.0f : 0.0f, p_options.generateLods ? 1.0f : 0.0f,
+			p_options.buildMeshlets ? 1.0f : 0.0f, p_options.compressCache ? 1.0f : 0.0f, p_options.optimizeOverdraw ? 1.0f : 0.0f };
+		return MeshCache::HashBytes(processing, sizeof(processing), p_seed);
+	}
 
-MeshGrid::MeshGrid(const unsigned int p_noOfXSeg, const unsigned int p_noOfYSeg, const char* p_texturePath)
-{
-	std::vector<float> vertices;
-	std::vector<unsigned int> triangles;
+	// Welds, optimizes and builds the levels and meshlets; false for triangles that reference
+	// vertices the mesh does not have, which the processing would index out of bounds with
+	bool _processGeometry(MeshLoad& p_load, const MeshOptions& p_options)
+	{
+		const size_t noOfVertices = p_load.vertices.size() / MeshParser::FLOATS_PER_VERTEX;
+		if (p_load.triangles.size() % 3 != 0 ||
+			std::any_of(p_load.triangles.begin(), p_load.triangles.end(), [noOfVertices](unsigned int p_index) { return p_index >= noOfVertices; }))
+		{
+			std::cout << "Mesh has triangles with vertex indices past its " << noOfVertices << " vertices" << std::endl;
+			return false;
+		}
 
-	_createSphere(p_noOfXSeg, p_noOfYSeg, vertices, triangles);
+		if (p_options.weldVertices)
+		{
+			p_load.weld = MeshWelder::Weld(p_load.vertices, p_load.triangles, MeshParser::FLOATS_PER_VERTEX, p_options.weldEpsilon);
+		}
 
-	_generateBuffers(vertices, triangles);
+		if (p_options.optimizeMesh)
+		{
+			const size_t floatsPerVertex = MeshParser::FLOATS_PER_VERTEX;
+			MeshOptimizer::OptimizeVertexCache(p_load.triangles, p_load.vertices.size() / floatsPerVertex);
+			if (p_options.optimizeOverdraw)
+			{
+				MeshOptimizer::OptimizeOverdraw(p_load.triangles, p_load.vertices, floatsPerVertex);
+			}
+			MeshOptimizer::OptimizeVertexFetch(p_load.vertices, p_load.triangles, floatsPerVertex);
+		}
 
-	_createTexture(p_texturePath);
+		p_load.lods.assign(1, MeshLod{ 0, static_cast<unsigned int>(p_load.triangles.size()), 0.0f });
+		if (p_options.generateLods)
+		{
+			const size_t floatsPerVertex = MeshParser::FLOATS_PER_VERTEX;
+			p_load.lods = MeshSimplifier::BuildLodChain(p_load.vertices, floatsPerVertex, p_load.triangles, LOD_RATIOS, sizeof(LOD_RATIOS) / sizeof(LOD_RATIOS[0]));
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-}
+			for (size_t i = 1; i < p_load.lods.size(); ++i)
+			{
+				// the coarser levels reuse the vertex order of the full mesh, only their triangles get reordered
+				if (p_options.optimizeMesh)
+				{
+					std::vector<unsigned int> level(p_load.triangles.begin() + p_load.lods[i].indexOffset, p_load.triangles.begin() + p_load.lods[i].indexOffset + p_load.lods[i].indexCount);
+					MeshOptimizer::OptimizeVertexCache(level, p_load.vertices.size() / floatsPerVertex);
+					std::copy(level.begin(), level.end(), p_load.triangles.begin() + p_load.lods[i].indexOffset);
+				}
+			}
+		}
 
+		p_load.meshlets.clear();
+		if (p_options.buildMeshlets)
+		{
+			// clustering reorders the triangles of each level, cache locality stays good within a meshlet
+			for (MeshLod& lod : p_load.lods)
+			{
+				std::vector<Meshlet> meshlets = MeshletBuilder::Build(p_load.vertices, MeshParser::FLOATS_PER_VERTEX, p_load.triangles, lod.indexOffset, lod.indexCount);
+				lod.meshletOffset = static_cast<unsigned int>(p_load.meshlets.size());
+				lod.meshletCount = static_cast<unsigned int>(meshlets.size());
+				p_load.meshlets.insert(p_load.meshlets.end(), meshlets.begin(), meshlets.end());
+			}
+		}
 
+		p_load.noOfFloats = p_load.vertices.size();
+		p_load.noOfIndices = p_load.triangles.size();
+		return true;
+	}
 
-MeshGrid::~MeshGrid()
-{
-	if (m_VBO)
+	bool _loadFromCache(const std::string& p_cachePath, uint64_t p_sourceHash, MeshLoad& p_load)
 	{
-		glDeleteBuffers(1, &m_VBO);
+		std::unique_ptr<MeshCache> cache = std::make_unique<MeshCache>(p_cachePath.c_str(), p_sourceHash);
+		if (!cache->IsValid())
+		{
+			return false;
+		}
+
+		// a corrupt block is treated like a stale cache and rebuilt, so nothing goes into p_load before it decodes
+		std::vector<float> vertices;
+		std::vector<unsigned int> triangles;
+		if (cache->IsCompressed() && (!cache->DecodeVertices(vertices) || !cache->DecodeIndices(triangles)))
+		{
+			return false;
+		}
+
+		p_load.noOfFloats = cache->FloatCount();
+		p_load.noOfIndices = cache->IndexCount();
+		p_load.lods = cache->Lods();
+		p_load.meshlets = cache->Meshlets();
+
+		if (cache->IsCompressed())
+		{
+			p_load.vertices = std::move(vertices);
+			p_load.triangles = std::move(triangles);
+			return true;
+		}
+
+		// upload straight from the mapped cache pages when the cache is up to date
+		p_load.cache = std::move(cache);
+		return true;
 	}
 
-	if (m_VAO)
+	void _writeCache(const std::string& p_cachePath, uint64_t p_sourceHash, const MeshLoad& p_load, bool p_compress)
 	{
-		glDeleteVertexArrays(1, &m_VAO);
+		// missing or stale cache, rebuild it for the next run
+		if (!MeshCache::Write(p_cachePath.c_str(), p_sourceHash, p_load.vertices.data(), p_load.vertices.size(), p_load.triangles.data(), p_load.triangles.size(), p_load.lods, p_load.meshlets, p_compress))
+		{
+			std::cout << "Failed to write mesh cache " << p_cachePath << std::endl;
+		}
 	}
 
-	if (m_EBO)
+	bool _loadTextMesh(const char* p_vertexPath, const char* p_trianglePath, const MeshOptions& p_options, MeshLoad& p_load)
 	{
-		glDeleteBuffers(1, &m_EBO);
-	}
-}
+		MappedFile vertexFile(p_vertexPath);
+		MappedFile triangleFile(p_trianglePath);
 
-void MeshGrid::Render(Shader& shader)
-{
-	// bind Texture
-	glBindTexture(GL_TEXTURE_2D, m_texture);
+		if (!vertexFile.IsOpen() || !triangleFile.IsOpen())
+		{
+			std::cout << "Cannot open " << p_vertexPath << " or " << p_trianglePath << std::endl;
+			return false;
+		}
 
-	shader.Use();
+		const uint64_t sourceHash = _processingHash(p_options, MeshCache::HashSources(vertexFile, triangleFile));
+		const std::string cachePath = MeshCache::PathFor(p_vertexPath);
 
-	glBindVertexArray(m_VAO);
-	glDrawElements(GL_TRIANGLES, m_noOfIndices, GL_UNSIGNED_INT, 0);
-}
+		if (!_loadFromCache(cachePath, sourceHash, p_load))
+		{
+			MeshParser::ParseVerticesParallel(vertexFile.Data(), vertexFile.End(), p_load.vertices, ThreadPool::Shared());
+			MeshParser::ParseTrianglesParallel(triangleFile.Data(), triangleFile.End(), p_load.triangles, ThreadPool::Shared());
+			if (!_processGeometry(p_load, p_options))
+			{
+				return false;
+			}
+			_writeCache(cachePath, sourceHash, p_load, p_options.compressCache);
+		}
 
-void MeshGrid::_readVerticesAndIndices(const char* p_vertexPath, const char* p_trianglePath, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles)
-{
-	std::ifstream vertexFile(p_vertexPath);
-	std::ifstream triangleFile(p_trianglePath);
+		return true;
+	}
 
-	if (!vertexFile.is_open() || !triangleFile.is_open())
+	bool _loadImportedMesh(const char* p_meshPath, const MeshOptions& p_options, MeshLoad& p_load)
 	{
-		// open failed
-		exit(1);
+		uint64_t sourceHash;
+		{
+			// the file is only mapped for hashing, the importer streams it
+			MappedFile meshFile(p_meshPath);
+			if (!meshFile.IsOpen())
+			{
+				std::cout << "Cannot open " << p_meshPath << std::endl;
+				return false;
+			}
+			sourceHash = _processingHash(p_options, MeshCache::HashBytes(meshFile.Data(), meshFile.Size(), 0));
+		}
+
+		const std::string cachePath = MeshCache::PathFor(p_meshPath);
+
+		if (!_loadFromCache(cachePath, sourceHash, p_load))
+		{
+			if (!MeshImporter::Import(p_meshPath, p_load.vertices, p_load.triangles, p_options.importMemoryBudget))
+			{
+				return false;
+			}
+
+			if (!_processGeometry(p_load, p_options))
+			{
+				return false;
+			}
+			_writeCache(cachePath, sourceHash, p_load, p_options.compressCache);
+		}
+
+		return true;
 	}
 
-	float x, y, z, nx, ny, nz;
+	bool _loadGeneratedMesh(const MeshGrid::Generator& p_generate, const MeshOptions& p_options, MeshLoad& p_load)
+	{
+		p_generate(p_load.vertices, p_load.triangles);
+		return _processGeometry(p_load, p_options);
+	}
 
-	constexpr float _PI = glm::pi<float>();
+	// Nothing to generate, sphere_procedural.vs computes the vertices; see MeshOptions::proceduralSphere
+	bool _loadProceduralSphere(unsigned int p_noOfXSeg, unsigned int p_noOfYSeg, MeshLoad& p_load)
+	{
+		p_load.proceduralXSeg = std::max(1u, p_noOfXSeg);
+		p_load.proceduralYSeg = std::max(1u, p_noOfYSeg);
+		p_load.noOfIndices = static_cast<size_t>(p_load.proceduralXSeg) * p_load.proceduralYSeg * 6;
+		p_load.lods.assign(1, MeshLod{ 0, static_cast<unsigned int>(p_load.noOfIndices), 0.0f });
+		return true;
+	}
 
-	while (vertexFile >> x >> y >> z >> nx >> ny >> nz)
+	// Bounds and, for compact vertices, the quantized copy; picks what goes into the VBO and EBO
+	void _prepareBuffers(MeshLoad& p_load, bool p_compact)
 	{
-		p_vertices.push_back(x);
-		p_vertices.push_back(y);
-		p_vertices.push_back(z);
-		p_vertices.push_back(nx);
-		p_vertices.push_back(ny);
-		p_vertices.push_back(nz);
+		if (p_load.proceduralXSeg)
+		{
+			p_load.boundsCenter = glm::vec3(0.0f);
+			p_load.boundsRadius = 1.0f;
+			return;
+		}
+
+		const float* vertices = p_load.cache ? p_load.cache->Vertices() : p_load.vertices.data();
+		const unsigned int* triangles = p_load.cache ? p_load.cache->Indices() : p_load.triangles.data();
+		const size_t noOfVertices = p_load.noOfFloats / MeshParser::FLOATS_PER_VERTEX;
 
-		// calculate texture coordinate
-		if (y != -1.0f && y != 1.0f)
+		// bounding sphere around the box center, used for level selection
+		glm::vec3 minimum(0.0f), maximum(0.0f);
+		for (size_t i = 0; i < noOfVertices; ++i)
 		{
-			//regular dots
-			p_vertices.push_back(1.0f - (glm::atan(z, x) / _PI + 1.0f) / 2.0f);
-			p_vertices.push_back(1.0f - (y + 1.0f) / 2.0f);
+			const glm::vec3 position(vertices[i * MeshParser::FLOATS_PER_VERTEX], vertices[i * MeshParser::FLOATS_PER_VERTEX + 1], vertices[i * MeshParser::FLOATS_PER_VERTEX + 2]);
+			minimum = i == 0 ? position : glm::min(minimum, position);
+			maximum = i == 0 ? position : glm::max(maximum, position);
 		}
-		else
+		p_load.boundsCenter = (minimum + maximum) * 0.5f;
+		p_load.boundsRadius = glm::length(maximum - minimum) * 0.5f;
+
+		p_load.vertexData = vertices;
+		p_load.vertexBytes = p_load.noOfFloats * sizeof(float);
+		p_load.indexData = triangles;
+		p_load.indexBytes = p_load.noOfIndices * sizeof(unsigned int);
+		p_load.indexType = GL_UNSIGNED_INT;
+
+		if (p_compact && VertexQuantizer::Quantize(vertices, noOfVertices, triangles, p_load.noOfIndices, p_load.quantized))
 		{
-			if (y == -1.0f)
+			p_load.compact = true;
+			p_load.vertexData = p_load.quantized.vertices.data();
+			p_load.vertexBytes = p_load.quantized.vertices.size();
+
+			if (!p_load.quantized.indices16.empty())
 			{
-				// special treatment
-				p_vertices.push_back(0.0f);
-				p_vertices.push_back(1.0f);
+				p_load.indexType = GL_UNSIGNED_SHORT;
+				p_load.indexData = p_load.quantized.indices16.data();
+				p_load.indexBytes = p_load.noOfIndices * sizeof(uint16_t);
+			}
+		}
+	}
+
+	// Creates the buffers of a prepared load with undefined contents and sets up the vertex layout
+	void _beginUpload(MeshLoad& p_load)
+	{
+		glGenVertexArrays(1, &p_load.VAO);
+
+		// a procedural sphere draws from the VAO alone, the core profile needs one bound anyway
+		if (!p_load.proceduralXSeg)
+		{
+			glGenBuffers(1, &p_load.VBO);
+			glGenBuffers(1, &p_load.EBO);
+
+			glBindBuffer(GL_ARRAY_BUFFER, p_load.VBO);
+			glBufferData(GL_ARRAY_BUFFER, p_load.vertexBytes, nullptr, GL_STATIC_DRAW);
+
+			glBindVertexArray(p_load.VAO);
+
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, p_load.EBO);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, p_load.indexBytes, nullptr, GL_STATIC_DRAW);
+
+			if (p_load.compact)
+			{
+				const QuantizedMesh& quantized = p_load.quantized;
+
+				// position, unorm16 relative to the mesh bounds
+				glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, quantized.stride, (void*)0);
+				glEnableVertexAttribArray(0);
+				// normal vector, octahedral snorm16; unit spheres derive it from the position in sphere.vs
+				if (quantized.format == VertexFormat::Quantized)
+				{
+					glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, quantized.stride, (void*)(uintptr_t)quantized.normalOffset);
+					glEnableVertexAttribArray(1);
+				}
+				// texture coord attribute, unorm16
+				glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, quantized.stride, (void*)(uintptr_t)quantized.texCoordOffset);
+				glEnableVertexAttribArray(2);
 			}
 			else
 			{
-				p_vertices.push_back(0.0f);
-				p_vertices.push_back(0.0f);
+				// position
+				glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+				glEnableVertexAttribArray(0);
+				// normal vector, it is after vertex' position information
+				glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+				glEnableVertexAttribArray(1);
+				// texture coord attribute
+				glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+				glEnableVertexAttribArray(2);
 			}
+
+			glBindVertexArray(0);
 		}
 	}
 
-	unsigned int index0, index1, index2;
+	// Copies vertices, then indices until p_budget bytes are used up.
+	// Returns true once everything is on the GPU.
+	bool _continueUpload(MeshLoad& p_load, size_t& p_budget)
+	{
+		// GL_COPY_WRITE_BUFFER leaves the element buffer binding of the current VAO alone
+		if (p_load.uploadedVertexBytes < p_load.vertexBytes && p_budget > 0)
+		{
+			const size_t bytes = std::min(p_budget, p_load.vertexBytes - p_load.uploadedVertexBytes);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, p_load.VBO);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, p_load.uploadedVertexBytes, bytes, static_cast<const char*>(p_load.vertexData) + p_load.uploadedVertexBytes);
+			p_load.uploadedVertexBytes += bytes;
+			p_budget -= bytes;
+		}
+
+		if (p_load.uploadedIndexBytes < p_load.indexBytes && p_budget > 0)
+		{
+			const size_t bytes = std::min(p_budget, p_load.indexBytes - p_load.uploadedIndexBytes);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, p_load.EBO);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, p_load.uploadedIndexBytes, bytes, static_cast<const char*>(p_load.indexData) + p_load.uploadedIndexBytes);
+			p_load.uploadedIndexBytes += bytes;
+			p_budget -= bytes;
+		}
 
-	while (triangleFile >> index0 >> index1 >> index2)
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		return p_load.uploadedVertexBytes == p_load.vertexBytes && p_load.uploadedIndexBytes == p_load.indexBytes;
+	}
+
+	void _deleteGlObjects(unsigned int& p_VAO, unsigned int& p_VBO, unsigned int& p_EBO)
 	{
-		p_triangles.push_back(index0);
-		p_triangles.push_back(index1);
-		p_triangles.push_back(index2);
+		if (p_VBO)
+		{
+			glDeleteBuffers(1, &p_VBO);
+		}
+
+		if (p_VAO)
+		{
+			glDeleteVertexArrays(1, &p_VAO);
+		}
+
+		if (p_EBO)
+		{
+			glDeleteBuffers(1, &p_EBO);
+		}
+
+		p_VAO = p_VBO = p_EBO = 0;
 	}
+}
 
-	m_noOfVertices = p_vertices.size();
-	m_noOfIndices = p_triangles.size();
+MeshGrid::MeshGrid(const char* p_vertexPath, const char* p_trianglePath, const char* p_texturePath, const MeshOptions& p_options)
+	: m_lodPixelError(p_options.lodPixelError)
+{
+	const std::string vertexPath = p_vertexPath;
+	const std::string trianglePath = p_trianglePath;
+	_load([vertexPath, trianglePath, p_options](MeshLoad& p_load) { return _loadTextMesh(vertexPath.c_str(), trianglePath.c_str(), p_options, p_load); }, p_texturePath, p_options);
 }
 
-void MeshGrid::_createSphere(const unsigned int p_noOfXSeg, const unsigned int p_noOfYSeg, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles)
+MeshGrid::MeshGrid(const char* p_meshPath, const char* p_texturePath, const MeshOptions& p_options)
+	: m_lodPixelError(p_options.lodPixelError)
 {
+	const std::string meshPath = p_meshPath;
+	_load([meshPath, p_options](MeshLoad& p_load) { return _loadImportedMesh(meshPath.c_str(), p_options, p_load); }, p_texturePath, p_options);
+}
 
-	for (unsigned int y = 0; y <= p_noOfYSeg; ++y)
+MeshGrid::MeshGrid(const unsigned int p_noOfXSeg, const unsigned int p_noOfYSeg, const char* p_texturePath, const MeshOptions& p_options)
+	: m_lodPixelError(p_options.lodPixelError)
+{
+	if (p_options.proceduralSphere)
 	{
-		for (unsigned int x = 0; x <= p_noOfXSeg; ++x)
-		{
-			// Create x & y segments
-			float xSegments = static_cast<float>(x) / static_cast<float>(p_noOfXSeg);
-			float ySegments = static_cast<float>(y) / static_cast<float>(p_noOfYSeg);
+		_load([p_noOfXSeg, p_noOfYSeg](MeshLoad& p_load) { return _loadProceduralSphere(p_noOfXSeg, p_noOfYSeg, p_load); }, p_texturePath, p_options);
+		return;
+	}
 
-			float xPos = std::cos(xSegments * 2.0f * glm::pi<float>()) * std::sin(ySegments * glm::pi<float>());
-			float yPos = std::cos(ySegments * glm::pi<float>());
-			float zPos = std::sin(xSegments * 2.0f * glm::pi<float>()) * std::sin(ySegments * glm::pi<float>());
+	const Generator generate = [p_noOfXSeg, p_noOfYSeg](std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles)
+	{
+		ParametricSurface::Generate(ParametricSurface::Sphere(), p_noOfXSeg, p_noOfYSeg, p_vertices, p_triangles);
+	};
+	_load([generate, p_options](MeshLoad& p_load) { return _loadGeneratedMesh(generate, p_options, p_load); }, p_texturePath, p_options);
+}
 
-			// Set position vertices
-			p_vertices.push_back(xPos);
-			p_vertices.push_back(yPos);
-			p_vertices.push_back(zPos);
+MeshGrid::MeshGrid(SphereMesh::Tessellation p_tessellation, unsigned int p_resolution, const char* p_texturePath, const MeshOptions& p_options)
+	: MeshGrid([p_tessellation, p_resolution](std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles)
+		{
+			SphereMesh::Generate(p_tessellation, p_resolution, p_vertices, p_triangles);
+		}, p_texturePath, p_options)
+{
+}
 
-			// Set Normal vertices (color)
-			p_vertices.push_back(xPos);
-			p_vertices.push_back(yPos);
-			p_vertices.push_back(zPos);
+MeshGrid::MeshGrid(const Generator& p_generate, const char* p_texturePath, const MeshOptions& p_options)
+	: m_lodPixelError(p_options.lodPixelError)
+{
+	_load([p_generate, p_options](MeshLoad& p_load) { return _loadGeneratedMesh(p_generate, p_options, p_load); }, p_texturePath, p_options);
+}
 
-			// Set TexCoords vertices
-			p_vertices.push_back(1.0f - xSegments);
-			p_vertices.push_back(ySegments);
-		}
+void MeshGrid::_load(const std::function<bool(MeshLoad&)>& p_loadGeometry, const char* p_texturePath, const MeshOptions& p_options)
+{
+	m_loadGeometry = p_loadGeometry;
+	m_compact = p_options.compactVertices;
+	m_proceduralPlaceholder = p_options.proceduralSphere;
+	m_cubeMapTexture = p_options.cubeMapTexture;
+	ResidencyManager::Shared().AddMesh(this);
+
+	// the texture streams in over the next frames whichever way the geometry is loaded
+	if (p_texturePath)
+	{
+		m_texture = ResourceManager::Shared().Texture(p_texturePath, m_cubeMapTexture);
 	}
 
-	for (unsigned int y = 0; y < p_noOfYSeg; ++y)
+	if (!p_options.loadAsync)
 	{
-		for (unsigned int x = 0; x < p_noOfXSeg; ++x)
+		MeshLoad load;
+		_loadOnWorker(m_loadGeometry, m_compact, load);
+		if (!load.valid)
 		{
+			exit(1);
+		}
 
-			unsigned int topLeft = y * (p_noOfXSeg + 1) + x;
-			unsigned int bottomLeft = (y + 1) * (p_noOfXSeg + 1) + x;
+		size_t unlimited = SIZE_MAX;
+		_beginUpload(load);
+		_continueUpload(load, unlimited);
+		_adopt(load);
+	}
+	else
+	{
+		_adoptPlaceholder();
+		_queueLoad();
+	}
 
-			p_triangles.push_back(topLeft);
-			p_triangles.push_back(topLeft + 1);
-			p_triangles.push_back(bottomLeft);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+}
 
-			p_triangles.push_back(topLeft + 1);
-			p_triangles.push_back(bottomLeft + 1);
-			p_triangles.push_back(bottomLeft);
-		}
+void MeshGrid::_loadOnWorker(const std::function<bool(MeshLoad&)>& p_loadGeometry, bool p_compact, MeshLoad& p_load)
+{
+	// CPU side only, the worker never touches GL or the members of a mesh
+	p_load.valid = p_loadGeometry(p_load);
+	if (p_load.valid)
+	{
+		_prepareBuffers(p_load, p_compact);
 	}
+	p_load.ready = true;
+}
 
-	m_noOfVertices = p_vertices.size();
-	m_noOfIndices = p_triangles.size();
+void MeshGrid::_adoptPlaceholder()
+{
+	// coarse sphere, drawn until the real mesh is uploaded
+	MeshLoad placeholder;
+	if (m_proceduralPlaceholder)
+	{
+		_loadProceduralSphere(PLACEHOLDER_X_SEGMENTS, PLACEHOLDER_Y_SEGMENTS, placeholder);
+	}
+	else
+	{
+		ParametricSurface::Generate(ParametricSurface::Sphere(), PLACEHOLDER_X_SEGMENTS, PLACEHOLDER_Y_SEGMENTS, placeholder.vertices, placeholder.triangles);
+		placeholder.noOfFloats = placeholder.vertices.size();
+		placeholder.noOfIndices = placeholder.triangles.size();
+		placeholder.lods.assign(1, MeshLod{ 0, static_cast<unsigned int>(placeholder.noOfIndices), 0.0f });
+	}
+	_prepareBuffers(placeholder, false);
+
+	size_t unlimited = SIZE_MAX;
+	_beginUpload(placeholder);
+	_continueUpload(placeholder, unlimited);
+	_adopt(placeholder);
+}
+
+void MeshGrid::_queueLoad()
+{
+	std::shared_ptr<MeshLoad> load = std::make_shared<MeshLoad>();
+	m_pendingLoad = load;
+	_loadWorker().Enqueue([load, loadGeometry = m_loadGeometry, compact = m_compact]() { _loadOnWorker(loadGeometry, compact, *load); });
+}
+
+bool MeshGrid::Evict()
+{
+	// a load in flight is left to finish, a procedural sphere has nothing to give back
+	if (m_evicted || m_pendingLoad || m_vertexFormat == VertexFormat::Procedural)
+	{
+		return false;
+	}
+
+	_adoptPlaceholder();
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	m_evicted = true;
+	return true;
+}
+
+void MeshGrid::_updatePendingLoad()
+{
+	MeshLoad& load = *m_pendingLoad;
+
+	if (!load.valid)
+	{
+		std::cout << "Failed to load mesh, keeping the placeholder" << std::endl;
+		m_pendingLoad.reset();
+		m_evicted = false;
+		return;
+	}
+
+	if (!load.VAO)
+	{
+		_beginUpload(load);
+	}
+
+	if (_continueUpload(load, uploadBytesLeft))
+	{
+		_adopt(load);
+		m_pendingLoad.reset();
+		m_evicted = false;
+	}
+}
+
+void MeshGrid::_adopt(MeshLoad& p_load)
+{
+	_deleteGlObjects(m_VAO, m_VBO, m_EBO);
+
+	m_VAO = p_load.VAO;
+	m_VBO = p_load.VBO;
+	m_EBO = p_load.EBO;
+	p_load.VAO = p_load.VBO = p_load.EBO = 0;
+	m_gpuBytes = p_load.vertexBytes + p_load.indexBytes;
+
+	m_noOfVertices = static_cast<unsigned int>(p_load.noOfFloats);
+	m_noOfIndices = static_cast<unsigned int>(p_load.noOfIndices);
+	m_indexType = p_load.indexType;
+	m_vertexFormat = p_load.proceduralXSeg ? VertexFormat::Procedural : (p_load.compact ? p_load.quantized.format : VertexFormat::Float);
+	m_proceduralXSeg = p_load.proceduralXSeg;
+	m_proceduralYSeg = p_load.proceduralYSeg;
+	m_positionMin = p_load.compact ? p_load.quantized.positionMin : glm::vec3(0.0f);
+	m_positionExtent = p_load.compact ? p_load.quantized.positionExtent : glm::vec3(1.0f);
+	m_boundsCenter = p_load.boundsCenter;
+	m_boundsRadius = p_load.boundsRadius;
+	m_lods = std::move(p_load.lods);
+	m_meshlets = std::move(p_load.meshlets);
+	m_currentLod = 0;
+
+	// loads from an up to date cache were welded when it was written and have nothing to report
+	if (p_load.weld.verticesBefore)
+	{
+		std::cout << "Weld: " << p_load.weld.verticesBefore << " -> " << p_load.weld.verticesAfter << " vertices, "
+			<< p_load.weld.bytesBefore << " -> " << p_load.weld.bytesAfter << " bytes" << std::endl;
+	}
+}
+
+void MeshGrid::BeginFrame(size_t p_uploadBudget)
+{
+	uploadBytesLeft = p_uploadBudget ? p_uploadBudget : SIZE_MAX;
+}
+
+MeshGrid::~MeshGrid()
+{
+	ResidencyManager::Shared().RemoveMesh(this);
+	_deleteGlObjects(m_VAO, m_VBO, m_EBO);
+
+	// a load still running on the worker keeps its own reference and is dropped when it finishes
+	if (m_pendingLoad)
+	{
+		_deleteGlObjects(m_pendingLoad->VAO, m_pendingLoad->VBO, m_pendingLoad->EBO);
+	}
+}
+
+void MeshGrid::SetCamera(const Camera* p_camera, const glm::mat4& p_projection, float p_viewportHeight)
+{
+	m_camera = p_camera;
+	m_projection = p_projection;
+	m_viewportHeight = p_viewportHeight;
 }
 
-void MeshGrid::_generateBuffers(std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles)
+void MeshGrid::SetModelMatrix(const glm::mat4& p_model)
 {
-	glGenVertexArrays(1, &m_VAO);
-	glGenBuffers(1, &m_VBO);
-	glGenBuffers(1, &m_EBO);
+	m_model = p_model;
+}
+
+void MeshGrid::SetPackedTexture(const PackedTexture& p_texture)
+{
+	m_packedTexture = p_texture;
+}
 
-	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-	glBufferData(GL_ARRAY_BUFFER, m_noOfVertices * sizeof(float), p_vertices.data(), GL_STATIC_DRAW);
+void MeshGrid::_prepareRender()
+{
+	// an evicted mesh draws the placeholder until it is loaded again
+	if (m_evicted && !m_pendingLoad)
+	{
+		_queueLoad();
+	}
+	if (m_pendingLoad && m_pendingLoad->ready)
+	{
+		_updatePendingLoad();
+	}
+
+	ResidencyManager::Shared().MeshDrawn(this);
+}
+
+Shader& MeshGrid::_program(Shader& p_shader)
+{
+	if (m_vertexFormat != VertexFormat::Procedural)
+	{
+		p_shader.Use();
+		return p_shader;
+	}
+
+	// next to the vertex shader of p_shader, whichever separator its path uses
+	if (!m_proceduralShader || m_proceduralShader->FragmentPath() != p_shader.FragmentPath())
+	{
+		const std::string& vertexPath = p_shader.VertexPath();
+		const size_t separator = vertexPath.find_last_of("/\\");
+		const std::string directory = separator == std::string::npos ? std::string() : vertexPath.substr(0, separator + 1);
+		m_proceduralShader = ResourceManager::Shared().Program((directory + "sphere_procedural.vs").c_str(), p_shader.FragmentPath().c_str());
+	}
+	m_proceduralShader->CopyUniforms(p_shader);
+	return *m_proceduralShader;
+}
+
+void MeshGrid::Render(Shader& p_shader)
+{
+	_prepareRender();
+	Shader& shader = _program(p_shader);
+
+	// bind Texture
+	if (m_packedTexture.texture)
+	{
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_packedTexture.texture);
+		shader.SetVec4("uTextureRect", m_packedTexture.rect);
+		shader.SetFloat("uTextureLayer", static_cast<float>(m_packedTexture.layer));
+	}
+	else if (m_texture)
+	{
+		ResidencyManager::Shared().TextureDrawn(m_texture.get(), 2.0f * m_boundsRadius * _pixelsPerUnit());
+		glBindTexture(m_cubeMapTexture ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D, m_texture->texture);
+	}
+
+	shader.SetMat4("model", m_model);
+	shader.SetMat3("t_i_model", glm::transpose(glm::inverse(glm::mat3(m_model))));
+	shader.SetInt("uVertexFormat", static_cast<int>(m_vertexFormat));
+	shader.SetVec3("uPositionMin", m_positionMin);
+	shader.SetVec3("uPositionExtent", m_positionExtent);
+
+	if (m_vertexFormat == VertexFormat::Procedural)
+	{
+		unsigned int noOfXSeg, noOfYSeg;
+		_selectProceduralSegments(noOfXSeg, noOfYSeg);
+		shader.SetInt("uNoOfXSeg", static_cast<int>(noOfXSeg));
+		shader.SetInt("uNoOfYSeg", static_cast<int>(noOfYSeg));
+
+		glBindVertexArray(m_VAO);
+		glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(noOfXSeg * noOfYSeg * 6));
+		m_currentLod = 0;
+		m_renderedTriangles = noOfXSeg * noOfYSeg * 2;
+		return;
+	}
+
+	m_currentLod = _selectLod();
+	const MeshLod& lod = m_lods[m_currentLod];
+	const size_t indexSize = m_indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
 
 	glBindVertexArray(m_VAO);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_noOfIndices * sizeof(unsigned int), p_triangles.data(), GL_STATIC_DRAW);
-
-	// position
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	// normal vector, it is after vertex' position information
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	// texture coord attribute
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-}
-
-void MeshGrid::_createTexture(const char* p_texturePath)
-{
-	glGenTextures(1, &m_texture);
-	glBindTexture(GL_TEXTURE_2D, m_texture); // all upcoming GL_TEXTURE_2D operations now have effect on this texture object
-	// set the texture wrapping parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	// set texture wrapping to GL_REPEAT (default wrapping method)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	// set texture filtering parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// load image, create texture and generate mipmaps
-	int width, height, nrChannels;
-	// The FileSystem::getPath(...) is part of the GitHub repository so we can find files on any IDE/platform; replace it with your own image path.
-	unsigned char* data = stbi_load(p_texturePath, &width, &height, &nrChannels, 0);
-	if (data)
-	{
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+	if (m_camera && lod.meshletCount > 0)
+	{
+		_drawVisibleMeshlets(lod, indexSize);
+		return;
+	}
+
+	glDrawElements(GL_TRIANGLES, lod.indexCount, m_indexType, (void*)(uintptr_t)(lod.indexOffset * indexSize));
+	m_renderedTriangles = lod.indexCount / 3;
+}
+
+void MeshGrid::RenderInstances(Shader& p_shader, unsigned int p_instanceBuffer, unsigned int p_firstInstance, unsigned int p_count)
+{
+	_prepareRender();
+	if (p_count == 0)
+	{
+		return;
+	}
+
+	Shader& shader = _program(p_shader);
+	shader.SetBool("uInstanced", true);
+	shader.SetInt("uVertexFormat", static_cast<int>(m_vertexFormat));
+	shader.SetVec3("uPositionMin", m_positionMin);
+	shader.SetVec3("uPositionExtent", m_positionExtent);
+
+	// GL 3.3 has no base instance, so the attributes start at the first record instead
+	glBindVertexArray(m_VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, p_instanceBuffer);
+	const GLsizei stride = sizeof(MeshInstance);
+	const uintptr_t offset = static_cast<uintptr_t>(p_firstInstance) * stride;
+	for (unsigned int column = 0; column < 4; ++column)
+	{
+		glVertexAttribPointer(5 + column, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(MeshInstance, model) + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(5 + column, 1);
+		glEnableVertexAttribArray(5 + column);
+	}
+	glVertexAttribPointer(9, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(MeshInstance, textureRect)));
+	glVertexAttribDivisor(9, 1);
+	glEnableVertexAttribArray(9);
+	glVertexAttribPointer(10, 1, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(MeshInstance, textureLayer)));
+	glVertexAttribDivisor(10, 1);
+	glEnableVertexAttribArray(10);
+	for (unsigned int column = 0; column < 3; ++column)
+	{
+		glVertexAttribPointer(11 + column, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(MeshInstance, normalMatrix) + column * sizeof(glm::vec3)));
+		glVertexAttribDivisor(11 + column, 1);
+		glEnableVertexAttribArray(11 + column);
+	}
+
+	if (m_vertexFormat == VertexFormat::Procedural)
+	{
+		unsigned int noOfXSeg, noOfYSeg;
+		_selectProceduralSegments(noOfXSeg, noOfYSeg);
+		shader.SetInt("uNoOfXSeg", static_cast<int>(noOfXSeg));
+		shader.SetInt("uNoOfYSeg", static_cast<int>(noOfYSeg));
+		glDrawArraysInstanced(GL_TRIANGLES, 0, static_cast<GLsizei>(noOfXSeg * noOfYSeg * 6), static_cast<GLsizei>(p_count));
+		m_currentLod = 0;
+		m_renderedTriangles = noOfXSeg * noOfYSeg * 2 * p_count;
 	}
 	else
 	{
-		std::cout << "Failed to load texture" << std::endl;
+		m_currentLod = _selectLod();
+		const MeshLod& lod = m_lods[m_currentLod];
+		const size_t indexSize = m_indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+		glDrawElementsInstanced(GL_TRIANGLES, lod.indexCount, m_indexType, (void*)(uintptr_t)(lod.indexOffset * indexSize), static_cast<GLsizei>(p_count));
+		m_renderedTriangles = lod.indexCount / 3 * p_count;
 	}
-	stbi_image_free(data);
+
+	// the VAO and program are shared with Render: no instanced arrays left behind, and no
+	// reference to the batch's buffer once it is deleted
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	for (unsigned int attribute = 5; attribute <= 13; ++attribute)
+	{
+		glDisableVertexAttribArray(attribute);
+		glVertexAttribDivisor(attribute, 0);
+		glVertexAttribPointer(attribute, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
+	}
+	glBindVertexArray(0);
+	shader.SetBool("uInstanced", false);
+}
+
+void MeshGrid::_drawVisibleMeshlets(const MeshLod& p_lod, size_t p_indexSize)
+{
+	// cull in object space, so the bounds stored with the meshlets can be used as they are
+	const glm::mat4 view = glm::lookAt(m_camera->Position, m_camera->Position + m_camera->Front, m_camera->Up);
+	glm::vec4 planes[6];
+	MeshletBuilder::ExtractFrustum(m_projection * view * m_model, planes);
+	const glm::vec3 cameraPosition = glm::vec3(glm::inverse(m_model) * glm::vec4(m_camera->Position, 1.0f));
+
+	m_drawCounts.clear();
+	m_drawOffsets.clear();
+	unsigned int nextIndex = 0;
+	m_renderedTriangles = 0;
+
+	for (unsigned int i = p_lod.meshletOffset; i < p_lod.meshletOffset + p_lod.meshletCount; ++i)
+	{
+		const Meshlet& meshlet = m_meshlets[i];
+		if (!MeshletBuilder::IsVisible(meshlet, planes, cameraPosition))
+		{
+			continue;
+		}
+
+		// neighbouring survivors are merged into one range
+		if (!m_drawCounts.empty() && meshlet.indexOffset == nextIndex)
+		{
+			m_drawCounts.back() += meshlet.indexCount;
+		}
+		else
+		{
+			m_drawCounts.push_back(meshlet.indexCount);
+			m_drawOffsets.push_back((const void*)(uintptr_t)(meshlet.indexOffset * p_indexSize));
+		}
+		nextIndex = meshlet.indexOffset + meshlet.indexCount;
+		m_renderedTriangles += meshlet.indexCount / 3;
+	}
+
+	if (!m_drawCounts.empty())
+	{
+		glMultiDrawElements(GL_TRIANGLES, m_drawCounts.data(), m_indexType, m_drawOffsets.data(), static_cast<GLsizei>(m_drawCounts.size()));
+	}
+}
+
+void MeshGrid::SetProceduralSegments(unsigned int p_noOfXSeg, unsigned int p_noOfYSeg)
+{
+	if (m_vertexFormat == VertexFormat::Procedural)
+	{
+		m_proceduralXSeg = std::max(1u, p_noOfXSeg);
+		m_proceduralYSeg = std::max(1u, p_noOfYSeg);
+	}
+}
+
+void MeshGrid::_selectProceduralSegments(unsigned int& p_noOfXSeg, unsigned int& p_noOfYSeg) const
+{
+	p_noOfXSeg = m_proceduralXSeg;
+	p_noOfYSeg = m_proceduralYSeg;
+	if (!m_camera)
+	{
+		return;
+	}
+
+	const glm::vec3 center = glm::vec3(m_model * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	const float scale = glm::max(glm::length(glm::vec3(m_model[0])), glm::max(glm::length(glm::vec3(m_model[1])), glm::length(glm::vec3(m_model[2]))));
+	const float distance = glm::length(center - m_camera->Position) - scale;
+	if (distance <= 0.0f)
+	{
+		return;
+	}
+
+	// a cell spanning the angle a in both directions lies up to about a^2 / 4 below the unit
+	// sphere, so the rows needed for the allowed object space error e are pi / (2 sqrt(e))
+	const float pixelsPerUnit = scale * MeshSimplifier::PixelsPerUnit(distance, glm::radians(m_camera->Zoom), m_viewportHeight);
+	const float allowedError = m_lodPixelError / pixelsPerUnit;
+	const float neededRows = glm::pi<float>() / (2.0f * std::sqrt(allowedError));
+	if (neededRows >= static_cast<float>(m_proceduralYSeg))
+	{
+		return;
+	}
+
+	// keep the column to row ratio, but never below an octahedron
+	p_noOfYSeg = std::max(2u, static_cast<unsigned int>(std::ceil(neededRows)));
+	p_noOfXSeg = std::max(4u, (m_proceduralXSeg * p_noOfYSeg + m_proceduralYSeg - 1) / m_proceduralYSeg);
+}
+
+size_t MeshGrid::_selectLod() const
+{
+	if (!m_camera || m_lods.size() < 2)
+	{
+		return 0;
+	}
+
+	const float pixelsPerUnit = _pixelsPerUnit();
+	if (std::isinf(pixelsPerUnit))
+	{
+		return 0;
+	}
+	return MeshSimplifier::SelectLod(m_lods, pixelsPerUnit, m_lodPixelError);
+}
+
+float MeshGrid::_pixelsPerUnit() const
+{
+	if (!m_camera)
+	{
+		return std::numeric_limits<float>::infinity();
+	}
+
+	// nearest point of the world space bounding sphere
+	const glm::vec3 center = glm::vec3(m_model * glm::vec4(m_boundsCenter, 1.0f));
+	const float scale = glm::max(glm::length(glm::vec3(m_model[0])), glm::max(glm::length(glm::vec3(m_model[1])), glm::length(glm::vec3(m_model[2]))));
+	const float distance = glm::length(center - m_camera->Position) - m_boundsRadius * scale;
+	if (distance <= 0.0f)
+	{
+		return std::numeric_limits<float>::infinity();
+	}
+
+	// object space lengths, so the scale of the model matrix is part of it
+	return scale * MeshSimplifier::PixelsPerUnit(distance, glm::radians(m_camera->Zoom), m_viewportHeight);
 }
\ No newline at end of file
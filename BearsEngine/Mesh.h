@@ -1,23 +1,200 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
 #include "Renderable.h"
+#include "SphereMesh.h"
+#include "TexturePacker.h"
+#include "VertexQuantizer.h"
 
+class Camera;
+struct MeshLoad;
+struct SharedTexture;
+
+// Optional processing applied to the geometry before it is uploaded
+struct MeshOptions
+{
+	// merge duplicated vertices whose position, normal and uv differ by at most weldEpsilon
+	bool weldVertices = false;
+	float weldEpsilon = 0.0f;
+
+	// reorder triangles for the post-transform cache, then vertices for fetch locality
+	bool optimizeMesh = false;
+	// with optimizeMesh, also sort triangle clusters so outward facing ones draw first; only pays for
+	// its extra cache misses on concave meshes that overdraw a lot
+	bool optimizeOverdraw = false;
+
+	// upload quantized 12/16 byte vertices and 16 bit indices where possible instead of 32 byte floats
+	bool compactVertices = false;
+
+	// build simplified levels (50%, 25%, 12.5% of the triangles) which Render picks from by screen size
+	bool generateLods = false;
+	// largest on-screen error in pixels a coarser level may introduce
+	float lodPixelError = 1.0f;
+
+	// split every level into meshlets so Render can skip clusters that are off-screen or face away
+	// from the camera (relies on back face culling being enabled)
+	bool buildMeshlets = false;
+
+	// store the .bmesh cache delta and FIFO coded (GeometryCodec), decoded again when it is loaded
+	bool compressCache = false;
+
+	// OBJ/PLY import fails instead of growing past this many bytes (0 means no limit)
+	size_t importMemoryBudget = 0;
+
+	// return right away with a coarse placeholder sphere; parsing and processing run on a background
+	// worker and Render swaps the real buffers in once they are uploaded. Textures always stream in
+	// through TextureLoader.
+	bool loadAsync = false;
+
+	// sphere constructor only: no vertex or index buffer at all, every vertex of the grid comes from
+	// gl_VertexID (VertexFormat::Procedural). Render links sphere_procedural.vs, next to the vertex
+	// shader it is given, with that program's fragment shader. The other geometry options do not apply.
+	bool proceduralSphere = false;
+
+	// the texture is an equirectangular image reprojected to a cube map (CubeMap), which Render
+	// binds as GL_TEXTURE_CUBE_MAP for sphere_cube.fs to sample by direction
+	bool cubeMapTexture = false;
+};
+
+// One object of an instanced draw, attributes 5 to 13 of sphere.vs, see MeshGrid::RenderInstances
+struct MeshInstance
+{
+	glm::mat4 model;
+	// transpose(inverse(mat3(model))), once per object instead of once per vertex
+	glm::mat3 normalMatrix;
+	// layer and uv rect of its image in the bound GL_TEXTURE_2D_ARRAY, see PackedTexture
+	glm::vec4 textureRect;
+	float textureLayer;
+};
+
+// p_texturePath may be nullptr for meshes drawn with a packed texture only
 class MeshGrid : public Renderable
 {
 public:
-	MeshGrid(const char* p_vertexPath, const char* p_trianglePath, const char* p_texturePath);
-	MeshGrid(const unsigned int p_noOfXSeg, const unsigned int p_noOfYSeg, const char* p_texturePath);
+	MeshGrid(const char* p_vertexPath, const char* p_trianglePath, const char* p_texturePath, const MeshOptions& p_options = MeshOptions());
+	// .obj or .ply file, see MeshImporter
+	MeshGrid(const char* p_meshPath, const char* p_texturePath, const MeshOptions& p_options = MeshOptions());
+	// Unit sphere, see ParametricSurface::Sphere
+	MeshGrid(const unsigned int p_noOfXSeg, const unsigned int p_noOfYSeg, const char* p_texturePath, const MeshOptions& p_options = MeshOptions());
+	// Unit sphere with an even triangle density, see SphereMesh::Tessellation for p_resolution
+	MeshGrid(SphereMesh::Tessellation p_tessellation, unsigned int p_resolution, const char* p_texturePath, const MeshOptions& p_options = MeshOptions());
+	// Procedural geometry in the pos/normal/uv float layout, e.g. ParametricSurface::Generate with a
+	// torus; runs on the load worker with MeshOptions::loadAsync
+	using Generator = std::function<void(std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles)>;
+	MeshGrid(const Generator& p_generate, const char* p_texturePath, const MeshOptions& p_options = MeshOptions());
 	~MeshGrid();
 	void Render(Shader& shader) override;
 
+	// Level selection and meshlet culling need the camera, its projection and the viewport
+	// height in pixels; without a camera the full mesh is drawn
+	void SetCamera(const Camera* p_camera, const glm::mat4& p_projection, float p_viewportHeight);
+	// Object to world transformation, uploaded as "model" by Render
+	void SetModelMatrix(const glm::mat4& p_model);
+	// Render binds the array of p_texture instead of the mesh's own texture and uploads the
+	// layer and rect for sphere_packed.fs
+	void SetPackedTexture(const PackedTexture& p_texture);
+
+	// Draws p_count instances from p_instanceBuffer, MeshInstance records from p_firstInstance on,
+	// in one call with the textures and the shader as they are bound. The level is the one Render
+	// would pick with the model matrix of SetModelMatrix, so that should be the nearest instance;
+	// meshlets are not culled. See MeshBatch.
+	void RenderInstances(Shader& shader, unsigned int p_instanceBuffer, unsigned int p_firstInstance, unsigned int p_count);
+
+	// Level and triangle count of the last Render call
+	size_t CurrentLod() const { return m_currentLod; }
+	unsigned int RenderedTriangles() const { return m_renderedTriangles; }
+	// Vertex and index buffer bytes of the geometry drawn now
+	size_t GpuBytes() const { return m_gpuBytes; }
+
+	// Grid of a MeshOptions::proceduralSphere mesh, takes effect with the next Render without any
+	// upload. With a camera, Render lowers it further while the sphere is small on screen.
+	void SetProceduralSegments(unsigned int p_noOfXSeg, unsigned int p_noOfYSeg);
+
+	// False while an asynchronous load is still drawing the placeholder
+	bool IsLoaded() const { return !m_pendingLoad; }
+
+	// Frees the geometry for the coarse placeholder sphere of asynchronous loads, see
+	// ResidencyManager; the next Render loads it again on the load worker. False if there was
+	// nothing to free.
+	bool Evict();
+	bool IsEvicted() const { return m_evicted; }
+
+	// Starts a new frame for the uploads of finished asynchronous loads: all meshes together copy
+	// at most p_uploadBudget bytes into GL buffers until the next call (0 means no limit)
+	static void BeginFrame(size_t p_uploadBudget);
+
 private:
-	void _readVerticesAndIndices(const char* p_vertexPath, const char* p_trianglePath, std::vector<float>& vertices, std::vector<unsigned int>& triangles);
-	void _createSphere(const unsigned int p_noOfXSeg, const unsigned int p_noOfYSeg, std::vector<float>& vertices, std::vector<unsigned int>& triangles);
-	void _generateBuffers(std::vector<float>& vertices, std::vector<unsigned int>& triangles);
-	void _createTexture(const char* p_texturePath);
+	// Runs p_loadGeometry here or on the load worker, see MeshOptions::loadAsync, and queues the texture
+	void _load(const std::function<bool(MeshLoad&)>& p_loadGeometry, const char* p_texturePath, const MeshOptions& p_options);
+	static void _loadOnWorker(const std::function<bool(MeshLoad&)>& p_loadGeometry, bool p_compact, MeshLoad& p_load);
+	void _adoptPlaceholder();
+	// Runs m_loadGeometry on the load worker into m_pendingLoad
+	void _queueLoad();
+	// Continues the upload of a finished asynchronous load within the frame budget
+	void _updatePendingLoad();
+	// Takes over the GL objects and levels of a completely uploaded load
+	void _adopt(MeshLoad& p_load);
+	// Continues loads and reports the mesh to the ResidencyManager, shared by both ways of drawing
+	void _prepareRender();
+	size_t _selectLod() const;
+	// On-screen pixels per object space unit at the nearest point of the bounds, infinite
+	// without a camera or from inside
+	float _pixelsPerUnit() const;
+	void _selectProceduralSegments(unsigned int& p_noOfXSeg, unsigned int& p_noOfYSeg) const;
+	// p_shader, or for procedural spheres its variant on sphere_procedural.vs with the uniforms
+	// of p_shader; in use either way
+	Shader& _program(Shader& p_shader);
+	void _drawVisibleMeshlets(const MeshLod& p_lod, size_t p_indexSize);
 	unsigned int m_noOfVertices;
 	unsigned int m_noOfIndices;
-	unsigned int m_VAO, m_VBO, m_EBO;
-	unsigned int m_texture;
+	unsigned int m_VAO = 0, m_VBO = 0, m_EBO = 0;
+	size_t m_gpuBytes = 0;
+	// shared with every other user of the same image, see ResourceManager
+	std::shared_ptr<const SharedTexture> m_texture;
+	PackedTexture m_packedTexture;
+
+	// vertex layout in the VBO and how sphere.vs has to decode it
+	VertexFormat m_vertexFormat = VertexFormat::Float;
+	glm::vec3 m_positionMin = glm::vec3(0.0f);
+	glm::vec3 m_positionExtent = glm::vec3(1.0f);
+	unsigned int m_indexType;
+	// grid of a procedural sphere
+	unsigned int m_proceduralXSeg = 0;
+	unsigned int m_proceduralYSeg = 0;
+	// sphere_procedural.vs with the fragment shader of the last program it was drawn with
+	std::shared_ptr<Shader> m_proceduralShader;
+
+	// detail levels inside the EBO, the full mesh first
+	std::vector<MeshLod> m_lods;
+	size_t m_currentLod = 0;
+	unsigned int m_renderedTriangles = 0;
+	float m_lodPixelError = 1.0f;
+	glm::vec3 m_boundsCenter = glm::vec3(0.0f);
+	float m_boundsRadius = 0.0f;
+
+	// clusters of all levels, see MeshLod::meshletOffset
+	std::vector<Meshlet> m_meshlets;
+	// index ranges that survived culling, reused every frame
+	std::vector<int> m_drawCounts;
+	std::vector<const void*> m_drawOffsets;
+
+	const Camera* m_camera = nullptr;
+	glm::mat4 m_projection = glm::mat4(1.0f);
+	float m_viewportHeight = 0.0f;
+	glm::mat4 m_model = glm::mat4(1.0f);
+
+	// asynchronous load still running or uploading, shared with the worker
+	std::shared_ptr<MeshLoad> m_pendingLoad;
+	// how the geometry was loaded, to load it again after an eviction
+	std::function<bool(MeshLoad&)> m_loadGeometry;
+	bool m_compact = false;
+	bool m_proceduralPlaceholder = false;
+	bool m_cubeMapTexture = false;
+	bool m_evicted = false;
 };
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include "MeshBatch.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#include "glad/glad.h"
+
+#include "ResidencyManager.h"
+
+MeshBatch::~MeshBatch()
+{
+	ResidencyManager::Shared().Untrack(this);
+	if (m_VBO)
+	{
+		glDeleteBuffers(1, &m_VBO);
+	}
+}
+
+void MeshBatch::Add(MeshGrid& p_mesh, const glm::mat4& p_model, const PackedTexture& p_texture)
+{
+	m_entries.push_back(Entry{ &p_mesh, p_texture.texture, MeshInstance{ p_model, glm::transpose(glm::inverse(glm::mat3(p_model))), p_texture.rect, static_cast<float>(p_texture.layer) } });
+}
+
+void MeshBatch::Render(Shader& shader, const glm::vec3& p_viewPosition)
+{
+	m_draws = 0;
+	m_renderedTriangles = 0;
+	if (m_entries.empty())
+	{
+		return;
+	}
+
+	// every run of the same mesh and texture is one draw
+	std::stable_sort(m_entries.begin(), m_entries.end(), [](const Entry& p_a, const Entry& p_b)
+	{
+		return p_a.mesh != p_b.mesh ? std::less<MeshGrid*>()(p_a.mesh, p_b.mesh) : p_a.texture < p_b.texture;
+	});
+	m_instances.clear();
+	for (const Entry& entry : m_entries)
+	{
+		m_instances.push_back(entry.instance);
+	}
+
+	// all instances of the frame in one buffer, orphaned every frame
+	if (!m_VBO)
+	{
+		glGenBuffers(1, &m_VBO);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+	const size_t bytes = m_instances.size() * sizeof(MeshInstance);
+	if (bytes > m_bufferBytes)
+	{
+		m_bufferBytes = std::max(bytes, 2 * m_bufferBytes);
+		ResidencyManager::Shared().Track(this, m_bufferBytes);
+	}
+	glBufferData(GL_ARRAY_BUFFER, m_bufferBytes, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, m_instances.data());
+
+	for (size_t first = 0; first < m_entries.size();)
+	{
+		MeshGrid* mesh = m_entries[first].mesh;
+		const unsigned int texture = m_entries[first].texture;
+		size_t last = first;
+		size_t nearest = first;
+		float nearestDistance = std::numeric_limits<float>::max();
+		for (; last < m_entries.size() && m_entries[last].mesh == mesh && m_entries[last].texture == texture; ++last)
+		{
+			const float distance = glm::length(glm::vec3(m_entries[last].instance.model[3]) - p_viewPosition);
+			if (distance < nearestDistance)
+			{
+				nearestDistance = distance;
+				nearest = last;
+			}
+		}
+
+		mesh->SetModelMatrix(m_entries[nearest].instance.model);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+		mesh->RenderInstances(shader, m_VBO, static_cast<unsigned int>(first), static_cast<unsigned int>(last - first));
+		++m_draws;
+		m_renderedTriangles += mesh->RenderedTriangles();
+		first = last;
+	}
+
+	m_entries.clear();
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "Mesh.h"
+
+// Collects the objects of a frame and draws them with one instanced draw per mesh and texture
+// array instead of one draw and one texture bind per object. The objects share meshes and get
+// their images from a TexturePacker, so differently textured objects in the same array still
+// end up in the same draw; sphere.vs reads the model matrix, layer and uv rect per instance.
+//
+// Meshes added here are drawn through the batch only, it moves their model matrix to the
+// nearest instance to pick the level of detail. All calls belong to the GL thread.
+class MeshBatch
+{
+public:
+	MeshBatch() = default;
+	~MeshBatch();
+	MeshBatch(const MeshBatch&) = delete;
+	MeshBatch& operator=(const MeshBatch&) = delete;
+
+	// Queues an object for the next Render
+	void Add(MeshGrid& p_mesh, const glm::mat4& p_model, const PackedTexture& p_texture);
+	// Draws everything queued since the last Render with shader (sphere.vs with sphere_packed.fs)
+	// and empties the queue
+	void Render(Shader& shader, const glm::vec3& p_viewPosition);
+
+	// Of the last Render
+	unsigned int Draws() const { return m_draws; }
+	unsigned int RenderedTriangles() const { return m_renderedTriangles; }
+
+private:
+	struct Entry
+	{
+		MeshGrid* mesh;
+		unsigned int texture;
+		MeshInstance instance;
+	};
+
+	std::vector<Entry> m_entries;
+	std::vector<MeshInstance> m_instances;
+	unsigned int m_VBO = 0;
+	size_t m_bufferBytes = 0;
+	unsigned int m_draws = 0;
+	unsigned int m_renderedTriangles = 0;
+};
\ No newline at end of file
@@ -0,0 +1,318 @@
+#include "MeshCache.h"
+
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "glad/glad.h"
+#include "GeometryCodec.h"
+
+namespace
+{
+	constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+	constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+	constexpr uint64_t PRIME_3 = 0x165667B19E3779F9ULL;
+	constexpr uint64_t PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+
+	// blocks start on a 64 byte boundary inside the file
+	constexpr uint64_t BLOCK_ALIGNMENT = 64;
+
+	inline uint64_t _rotl(uint64_t p_value, int p_bits)
+	{
+		return (p_value << p_bits) | (p_value >> (64 - p_bits));
+	}
+
+	inline uint64_t _read64(const unsigned char* p_data)
+	{
+		uint64_t value;
+		memcpy(&value, p_data, sizeof(value));
+		return value;
+	}
+
+	inline uint64_t _round(uint64_t p_accumulator, uint64_t p_input)
+	{
+		p_accumulator += p_input * PRIME_2;
+		p_accumulator = _rotl(p_accumulator, 31);
+		return p_accumulator * PRIME_1;
+	}
+
+	inline uint64_t _alignUp(uint64_t p_value)
+	{
+		return (p_value + BLOCK_ALIGNMENT - 1) & ~(BLOCK_ALIGNMENT - 1);
+	}
+}
+
+MeshCache::MeshCache(const char* p_cachePath, uint64_t p_sourceHash)
+	: m_file(p_cachePath)
+{
+	if (!m_file.IsOpen() || m_file.Size() < sizeof(MeshCacheHeader))
+	{
+		return;
+	}
+
+	const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(m_file.Data());
+
+	if (header->magic != MeshCacheHeader::MAGIC || header->version != MeshCacheHeader::VERSION || header->sourceHash != p_sourceHash)
+	{
+		return;
+	}
+
+	// the renderer only knows the default layout so far
+	MeshCacheHeader expected = {};
+	DefaultLayout(expected);
+	if (header->vertexStride != expected.vertexStride || header->attributeCount != expected.attributeCount ||
+		memcmp(header->attributes, expected.attributes, sizeof(expected.attributes)) != 0)
+	{
+		return;
+	}
+
+	// compressed blocks have no fixed size, their decoder checks the bounds
+	const bool rawSizes = header->vertexBytes == static_cast<uint64_t>(header->vertexCount) * header->vertexStride &&
+		header->indexBytes == static_cast<uint64_t>(header->indexCount) * sizeof(unsigned int);
+
+	if (header->compression > 1 || (!header->compression && !rawSizes) ||
+		header->vertexOffset + header->vertexBytes > m_file.Size() ||
+		header->indexOffset + header->indexBytes > m_file.Size() ||
+		header->meshletBytes % sizeof(Meshlet) != 0 ||
+		header->meshletOffset + header->meshletBytes > m_file.Size())
+	{
+		return;
+	}
+
+	if (header->lodCount == 0 || header->lodCount > MeshCacheHeader::MAX_LODS)
+	{
+		return;
+	}
+
+	for (uint32_t i = 0; i < header->lodCount; ++i)
+	{
+		if (static_cast<uint64_t>(header->lods[i].indexOffset) + header->lods[i].indexCount > header->indexCount ||
+			(static_cast<uint64_t>(header->lods[i].meshletOffset) + header->lods[i].meshletCount) * sizeof(Meshlet) > header->meshletBytes)
+		{
+			return;
+		}
+	}
+
+	m_header = header;
+}
+
+const float* MeshCache::Vertices() const
+{
+	return reinterpret_cast<const float*>(m_file.Data() + m_header->vertexOffset);
+}
+
+const unsigned int* MeshCache::Indices() const
+{
+	return reinterpret_cast<const unsigned int*>(m_file.Data() + m_header->indexOffset);
+}
+
+bool MeshCache::DecodeVertices(std::vector<float>& p_vertices) const
+{
+	p_vertices.resize(FloatCount());
+	return GeometryCodec::DecodeVertices(p_vertices.data(), m_header->vertexCount, m_header->vertexStride, reinterpret_cast<const uint8_t*>(m_file.Data() + m_header->vertexOffset), m_header->vertexBytes);
+}
+
+bool MeshCache::DecodeIndices(std::vector<unsigned int>& p_indices) const
+{
+	p_indices.resize(m_header->indexCount);
+	return GeometryCodec::DecodeIndices(p_indices.data(), m_header->indexCount, reinterpret_cast<const uint8_t*>(m_file.Data() + m_header->indexOffset), m_header->indexBytes);
+}
+
+size_t MeshCache::FloatCount() const
+{
+	return static_cast<size_t>(m_header->vertexCount) * FLOATS_PER_VERTEX;
+}
+
+size_t MeshCache::IndexCount() const
+{
+	return m_header->indexCount;
+}
+
+std::vector<MeshLod> MeshCache::Lods() const
+{
+	return std::vector<MeshLod>(m_header->lods, m_header->lods + m_header->lodCount);
+}
+
+std::vector<Meshlet> MeshCache::Meshlets() const
+{
+	const Meshlet* meshlets = reinterpret_cast<const Meshlet*>(m_file.Data() + m_header->meshletOffset);
+	return std::vector<Meshlet>(meshlets, meshlets + m_header->meshletBytes / sizeof(Meshlet));
+}
+
+void MeshCache::DefaultLayout(MeshCacheHeader& p_header)
+{
+	p_header.vertexStride = FLOATS_PER_VERTEX * sizeof(float);
+	p_header.attributeCount = 3;
+	memset(p_header.attributes, 0, sizeof(p_header.attributes));
+	// position
+	p_header.attributes[0] = { 0, 3, GL_FLOAT, 0, 0 };
+	// normal
+	p_header.attributes[1] = { 1, 3, GL_FLOAT, 0, 3 * sizeof(float) };
+	// texture coordinate
+	p_header.attributes[2] = { 2, 2, GL_FLOAT, 0, 6 * sizeof(float) };
+}
+
+bool MeshCache::Write(const char* p_cachePath, uint64_t p_sourceHash, const float* p_vertices, size_t p_floatCount, const unsigned int* p_indices, size_t p_indexCount, const std::vector<MeshLod>& p_lods, const std::vector<Meshlet>& p_meshlets, bool p_compress)
+{
+	MeshCacheHeader header = {};
+	header.magic = MeshCacheHeader::MAGIC;
+	header.version = MeshCacheHeader::VERSION;
+	header.sourceHash = p_sourceHash;
+	DefaultLayout(header);
+
+	header.vertexCount = static_cast<uint32_t>(p_floatCount / FLOATS_PER_VERTEX);
+	header.indexCount = static_cast<uint32_t>(p_indexCount);
+
+	if (p_lods.size() > MeshCacheHeader::MAX_LODS)
+	{
+		return false;
+	}
+
+	header.lodCount = p_lods.empty() ? 1 : static_cast<uint32_t>(p_lods.size());
+	header.lods[0] = { 0, header.indexCount, 0.0f };
+	for (size_t i = 0; i < p_lods.size(); ++i)
+	{
+		header.lods[i] = p_lods[i];
+	}
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		header.boundsMin[axis] = header.vertexCount ? FLT_MAX : 0.0f;
+		header.boundsMax[axis] = header.vertexCount ? -FLT_MAX : 0.0f;
+	}
+
+	for (uint32_t i = 0; i < header.vertexCount; ++i)
+	{
+		const float* position = p_vertices + i * FLOATS_PER_VERTEX;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			header.boundsMin[axis] = position[axis] < header.boundsMin[axis] ? position[axis] : header.boundsMin[axis];
+			header.boundsMax[axis] = position[axis] > header.boundsMax[axis] ? position[axis] : header.boundsMax[axis];
+		}
+	}
+
+	header.vertexBytes = static_cast<uint64_t>(header.vertexCount) * header.vertexStride;
+	header.indexBytes = static_cast<uint64_t>(header.indexCount) * sizeof(unsigned int);
+
+	const char* vertexBlock = reinterpret_cast<const char*>(p_vertices);
+	const char* indexBlock = reinterpret_cast<const char*>(p_indices);
+	std::vector<uint8_t> encodedVertices;
+	std::vector<uint8_t> encodedIndices;
+
+	// the index codec keeps the triangle order, so level and meshlet ranges stay valid
+	if (p_compress && header.indexCount % 3 == 0)
+	{
+		header.compression = 1;
+		GeometryCodec::EncodeVertices(p_vertices, header.vertexCount, header.vertexStride, encodedVertices);
+		GeometryCodec::EncodeIndices(p_indices, header.indexCount, encodedIndices);
+		header.vertexBytes = encodedVertices.size();
+		header.indexBytes = encodedIndices.size();
+		vertexBlock = reinterpret_cast<const char*>(encodedVertices.data());
+		indexBlock = reinterpret_cast<const char*>(encodedIndices.data());
+	}
+	header.vertexOffset = _alignUp(sizeof(MeshCacheHeader));
+	header.indexOffset = _alignUp(header.vertexOffset + header.vertexBytes);
+	header.meshletBytes = p_meshlets.size() * sizeof(Meshlet);
+	header.meshletOffset = _alignUp(header.indexOffset + header.indexBytes);
+
+	// write to a temporary file first so a crash never leaves a half written cache behind
+	std::string temporaryPath = std::string(p_cachePath) + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		const char padding[BLOCK_ALIGNMENT] = { 0 };
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(padding, header.vertexOffset - sizeof(header));
+		file.write(vertexBlock, header.vertexBytes);
+		file.write(padding, header.indexOffset - header.vertexOffset - header.vertexBytes);
+		file.write(indexBlock, header.indexBytes);
+		file.write(padding, header.meshletOffset - header.indexOffset - header.indexBytes);
+		file.write(reinterpret_cast<const char*>(p_meshlets.data()), header.meshletBytes);
+
+		if (!file.good())
+		{
+			file.close();
+			std::remove(temporaryPath.c_str());
+			return false;
+		}
+	}
+
+	std::remove(p_cachePath);
+	return std::rename(temporaryPath.c_str(), p_cachePath) == 0;
+}
+
+std::string MeshCache::PathFor(const char* p_vertexPath)
+{
+	return std::string(p_vertexPath) + ".bmesh";
+}
+
+uint64_t MeshCache::HashSources(const MappedFile& p_vertexFile, const MappedFile& p_triangleFile)
+{
+	uint64_t hash = HashBytes(p_vertexFile.Data(), p_vertexFile.Size(), 0);
+	return HashBytes(p_triangleFile.Data(), p_triangleFile.Size(), hash);
+}
+
+uint64_t MeshCache::HashBytes(const void* p_data, size_t p_size, uint64_t p_seed)
+{
+	// four independent 64 bit lanes so the loop is not bound by multiply latency
+	const unsigned char* cursor = static_cast<const unsigned char*>(p_data);
+	const unsigned char* end = cursor + p_size;
+	uint64_t hash;
+
+	if (p_size >= 32)
+	{
+		uint64_t lane0 = p_seed + PRIME_1 + PRIME_2;
+		uint64_t lane1 = p_seed + PRIME_2;
+		uint64_t lane2 = p_seed;
+		uint64_t lane3 = p_seed - PRIME_1;
+
+		while (end - cursor >= 32)
+		{
+			lane0 = _round(lane0, _read64(cursor));
+			lane1 = _round(lane1, _read64(cursor + 8));
+			lane2 = _round(lane2, _read64(cursor + 16));
+			lane3 = _round(lane3, _read64(cursor + 24));
+			cursor += 32;
+		}
+
+		hash = _rotl(lane0, 1) + _rotl(lane1, 7) + _rotl(lane2, 12) + _rotl(lane3, 18);
+		hash = (hash ^ _round(0, lane0)) * PRIME_1 + PRIME_4;
+		hash = (hash ^ _round(0, lane1)) * PRIME_1 + PRIME_4;
+		hash = (hash ^ _round(0, lane2)) * PRIME_1 + PRIME_4;
+		hash = (hash ^ _round(0, lane3)) * PRIME_1 + PRIME_4;
+	}
+	else
+	{
+		hash = p_seed + PRIME_3;
+	}
+
+	hash += static_cast<uint64_t>(p_size);
+
+	while (end - cursor >= 8)
+	{
+		hash ^= _round(0, _read64(cursor));
+		hash = _rotl(hash, 27) * PRIME_1 + PRIME_4;
+		cursor += 8;
+	}
+
+	while (cursor != end)
+	{
+		hash ^= (*cursor) * PRIME_3;
+		hash = _rotl(hash, 11) * PRIME_1;
+		++cursor;
+	}
+
+	hash ^= hash >> 33;
+	hash *= PRIME_2;
+	hash ^= hash >> 29;
+	hash *= PRIME_3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+
+// One vertex attribute as it is handed to glVertexAttribPointer
+struct MeshCacheAttribute
+{
+	uint32_t location;
+	uint32_t components;
+	uint32_t type;			// GL type enum, e.g. GL_FLOAT
+	uint32_t normalized;
+	uint32_t offset;		// byte offset inside one vertex
+};
+
+// Fixed size header at the start of a .bmesh file. All values are stored little endian.
+// The vertex and index blocks are placed after the header at the recorded offsets.
+struct MeshCacheHeader
+{
+	static constexpr uint32_t MAGIC = 0x48534D42; // "BMSH"
+	static constexpr uint32_t VERSION = 4;
+	static constexpr uint32_t MAX_ATTRIBUTES = 4;
+	static constexpr uint32_t MAX_LODS = 8;
+
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;
+
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t vertexStride;
+	uint32_t attributeCount;
+	MeshCacheAttribute attributes[MAX_ATTRIBUTES];
+
+	// 0: raw vertex and index blocks, 1: blocks coded with GeometryCodec
+	uint32_t compression;
+
+	float boundsMin[3];
+	float boundsMax[3];
+
+	// index ranges of the detail levels inside the index block, the full mesh first
+	uint32_t lodCount;
+	MeshLod lods[MAX_LODS];
+
+	uint64_t vertexOffset;
+	uint64_t vertexBytes;
+	uint64_t indexOffset;
+	uint64_t indexBytes;
+	uint64_t meshletOffset;
+	uint64_t meshletBytes;
+};
+
+// Binary cache of a text mesh (interleaved pos/normal/uv vertices and triangle indices).
+// The cache file is mapped read-only, so the vertex and index blocks can be passed to
+// glBufferData straight from the mapped pages.
+class MeshCache
+{
+public:
+	// Maps the cache file. The cache is only valid if it exists, has the expected
+	// layout and was built from sources with the given hash.
+	MeshCache(const char* p_cachePath, uint64_t p_sourceHash);
+
+	bool IsValid() const { return m_header != nullptr; }
+
+	// Raw blocks, only available if the cache is not compressed
+	bool IsCompressed() const { return m_header->compression != 0; }
+	const float* Vertices() const;
+	const unsigned int* Indices() const;
+	// Decode the blocks of a compressed cache; false if they are corrupt
+	bool DecodeVertices(std::vector<float>& p_vertices) const;
+	bool DecodeIndices(std::vector<unsigned int>& p_indices) const;
+	// number of floats and indices, matching MeshGrid::m_noOfVertices / m_noOfIndices
+	size_t FloatCount() const;
+	size_t IndexCount() const;
+	std::vector<MeshLod> Lods() const;
+	std::vector<Meshlet> Meshlets() const;
+
+	// Writes a new cache file, replacing any existing one. Without levels the whole index
+	// block is stored as a single level. Compressed caches are several times smaller but
+	// have to be decoded before the upload.
+	static bool Write(const char* p_cachePath, uint64_t p_sourceHash, const float* p_vertices, size_t p_floatCount, const unsigned int* p_indices, size_t p_indexCount,
+		const std::vector<MeshLod>& p_lods = std::vector<MeshLod>(), const std::vector<Meshlet>& p_meshlets = std::vector<Meshlet>(), bool p_compress = false);
+
+	// Location of the cache belonging to a text mesh
+	static std::string PathFor(const char* p_vertexPath);
+
+	// Content hash over both text files, used to detect stale caches
+	static uint64_t HashSources(const MappedFile& p_vertexFile, const MappedFile& p_triangleFile);
+	static uint64_t HashBytes(const void* p_data, size_t p_size, uint64_t p_seed);
+
+	// Layout written by this version: 3 float position, 3 float normal, 2 float uv
+	static constexpr uint32_t FLOATS_PER_VERTEX = 8;
+	static void DefaultLayout(MeshCacheHeader& p_header);
+
+private:
+	MappedFile m_file;
+	const MeshCacheHeader* m_header = nullptr;
+};
\ No newline at end of file
@@ -0,0 +1,832 @@
+#include "MeshImporter.h"
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "glm/glm.hpp"
+
+#include "MeshParser.h"
+
+namespace
+{
+	constexpr size_t FLOATS_PER_VERTEX = MeshParser::FLOATS_PER_VERTEX;
+
+	// size of the streaming read buffer, which is also the longest line that can be read
+	constexpr size_t STREAM_BUFFER_BYTES = 1 << 20;
+
+	// how many lines/elements are read between two memory budget checks
+	constexpr size_t BUDGET_CHECK_INTERVAL = 1 << 16;
+
+	constexpr unsigned int NONE = 0xFFFFFFFFu;
+
+	// Sequential reader over a file with a fixed size buffer
+	class FileStream
+	{
+	public:
+		FileStream(const char* p_path)
+			: m_buffer(STREAM_BUFFER_BYTES)
+		{
+			m_file = std::fopen(p_path, "rb");
+		}
+
+		~FileStream()
+		{
+			if (m_file)
+			{
+				std::fclose(m_file);
+			}
+		}
+
+		bool IsOpen() const { return m_file != nullptr; }
+
+		// Returns the next line without its line break. False at the end of the file or if a
+		// line does not fit into the buffer.
+		bool NextLine(const char*& p_begin, const char*& p_end)
+		{
+			while (true)
+			{
+				const char* begin = m_buffer.data() + m_begin;
+				const char* newline = static_cast<const char*>(memchr(begin, '\n', m_end - m_begin));
+
+				if (newline)
+				{
+					p_begin = begin;
+					p_end = newline > begin && newline[-1] == '\r' ? newline - 1 : newline;
+					m_begin = newline - m_buffer.data() + 1;
+					return true;
+				}
+
+				if (m_eof)
+				{
+					if (m_begin == m_end)
+					{
+						return false;
+					}
+
+					// last line without a line break
+					p_begin = begin;
+					p_end = m_buffer.data() + m_end;
+					p_end = p_end > p_begin && p_end[-1] == '\r' ? p_end - 1 : p_end;
+					m_begin = m_end;
+					return true;
+				}
+
+				if (m_begin == 0 && m_end == m_buffer.size())
+				{
+					std::cout << "Mesh import: line longer than " << STREAM_BUFFER_BYTES << " bytes" << std::endl;
+					return false;
+				}
+
+				_refill();
+			}
+		}
+
+		bool Read(void* p_destination, size_t p_bytes)
+		{
+			char* destination = static_cast<char*>(p_destination);
+			while (p_bytes > 0)
+			{
+				if (m_begin == m_end)
+				{
+					if (m_eof)
+					{
+						return false;
+					}
+					_refill();
+					continue;
+				}
+
+				size_t available = m_end - m_begin;
+				size_t bytes = available < p_bytes ? available : p_bytes;
+				memcpy(destination, m_buffer.data() + m_begin, bytes);
+				m_begin += bytes;
+				destination += bytes;
+				p_bytes -= bytes;
+			}
+			return true;
+		}
+
+	private:
+		void _refill()
+		{
+			// keep the unread tail and fill up the rest of the buffer
+			size_t remaining = m_end - m_begin;
+			memmove(m_buffer.data(), m_buffer.data() + m_begin, remaining);
+			m_begin = 0;
+			m_end = remaining;
+
+			size_t read = std::fread(m_buffer.data() + m_end, 1, m_buffer.size() - m_end, m_file);
+			m_end += read;
+			if (read == 0)
+			{
+				m_eof = true;
+			}
+		}
+
+		FILE* m_file = nullptr;
+		std::vector<char> m_buffer;
+		size_t m_begin = 0;
+		size_t m_end = 0;
+		bool m_eof = false;
+	};
+
+	inline const char* _skipSpaces(const char* p_cursor, const char* p_end)
+	{
+		while (p_cursor != p_end && (*p_cursor == ' ' || *p_cursor == '\t'))
+		{
+			++p_cursor;
+		}
+		return p_cursor;
+	}
+
+	inline const char* _skipToken(const char* p_cursor, const char* p_end)
+	{
+		while (p_cursor != p_end && *p_cursor != ' ' && *p_cursor != '\t')
+		{
+			++p_cursor;
+		}
+		return p_cursor;
+	}
+
+	// Signed integer without leading whitespace; returns nullptr if there is none
+	const char* _parseInt(const char* p_cursor, const char* p_end, long long& p_value)
+	{
+		std::from_chars_result result = std::from_chars(p_cursor, p_end, p_value);
+		return result.ec == std::errc() ? result.ptr : nullptr;
+	}
+
+	template<typename T>
+	size_t _capacityBytes(const std::vector<T>& p_vector)
+	{
+		return p_vector.capacity() * sizeof(T);
+	}
+
+	bool _overBudget(size_t p_bytes, size_t p_budget)
+	{
+		if (p_budget != 0 && p_bytes > p_budget)
+		{
+			std::cout << "Mesh import: " << p_bytes << " bytes exceed the memory budget of " << p_budget << " bytes" << std::endl;
+			return true;
+		}
+		return false;
+	}
+
+	// Area weighted vertex normals for the vertices flagged in p_needsNormal (all if empty).
+	// p_shareKey lets vertices that only differ in uv share one smooth normal.
+	void _computeNormals(std::vector<float>& p_vertices, const std::vector<unsigned int>& p_triangles, const std::vector<unsigned int>& p_shareKey, size_t p_noOfKeys, const std::vector<bool>& p_needsNormal)
+	{
+		const size_t noOfVertices = p_vertices.size() / FLOATS_PER_VERTEX;
+		auto key = [&](unsigned int p_vertex) { return p_shareKey.empty() ? p_vertex : p_shareKey[p_vertex]; };
+
+		std::vector<glm::vec3> accumulated(p_shareKey.empty() ? noOfVertices : p_noOfKeys, glm::vec3(0.0f));
+
+		for (size_t t = 0; t + 2 < p_triangles.size(); t += 3)
+		{
+			const float* a = &p_vertices[p_triangles[t] * FLOATS_PER_VERTEX];
+			const float* b = &p_vertices[p_triangles[t + 1] * FLOATS_PER_VERTEX];
+			const float* c = &p_vertices[p_triangles[t + 2] * FLOATS_PER_VERTEX];
+
+			// the cross product length is twice the area, so larger faces weigh more
+			glm::vec3 normal = glm::cross(glm::vec3(b[0] - a[0], b[1] - a[1], b[2] - a[2]), glm::vec3(c[0] - a[0], c[1] - a[1], c[2] - a[2]));
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				accumulated[key(p_triangles[t + corner])] += normal;
+			}
+		}
+
+		for (size_t v = 0; v < noOfVertices; ++v)
+		{
+			if (!p_needsNormal.empty() && !p_needsNormal[v])
+			{
+				continue;
+			}
+
+			glm::vec3 normal = accumulated[key(static_cast<unsigned int>(v))];
+			float length = glm::length(normal);
+			normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+
+			float* out = &p_vertices[v * FLOATS_PER_VERTEX + 3];
+			out[0] = normal.x;
+			out[1] = normal.y;
+			out[2] = normal.z;
+		}
+	}
+
+	// Open addressing map from an OBJ (position, uv, normal) index triple to the output vertex
+	class CornerMap
+	{
+	public:
+		CornerMap()
+		{
+			m_slots.assign(1024, Slot{ NONE, NONE, NONE, NONE });
+		}
+
+		unsigned int Find(unsigned int p_position, unsigned int p_texCoord, unsigned int p_normal, unsigned int p_newValue, bool& p_inserted)
+		{
+			if ((m_size + 1) * 2 > m_slots.size())
+			{
+				_grow();
+			}
+
+			size_t mask = m_slots.size() - 1;
+			size_t index = _hash(p_position, p_texCoord, p_normal) & mask;
+
+			while (true)
+			{
+				Slot& slot = m_slots[index];
+				if (slot.value == NONE)
+				{
+					slot = Slot{ p_position, p_texCoord, p_normal, p_newValue };
+					++m_size;
+					p_inserted = true;
+					return p_newValue;
+				}
+
+				if (slot.position == p_position && slot.texCoord == p_texCoord && slot.normal == p_normal)
+				{
+					p_inserted = false;
+					return slot.value;
+				}
+
+				index = (index + 1) & mask;
+			}
+		}
+
+		size_t Bytes() const { return _capacityBytes(m_slots); }
+
+	private:
+		struct Slot
+		{
+			unsigned int position;
+			unsigned int texCoord;
+			unsigned int normal;
+			unsigned int value;
+		};
+
+		static size_t _hash(unsigned int p_position, unsigned int p_texCoord, unsigned int p_normal)
+		{
+			uint64_t hash = p_position * 0x9E3779B97F4A7C15ULL;
+			hash ^= (hash >> 29) + p_texCoord * 0xC2B2AE3D27D4EB4FULL;
+			hash ^= (hash >> 31) + p_normal * 0x165667B19E3779F9ULL;
+			return static_cast<size_t>(hash ^ (hash >> 32));
+		}
+
+		void _grow()
+		{
+			std::vector<Slot> old;
+			old.swap(m_slots);
+			m_slots.assign(old.size() * 2, Slot{ NONE, NONE, NONE, NONE });
+			m_size = 0;
+
+			bool inserted;
+			for (const Slot& slot : old)
+			{
+				if (slot.value != NONE)
+				{
+					Find(slot.position, slot.texCoord, slot.normal, slot.value, inserted);
+				}
+			}
+		}
+
+		std::vector<Slot> m_slots;
+		size_t m_size = 0;
+	};
+
+	// OBJ indices are 1 based, negative ones count back from the last element
+	bool _resolveObjIndex(long long p_index, size_t p_count, unsigned int& p_resolved)
+	{
+		long long resolved = p_index < 0 ? static_cast<long long>(p_count) + p_index : p_index - 1;
+		if (resolved < 0 || resolved >= static_cast<long long>(p_count))
+		{
+			return false;
+		}
+		p_resolved = static_cast<unsigned int>(resolved);
+		return true;
+	}
+
+	enum class PlyType
+	{
+		Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid
+	};
+
+	struct PlyProperty
+	{
+		std::string name;
+		PlyType type = PlyType::Invalid;
+		bool isList = false;
+		PlyType countType = PlyType::Invalid;
+		int vertexSlot = -1;	// index into the 8 output floats, -1 if unused
+	};
+
+	struct PlyElement
+	{
+		std::string name;
+		size_t count = 0;
+		std::vector<PlyProperty> properties;
+	};
+
+	PlyType _plyType(const std::string& p_name)
+	{
+		if (p_name == "char" || p_name == "int8") return PlyType::Int8;
+		if (p_name == "uchar" || p_name == "uint8") return PlyType::UInt8;
+		if (p_name == "short" || p_name == "int16") return PlyType::Int16;
+		if (p_name == "ushort" || p_name == "uint16") return PlyType::UInt16;
+		if (p_name == "int" || p_name == "int32") return PlyType::Int32;
+		if (p_name == "uint" || p_name == "uint32") return PlyType::UInt32;
+		if (p_name == "float" || p_name == "float32") return PlyType::Float32;
+		if (p_name == "double" || p_name == "float64") return PlyType::Float64;
+		return PlyType::Invalid;
+	}
+
+	size_t _plyTypeSize(PlyType p_type)
+	{
+		switch (p_type)
+		{
+		case PlyType::Int8: case PlyType::UInt8: return 1;
+		case PlyType::Int16: case PlyType::UInt16: return 2;
+		case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32: return 4;
+		case PlyType::Float64: return 8;
+		default: return 0;
+		}
+	}
+
+	int _plyVertexSlot(const std::string& p_name)
+	{
+		if (p_name == "x") return 0;
+		if (p_name == "y") return 1;
+		if (p_name == "z") return 2;
+		if (p_name == "nx") return 3;
+		if (p_name == "ny") return 4;
+		if (p_name == "nz") return 5;
+		if (p_name == "u" || p_name == "s" || p_name == "texture_u" || p_name == "texture_s") return 6;
+		if (p_name == "v" || p_name == "t" || p_name == "texture_v" || p_name == "texture_t") return 7;
+		return -1;
+	}
+
+	// Reads one binary PLY scalar and converts it to double
+	bool _readPlyBinary(FileStream& p_stream, PlyType p_type, bool p_bigEndian, double& p_value)
+	{
+		unsigned char bytes[8];
+		size_t size = _plyTypeSize(p_type);
+		if (!p_stream.Read(bytes, size))
+		{
+			return false;
+		}
+
+		if (p_bigEndian)
+		{
+			for (size_t i = 0; i < size / 2; ++i)
+			{
+				std::swap(bytes[i], bytes[size - 1 - i]);
+			}
+		}
+
+		switch (p_type)
+		{
+		case PlyType::Int8: { int8_t v; memcpy(&v, bytes, 1); p_value = v; break; }
+		case PlyType::UInt8: { uint8_t v; memcpy(&v, bytes, 1); p_value = v; break; }
+		case PlyType::Int16: { int16_t v; memcpy(&v, bytes, 2); p_value = v; break; }
+		case PlyType::UInt16: { uint16_t v; memcpy(&v, bytes, 2); p_value = v; break; }
+		case PlyType::Int32: { int32_t v; memcpy(&v, bytes, 4); p_value = v; break; }
+		case PlyType::UInt32: { uint32_t v; memcpy(&v, bytes, 4); p_value = v; break; }
+		case PlyType::Float32: { float v; memcpy(&v, bytes, 4); p_value = v; break; }
+		case PlyType::Float64: { double v; memcpy(&v, bytes, 8); p_value = v; break; }
+		default: return false;
+		}
+		return true;
+	}
+
+	// Reads the next ASCII PLY value of the current line
+	bool _readPlyAscii(const char*& p_cursor, const char* p_end, double& p_value)
+	{
+		p_cursor = _skipSpaces(p_cursor, p_end);
+		std::from_chars_result result = std::from_chars(p_cursor, p_end, p_value);
+		if (result.ec != std::errc())
+		{
+			return false;
+		}
+		p_cursor = result.ptr;
+		return true;
+	}
+
+	bool _endsWith(const std::string& p_text, const char* p_suffix)
+	{
+		size_t length = strlen(p_suffix);
+		if (p_text.size() < length)
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < length; ++i)
+		{
+			char c = p_text[p_text.size() - length + i];
+			c = (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+			if (c != p_suffix[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+namespace MeshImporter
+{
+	bool ImportObj(const char* p_path, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles, size_t p_memoryBudget)
+	{
+		FileStream stream(p_path);
+		if (!stream.IsOpen())
+		{
+			std::cout << "Mesh import: cannot open " << p_path << std::endl;
+			return false;
+		}
+
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> texCoords;
+		std::vector<glm::vec3> normals;
+
+		// per output vertex: its position index, so computed normals are smooth across uv seams
+		std::vector<unsigned int> vertexPosition;
+		std::vector<bool> needsNormal;
+		bool anyMissingNormal = false;
+
+		CornerMap corners;
+		std::vector<unsigned int> polygon;
+
+		p_vertices.clear();
+		p_triangles.clear();
+
+		const char* line;
+		const char* lineEnd;
+		size_t lineNumber = 0;
+
+		while (stream.NextLine(line, lineEnd))
+		{
+			++lineNumber;
+			const char* cursor = _skipSpaces(line, lineEnd);
+			if (cursor == lineEnd || *cursor == '#')
+			{
+				continue;
+			}
+
+			const char* keywordEnd = _skipToken(cursor, lineEnd);
+			const size_t keywordLength = keywordEnd - cursor;
+
+			if (keywordLength == 1 && cursor[0] == 'v')
+			{
+				glm::vec3 position(0.0f);
+				const char* next = keywordEnd;
+				for (int axis = 0; axis < 3 && next; ++axis)
+				{
+					next = MeshParser::ParseFloat(next, lineEnd, position[axis]);
+				}
+				if (!next)
+				{
+					std::cout << "Mesh import: bad vertex in " << p_path << ":" << lineNumber << std::endl;
+					return false;
+				}
+				positions.push_back(position);
+			}
+			else if (keywordLength == 2 && cursor[0] == 'v' && cursor[1] == 't')
+			{
+				glm::vec2 texCoord(0.0f);
+				const char* next = MeshParser::ParseFloat(keywordEnd, lineEnd, texCoord.x);
+				// the v coordinate is optional
+				if (next)
+				{
+					MeshParser::ParseFloat(next, lineEnd, texCoord.y);
+				}
+				texCoords.push_back(texCoord);
+			}
+			else if (keywordLength == 2 && cursor[0] == 'v' && cursor[1] == 'n')
+			{
+				glm::vec3 normal(0.0f);
+				const char* next = keywordEnd;
+				for (int axis = 0; axis < 3 && next; ++axis)
+				{
+					next = MeshParser::ParseFloat(next, lineEnd, normal[axis]);
+				}
+				normals.push_back(normal);
+			}
+			else if (keywordLength == 1 && cursor[0] == 'f')
+			{
+				polygon.clear();
+				cursor = _skipSpaces(keywordEnd, lineEnd);
+
+				while (cursor != lineEnd)
+				{
+					// corner forms: p, p/t, p//n, p/t/n
+					long long indices[3] = { 0, 0, 0 };
+					const char* next = _parseInt(cursor, lineEnd, indices[0]);
+					if (!next)
+					{
+						std::cout << "Mesh import: bad face in " << p_path << ":" << lineNumber << std::endl;
+						return false;
+					}
+
+					for (int component = 1; component < 3 && next != lineEnd && *next == '/'; ++component)
+					{
+						++next;
+						const char* parsed = _parseInt(next, lineEnd, indices[component]);
+						next = parsed ? parsed : next;
+					}
+
+					unsigned int position, texCoord = NONE, normal = NONE;
+					if (!_resolveObjIndex(indices[0], positions.size(), position) ||
+						(indices[1] != 0 && !_resolveObjIndex(indices[1], texCoords.size(), texCoord)) ||
+						(indices[2] != 0 && !_resolveObjIndex(indices[2], normals.size(), normal)))
+					{
+						std::cout << "Mesh import: face index out of range in " << p_path << ":" << lineNumber << std::endl;
+						return false;
+					}
+
+					bool inserted;
+					const unsigned int newVertex = static_cast<unsigned int>(vertexPosition.size());
+					unsigned int vertex = corners.Find(position, texCoord, normal, newVertex, inserted);
+
+					if (inserted)
+					{
+						const glm::vec3& p = positions[position];
+						glm::vec3 n = normal != NONE ? normals[normal] : glm::vec3(0.0f);
+						glm::vec2 t = texCoord != NONE ? texCoords[texCoord] : glm::vec2(0.0f, 1.0f);
+
+						const float vertexData[FLOATS_PER_VERTEX] = { p.x, p.y, p.z, n.x, n.y, n.z, t.x, 1.0f - t.y };
+						p_vertices.insert(p_vertices.end(), vertexData, vertexData + FLOATS_PER_VERTEX);
+						vertexPosition.push_back(position);
+						needsNormal.push_back(normal == NONE);
+						anyMissingNormal = anyMissingNormal || normal == NONE;
+					}
+
+					polygon.push_back(vertex);
+					cursor = _skipSpaces(_skipToken(next, lineEnd), lineEnd);
+				}
+
+				// fan triangulation, fine for the convex polygons exporters write
+				for (size_t i = 2; i < polygon.size(); ++i)
+				{
+					p_triangles.push_back(polygon[0]);
+					p_triangles.push_back(polygon[i - 1]);
+					p_triangles.push_back(polygon[i]);
+				}
+			}
+
+			if (lineNumber % BUDGET_CHECK_INTERVAL == 0)
+			{
+				size_t bytes = _capacityBytes(positions) + _capacityBytes(texCoords) + _capacityBytes(normals) +
+					_capacityBytes(vertexPosition) + corners.Bytes() + _capacityBytes(p_vertices) + _capacityBytes(p_triangles);
+				if (_overBudget(bytes, p_memoryBudget))
+				{
+					return false;
+				}
+			}
+		}
+
+		if (anyMissingNormal)
+		{
+			_computeNormals(p_vertices, p_triangles, vertexPosition, positions.size(), needsNormal);
+		}
+
+		return true;
+	}
+
+	bool ImportPly(const char* p_path, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles, size_t p_memoryBudget)
+	{
+		FileStream stream(p_path);
+		if (!stream.IsOpen())
+		{
+			std::cout << "Mesh import: cannot open " << p_path << std::endl;
+			return false;
+		}
+
+		const char* line;
+		const char* lineEnd;
+
+		if (!stream.NextLine(line, lineEnd) || std::string(line, lineEnd) != "ply")
+		{
+			std::cout << "Mesh import: " << p_path << " is not a PLY file" << std::endl;
+			return false;
+		}
+
+		// header
+		bool ascii = false;
+		bool bigEndian = false;
+		std::vector<PlyElement> elements;
+
+		while (true)
+		{
+			if (!stream.NextLine(line, lineEnd))
+			{
+				std::cout << "Mesh import: PLY header of " << p_path << " is not terminated" << std::endl;
+				return false;
+			}
+
+			std::vector<std::string> words;
+			for (const char* cursor = _skipSpaces(line, lineEnd); cursor != lineEnd; cursor = _skipSpaces(cursor, lineEnd))
+			{
+				const char* wordEnd = _skipToken(cursor, lineEnd);
+				words.emplace_back(cursor, wordEnd);
+				cursor = wordEnd;
+			}
+
+			if (words.empty() || words[0] == "comment" || words[0] == "obj_info")
+			{
+				continue;
+			}
+
+			if (words[0] == "end_header")
+			{
+				break;
+			}
+
+			if (words[0] == "format" && words.size() >= 2)
+			{
+				ascii = words[1] == "ascii";
+				bigEndian = words[1] == "binary_big_endian";
+				if (!ascii && !bigEndian && words[1] != "binary_little_endian")
+				{
+					std::cout << "Mesh import: unknown PLY format " << words[1] << std::endl;
+					return false;
+				}
+			}
+			else if (words[0] == "element" && words.size() >= 3)
+			{
+				PlyElement element;
+				element.name = words[1];
+				element.count = std::strtoull(words[2].c_str(), nullptr, 10);
+				elements.push_back(element);
+			}
+			else if (words[0] == "property" && !elements.empty())
+			{
+				PlyProperty property;
+				if (words.size() >= 5 && words[1] == "list")
+				{
+					property.isList = true;
+					property.countType = _plyType(words[2]);
+					property.type = _plyType(words[3]);
+					property.name = words[4];
+				}
+				else if (words.size() >= 3)
+				{
+					property.type = _plyType(words[1]);
+					property.name = words[2];
+				}
+
+				if (property.type == PlyType::Invalid || (property.isList && property.countType == PlyType::Invalid))
+				{
+					std::cout << "Mesh import: unsupported PLY property in " << p_path << std::endl;
+					return false;
+				}
+
+				if (elements.back().name == "vertex" && !property.isList)
+				{
+					property.vertexSlot = _plyVertexSlot(property.name);
+				}
+				elements.back().properties.push_back(property);
+			}
+		}
+
+		bool hasNormals = false;
+		size_t noOfVertices = 0;
+		size_t noOfFaces = 0;
+		for (const PlyElement& element : elements)
+		{
+			if (element.name == "vertex")
+			{
+				noOfVertices = element.count;
+				for (const PlyProperty& property : element.properties)
+				{
+					hasNormals = hasNormals || property.vertexSlot == 3;
+				}
+			}
+			else if (element.name == "face")
+			{
+				noOfFaces = element.count;
+			}
+		}
+
+		// the counts are known up front, so the budget can be checked before reading anything
+		if (_overBudget(noOfVertices * FLOATS_PER_VERTEX * sizeof(float) + noOfFaces * 3 * sizeof(unsigned int), p_memoryBudget))
+		{
+			return false;
+		}
+
+		p_vertices.assign(noOfVertices * FLOATS_PER_VERTEX, 0.0f);
+		p_triangles.clear();
+		p_triangles.reserve(noOfFaces * 3);
+
+		std::vector<unsigned int> polygon;
+
+		for (const PlyElement& element : elements)
+		{
+			const bool isVertex = element.name == "vertex";
+			const bool isFace = element.name == "face";
+
+			for (size_t item = 0; item < element.count; ++item)
+			{
+				const char* cursor = nullptr;
+				if (ascii)
+				{
+					if (!stream.NextLine(line, lineEnd))
+					{
+						std::cout << "Mesh import: " << p_path << " ends early" << std::endl;
+						return false;
+					}
+					cursor = line;
+				}
+
+				for (const PlyProperty& property : element.properties)
+				{
+					size_t noOfValues = 1;
+					double value = 0.0;
+
+					if (property.isList)
+					{
+						bool read = ascii ? _readPlyAscii(cursor, lineEnd, value) : _readPlyBinary(stream, property.countType, bigEndian, value);
+						if (!read || value < 0.0)
+						{
+							std::cout << "Mesh import: bad list in " << p_path << std::endl;
+							return false;
+						}
+						noOfValues = static_cast<size_t>(value);
+						polygon.clear();
+					}
+
+					for (size_t i = 0; i < noOfValues; ++i)
+					{
+						bool read = ascii ? _readPlyAscii(cursor, lineEnd, value) : _readPlyBinary(stream, property.type, bigEndian, value);
+						if (!read)
+						{
+							std::cout << "Mesh import: " << p_path << " ends early" << std::endl;
+							return false;
+						}
+
+						if (isVertex && property.vertexSlot >= 0)
+						{
+							float stored = static_cast<float>(value);
+							// flip v so row 0 of the image is at v = 0, as in the rest of the engine
+							p_vertices[item * FLOATS_PER_VERTEX + property.vertexSlot] = property.vertexSlot == 7 ? 1.0f - stored : stored;
+						}
+						else if (isFace && property.isList && (property.name == "vertex_indices" || property.name == "vertex_index"))
+						{
+							if (value < 0.0 || value >= static_cast<double>(noOfVertices))
+							{
+								std::cout << "Mesh import: face index out of range in " << p_path << std::endl;
+								return false;
+							}
+							polygon.push_back(static_cast<unsigned int>(value));
+						}
+					}
+
+					if (isFace && property.isList && (property.name == "vertex_indices" || property.name == "vertex_index"))
+					{
+						for (size_t i = 2; i < polygon.size(); ++i)
+						{
+							p_triangles.push_back(polygon[0]);
+							p_triangles.push_back(polygon[i - 1]);
+							p_triangles.push_back(polygon[i]);
+						}
+					}
+				}
+
+				if (isFace && item % BUDGET_CHECK_INTERVAL == 0 && _overBudget(_capacityBytes(p_vertices) + _capacityBytes(p_triangles), p_memoryBudget))
+				{
+					return false;
+				}
+			}
+		}
+
+		if (!hasNormals)
+		{
+			_computeNormals(p_vertices, p_triangles, std::vector<unsigned int>(), 0, std::vector<bool>());
+		}
+
+		return true;
+	}
+
+	bool Import(const char* p_path, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles, size_t p_memoryBudget)
+	{
+		std::string path(p_path);
+		if (_endsWith(path, ".obj"))
+		{
+			return ImportObj(p_path, p_vertices, p_triangles, p_memoryBudget);
+		}
+
+		if (_endsWith(path, ".ply"))
+		{
+			return ImportPly(p_path, p_vertices, p_triangles, p_memoryBudget);
+		}
+
+		std::cout << "Mesh import: unknown file type " << p_path << std::endl;
+		return false;
+	}
+
+	bool IsSupported(const char* p_path)
+	{
+		std::string path(p_path);
+		return _endsWith(path, ".obj") || _endsWith(path, ".ply");
+	}
+}
\ No newline at end of file
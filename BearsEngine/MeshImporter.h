@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Importers for Wavefront OBJ and PLY (ASCII and binary) meshes.
+// Files are streamed through a fixed size read buffer instead of being loaded whole, and
+// polygons are triangulated as fans. The output matches the text mesh format: interleaved
+// pos/normal/uv floats (8 per vertex) and triangle indices. Missing normals are computed
+// from the faces, missing texture coordinates are 0. Texture coordinates are flipped
+// vertically since both formats put v = 0 at the bottom of the image.
+namespace MeshImporter
+{
+	// Fails when the file cannot be read or is malformed, or when the imported data would
+	// exceed p_memoryBudget bytes (0 means no limit).
+	bool ImportObj(const char* p_path, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles, size_t p_memoryBudget = 0);
+	bool ImportPly(const char* p_path, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles, size_t p_memoryBudget = 0);
+
+	// Picks the importer from the file extension (.obj or .ply)
+	bool Import(const char* p_path, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles, size_t p_memoryBudget = 0);
+
+	// True if Import() knows the file extension
+	bool IsSupported(const char* p_path);
+}
\ No newline at end of file
@@ -0,0 +1,511 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "glm/glm.hpp"
+
+namespace
+{
+	// Forsyth's tuning values
+	constexpr int FORSYTH_CACHE_SIZE = 32;
+	constexpr float CACHE_DECAY_POWER = 1.5f;
+	constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+	constexpr float VALENCE_BOOST_SCALE = 2.0f;
+	constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+	// cache used to find cluster boundaries for the overdraw pass
+	constexpr unsigned int CLUSTER_CACHE_SIZE = 16;
+
+	// overdraw measurement resolution per view
+	constexpr int OVERDRAW_RESOLUTION = 256;
+
+	float _vertexScore(int p_cachePosition, unsigned int p_remainingValence)
+	{
+		if (p_remainingValence == 0)
+		{
+			// no triangle needs this vertex anymore
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (p_cachePosition >= 0)
+		{
+			if (p_cachePosition < 3)
+			{
+				// used by the last triangle, deliberately less than the next few to avoid strips
+				score = LAST_TRIANGLE_SCORE;
+			}
+			else
+			{
+				const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+				score = std::pow(1.0f - (p_cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+			}
+		}
+
+		// boost vertices with few triangles left so lone triangles do not get stranded
+		score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(p_remainingValence), -VALENCE_BOOST_POWER);
+		return score;
+	}
+
+	// FIFO cache simulation step, returns the number of misses of one triangle
+	struct FifoCache
+	{
+		std::vector<size_t> insertedAt;
+		size_t clock = 0;
+		unsigned int size;
+
+		FifoCache(size_t p_noOfVertices, unsigned int p_size)
+			: insertedAt(p_noOfVertices, 0), size(p_size)
+		{
+		}
+
+		// timestamps start at 1 so 0 means never inserted
+		unsigned int Access(unsigned int p_vertex)
+		{
+			if (insertedAt[p_vertex] != 0 && clock - insertedAt[p_vertex] < size)
+			{
+				return 0;
+			}
+			insertedAt[p_vertex] = ++clock;
+			return 1;
+		}
+
+		void Reset()
+		{
+			clock += size;
+		}
+	};
+
+	// Cache misses of the whole index buffer on a FIFO cache of p_size entries
+	size_t _fifoMisses(const std::vector<unsigned int>& p_indices, size_t p_noOfVertices, unsigned int p_size)
+	{
+		FifoCache cache(p_noOfVertices, p_size);
+		size_t misses = 0;
+		for (unsigned int index : p_indices)
+		{
+			misses += cache.Access(index);
+		}
+		return misses;
+	}
+
+	glm::vec3 _position(const std::vector<float>& p_vertices, size_t p_floatsPerVertex, unsigned int p_index)
+	{
+		const float* position = p_vertices.data() + p_index * p_floatsPerVertex;
+		return glm::vec3(position[0], position[1], position[2]);
+	}
+
+	// The six orthographic views used for overdraw measurement, as rotations of the mesh.
+	// After the rotation the camera looks down -z.
+	glm::vec3 _viewRotate(const glm::vec3& p_position, int p_view)
+	{
+		switch (p_view)
+		{
+		case 0: return glm::vec3(p_position.x, p_position.y, p_position.z);
+		case 1: return glm::vec3(-p_position.x, p_position.y, -p_position.z);
+		case 2: return glm::vec3(p_position.z, p_position.y, -p_position.x);
+		case 3: return glm::vec3(-p_position.z, p_position.y, p_position.x);
+		case 4: return glm::vec3(p_position.x, p_position.z, -p_position.y);
+		default: return glm::vec3(p_position.x, -p_position.z, p_position.y);
+		}
+	}
+}
+
+namespace MeshOptimizer
+{
+	void OptimizeVertexCache(std::vector<unsigned int>& p_indices, size_t p_noOfVertices)
+	{
+		const size_t noOfTriangles = p_indices.size() / 3;
+		if (noOfTriangles == 0)
+		{
+			return;
+		}
+
+		// vertex -> triangle adjacency, as one array with per vertex offsets
+		std::vector<unsigned int> valence(p_noOfVertices, 0);
+		for (size_t i = 0; i < noOfTriangles * 3; ++i)
+		{
+			++valence[p_indices[i]];
+		}
+
+		std::vector<unsigned int> adjacencyOffset(p_noOfVertices + 1, 0);
+		for (size_t v = 0; v < p_noOfVertices; ++v)
+		{
+			adjacencyOffset[v + 1] = adjacencyOffset[v] + valence[v];
+		}
+
+		std::vector<unsigned int> adjacency(noOfTriangles * 3);
+		{
+			std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+			for (size_t t = 0; t < noOfTriangles; ++t)
+			{
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					unsigned int vertex = p_indices[t * 3 + corner];
+					adjacency[fill[vertex]++] = static_cast<unsigned int>(t);
+				}
+			}
+		}
+
+		// valence now counts the triangles that are not emitted yet
+		std::vector<float> vertexScore(p_noOfVertices);
+		for (size_t v = 0; v < p_noOfVertices; ++v)
+		{
+			vertexScore[v] = _vertexScore(-1, valence[v]);
+		}
+
+		std::vector<float> triangleScore(noOfTriangles);
+		std::vector<bool> emitted(noOfTriangles, false);
+		for (size_t t = 0; t < noOfTriangles; ++t)
+		{
+			triangleScore[t] = vertexScore[p_indices[t * 3]] + vertexScore[p_indices[t * 3 + 1]] + vertexScore[p_indices[t * 3 + 2]];
+		}
+
+		std::vector<unsigned int> result;
+		result.reserve(noOfTriangles * 3);
+
+		unsigned int cache[FORSYTH_CACHE_SIZE + 3];
+		unsigned int newCache[FORSYTH_CACHE_SIZE + 3];
+		int cacheCount = 0;
+
+		size_t bestTriangle = std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+		size_t inputCursor = 0;
+
+		while (result.size() < noOfTriangles * 3)
+		{
+			if (bestTriangle == noOfTriangles)
+			{
+				// nothing in the cache is connected to remaining triangles, continue in input order
+				while (emitted[inputCursor])
+				{
+					++inputCursor;
+				}
+				bestTriangle = inputCursor;
+			}
+
+			const unsigned int* triangle = &p_indices[bestTriangle * 3];
+			result.insert(result.end(), triangle, triangle + 3);
+			emitted[bestTriangle] = true;
+
+			// the emitted triangle's vertices go to the front of the cache
+			int newCount = 0;
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int vertex = triangle[corner];
+				newCache[newCount++] = vertex;
+
+				// drop the triangle from the vertex' remaining adjacency
+				unsigned int* begin = &adjacency[adjacencyOffset[vertex]];
+				unsigned int* end = begin + valence[vertex];
+				unsigned int* found = std::find(begin, end, static_cast<unsigned int>(bestTriangle));
+				std::swap(*found, *(end - 1));
+				--valence[vertex];
+			}
+
+			for (int i = 0; i < cacheCount; ++i)
+			{
+				unsigned int vertex = cache[i];
+				if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+				{
+					newCache[newCount++] = vertex;
+				}
+			}
+
+			// rescore everything that was or is in the cache
+			for (int i = 0; i < newCount; ++i)
+			{
+				unsigned int vertex = newCache[i];
+				int position = i < FORSYTH_CACHE_SIZE ? i : -1;
+
+				float score = _vertexScore(position, valence[vertex]);
+				float delta = score - vertexScore[vertex];
+				vertexScore[vertex] = score;
+
+				const unsigned int* begin = &adjacency[adjacencyOffset[vertex]];
+				for (unsigned int k = 0; k < valence[vertex]; ++k)
+				{
+					triangleScore[begin[k]] += delta;
+				}
+			}
+
+			// the next triangle is the best one connected to the cache
+			bestTriangle = noOfTriangles;
+			float bestScore = -1.0f;
+			for (int i = 0; i < newCount && i < FORSYTH_CACHE_SIZE; ++i)
+			{
+				unsigned int vertex = newCache[i];
+				const unsigned int* begin = &adjacency[adjacencyOffset[vertex]];
+				for (unsigned int k = 0; k < valence[vertex]; ++k)
+				{
+					if (triangleScore[begin[k]] > bestScore)
+					{
+						bestScore = triangleScore[begin[k]];
+						bestTriangle = begin[k];
+					}
+				}
+			}
+
+			cacheCount = newCount < FORSYTH_CACHE_SIZE ? newCount : FORSYTH_CACHE_SIZE;
+			memcpy(cache, newCache, cacheCount * sizeof(unsigned int));
+		}
+
+		// meshes that are already in a cache friendly order (e.g. row by row grids on larger caches)
+		// can come out worse, keep the input unless the new order misses less on both cache sizes
+		const size_t inputMisses16 = _fifoMisses(p_indices, p_noOfVertices, 16);
+		const size_t inputMisses32 = _fifoMisses(p_indices, p_noOfVertices, 32);
+		const size_t resultMisses16 = _fifoMisses(result, p_noOfVertices, 16);
+		const size_t resultMisses32 = _fifoMisses(result, p_noOfVertices, 32);
+		if (!(resultMisses16 <= inputMisses16 && resultMisses32 <= inputMisses32 && resultMisses16 + resultMisses32 < inputMisses16 + inputMisses32))
+		{
+			return;
+		}
+
+		p_indices.swap(result);
+	}
+
+	void OptimizeOverdraw(std::vector<unsigned int>& p_indices, const std::vector<float>& p_vertices, size_t p_floatsPerVertex, float p_threshold)
+	{
+		const size_t noOfTriangles = p_indices.size() / 3;
+		const size_t noOfVertices = p_vertices.size() / p_floatsPerVertex;
+		if (noOfTriangles == 0)
+		{
+			return;
+		}
+
+		// hard boundaries: triangles where the cache starts over (all three vertices miss)
+		std::vector<size_t> hardBoundaries;
+		{
+			FifoCache cache(noOfVertices, CLUSTER_CACHE_SIZE);
+			for (size_t t = 0; t < noOfTriangles; ++t)
+			{
+				unsigned int misses = cache.Access(p_indices[t * 3]) + cache.Access(p_indices[t * 3 + 1]) + cache.Access(p_indices[t * 3 + 2]);
+				if (misses == 3)
+				{
+					hardBoundaries.push_back(t);
+				}
+			}
+			hardBoundaries.push_back(noOfTriangles);
+		}
+
+		// soft boundaries: split a hard cluster further wherever the local ACMR stays within the threshold
+		std::vector<size_t> clusters;
+		for (size_t c = 0; c + 1 < hardBoundaries.size(); ++c)
+		{
+			const size_t begin = hardBoundaries[c];
+			const size_t end = hardBoundaries[c + 1];
+
+			FifoCache cache(noOfVertices, CLUSTER_CACHE_SIZE);
+			size_t clusterMisses = 0;
+			for (size_t t = begin; t < end; ++t)
+			{
+				clusterMisses += cache.Access(p_indices[t * 3]) + cache.Access(p_indices[t * 3 + 1]) + cache.Access(p_indices[t * 3 + 2]);
+			}
+			const float clusterAcmr = static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+			clusters.push_back(begin);
+			cache.Reset();
+
+			size_t runningMisses = 0;
+			size_t runningTriangles = 0;
+			for (size_t t = begin; t < end; ++t)
+			{
+				runningMisses += cache.Access(p_indices[t * 3]) + cache.Access(p_indices[t * 3 + 1]) + cache.Access(p_indices[t * 3 + 2]);
+				++runningTriangles;
+
+				if (t + 1 < end && static_cast<float>(runningMisses) / static_cast<float>(runningTriangles) <= clusterAcmr * p_threshold)
+				{
+					clusters.push_back(t + 1);
+					cache.Reset();
+					runningMisses = 0;
+					runningTriangles = 0;
+				}
+			}
+		}
+		clusters.push_back(noOfTriangles);
+
+		glm::vec3 meshCentroid(0.0f);
+		for (size_t v = 0; v < noOfVertices; ++v)
+		{
+			meshCentroid += _position(p_vertices, p_floatsPerVertex, static_cast<unsigned int>(v));
+		}
+		meshCentroid /= static_cast<float>(noOfVertices > 0 ? noOfVertices : 1);
+
+		// sort key: how much the cluster faces away from the mesh center
+		const size_t noOfClusters = clusters.size() - 1;
+		std::vector<float> sortKey(noOfClusters);
+		for (size_t c = 0; c < noOfClusters; ++c)
+		{
+			glm::vec3 centroid(0.0f);
+			glm::vec3 normal(0.0f);
+			float area = 0.0f;
+
+			for (size_t t = clusters[c]; t < clusters[c + 1]; ++t)
+			{
+				glm::vec3 a = _position(p_vertices, p_floatsPerVertex, p_indices[t * 3]);
+				glm::vec3 b = _position(p_vertices, p_floatsPerVertex, p_indices[t * 3 + 1]);
+				glm::vec3 d = _position(p_vertices, p_floatsPerVertex, p_indices[t * 3 + 2]);
+
+				glm::vec3 crossed = glm::cross(b - a, d - a);
+				float triangleArea = glm::length(crossed);
+
+				centroid += (a + b + d) * (triangleArea / 3.0f);
+				normal += crossed;
+				area += triangleArea;
+			}
+
+			centroid = area > 0.0f ? centroid / area : centroid;
+			float normalLength = glm::length(normal);
+			normal = normalLength > 0.0f ? normal / normalLength : normal;
+
+			sortKey[c] = glm::dot(centroid - meshCentroid, normal);
+		}
+
+		std::vector<size_t> order(noOfClusters);
+		for (size_t c = 0; c < noOfClusters; ++c)
+		{
+			order[c] = c;
+		}
+		std::stable_sort(order.begin(), order.end(), [&sortKey](size_t p_a, size_t p_b) { return sortKey[p_a] > sortKey[p_b]; });
+
+		std::vector<unsigned int> result;
+		result.reserve(p_indices.size());
+		for (size_t c : order)
+		{
+			result.insert(result.end(), p_indices.begin() + clusters[c] * 3, p_indices.begin() + clusters[c + 1] * 3);
+		}
+
+		// the clusters rarely end with the cache contents the next one starts with, keep the cache
+		// order when reordering them costs more than the threshold allows
+		const size_t inputMisses = _fifoMisses(p_indices, noOfVertices, CLUSTER_CACHE_SIZE);
+		if (static_cast<float>(_fifoMisses(result, noOfVertices, CLUSTER_CACHE_SIZE)) > static_cast<float>(inputMisses) * p_threshold)
+		{
+			return;
+		}
+
+		p_indices.swap(result);
+	}
+
+	size_t OptimizeVertexFetch(std::vector<float>& p_vertices, std::vector<unsigned int>& p_indices, size_t p_floatsPerVertex)
+	{
+		const unsigned int unused = 0xFFFFFFFFu;
+		const size_t noOfVertices = p_vertices.size() / p_floatsPerVertex;
+
+		std::vector<unsigned int> remap(noOfVertices, unused);
+		std::vector<float> result;
+		result.reserve(p_vertices.size());
+
+		unsigned int next = 0;
+		for (unsigned int& index : p_indices)
+		{
+			if (remap[index] == unused)
+			{
+				remap[index] = next++;
+				result.insert(result.end(), p_vertices.begin() + index * p_floatsPerVertex, p_vertices.begin() + (index + 1) * p_floatsPerVertex);
+			}
+			index = remap[index];
+		}
+
+		p_vertices.swap(result);
+		return next;
+	}
+
+	VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& p_indices, size_t p_noOfVertices, unsigned int p_cacheSize)
+	{
+		VertexCacheStats stats;
+		stats.misses = _fifoMisses(p_indices, p_noOfVertices, p_cacheSize);
+
+		const size_t noOfTriangles = p_indices.size() / 3;
+		stats.acmr = noOfTriangles ? static_cast<float>(stats.misses) / static_cast<float>(noOfTriangles) : 0.0f;
+		stats.atvr = p_noOfVertices ? static_cast<float>(stats.misses) / static_cast<float>(p_noOfVertices) : 0.0f;
+		return stats;
+	}
+
+	OverdrawStats AnalyzeOverdraw(const std::vector<unsigned int>& p_indices, const std::vector<float>& p_vertices, size_t p_floatsPerVertex)
+	{
+		OverdrawStats stats;
+		const size_t noOfVertices = p_vertices.size() / p_floatsPerVertex;
+		const size_t noOfTriangles = p_indices.size() / 3;
+
+		std::vector<float> depth(OVERDRAW_RESOLUTION * OVERDRAW_RESOLUTION);
+		std::vector<glm::vec3> projected(noOfVertices);
+
+		for (int view = 0; view < 6; ++view)
+		{
+			glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX);
+			for (size_t v = 0; v < noOfVertices; ++v)
+			{
+				projected[v] = _viewRotate(_position(p_vertices, p_floatsPerVertex, static_cast<unsigned int>(v)), view);
+				minimum = glm::min(minimum, projected[v]);
+				maximum = glm::max(maximum, projected[v]);
+			}
+
+			// fit the mesh into the viewport keeping its aspect ratio
+			float extent = std::max(maximum.x - minimum.x, maximum.y - minimum.y);
+			float scale = extent > 0.0f ? (OVERDRAW_RESOLUTION - 1) / extent : 0.0f;
+			for (glm::vec3& position : projected)
+			{
+				position.x = (position.x - minimum.x) * scale;
+				position.y = (position.y - minimum.y) * scale;
+			}
+
+			// larger z is closer to the camera
+			std::fill(depth.begin(), depth.end(), -FLT_MAX);
+
+			for (size_t t = 0; t < noOfTriangles; ++t)
+			{
+				const glm::vec3& a = projected[p_indices[t * 3]];
+				const glm::vec3& b = projected[p_indices[t * 3 + 1]];
+				const glm::vec3& d = projected[p_indices[t * 3 + 2]];
+
+				float area = (b.x - a.x) * (d.y - a.y) - (d.x - a.x) * (b.y - a.y);
+				if (area <= 0.0f)
+				{
+					// back facing or degenerate, culled like glFrontFace(GL_CCW) does
+					continue;
+				}
+
+				int minX = std::max(0, static_cast<int>(std::floor(std::min({ a.x, b.x, d.x }))));
+				int maxX = std::min(OVERDRAW_RESOLUTION - 1, static_cast<int>(std::ceil(std::max({ a.x, b.x, d.x }))));
+				int minY = std::max(0, static_cast<int>(std::floor(std::min({ a.y, b.y, d.y }))));
+				int maxY = std::min(OVERDRAW_RESOLUTION - 1, static_cast<int>(std::ceil(std::max({ a.y, b.y, d.y }))));
+
+				for (int y = minY; y <= maxY; ++y)
+				{
+					float py = y + 0.5f;
+					for (int x = minX; x <= maxX; ++x)
+					{
+						float px = x + 0.5f;
+
+						// barycentric weights from the edge functions
+						float w0 = (d.x - b.x) * (py - b.y) - (d.y - b.y) * (px - b.x);
+						float w1 = (a.x - d.x) * (py - d.y) - (a.y - d.y) * (px - d.x);
+						float w2 = (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+						if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+						{
+							continue;
+						}
+
+						float z = (w0 * a.z + w1 * b.z + w2 * d.z) / area;
+						float& stored = depth[y * OVERDRAW_RESOLUTION + x];
+
+						if (stored == -FLT_MAX)
+						{
+							++stats.pixelsCovered;
+						}
+
+						if (z > stored)
+						{
+							stored = z;
+							++stats.pixelsShaded;
+						}
+					}
+				}
+			}
+		}
+
+		stats.overdraw = stats.pixelsCovered ? static_cast<float>(stats.pixelsShaded) / static_cast<float>(stats.pixelsCovered) : 0.0f;
+		return stats;
+	}
+}
\ No newline at end of file
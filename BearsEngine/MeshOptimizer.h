@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Results of the post-transform cache simulation
+struct VertexCacheStats
+{
+	size_t misses = 0;
+	float acmr = 0.0f;		// transformed vertices per triangle, 0.5 is ideal for regular grids
+	float atvr = 0.0f;		// transformed vertices per vertex, 1.0 is ideal
+};
+
+// Results of the software overdraw measurement
+struct OverdrawStats
+{
+	size_t pixelsCovered = 0;
+	size_t pixelsShaded = 0;
+	float overdraw = 0.0f;	// shaded / covered, 1.0 is ideal
+};
+
+// Index and vertex reordering for GPU friendly triangle lists.
+// Vertices are interleaved floats with the position in the first three floats.
+namespace MeshOptimizer
+{
+	// Reorders triangles to maximize post-transform cache hits (Forsyth's linear speed algorithm),
+	// leaves them as they are when that does not lower the misses on 16 and 32 entry FIFO caches
+	void OptimizeVertexCache(std::vector<unsigned int>& p_indices, size_t p_noOfVertices);
+
+	// Splits the cache optimized triangle list into clusters and sorts them so outward facing
+	// clusters are drawn first, which lets early depth testing reject more of the hidden ones.
+	// Clusters are only split, and the result only kept, where it costs at most p_threshold times
+	// the original ACMR.
+	void OptimizeOverdraw(std::vector<unsigned int>& p_indices, const std::vector<float>& p_vertices, size_t p_floatsPerVertex, float p_threshold = 1.05f);
+
+	// Orders vertices by first use in the index buffer and drops unreferenced ones.
+	// Returns the new vertex count.
+	size_t OptimizeVertexFetch(std::vector<float>& p_vertices, std::vector<unsigned int>& p_indices, size_t p_floatsPerVertex);
+
+	// FIFO cache simulation, as found in most desktop GPUs
+	VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& p_indices, size_t p_noOfVertices, unsigned int p_cacheSize = 16);
+
+	// Rasterizes the mesh from the six axis directions with back face culling and depth test,
+	// counting how often covered pixels get shaded.
+	OverdrawStats AnalyzeOverdraw(const std::vector<unsigned int>& p_indices, const std::vector<float>& p_vertices, size_t p_floatsPerVertex);
+}
\ No newline at end of file
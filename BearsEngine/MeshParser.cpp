@@ -0,0 +1,411 @@
+#include "MeshParser.h"
+
+#include "ThreadPool.h"
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/constants.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESHPARSER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// chunks smaller than this are not worth a task
+	constexpr size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+	// exact powers of ten representable by a double, used for the fast conversion path
+	constexpr double POWERS_OF_TEN[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	inline bool _isSpace(char p_char)
+	{
+		return p_char == ' ' || p_char == '\n' || p_char == '\r' || p_char == '\t' || p_char == '\v' || p_char == '\f';
+	}
+
+	inline bool _isDigit(char p_char)
+	{
+		return static_cast<unsigned char>(p_char - '0') < 10;
+	}
+
+	inline const char* _skipSpaces(const char* p_cursor, const char* p_end)
+	{
+		while (p_cursor != p_end && _isSpace(*p_cursor))
+		{
+			++p_cursor;
+		}
+		return p_cursor;
+	}
+}
+
+namespace MeshParser
+{
+	const char* ParseFloat(const char* p_cursor, const char* p_end, float& p_value)
+	{
+		p_cursor = _skipSpaces(p_cursor, p_end);
+
+		bool negative = false;
+		if (p_cursor != p_end && (*p_cursor == '-' || *p_cursor == '+'))
+		{
+			negative = *p_cursor == '-';
+			++p_cursor;
+		}
+
+		// up to 19 significant digits fit into the mantissa, the rest only move the exponent
+		uint64_t mantissa = 0;
+		int significantDigits = 0;
+		int exponent = 0;
+		bool hasDigits = false;
+
+		while (p_cursor != p_end && _isDigit(*p_cursor))
+		{
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + static_cast<uint64_t>(*p_cursor - '0');
+				significantDigits += mantissa != 0;
+			}
+			else
+			{
+				++exponent;
+			}
+			hasDigits = true;
+			++p_cursor;
+		}
+
+		if (p_cursor != p_end && *p_cursor == '.')
+		{
+			++p_cursor;
+			while (p_cursor != p_end && _isDigit(*p_cursor))
+			{
+				if (significantDigits < 19)
+				{
+					mantissa = mantissa * 10 + static_cast<uint64_t>(*p_cursor - '0');
+					significantDigits += mantissa != 0;
+					--exponent;
+				}
+				hasDigits = true;
+				++p_cursor;
+			}
+		}
+
+		if (!hasDigits)
+		{
+			return nullptr;
+		}
+
+		if (p_cursor != p_end && (*p_cursor == 'e' || *p_cursor == 'E'))
+		{
+			const char* exponentCursor = p_cursor + 1;
+			bool negativeExponent = false;
+			if (exponentCursor != p_end && (*exponentCursor == '-' || *exponentCursor == '+'))
+			{
+				negativeExponent = *exponentCursor == '-';
+				++exponentCursor;
+			}
+
+			// "1e" without digits is the number 1 followed by garbage, same as strtof
+			if (exponentCursor != p_end && _isDigit(*exponentCursor))
+			{
+				int explicitExponent = 0;
+				while (exponentCursor != p_end && _isDigit(*exponentCursor))
+				{
+					if (explicitExponent < 10000)
+					{
+						explicitExponent = explicitExponent * 10 + (*exponentCursor - '0');
+					}
+					++exponentCursor;
+				}
+				exponent += negativeExponent ? -explicitExponent : explicitExponent;
+				p_cursor = exponentCursor;
+			}
+		}
+
+		double value = static_cast<double>(mantissa);
+		if (mantissa != 0 && exponent != 0)
+		{
+			if (exponent > 0 && exponent <= 22)
+			{
+				value *= POWERS_OF_TEN[exponent];
+			}
+			else if (exponent < 0 && exponent >= -22)
+			{
+				value /= POWERS_OF_TEN[-exponent];
+			}
+			else
+			{
+				value *= std::pow(10.0, exponent);
+			}
+		}
+
+		p_value = static_cast<float>(negative ? -value : value);
+		return p_cursor;
+	}
+
+	const char* ParseUInt(const char* p_cursor, const char* p_end, unsigned int& p_value)
+	{
+		p_cursor = _skipSpaces(p_cursor, p_end);
+
+		if (p_cursor != p_end && *p_cursor == '+')
+		{
+			++p_cursor;
+		}
+
+		if (p_cursor == p_end || !_isDigit(*p_cursor))
+		{
+			return nullptr;
+		}
+
+		unsigned int value = 0;
+		while (p_cursor != p_end && _isDigit(*p_cursor))
+		{
+			value = value * 10 + static_cast<unsigned int>(*p_cursor - '0');
+			++p_cursor;
+		}
+
+		p_value = value;
+		return p_cursor;
+	}
+
+	size_t CountLines(const char* p_begin, const char* p_end)
+	{
+		size_t count = 0;
+		const char* cursor = p_begin;
+
+#ifdef MESHPARSER_SSE2
+		const __m128i newline = _mm_set1_epi8('\n');
+		while (p_end - cursor >= 16)
+		{
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+			unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+			count += std::popcount(mask);
+			cursor += 16;
+		}
+#endif
+
+		while (cursor != p_end)
+		{
+			count += *cursor == '\n';
+			++cursor;
+		}
+
+		return count;
+	}
+
+	void SphericalTexCoord(float p_x, float p_y, float p_z, float* p_uv)
+	{
+		constexpr float _PI = glm::pi<float>();
+
+		if (p_y != -1.0f && p_y != 1.0f)
+		{
+			// regular dots
+			p_uv[0] = 1.0f - (glm::atan(p_z, p_x) / _PI + 1.0f) / 2.0f;
+			p_uv[1] = 1.0f - (p_y + 1.0f) / 2.0f;
+		}
+		else if (p_y == -1.0f)
+		{
+			// special treatment for the poles
+			p_uv[0] = 0.0f;
+			p_uv[1] = 1.0f;
+		}
+		else
+		{
+			p_uv[0] = 0.0f;
+			p_uv[1] = 0.0f;
+		}
+	}
+}
+
+namespace
+{
+	// Parses up to p_maxRows vertex rows into p_out. p_stop receives the position after the
+	// last complete row; parsing ends early at the first row that cannot be read.
+	size_t _parseVertexRows(const char* p_begin, const char* p_end, float* p_out, size_t p_maxRows, const char*& p_stop)
+	{
+		size_t noOfRows = 0;
+		const char* cursor = p_begin;
+
+		while (noOfRows < p_maxRows)
+		{
+			const char* next = cursor;
+			for (int i = 0; i < 6 && next; ++i)
+			{
+				next = MeshParser::ParseFloat(next, p_end, p_out[i]);
+			}
+
+			if (!next)
+			{
+				break;
+			}
+
+			MeshParser::SphericalTexCoord(p_out[0], p_out[1], p_out[2], p_out + 6);
+
+			cursor = next;
+			p_out += MeshParser::FLOATS_PER_VERTEX;
+			++noOfRows;
+		}
+
+		p_stop = cursor;
+		return noOfRows;
+	}
+
+	size_t _parseTriangleRows(const char* p_begin, const char* p_end, unsigned int* p_out, size_t p_maxRows, const char*& p_stop)
+	{
+		size_t noOfRows = 0;
+		const char* cursor = p_begin;
+
+		while (noOfRows < p_maxRows)
+		{
+			const char* next = MeshParser::ParseUInt(cursor, p_end, p_out[0]);
+			next = next ? MeshParser::ParseUInt(next, p_end, p_out[1]) : nullptr;
+			next = next ? MeshParser::ParseUInt(next, p_end, p_out[2]) : nullptr;
+
+			if (!next)
+			{
+				break;
+			}
+
+			cursor = next;
+			p_out += 3;
+			++noOfRows;
+		}
+
+		p_stop = cursor;
+		return noOfRows;
+	}
+
+	// Splits [p_begin, p_end) at line boundaries, parses the chunks on the pool straight into
+	// their slot of the output and closes the gaps left by chunks with blank or broken lines.
+	// The result is identical to parsing the whole range serially.
+	template<typename T, typename RowParser>
+	size_t _parseChunked(const char* p_begin, const char* p_end, std::vector<T>& p_out, size_t p_valuesPerRow, ThreadPool& p_pool, RowParser p_parseRows)
+	{
+		const size_t size = static_cast<size_t>(p_end - p_begin);
+		const size_t noOfThreads = static_cast<size_t>(p_pool.NoOfWorkers()) + 1;
+		size_t noOfChunks = size / MIN_CHUNK_BYTES;
+		noOfChunks = noOfChunks < 4 * noOfThreads ? noOfChunks : 4 * noOfThreads;
+		noOfChunks = noOfChunks > 0 ? noOfChunks : 1;
+
+		struct Chunk
+		{
+			const char* begin;
+			const char* end;
+			size_t maxRows;
+			size_t offset;		// first row slot reserved for this chunk
+			size_t noOfRows;
+			bool complete;		// parsing reached the end of the chunk
+		};
+
+		std::vector<Chunk> chunks(noOfChunks);
+		const char* cursor = p_begin;
+		for (size_t i = 0; i < noOfChunks; ++i)
+		{
+			const char* end = i + 1 == noOfChunks ? p_end : p_begin + size * (i + 1) / noOfChunks;
+			end = end < cursor ? cursor : end;
+			// move the split point just past the next newline
+			while (end != p_end && end[-1] != '\n')
+			{
+				++end;
+			}
+			chunks[i].begin = cursor;
+			chunks[i].end = end;
+			cursor = end;
+		}
+
+		// pass 1: line counts give every chunk an upper bound of rows, the prefix sum places them
+		p_pool.ParallelFor(noOfChunks, [&chunks](size_t p_index)
+		{
+			Chunk& chunk = chunks[p_index];
+			chunk.maxRows = MeshParser::CountLines(chunk.begin, chunk.end) + 1;
+		});
+
+		const size_t first = p_out.size();
+		size_t totalRows = 0;
+		for (Chunk& chunk : chunks)
+		{
+			chunk.offset = totalRows;
+			totalRows += chunk.maxRows;
+		}
+		p_out.resize(first + totalRows * p_valuesPerRow);
+
+		// pass 2: parse every chunk into its own slot
+		T* base = p_out.data() + first;
+		p_pool.ParallelFor(noOfChunks, [&chunks, base, p_valuesPerRow, p_parseRows](size_t p_index)
+		{
+			Chunk& chunk = chunks[p_index];
+			const char* stop;
+			chunk.noOfRows = p_parseRows(chunk.begin, chunk.end, base + chunk.offset * p_valuesPerRow, chunk.maxRows, stop);
+			while (stop != chunk.end && _isSpace(*stop))
+			{
+				++stop;
+			}
+			chunk.complete = stop == chunk.end;
+		});
+
+		// stitch: pack the rows and stop after the first chunk the serial parser would stop in
+		size_t noOfRows = 0;
+		for (const Chunk& chunk : chunks)
+		{
+			if (chunk.offset != noOfRows)
+			{
+				memmove(base + noOfRows * p_valuesPerRow, base + chunk.offset * p_valuesPerRow, chunk.noOfRows * p_valuesPerRow * sizeof(T));
+			}
+			noOfRows += chunk.noOfRows;
+
+			if (!chunk.complete)
+			{
+				break;
+			}
+		}
+
+		p_out.resize(first + noOfRows * p_valuesPerRow);
+		return noOfRows;
+	}
+}
+
+namespace MeshParser
+{
+	size_t ParseVertices(const char* p_begin, const char* p_end, std::vector<float>& p_vertices)
+	{
+		// one vertex per line; the last line may lack its newline
+		const size_t maxVertices = CountLines(p_begin, p_end) + 1;
+		const size_t firstFloat = p_vertices.size();
+		p_vertices.resize(firstFloat + maxVertices * FLOATS_PER_VERTEX);
+
+		const char* stop;
+		size_t noOfVertices = _parseVertexRows(p_begin, p_end, p_vertices.data() + firstFloat, maxVertices, stop);
+
+		p_vertices.resize(firstFloat + noOfVertices * FLOATS_PER_VERTEX);
+		return noOfVertices;
+	}
+
+	size_t ParseTriangles(const char* p_begin, const char* p_end, std::vector<unsigned int>& p_triangles)
+	{
+		const size_t maxTriangles = CountLines(p_begin, p_end) + 1;
+		const size_t firstIndex = p_triangles.size();
+		p_triangles.resize(firstIndex + maxTriangles * 3);
+
+		const char* stop;
+		size_t noOfTriangles = _parseTriangleRows(p_begin, p_end, p_triangles.data() + firstIndex, maxTriangles, stop);
+
+		p_triangles.resize(firstIndex + noOfTriangles * 3);
+		return noOfTriangles;
+	}
+
+	size_t ParseVerticesParallel(const char* p_begin, const char* p_end, std::vector<float>& p_vertices, ThreadPool& p_pool)
+	{
+		return _parseChunked(p_begin, p_end, p_vertices, FLOATS_PER_VERTEX, p_pool, _parseVertexRows);
+	}
+
+	size_t ParseTrianglesParallel(const char* p_begin, const char* p_end, std::vector<unsigned int>& p_triangles, ThreadPool& p_pool)
+	{
+		return _parseChunked(p_begin, p_end, p_triangles, 3, p_pool, _parseTriangleRows);
+	}
+}
\ No newline at end of file
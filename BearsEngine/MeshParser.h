@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class ThreadPool;
+
+// Parsers for the plain text mesh format (vertices.txt / triangles.txt).
+// They work directly on a memory range (usually a MappedFile), size the output
+// once and write into it without going through iostreams.
+namespace MeshParser
+{
+	// Number of floats emitted per vertex: position (3), normal (3), texture coordinate (2)
+	constexpr size_t FLOATS_PER_VERTEX = 8;
+
+	// Parses "x y z nx ny nz" rows and appends interleaved pos/normal/uv vertices.
+	// Returns the number of vertices appended.
+	size_t ParseVertices(const char* p_begin, const char* p_end, std::vector<float>& p_vertices);
+
+	// Parses "i0 i1 i2" rows and appends the indices. Returns the number of triangles appended.
+	size_t ParseTriangles(const char* p_begin, const char* p_end, std::vector<unsigned int>& p_triangles);
+
+	// Same results as ParseVertices / ParseTriangles, but the range is split into chunks at line
+	// boundaries which are parsed on the pool. Rows must not span several lines.
+	size_t ParseVerticesParallel(const char* p_begin, const char* p_end, std::vector<float>& p_vertices, ThreadPool& p_pool);
+	size_t ParseTrianglesParallel(const char* p_begin, const char* p_end, std::vector<unsigned int>& p_triangles, ThreadPool& p_pool);
+
+	// Counts '\n' characters in the range, 16 bytes at a time where SSE2 is available.
+	size_t CountLines(const char* p_begin, const char* p_end);
+
+	// Equirectangular texture coordinate of a point on the unit sphere
+	void SphericalTexCoord(float p_x, float p_y, float p_z, float* p_uv);
+
+	// Single-value parsers. They skip leading whitespace and return the position after the
+	// value, or nullptr if no value could be read.
+	const char* ParseFloat(const char* p_cursor, const char* p_end, float& p_value);
+	const char* ParseUInt(const char* p_cursor, const char* p_end, unsigned int& p_value);
+}
\ No newline at end of file
@@ -0,0 +1,524 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "glm/glm.hpp"
+
+namespace
+{
+	constexpr uint64_t EMPTY_KEY = ~0ULL;
+
+	// border planes weigh more than the surface so outlines are kept longer
+	constexpr double BORDER_WEIGHT = 10.0;
+
+	// collapses that turn a neighbouring triangle by more than ~78 degrees are rejected
+	constexpr float MIN_NORMAL_COSINE = 0.2f;
+
+	// a level that keeps more than this share of the previous one is not worth storing
+	constexpr float MIN_LOD_REDUCTION = 0.9f;
+
+	enum class VertexKind : uint8_t
+	{
+		Manifold,	// may collapse onto any neighbour
+		Border,		// may only collapse along an open border edge onto another border vertex
+		Locked		// shares its position with other vertices or sits on a non-manifold edge
+	};
+
+	// Sum of squared distances to a set of planes: p^T A p + 2 b^T p + c
+	struct Quadric
+	{
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+		double weight;
+	};
+
+	struct Collapse
+	{
+		unsigned int from;
+		unsigned int to;
+		double error;
+	};
+
+	void _addPlane(Quadric& p_quadric, const glm::dvec3& p_normal, double p_distance, double p_weight)
+	{
+		p_quadric.a00 += p_weight * p_normal.x * p_normal.x;
+		p_quadric.a01 += p_weight * p_normal.x * p_normal.y;
+		p_quadric.a02 += p_weight * p_normal.x * p_normal.z;
+		p_quadric.a11 += p_weight * p_normal.y * p_normal.y;
+		p_quadric.a12 += p_weight * p_normal.y * p_normal.z;
+		p_quadric.a22 += p_weight * p_normal.z * p_normal.z;
+		p_quadric.b0 += p_weight * p_normal.x * p_distance;
+		p_quadric.b1 += p_weight * p_normal.y * p_distance;
+		p_quadric.b2 += p_weight * p_normal.z * p_distance;
+		p_quadric.c += p_weight * p_distance * p_distance;
+		p_quadric.weight += p_weight;
+	}
+
+	void _addQuadric(Quadric& p_quadric, const Quadric& p_other)
+	{
+		p_quadric.a00 += p_other.a00;
+		p_quadric.a01 += p_other.a01;
+		p_quadric.a02 += p_other.a02;
+		p_quadric.a11 += p_other.a11;
+		p_quadric.a12 += p_other.a12;
+		p_quadric.a22 += p_other.a22;
+		p_quadric.b0 += p_other.b0;
+		p_quadric.b1 += p_other.b1;
+		p_quadric.b2 += p_other.b2;
+		p_quadric.c += p_other.c;
+		p_quadric.weight += p_other.weight;
+	}
+
+	// Weighted mean squared distance of p_position to the planes of both quadrics
+	double _evaluate(const Quadric& p_a, const Quadric& p_b, const glm::vec3& p_position)
+	{
+		const double x = p_position.x, y = p_position.y, z = p_position.z;
+		double error =
+			(p_a.a00 + p_b.a00) * x * x + (p_a.a11 + p_b.a11) * y * y + (p_a.a22 + p_b.a22) * z * z +
+			2.0 * ((p_a.a01 + p_b.a01) * x * y + (p_a.a02 + p_b.a02) * x * z + (p_a.a12 + p_b.a12) * y * z) +
+			2.0 * ((p_a.b0 + p_b.b0) * x + (p_a.b1 + p_b.b1) * y + (p_a.b2 + p_b.b2) * z) +
+			p_a.c + p_b.c;
+
+		const double weight = p_a.weight + p_b.weight;
+		// rounding can push a zero error slightly below zero
+		return error > 0.0 && weight > 0.0 ? error / weight : 0.0;
+	}
+
+	inline uint64_t _mix(uint64_t p_hash)
+	{
+		p_hash ^= p_hash >> 33;
+		p_hash *= 0xFF51AFD7ED558CCDULL;
+		p_hash ^= p_hash >> 33;
+		p_hash *= 0xC4CEB9FE1A85EC53ULL;
+		p_hash ^= p_hash >> 33;
+		return p_hash;
+	}
+
+	// Open addressing set of directed edges between canonical vertices
+	class EdgeSet
+	{
+	public:
+		void Reset(size_t p_noOfEdges)
+		{
+			size_t tableSize = 16;
+			while (tableSize < p_noOfEdges * 2)
+			{
+				tableSize <<= 1;
+			}
+			m_keys.assign(tableSize, EMPTY_KEY);
+			m_mask = tableSize - 1;
+		}
+
+		// false if the edge was already present, i.e. two triangles use it in the same direction
+		bool Insert(unsigned int p_from, unsigned int p_to)
+		{
+			const uint64_t key = (static_cast<uint64_t>(p_from) << 32) | p_to;
+			size_t index = _mix(key) & m_mask;
+			while (m_keys[index] != EMPTY_KEY)
+			{
+				if (m_keys[index] == key)
+				{
+					return false;
+				}
+				index = (index + 1) & m_mask;
+			}
+			m_keys[index] = key;
+			return true;
+		}
+
+		bool Contains(unsigned int p_from, unsigned int p_to) const
+		{
+			const uint64_t key = (static_cast<uint64_t>(p_from) << 32) | p_to;
+			size_t index = _mix(key) & m_mask;
+			while (m_keys[index] != EMPTY_KEY)
+			{
+				if (m_keys[index] == key)
+				{
+					return true;
+				}
+				index = (index + 1) & m_mask;
+			}
+			return false;
+		}
+
+	private:
+		std::vector<uint64_t> m_keys;
+		size_t m_mask = 0;
+	};
+
+	// Maps every vertex to the first vertex with exactly the same position
+	void _buildPositionRemap(const std::vector<glm::vec3>& p_positions, std::vector<unsigned int>& p_remap)
+	{
+		const size_t noOfVertices = p_positions.size();
+		size_t tableSize = 16;
+		while (tableSize < noOfVertices * 2)
+		{
+			tableSize <<= 1;
+		}
+
+		const unsigned int NONE = 0xFFFFFFFFu;
+		std::vector<unsigned int> table(tableSize, NONE);
+		p_remap.resize(noOfVertices);
+
+		for (size_t v = 0; v < noOfVertices; ++v)
+		{
+			// +0 and -0 compare equal, so they have to hash the same
+			uint32_t bits[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float value = p_positions[v][axis] == 0.0f ? 0.0f : p_positions[v][axis];
+				memcpy(&bits[axis], &value, sizeof(uint32_t));
+			}
+
+			size_t index = _mix((static_cast<uint64_t>(bits[0]) << 32 | bits[1]) ^ _mix(bits[2])) & (tableSize - 1);
+			while (table[index] != NONE && p_positions[table[index]] != p_positions[v])
+			{
+				index = (index + 1) & (tableSize - 1);
+			}
+
+			if (table[index] == NONE)
+			{
+				table[index] = static_cast<unsigned int>(v);
+			}
+			p_remap[v] = table[index];
+		}
+	}
+}
+
+namespace MeshSimplifier
+{
+	float Simplify(const std::vector<float>& p_vertices, size_t p_floatsPerVertex, const std::vector<unsigned int>& p_indices, size_t p_targetIndexCount, std::vector<unsigned int>& p_result)
+	{
+		p_result = p_indices;
+		if (p_result.size() <= p_targetIndexCount)
+		{
+			return 0.0f;
+		}
+
+		const size_t noOfVertices = p_vertices.size() / p_floatsPerVertex;
+
+		std::vector<glm::vec3> positions(noOfVertices);
+		for (size_t v = 0; v < noOfVertices; ++v)
+		{
+			const float* vertex = p_vertices.data() + v * p_floatsPerVertex;
+			positions[v] = glm::vec3(vertex[0], vertex[1], vertex[2]);
+		}
+
+		// seams duplicate a position with different normals or uvs; those vertices are locked
+		std::vector<unsigned int> remap;
+		_buildPositionRemap(positions, remap);
+		std::vector<unsigned int> noOfWedges(noOfVertices, 0);
+		for (size_t v = 0; v < noOfVertices; ++v)
+		{
+			++noOfWedges[remap[v]];
+		}
+
+		// quadrics live on the canonical vertex of each position
+		std::vector<Quadric> quadrics(noOfVertices, Quadric{});
+		for (size_t t = 0; t + 2 < p_result.size(); t += 3)
+		{
+			const glm::vec3& p0 = positions[p_result[t]];
+			glm::vec3 cross = glm::cross(positions[p_result[t + 1]] - p0, positions[p_result[t + 2]] - p0);
+			float length = glm::length(cross);
+			if (length == 0.0f)
+			{
+				continue;
+			}
+
+			// area weighted plane of the triangle
+			glm::dvec3 normal = glm::dvec3(cross / length);
+			double distance = -glm::dot(normal, glm::dvec3(p0));
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				_addPlane(quadrics[remap[p_result[t + corner]]], normal, distance, 0.5 * length);
+			}
+		}
+
+		EdgeSet edges;
+		std::vector<VertexKind> kinds(noOfVertices);
+		std::vector<unsigned int> triangleOffsets(noOfVertices + 1);
+		std::vector<unsigned int> vertexTriangles;
+		std::vector<unsigned int> collapseTarget(noOfVertices);
+		std::vector<uint8_t> frozen(noOfVertices);
+		std::vector<Collapse> collapses;
+		double maxError = 0.0;
+		bool firstPass = true;
+
+		// every pass collapses a set of independent edges, cheapest first
+		while (p_result.size() > p_targetIndexCount)
+		{
+			const size_t noOfTriangles = p_result.size() / 3;
+
+			for (size_t v = 0; v < noOfVertices; ++v)
+			{
+				kinds[v] = noOfWedges[remap[v]] > 1 ? VertexKind::Locked : VertexKind::Manifold;
+			}
+
+			// directed edges between positions; an edge without its reverse lies on an open border
+			edges.Reset(p_result.size());
+			for (size_t t = 0; t < noOfTriangles; ++t)
+			{
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					unsigned int a = p_result[t * 3 + corner];
+					unsigned int b = p_result[t * 3 + (corner + 1) % 3];
+					if (!edges.Insert(remap[a], remap[b]))
+					{
+						kinds[a] = VertexKind::Locked;
+						kinds[b] = VertexKind::Locked;
+					}
+				}
+			}
+
+			for (size_t t = 0; t < noOfTriangles; ++t)
+			{
+				const unsigned int* triangle = &p_result[t * 3];
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					unsigned int a = triangle[corner];
+					unsigned int b = triangle[(corner + 1) % 3];
+					if (edges.Contains(remap[b], remap[a]))
+					{
+						continue;
+					}
+
+					kinds[a] = kinds[a] == VertexKind::Locked ? VertexKind::Locked : VertexKind::Border;
+					kinds[b] = kinds[b] == VertexKind::Locked ? VertexKind::Locked : VertexKind::Border;
+
+					// planes through the border edge, perpendicular to the triangle, keep the outline in place
+					if (firstPass)
+					{
+						glm::vec3 edge = positions[b] - positions[a];
+						glm::vec3 normal = glm::cross(edge, positions[triangle[(corner + 2) % 3]] - positions[a]);
+						glm::vec3 planeNormal = glm::cross(edge, normal);
+						float length = glm::length(planeNormal);
+						if (length > 0.0f)
+						{
+							glm::dvec3 unitNormal = glm::dvec3(planeNormal / length);
+							double distance = -glm::dot(unitNormal, glm::dvec3(positions[a]));
+							double weight = BORDER_WEIGHT * glm::dot(edge, edge);
+							_addPlane(quadrics[remap[a]], unitNormal, distance, weight);
+							_addPlane(quadrics[remap[b]], unitNormal, distance, weight);
+						}
+					}
+				}
+			}
+			firstPass = false;
+
+			// triangles around each vertex
+			std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+			for (unsigned int index : p_result)
+			{
+				++triangleOffsets[index + 1];
+			}
+			for (size_t v = 0; v < noOfVertices; ++v)
+			{
+				triangleOffsets[v + 1] += triangleOffsets[v];
+			}
+			vertexTriangles.resize(p_result.size());
+			{
+				std::vector<unsigned int> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+				for (size_t i = 0; i < p_result.size(); ++i)
+				{
+					vertexTriangles[cursor[p_result[i]]++] = static_cast<unsigned int>(i / 3);
+				}
+			}
+
+			// cheapest valid direction of every edge
+			collapses.clear();
+			for (size_t t = 0; t < noOfTriangles; ++t)
+			{
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					unsigned int a = p_result[t * 3 + corner];
+					unsigned int b = p_result[t * 3 + (corner + 1) % 3];
+					const bool border = !edges.Contains(remap[b], remap[a]);
+
+					// interior edges are seen from both triangles, keep one of them
+					if (remap[a] == remap[b] || (!border && remap[a] > remap[b]))
+					{
+						continue;
+					}
+
+					auto allowed = [&](unsigned int p_from, unsigned int p_to)
+					{
+						return kinds[p_from] == VertexKind::Manifold ||
+							(kinds[p_from] == VertexKind::Border && border && kinds[p_to] != VertexKind::Manifold);
+					};
+
+					Collapse collapse = { 0, 0, -1.0 };
+					if (allowed(a, b))
+					{
+						collapse = { a, b, _evaluate(quadrics[remap[a]], quadrics[remap[b]], positions[b]) };
+					}
+					if (allowed(b, a))
+					{
+						double error = _evaluate(quadrics[remap[a]], quadrics[remap[b]], positions[a]);
+						if (collapse.error < 0.0 || error < collapse.error)
+						{
+							collapse = { b, a, error };
+						}
+					}
+
+					if (collapse.error >= 0.0)
+					{
+						collapses.push_back(collapse);
+					}
+				}
+			}
+
+			if (collapses.empty())
+			{
+				break;
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& p_a, const Collapse& p_b) { return p_a.error < p_b.error; });
+
+			for (size_t v = 0; v < noOfVertices; ++v)
+			{
+				collapseTarget[v] = static_cast<unsigned int>(v);
+			}
+			std::fill(frozen.begin(), frozen.end(), 0);
+
+			size_t remainingTriangles = noOfTriangles;
+			size_t noOfCollapses = 0;
+
+			for (const Collapse& collapse : collapses)
+			{
+				if (remainingTriangles * 3 <= p_targetIndexCount)
+				{
+					break;
+				}
+
+				// the neighbourhood of an earlier collapse in this pass has stale adjacency
+				if (frozen[collapse.from] || frozen[collapse.to])
+				{
+					continue;
+				}
+
+				const unsigned int toPosition = remap[collapse.to];
+				size_t noOfRemoved = 0;
+				bool flips = false;
+
+				for (unsigned int i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1] && !flips; ++i)
+				{
+					const unsigned int* triangle = &p_result[vertexTriangles[i] * 3];
+					if (remap[triangle[0]] == toPosition || remap[triangle[1]] == toPosition || remap[triangle[2]] == toPosition)
+					{
+						++noOfRemoved;
+						continue;
+					}
+
+					glm::vec3 corners[3];
+					for (int corner = 0; corner < 3; ++corner)
+					{
+						corners[corner] = positions[triangle[corner]];
+					}
+					glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+					for (int corner = 0; corner < 3; ++corner)
+					{
+						corners[corner] = triangle[corner] == collapse.from ? positions[collapse.to] : corners[corner];
+					}
+					glm::vec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+					flips = glm::dot(before, after) < MIN_NORMAL_COSINE * glm::length(before) * glm::length(after);
+				}
+
+				if (flips)
+				{
+					continue;
+				}
+
+				collapseTarget[collapse.from] = collapse.to;
+				for (unsigned int i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1]; ++i)
+				{
+					const unsigned int* triangle = &p_result[vertexTriangles[i] * 3];
+					frozen[triangle[0]] = frozen[triangle[1]] = frozen[triangle[2]] = 1;
+				}
+
+				_addQuadric(quadrics[toPosition], quadrics[remap[collapse.from]]);
+				maxError = collapse.error > maxError ? collapse.error : maxError;
+				remainingTriangles -= noOfRemoved;
+				++noOfCollapses;
+			}
+
+			if (noOfCollapses == 0)
+			{
+				break;
+			}
+
+			// apply the collapses and drop triangles that lost their area
+			size_t write = 0;
+			for (size_t t = 0; t < noOfTriangles; ++t)
+			{
+				unsigned int a = collapseTarget[p_result[t * 3]];
+				unsigned int b = collapseTarget[p_result[t * 3 + 1]];
+				unsigned int c = collapseTarget[p_result[t * 3 + 2]];
+				if (remap[a] != remap[b] && remap[b] != remap[c] && remap[a] != remap[c])
+				{
+					p_result[write++] = a;
+					p_result[write++] = b;
+					p_result[write++] = c;
+				}
+			}
+			p_result.resize(write);
+		}
+
+		return static_cast<float>(std::sqrt(maxError));
+	}
+
+	std::vector<MeshLod> BuildLodChain(const std::vector<float>& p_vertices, size_t p_floatsPerVertex, std::vector<unsigned int>& p_indices, const float* p_ratios, size_t p_noOfRatios)
+	{
+		std::vector<MeshLod> lods;
+		lods.push_back({ 0, static_cast<unsigned int>(p_indices.size()), 0.0f });
+
+		const size_t noOfTriangles = p_indices.size() / 3;
+		std::vector<unsigned int> current(p_indices), next;
+		float error = 0.0f;
+
+		for (size_t i = 0; i < p_noOfRatios; ++i)
+		{
+			const size_t targetIndexCount = static_cast<size_t>(noOfTriangles * p_ratios[i]) * 3;
+			if (targetIndexCount >= current.size())
+			{
+				continue;
+			}
+
+			// every level starts from the previous one, which is much cheaper than from the full mesh
+			float levelError = Simplify(p_vertices, p_floatsPerVertex, current, targetIndexCount, next);
+			if (next.size() > current.size() * MIN_LOD_REDUCTION)
+			{
+				break;
+			}
+
+			// the deviations of consecutive levels add up at most
+			error += levelError;
+			lods.push_back({ static_cast<unsigned int>(p_indices.size()), static_cast<unsigned int>(next.size()), error });
+			p_indices.insert(p_indices.end(), next.begin(), next.end());
+			current.swap(next);
+		}
+
+		return lods;
+	}
+
+	size_t SelectLod(const std::vector<MeshLod>& p_lods, float p_pixelsPerUnit, float p_pixelThreshold)
+	{
+		for (size_t i = p_lods.size(); i-- > 1;)
+		{
+			if (p_lods[i].error * p_pixelsPerUnit <= p_pixelThreshold)
+			{
+				return i;
+			}
+		}
+		return 0;
+	}
+
+	float PixelsPerUnit(float p_distance, float p_fovY, float p_viewportHeight)
+	{
+		return p_viewportHeight / (2.0f * std::tan(p_fovY * 0.5f) * p_distance);
+	}
+}
\ No newline at end of file
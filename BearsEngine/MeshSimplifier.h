@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// One level of detail inside a shared index buffer
+struct MeshLod
+{
+	unsigned int indexOffset;	// first index of the level
+	unsigned int indexCount;
+	float error;				// geometric deviation from the full mesh, in object space units
+
+	// meshlets covering the level, if the mesh was clustered (see MeshletBuilder)
+	unsigned int meshletOffset = 0;
+	unsigned int meshletCount = 0;
+};
+
+// Quadric error metric simplification (Garland & Heckbert) by collapsing edges onto existing
+// vertices, so every level can share the vertex buffer of the full mesh.
+// Vertices are interleaved floats with the position in the first three floats. Vertices that
+// share a position with another vertex (uv seams, poles) are never moved, and open borders
+// only collapse along themselves, so the outline and the texture mapping stay intact.
+namespace MeshSimplifier
+{
+	// Collapses edges in order of increasing error until at most p_targetIndexCount indices are
+	// left or no further collapse is possible. Returns the largest collapse error.
+	float Simplify(const std::vector<float>& p_vertices, size_t p_floatsPerVertex, const std::vector<unsigned int>& p_indices, size_t p_targetIndexCount, std::vector<unsigned int>& p_result);
+
+	// Appends coarser levels with p_ratios (fractions of the full triangle count, descending) of
+	// the triangles to p_indices, which holds the full mesh. Stops early once a level barely
+	// shrinks. Returns all levels, the full mesh first.
+	std::vector<MeshLod> BuildLodChain(const std::vector<float>& p_vertices, size_t p_floatsPerVertex, std::vector<unsigned int>& p_indices, const float* p_ratios, size_t p_noOfRatios);
+
+	// Coarsest level whose error projects to at most p_pixelThreshold pixels, given how many
+	// pixels one object space unit covers at the mesh's distance
+	size_t SelectLod(const std::vector<MeshLod>& p_lods, float p_pixelsPerUnit, float p_pixelThreshold);
+
+	// Pixels one world space unit covers at p_distance for a vertical field of view in radians
+	float PixelsPerUnit(float p_distance, float p_fovY, float p_viewportHeight);
+}
\ No newline at end of file
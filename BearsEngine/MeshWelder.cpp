@@ -0,0 +1,154 @@
+#include "MeshWelder.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	constexpr unsigned int NONE = 0xFFFFFFFFu;
+
+	inline uint64_t _mix(uint64_t p_hash)
+	{
+		p_hash ^= p_hash >> 33;
+		p_hash *= 0xFF51AFD7ED558CCDULL;
+		p_hash ^= p_hash >> 33;
+		p_hash *= 0xC4CEB9FE1A85EC53ULL;
+		p_hash ^= p_hash >> 33;
+		return p_hash;
+	}
+
+	inline uint64_t _hashCell(int64_t p_x, int64_t p_y, int64_t p_z)
+	{
+		return _mix(static_cast<uint64_t>(p_x) * 0x9E3779B97F4A7C15ULL ^ static_cast<uint64_t>(p_y) * 0xC2B2AE3D27D4EB4FULL ^ static_cast<uint64_t>(p_z));
+	}
+
+	// hash of the exact attribute values; +0 and -0 hash the same since they compare equal
+	inline uint64_t _hashExact(const float* p_vertex, size_t p_floatsPerVertex)
+	{
+		uint64_t hash = 0;
+		for (size_t i = 0; i < p_floatsPerVertex; ++i)
+		{
+			float value = p_vertex[i] == 0.0f ? 0.0f : p_vertex[i];
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			hash = _mix(hash ^ bits);
+		}
+		return hash;
+	}
+
+	inline bool _isSame(const float* p_a, const float* p_b, size_t p_floatsPerVertex, float p_epsilon)
+	{
+		for (size_t i = 0; i < p_floatsPerVertex; ++i)
+		{
+			if (!(std::fabs(p_a[i] - p_b[i]) <= p_epsilon))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+namespace MeshWelder
+{
+	WeldStats Weld(std::vector<float>& p_vertices, std::vector<unsigned int>& p_indices, size_t p_floatsPerVertex, float p_epsilon)
+	{
+		WeldStats stats;
+		const size_t noOfVertices = p_vertices.size() / p_floatsPerVertex;
+		stats.verticesBefore = noOfVertices;
+		stats.bytesBefore = noOfVertices * p_floatsPerVertex * sizeof(float);
+
+		size_t tableSize = 1;
+		while (tableSize < noOfVertices * 2)
+		{
+			tableSize <<= 1;
+		}
+		const uint64_t tableMask = tableSize - 1;
+
+		// buckets hold chains of kept vertices (by their new index)
+		std::vector<unsigned int> buckets(tableSize, NONE);
+		std::vector<unsigned int> chain(noOfVertices, NONE);
+		std::vector<unsigned int> remap(noOfVertices);
+
+		const bool exact = !(p_epsilon > 0.0f);
+		const float cellSize = exact ? 1.0f : p_epsilon;
+		float* data = p_vertices.data();
+		unsigned int noOfKept = 0;
+
+		for (size_t i = 0; i < noOfVertices; ++i)
+		{
+			const float* vertex = data + i * p_floatsPerVertex;
+			unsigned int match = NONE;
+			uint64_t ownBucket;
+
+			if (exact)
+			{
+				ownBucket = _hashExact(vertex, p_floatsPerVertex) & tableMask;
+				for (unsigned int candidate = buckets[ownBucket]; candidate != NONE && match == NONE; candidate = chain[candidate])
+				{
+					if (_isSame(vertex, data + candidate * p_floatsPerVertex, p_floatsPerVertex, 0.0f))
+					{
+						match = candidate;
+					}
+				}
+			}
+			else
+			{
+				// a vertex within epsilon is at most one grid cell away on every axis
+				const int64_t cellX = static_cast<int64_t>(std::floor(vertex[0] / cellSize));
+				const int64_t cellY = static_cast<int64_t>(std::floor(vertex[1] / cellSize));
+				const int64_t cellZ = static_cast<int64_t>(std::floor(vertex[2] / cellSize));
+				ownBucket = _hashCell(cellX, cellY, cellZ) & tableMask;
+
+				for (int dz = -1; dz <= 1 && match == NONE; ++dz)
+				{
+					for (int dy = -1; dy <= 1 && match == NONE; ++dy)
+					{
+						for (int dx = -1; dx <= 1 && match == NONE; ++dx)
+						{
+							uint64_t bucket = _hashCell(cellX + dx, cellY + dy, cellZ + dz) & tableMask;
+							for (unsigned int candidate = buckets[bucket]; candidate != NONE && match == NONE; candidate = chain[candidate])
+							{
+								if (_isSame(vertex, data + candidate * p_floatsPerVertex, p_floatsPerVertex, p_epsilon))
+								{
+									match = candidate;
+								}
+							}
+						}
+					}
+				}
+			}
+
+			if (match != NONE)
+			{
+				remap[i] = match;
+				continue;
+			}
+
+			// keep the vertex, compacting in place (the kept slot is never ahead of i)
+			if (noOfKept != i)
+			{
+				memmove(data + noOfKept * p_floatsPerVertex, vertex, p_floatsPerVertex * sizeof(float));
+			}
+			chain[noOfKept] = buckets[ownBucket];
+			buckets[ownBucket] = noOfKept;
+			remap[i] = noOfKept;
+			++noOfKept;
+		}
+
+		p_vertices.resize(noOfKept * p_floatsPerVertex);
+
+		for (unsigned int& index : p_indices)
+		{
+			if (index < noOfVertices)
+			{
+				index = remap[index];
+			}
+		}
+
+		stats.verticesAfter = noOfKept;
+		stats.bytesAfter = noOfKept * p_floatsPerVertex * sizeof(float);
+		return stats;
+	}
+}
\ No newline at end of file
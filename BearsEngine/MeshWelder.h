@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Before/after numbers of a weld pass
+struct WeldStats
+{
+	size_t verticesBefore = 0;
+	size_t verticesAfter = 0;
+	size_t bytesBefore = 0;
+	size_t bytesAfter = 0;
+};
+
+namespace MeshWelder
+{
+	// Merges vertices whose attributes (all p_floatsPerVertex floats) differ by at most p_epsilon
+	// and remaps p_indices to the merged vertices. Vertices keep the order of their first occurrence.
+	// An epsilon of 0 merges exact duplicates only.
+	WeldStats Weld(std::vector<float>& p_vertices, std::vector<unsigned int>& p_indices, size_t p_floatsPerVertex, float p_epsilon);
+}
\ No newline at end of file
@@ -0,0 +1,284 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+
+namespace
+{
+	constexpr unsigned int NONE = 0xFFFFFFFFu;
+
+	// cones whose normals spread this far (dot with the axis) cannot be culled usefully
+	constexpr float MIN_CONE_DOT = 0.1f;
+
+	void _computeBounds(const std::vector<float>& p_vertices, size_t p_floatsPerVertex, const unsigned int* p_triangles, Meshlet& p_meshlet)
+	{
+		auto position = [&](unsigned int p_vertex)
+		{
+			const float* vertex = p_vertices.data() + p_vertex * p_floatsPerVertex;
+			return glm::vec3(vertex[0], vertex[1], vertex[2]);
+		};
+
+		glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX);
+		for (unsigned int i = 0; i < p_meshlet.indexCount; ++i)
+		{
+			minimum = glm::min(minimum, position(p_triangles[i]));
+			maximum = glm::max(maximum, position(p_triangles[i]));
+		}
+
+		p_meshlet.center = (minimum + maximum) * 0.5f;
+		p_meshlet.radius = 0.0f;
+		for (unsigned int i = 0; i < p_meshlet.indexCount; ++i)
+		{
+			p_meshlet.radius = glm::max(p_meshlet.radius, glm::length(position(p_triangles[i]) - p_meshlet.center));
+		}
+
+		// the cone axis is the average triangle normal, the cutoff follows from the widest one
+		glm::vec3 axis(0.0f);
+		for (unsigned int t = 0; t < p_meshlet.indexCount; t += 3)
+		{
+			glm::vec3 p0 = position(p_triangles[t]);
+			glm::vec3 normal = glm::cross(position(p_triangles[t + 1]) - p0, position(p_triangles[t + 2]) - p0);
+			float length = glm::length(normal);
+			axis += length > 0.0f ? normal / length : glm::vec3(0.0f);
+		}
+
+		p_meshlet.coneApex = p_meshlet.center;
+		p_meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+		p_meshlet.coneCutoff = 2.0f;
+
+		float axisLength = glm::length(axis);
+		if (axisLength == 0.0f)
+		{
+			return;
+		}
+		axis /= axisLength;
+
+		float minDot = 1.0f;
+		for (unsigned int t = 0; t < p_meshlet.indexCount; t += 3)
+		{
+			glm::vec3 p0 = position(p_triangles[t]);
+			glm::vec3 normal = glm::cross(position(p_triangles[t + 1]) - p0, position(p_triangles[t + 2]) - p0);
+			float length = glm::length(normal);
+			if (length > 0.0f)
+			{
+				minDot = glm::min(minDot, glm::dot(normal / length, axis));
+			}
+		}
+
+		p_meshlet.coneAxis = axis;
+		if (minDot <= MIN_CONE_DOT)
+		{
+			return;
+		}
+
+		// move the apex back along the axis until every triangle plane lies in front of it
+		float maxT = 0.0f;
+		for (unsigned int t = 0; t < p_meshlet.indexCount; t += 3)
+		{
+			glm::vec3 p0 = position(p_triangles[t]);
+			glm::vec3 normal = glm::cross(position(p_triangles[t + 1]) - p0, position(p_triangles[t + 2]) - p0);
+			float length = glm::length(normal);
+			if (length > 0.0f)
+			{
+				normal /= length;
+				maxT = glm::max(maxT, glm::dot(p_meshlet.center - p0, normal) / glm::dot(normal, axis));
+			}
+		}
+
+		p_meshlet.coneApex = p_meshlet.center - axis * maxT;
+		p_meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+	}
+}
+
+namespace MeshletBuilder
+{
+	std::vector<Meshlet> Build(const std::vector<float>& p_vertices, size_t p_floatsPerVertex, std::vector<unsigned int>& p_indices, size_t p_indexOffset, size_t p_indexCount)
+	{
+		std::vector<Meshlet> meshlets;
+		const unsigned int* triangles = p_indices.data() + p_indexOffset;
+		const size_t noOfTriangles = p_indexCount / 3;
+		const size_t noOfVertices = p_vertices.size() / p_floatsPerVertex;
+
+		// triangles around each vertex
+		std::vector<unsigned int> triangleOffsets(noOfVertices + 1, 0);
+		for (size_t i = 0; i < noOfTriangles * 3; ++i)
+		{
+			++triangleOffsets[triangles[i] + 1];
+		}
+		for (size_t v = 0; v < noOfVertices; ++v)
+		{
+			triangleOffsets[v + 1] += triangleOffsets[v];
+		}
+		std::vector<unsigned int> vertexTriangles(noOfTriangles * 3);
+		{
+			std::vector<unsigned int> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < noOfTriangles * 3; ++i)
+			{
+				vertexTriangles[cursor[triangles[i]]++] = static_cast<unsigned int>(i / 3);
+			}
+		}
+
+		std::vector<glm::vec3> centroids(noOfTriangles);
+		for (size_t t = 0; t < noOfTriangles; ++t)
+		{
+			glm::vec3 sum(0.0f);
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				const float* vertex = p_vertices.data() + triangles[t * 3 + corner] * p_floatsPerVertex;
+				sum += glm::vec3(vertex[0], vertex[1], vertex[2]);
+			}
+			centroids[t] = sum / 3.0f;
+		}
+
+		std::vector<unsigned int> order;
+		order.reserve(noOfTriangles);
+		std::vector<uint8_t> emitted(noOfTriangles, 0);
+		// id of the last meshlet that used a vertex, so the marks never need clearing
+		std::vector<unsigned int> vertexMeshlet(noOfVertices, NONE);
+		std::vector<unsigned int> candidates;
+		size_t seed = 0;
+
+		while (order.size() < noOfTriangles)
+		{
+			while (emitted[seed])
+			{
+				++seed;
+			}
+
+			const unsigned int id = static_cast<unsigned int>(meshlets.size());
+			Meshlet meshlet = {};
+			meshlet.indexOffset = static_cast<unsigned int>(p_indexOffset + order.size() * 3);
+			size_t noOfMeshletVertices = 0;
+			glm::vec3 centroidSum(0.0f);
+
+			candidates.assign(1, static_cast<unsigned int>(seed));
+
+			while (meshlet.indexCount / 3 < MAX_TRIANGLES)
+			{
+				// prefer triangles that add the fewest vertices, then the ones closest to the meshlet
+				unsigned int best = NONE;
+				size_t bestNewVertices = 0;
+				float bestDistance = 0.0f;
+				const glm::vec3 center = meshlet.indexCount ? centroidSum / static_cast<float>(meshlet.indexCount / 3) : centroids[seed];
+
+				size_t kept = 0;
+				for (unsigned int candidate : candidates)
+				{
+					if (emitted[candidate])
+					{
+						continue;
+					}
+					candidates[kept++] = candidate;
+
+					size_t newVertices = 0;
+					for (int corner = 0; corner < 3; ++corner)
+					{
+						newVertices += vertexMeshlet[triangles[candidate * 3 + corner]] != id;
+					}
+					if (noOfMeshletVertices + newVertices > MAX_VERTICES)
+					{
+						continue;
+					}
+
+					glm::vec3 offset = centroids[candidate] - center;
+					float distance = glm::dot(offset, offset);
+					if (best == NONE || newVertices < bestNewVertices || (newVertices == bestNewVertices && distance < bestDistance))
+					{
+						best = candidate;
+						bestNewVertices = newVertices;
+						bestDistance = distance;
+					}
+				}
+				candidates.resize(kept);
+
+				if (best == NONE)
+				{
+					break;
+				}
+
+				emitted[best] = 1;
+				order.push_back(best);
+				meshlet.indexCount += 3;
+				centroidSum += centroids[best];
+				noOfMeshletVertices += bestNewVertices;
+
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					unsigned int vertex = triangles[best * 3 + corner];
+					if (vertexMeshlet[vertex] == id)
+					{
+						continue;
+					}
+					vertexMeshlet[vertex] = id;
+
+					for (unsigned int i = triangleOffsets[vertex]; i < triangleOffsets[vertex + 1]; ++i)
+					{
+						if (!emitted[vertexTriangles[i]])
+						{
+							candidates.push_back(vertexTriangles[i]);
+						}
+					}
+				}
+			}
+
+			meshlets.push_back(meshlet);
+		}
+
+		// write the triangles back in meshlet order
+		std::vector<unsigned int> reordered(noOfTriangles * 3);
+		for (size_t i = 0; i < noOfTriangles; ++i)
+		{
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				reordered[i * 3 + corner] = triangles[order[i] * 3 + corner];
+			}
+		}
+		std::copy(reordered.begin(), reordered.end(), p_indices.begin() + p_indexOffset);
+
+		for (Meshlet& meshlet : meshlets)
+		{
+			_computeBounds(p_vertices, p_floatsPerVertex, p_indices.data() + meshlet.indexOffset, meshlet);
+		}
+
+		return meshlets;
+	}
+
+	void ExtractFrustum(const glm::mat4& p_modelViewProjection, glm::vec4* p_planes)
+	{
+		// rows of the matrix; glm stores columns
+		glm::vec4 rows[4];
+		for (int row = 0; row < 4; ++row)
+		{
+			rows[row] = glm::vec4(p_modelViewProjection[0][row], p_modelViewProjection[1][row], p_modelViewProjection[2][row], p_modelViewProjection[3][row]);
+		}
+
+		p_planes[0] = rows[3] + rows[0];	// left
+		p_planes[1] = rows[3] - rows[0];	// right
+		p_planes[2] = rows[3] + rows[1];	// bottom
+		p_planes[3] = rows[3] - rows[1];	// top
+		p_planes[4] = rows[3] + rows[2];	// near
+		p_planes[5] = rows[3] - rows[2];	// far
+
+		for (int i = 0; i < 6; ++i)
+		{
+			p_planes[i] /= glm::length(glm::vec3(p_planes[i]));
+		}
+	}
+
+	bool IsVisible(const Meshlet& p_meshlet, const glm::vec4* p_planes, const glm::vec3& p_cameraPosition)
+	{
+		for (int i = 0; i < 6; ++i)
+		{
+			if (glm::dot(glm::vec3(p_planes[i]), p_meshlet.center) + p_planes[i].w < -p_meshlet.radius)
+			{
+				return false;
+			}
+		}
+
+		glm::vec3 view = p_meshlet.coneApex - p_cameraPosition;
+		float length = glm::length(view);
+		return !(length > 0.0f && glm::dot(view, p_meshlet.coneAxis) >= p_meshlet.coneCutoff * length);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+// Small cluster of triangles stored as a contiguous range of the index buffer, with the bounds
+// needed to cull it as a whole. Stored as is in the .bmesh cache.
+struct Meshlet
+{
+	unsigned int indexOffset;
+	unsigned int indexCount;
+
+	// bounding sphere in object space
+	glm::vec3 center;
+	float radius;
+
+	// normal cone: a camera whose direction to coneApex has a component of at least coneCutoff
+	// along coneAxis only sees back faces. A cutoff above 1 means the cluster is never culled.
+	glm::vec3 coneApex;
+	glm::vec3 coneAxis;
+	float coneCutoff;
+};
+
+namespace MeshletBuilder
+{
+	constexpr size_t MAX_VERTICES = 64;
+	constexpr size_t MAX_TRIANGLES = 124;
+
+	// Partitions the triangles in [p_indexOffset, p_indexOffset + p_indexCount) into meshlets of
+	// at most MAX_VERTICES vertices and MAX_TRIANGLES triangles, grown greedily over shared
+	// vertices. The range is reordered so every meshlet is contiguous.
+	std::vector<Meshlet> Build(const std::vector<float>& p_vertices, size_t p_floatsPerVertex, std::vector<unsigned int>& p_indices, size_t p_indexOffset, size_t p_indexCount);
+
+	// The six clip planes (xyz normal pointing inwards, w distance) of a model-view-projection
+	// matrix, so the planes are in the object space of the mesh
+	void ExtractFrustum(const glm::mat4& p_modelViewProjection, glm::vec4* p_planes);
+
+	// False if the meshlet lies completely outside the frustum, or if all of its triangles face
+	// away from p_cameraPosition (object space) and would be back face culled anyway
+	bool IsVisible(const Meshlet& p_meshlet, const glm::vec4* p_planes, const glm::vec3& p_cameraPosition);
+}
\ No newline at end of file
@@ -0,0 +1,350 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ThreadPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIPGENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// rows of the new level filtered by one task
+	constexpr int BAND_ROWS = 32;
+	// support of the Kaiser and Lanczos filters, in texels of the new level each side
+	constexpr double FILTER_WIDTH = 3.0;
+	constexpr double KAISER_ALPHA = 4.0;
+	// entries of the tables from linear values in [0, 1] back to 8 bits
+	constexpr int ENCODE_STEPS = 16384;
+
+	constexpr double PI = 3.14159265358979323846;
+
+	// 8 bit values to linear floats and back, for sRGB and for plain channels
+	struct Tables
+	{
+		float srgbToLinear[256];
+		float toLinear[256];
+		unsigned char linearToSrgb[ENCODE_STEPS + 1];
+		unsigned char fromLinear[ENCODE_STEPS + 1];
+		// srgbToLinear in steps of the encode tables, for the integer box path
+		int srgbToSteps[256];
+	};
+
+	// Filter taps of every texel of the new level along one axis
+	struct Axis
+	{
+		int taps = 0;
+		// taps entries per texel, indices already wrapped or clamped to the old level
+		std::vector<int> indices;
+		std::vector<float> weights;
+	};
+
+	const Tables& _tables()
+	{
+		static const Tables tables = []()
+		{
+			Tables result;
+			for (int i = 0; i < 256; ++i)
+			{
+				const double value = i / 255.0;
+				result.srgbToLinear[i] = static_cast<float>(value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4));
+				result.toLinear[i] = static_cast<float>(value);
+				result.srgbToSteps[i] = static_cast<int>(result.srgbToLinear[i] * ENCODE_STEPS + 0.5f);
+			}
+			for (int i = 0; i <= ENCODE_STEPS; ++i)
+			{
+				const double value = static_cast<double>(i) / ENCODE_STEPS;
+				const double srgb = value <= 0.0031308 ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+				result.linearToSrgb[i] = static_cast<unsigned char>(srgb * 255.0 + 0.5);
+				result.fromLinear[i] = static_cast<unsigned char>(value * 255.0 + 0.5);
+			}
+			return result;
+		}();
+		return tables;
+	}
+
+	double _sinc(double p_x)
+	{
+		return p_x == 0.0 ? 1.0 : std::sin(PI * p_x) / (PI * p_x);
+	}
+
+	// Modified Bessel function of the first kind, order 0
+	double _besselI0(double p_x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; term > sum * 1e-12; ++k)
+		{
+			term *= (p_x / (2.0 * k)) * (p_x / (2.0 * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	double _filter(MipFilter p_filter, double p_x)
+	{
+		if (std::fabs(p_x) >= FILTER_WIDTH)
+		{
+			return 0.0;
+		}
+		if (p_filter == MipFilter::Lanczos)
+		{
+			return _sinc(p_x) * _sinc(p_x / FILTER_WIDTH);
+		}
+		const double t = p_x / FILTER_WIDTH;
+		return _sinc(p_x) * _besselI0(KAISER_ALPHA * std::sqrt(1.0 - t * t)) / _besselI0(KAISER_ALPHA);
+	}
+
+	Axis _axis(int p_sourceSize, int p_size, MipFilter p_filter, bool p_wrap)
+	{
+		const double scale = static_cast<double>(p_sourceSize) / p_size;
+		const double support = p_filter == MipFilter::Box ? 0.5 * scale : FILTER_WIDTH * scale;
+		const int window = static_cast<int>(std::ceil(2.0 * support)) + 2;
+
+		// weights over a window around every texel, trimmed to the widest run of non-zero taps
+		std::vector<int> firsts(p_size);
+		std::vector<double> weights(static_cast<size_t>(p_size) * window);
+		int lowest = window;
+		int highest = 0;
+		for (int i = 0; i < p_size; ++i)
+		{
+			// texel j covers [j, j + 1] of the old level, texel i of the new one is centered at
+			// (i + 0.5) * scale
+			const double center = (i + 0.5) * scale;
+			firsts[i] = static_cast<int>(std::floor(center - support)) - 1;
+			double* texelWeights = weights.data() + static_cast<size_t>(i) * window;
+			double sum = 0.0;
+			for (int k = 0; k < window; ++k)
+			{
+				const int j = firsts[i] + k;
+				if (p_filter == MipFilter::Box)
+				{
+					texelWeights[k] = std::max(0.0, std::min(j + 1.0, center + support) - std::max(static_cast<double>(j), center - support));
+				}
+				else
+				{
+					texelWeights[k] = _filter(p_filter, (j + 0.5 - center) / scale);
+				}
+				sum += texelWeights[k];
+			}
+			for (int k = 0; k < window; ++k)
+			{
+				texelWeights[k] /= sum;
+				if (std::fabs(texelWeights[k]) > 1e-6)
+				{
+					lowest = std::min(lowest, k);
+					highest = std::max(highest, k);
+				}
+			}
+		}
+
+		Axis axis;
+		axis.taps = highest - lowest + 1;
+		axis.indices.resize(static_cast<size_t>(p_size) * axis.taps);
+		axis.weights.resize(static_cast<size_t>(p_size) * axis.taps);
+		for (int i = 0; i < p_size; ++i)
+		{
+			for (int k = 0; k < axis.taps; ++k)
+			{
+				const int j = firsts[i] + lowest + k;
+				const size_t tap = static_cast<size_t>(i) * axis.taps + k;
+				axis.indices[tap] = p_wrap ? ((j % p_sourceSize) + p_sourceSize) % p_sourceSize : std::clamp(j, 0, p_sourceSize - 1);
+				axis.weights[tap] = static_cast<float>(weights[static_cast<size_t>(i) * window + lowest + k]);
+			}
+		}
+		return axis;
+	}
+
+	// One row of the old level as linear RGBA floats; RGB sources get an alpha of one
+	void _decodeRow(const unsigned char* p_texels, int p_width, int p_channels, const float* p_colorTable, const float* p_alphaTable, float* p_out)
+	{
+		for (int x = 0; x < p_width; ++x, p_texels += p_channels, p_out += 4)
+		{
+			p_out[0] = p_colorTable[p_texels[0]];
+			p_out[1] = p_colorTable[p_texels[1]];
+			p_out[2] = p_colorTable[p_texels[2]];
+			p_out[3] = p_channels == 4 ? p_alphaTable[p_texels[3]] : 1.0f;
+		}
+	}
+
+	// p_out[i] += p_weight * p_row[i]
+	void _accumulate(float* p_out, const float* p_row, float p_weight, size_t p_count)
+	{
+		size_t i = 0;
+#ifdef MIPGENERATOR_SSE2
+		const __m128 weight = _mm_set1_ps(p_weight);
+		for (; i + 4 <= p_count; i += 4)
+		{
+			_mm_storeu_ps(p_out + i, _mm_add_ps(_mm_loadu_ps(p_out + i), _mm_mul_ps(_mm_loadu_ps(p_row + i), weight)));
+		}
+#endif
+		for (; i < p_count; ++i)
+		{
+			p_out[i] += p_weight * p_row[i];
+		}
+	}
+
+	// 2 x 2 box of an even sized level, which needs no weights, straight on the bytes; sRGB color
+	// is averaged as linear light in integer steps of the encode table
+	template <int CHANNELS, bool SRGB>
+	void _boxRows(const MipLevel& p_source, int p_firstRow, int p_lastRow, MipLevel& p_level)
+	{
+		const Tables& tables = _tables();
+		const size_t sourceRowBytes = static_cast<size_t>(p_source.width) * CHANNELS;
+		for (int y = p_firstRow; y < p_lastRow; ++y)
+		{
+			const unsigned char* row0 = p_source.texels.data() + static_cast<size_t>(2 * y) * sourceRowBytes;
+			const unsigned char* row1 = row0 + sourceRowBytes;
+			unsigned char* out = p_level.texels.data() + static_cast<size_t>(y) * p_level.width * CHANNELS;
+			for (int x = 0; x < p_level.width; ++x, row0 += 2 * CHANNELS, row1 += 2 * CHANNELS, out += CHANNELS)
+			{
+				for (int c = 0; c < CHANNELS; ++c)
+				{
+					if (SRGB && c < 3)
+					{
+						const int steps = tables.srgbToSteps[row0[c]] + tables.srgbToSteps[row0[c + CHANNELS]] + tables.srgbToSteps[row1[c]] + tables.srgbToSteps[row1[c + CHANNELS]];
+						out[c] = tables.linearToSrgb[(steps + 2) >> 2];
+					}
+					else
+					{
+						out[c] = static_cast<unsigned char>((row0[c] + row0[c + CHANNELS] + row1[c] + row1[c + CHANNELS] + 2) >> 2);
+					}
+				}
+			}
+		}
+	}
+
+	// Filters one texel out of a row of linear RGBA floats and stores it as 8 bits
+	void _filterTexel(const float* p_row, const int* p_indices, const float* p_weights, int p_taps, int p_channels, const unsigned char* p_colorTable,
+		const unsigned char* p_alphaTable, unsigned char* p_out)
+	{
+		int steps[4];
+#ifdef MIPGENERATOR_SSE2
+		__m128 sum = _mm_setzero_ps();
+		for (int k = 0; k < p_taps; ++k)
+		{
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(p_row + p_indices[k] * 4), _mm_set1_ps(p_weights[k])));
+		}
+		// sharpening filters overshoot a little, so clamp before the table lookup
+		sum = _mm_min_ps(_mm_max_ps(sum, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(steps), _mm_cvtps_epi32(_mm_mul_ps(sum, _mm_set1_ps(static_cast<float>(ENCODE_STEPS)))));
+#else
+		float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int k = 0; k < p_taps; ++k)
+		{
+			const float* texel = p_row + p_indices[k] * 4;
+			for (int c = 0; c < 4; ++c)
+			{
+				sum[c] += texel[c] * p_weights[k];
+			}
+		}
+		for (int c = 0; c < 4; ++c)
+		{
+			steps[c] = static_cast<int>(std::clamp(sum[c], 0.0f, 1.0f) * ENCODE_STEPS + 0.5f);
+		}
+#endif
+		p_out[0] = p_colorTable[steps[0]];
+		p_out[1] = p_colorTable[steps[1]];
+		p_out[2] = p_colorTable[steps[2]];
+		if (p_channels == 4)
+		{
+			p_out[3] = p_alphaTable[steps[3]];
+		}
+	}
+}
+
+MipLevel MipGenerator::Downsample(const MipLevel& p_source, int p_channels, const MipOptions& p_options)
+{
+	MipLevel level{ std::max(1, p_source.width / 2), std::max(1, p_source.height / 2), {} };
+	level.texels.resize(static_cast<size_t>(level.width) * level.height * p_channels);
+
+	if (p_options.filter == MipFilter::Box && p_source.width % 2 == 0 && p_source.height % 2 == 0)
+	{
+		const size_t bands = (level.height + BAND_ROWS - 1) / BAND_ROWS;
+		ThreadPool::Shared().ParallelFor(bands, [&](size_t p_band)
+		{
+			const int firstRow = static_cast<int>(p_band) * BAND_ROWS;
+			const int lastRow = std::min(firstRow + BAND_ROWS, level.height);
+			if (p_channels == 4)
+			{
+				p_options.srgb ? _boxRows<4, true>(p_source, firstRow, lastRow, level) : _boxRows<4, false>(p_source, firstRow, lastRow, level);
+			}
+			else
+			{
+				p_options.srgb ? _boxRows<3, true>(p_source, firstRow, lastRow, level) : _boxRows<3, false>(p_source, firstRow, lastRow, level);
+			}
+		});
+		return level;
+	}
+
+	const Axis columns = _axis(p_source.width, level.width, p_options.filter, p_options.wrapX);
+	const Axis rows = _axis(p_source.height, level.height, p_options.filter, p_options.wrapY);
+
+	const Tables& tables = _tables();
+	const float* decodeColor = p_options.srgb ? tables.srgbToLinear : tables.toLinear;
+	const unsigned char* encodeColor = p_options.srgb ? tables.linearToSrgb : tables.fromLinear;
+	const size_t sourceRowBytes = static_cast<size_t>(p_source.width) * p_channels;
+	const size_t rowFloats = static_cast<size_t>(p_source.width) * 4;
+
+	const size_t bands = (level.height + BAND_ROWS - 1) / BAND_ROWS;
+	ThreadPool::Shared().ParallelFor(bands, [&](size_t p_band)
+	{
+		const int firstRow = static_cast<int>(p_band) * BAND_ROWS;
+		const int lastRow = std::min(firstRow + BAND_ROWS, level.height);
+
+		// every old row the band reads is decoded once, neighbouring bands decode their overlap again
+		std::vector<int> slots(p_source.height, -1);
+		int noOfSlots = 0;
+		for (size_t tap = static_cast<size_t>(firstRow) * rows.taps; tap < static_cast<size_t>(lastRow) * rows.taps; ++tap)
+		{
+			if (slots[rows.indices[tap]] < 0)
+			{
+				slots[rows.indices[tap]] = noOfSlots++;
+			}
+		}
+		std::vector<float> decoded(noOfSlots * rowFloats);
+		for (int y = 0; y < p_source.height; ++y)
+		{
+			if (slots[y] >= 0)
+			{
+				_decodeRow(p_source.texels.data() + y * sourceRowBytes, p_source.width, p_channels, decodeColor, tables.toLinear, decoded.data() + slots[y] * rowFloats);
+			}
+		}
+
+		// vertical pass into one full width row, then the horizontal pass out of it
+		std::vector<float> filtered(rowFloats);
+		for (int y = firstRow; y < lastRow; ++y)
+		{
+			std::fill(filtered.begin(), filtered.end(), 0.0f);
+			for (int k = 0; k < rows.taps; ++k)
+			{
+				const size_t tap = static_cast<size_t>(y) * rows.taps + k;
+				if (rows.weights[tap] != 0.0f)
+				{
+					_accumulate(filtered.data(), decoded.data() + slots[rows.indices[tap]] * rowFloats, rows.weights[tap], rowFloats);
+				}
+			}
+
+			unsigned char* out = level.texels.data() + static_cast<size_t>(y) * level.width * p_channels;
+			for (int x = 0; x < level.width; ++x, out += p_channels)
+			{
+				const size_t tap = static_cast<size_t>(x) * columns.taps;
+				_filterTexel(filtered.data(), columns.indices.data() + tap, columns.weights.data() + tap, columns.taps, p_channels, encodeColor, tables.fromLinear, out);
+			}
+		}
+	});
+
+	return level;
+}
+
+void MipGenerator::Generate(std::vector<MipLevel>& p_levels, int p_channels, const MipOptions& p_options)
+{
+	while (p_levels.back().width > 1 || p_levels.back().height > 1)
+	{
+		MipLevel level = Downsample(p_levels.back(), p_channels, p_options);
+		p_levels.push_back(std::move(level));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+enum class MipFilter
+{
+	Box,		// average of the texels under each new texel, like glGenerateMipmap
+	Kaiser,		// Kaiser windowed sinc, 3 texels of the new level each side; sharp without much ringing
+	Lanczos		// Lanczos 3; slightly sharper than Kaiser, slightly more ringing
+};
+
+struct MipOptions
+{
+	MipFilter filter = MipFilter::Kaiser;
+	// RGB is sRGB encoded and averaged as linear light; alpha is always averaged as it is
+	bool srgb = true;
+	// Filters wrap around the left and right edge, the longitude seam of an equirectangular
+	// map, and the top and bottom edge; otherwise the edge texels repeat
+	bool wrapX = true;
+	bool wrapY = false;
+};
+
+// Texels of one level, rows tightly packed
+struct MipLevel
+{
+	int width;
+	int height;
+	std::vector<unsigned char> texels;
+};
+
+// Mip chains of 8 bit RGB or RGBA images. Every level is filtered from the one above it in
+// bands of rows spread over ThreadPool::Shared, with SSE2 for the filter taps where available.
+namespace MipGenerator
+{
+	// Level of max(1, width / 2) x max(1, height / 2) texels below p_source; box levels of even
+	// sized sources average 2 x 2 bytes without the float passes
+	MipLevel Downsample(const MipLevel& p_source, int p_channels, const MipOptions& p_options);
+	// Appends levels to p_levels until the last one is 1 x 1; p_levels holds at least level 0
+	void Generate(std::vector<MipLevel>& p_levels, int p_channels, const MipOptions& p_options);
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "ParametricSurface.h"
+
+#include <algorithm>
+
+namespace
+{
+	// rows per pool task; enough tasks per thread to even out the last ones
+	constexpr unsigned int MIN_ROWS_PER_CHUNK = 16;
+	constexpr unsigned int CHUNKS_PER_THREAD = 4;
+}
+
+namespace ParametricSurface
+{
+	void BuildColumns(unsigned int p_noOfXSeg, Columns& p_columns)
+	{
+		const unsigned int noOfColumns = p_noOfXSeg + 1;
+		p_columns.cosU.resize(noOfColumns);
+		p_columns.sinU.resize(noOfColumns);
+		p_columns.texU.resize(noOfColumns);
+
+		for (unsigned int x = 0; x < noOfColumns; ++x)
+		{
+			const double u = static_cast<double>(x) / p_noOfXSeg;
+			const double angle = u * 2.0 * 3.14159265358979323846;
+			p_columns.cosU[x] = static_cast<float>(std::cos(angle));
+			p_columns.sinU[x] = static_cast<float>(std::sin(angle));
+			p_columns.texU[x] = static_cast<float>(1.0 - u);
+		}
+	}
+
+	void ForEachRowRange(unsigned int p_noOfRows, ThreadPool& p_pool, const std::function<void(unsigned int, unsigned int)>& p_function)
+	{
+		const unsigned int noOfThreads = p_pool.NoOfWorkers() + 1;
+		const unsigned int rowsPerChunk = std::max(MIN_ROWS_PER_CHUNK, (p_noOfRows + noOfThreads * CHUNKS_PER_THREAD - 1) / (noOfThreads * CHUNKS_PER_THREAD));
+		const unsigned int noOfChunks = (p_noOfRows + rowsPerChunk - 1) / rowsPerChunk;
+
+		p_pool.ParallelFor(noOfChunks, [&](size_t p_chunk)
+		{
+			const unsigned int first = static_cast<unsigned int>(p_chunk) * rowsPerChunk;
+			p_function(first, std::min(p_noOfRows, first + rowsPerChunk));
+		});
+	}
+
+	void GenerateIndices(unsigned int p_noOfXSeg, unsigned int p_noOfYSeg, unsigned int* p_indices, ThreadPool& p_pool)
+	{
+		ForEachRowRange(p_noOfYSeg, p_pool, [&](unsigned int p_first, unsigned int p_last)
+		{
+			unsigned int* out = p_indices + static_cast<size_t>(p_first) * p_noOfXSeg * 6;
+			for (unsigned int y = p_first; y < p_last; ++y)
+			{
+				for (unsigned int x = 0; x < p_noOfXSeg; ++x)
+				{
+					const unsigned int topLeft = y * (p_noOfXSeg + 1) + x;
+					const unsigned int bottomLeft = (y + 1) * (p_noOfXSeg + 1) + x;
+
+					out[0] = topLeft;
+					out[1] = topLeft + 1;
+					out[2] = bottomLeft;
+
+					out[3] = topLeft + 1;
+					out[4] = bottomLeft + 1;
+					out[5] = bottomLeft;
+					out += 6;
+				}
+			}
+		});
+	}
+}
\ No newline at end of file
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "ThreadPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PARAMETRICSURFACE_SSE2
+#include <emmintrin.h>
+#endif
+
+// Grid meshes of surfaces of revolution around the y axis, in the MeshGrid vertex layout
+// (3 float position, 3 float normal, 2 float uv) with the winding of the original sphere.
+//
+// Column x of p_noOfXSeg + 1 sits at the angle 2 pi x / p_noOfXSeg around y; its cosine and sine
+// come from a table shared by all rows. Each surface turns the row parameter v in [0, 1] into a
+// Row of precomputed values once per row and evaluates four columns at a time through Lanes.
+// Rows are split over a ThreadPool and written straight into a pre-sized buffer.
+//
+// A surface provides:
+//   struct Row;
+//   Row MakeRow(double p_v) const;
+//   template <typename T> void Evaluate(const Row& p_row, T p_cosU, T p_sinU, T* p_position, T* p_normal) const;
+// where T is float or Lanes.
+namespace ParametricSurface
+{
+	constexpr size_t FLOATS_PER_VERTEX = 8;
+
+#ifdef PARAMETRICSURFACE_SSE2
+	// Four floats evaluated side by side
+	struct Lanes
+	{
+		__m128 value;
+
+		Lanes(float p_value) : value(_mm_set1_ps(p_value)) {}
+		Lanes(__m128 p_value) : value(p_value) {}
+	};
+
+	inline Lanes operator+(Lanes p_a, Lanes p_b) { return _mm_add_ps(p_a.value, p_b.value); }
+	inline Lanes operator-(Lanes p_a, Lanes p_b) { return _mm_sub_ps(p_a.value, p_b.value); }
+	inline Lanes operator*(Lanes p_a, Lanes p_b) { return _mm_mul_ps(p_a.value, p_b.value); }
+	inline Lanes operator/(Lanes p_a, Lanes p_b) { return _mm_div_ps(p_a.value, p_b.value); }
+	inline Lanes Sqrt(Lanes p_a) { return _mm_sqrt_ps(p_a.value); }
+#endif
+
+	inline float Sqrt(float p_a) { return std::sqrt(p_a); }
+
+	// Unit sphere, v = 0 at the north pole (+y)
+	struct Sphere
+	{
+		struct Row { float sinV, cosV; };
+
+		Row MakeRow(double p_v) const
+		{
+			const double angle = p_v * 3.14159265358979323846;
+			return { static_cast<float>(std::sin(angle)), static_cast<float>(std::cos(angle)) };
+		}
+
+		template <typename T>
+		void Evaluate(const Row& p_row, T p_cosU, T p_sinU, T* p_position, T* p_normal) const
+		{
+			p_position[0] = T(p_row.sinV) * p_cosU;
+			p_position[1] = T(p_row.cosV);
+			p_position[2] = T(p_row.sinV) * p_sinU;
+			p_normal[0] = p_position[0];
+			p_normal[1] = p_position[1];
+			p_normal[2] = p_position[2];
+		}
+	};
+
+	// Ellipsoid with the semi axes a (x), b (y) and c (z)
+	struct Ellipsoid
+	{
+		float a, b, c;
+
+		Ellipsoid(float p_a, float p_b, float p_c) : a(p_a), b(p_b), c(p_c) {}
+
+		struct Row { float sinV, cosV; };
+
+		Row MakeRow(double p_v) const
+		{
+			const double angle = p_v * 3.14159265358979323846;
+			return { static_cast<float>(std::sin(angle)), static_cast<float>(std::cos(angle)) };
+		}
+
+		template <typename T>
+		void Evaluate(const Row& p_row, T p_cosU, T p_sinU, T* p_position, T* p_normal) const
+		{
+			p_position[0] = T(a * p_row.sinV) * p_cosU;
+			p_position[1] = T(b * p_row.cosV);
+			p_position[2] = T(c * p_row.sinV) * p_sinU;
+
+			// gradient of the implicit form, only separable into rows and columns if a == c
+			T x = T(p_row.sinV / a) * p_cosU;
+			T y = T(p_row.cosV / b);
+			T z = T(p_row.sinV / c) * p_sinU;
+			T inverseLength = T(1.0f) / Sqrt(x * x + y * y + z * z);
+			p_normal[0] = x * inverseLength;
+			p_normal[1] = y * inverseLength;
+			p_normal[2] = z * inverseLength;
+		}
+	};
+
+	// Torus around the y axis with the ring radius R and the tube radius r; v = 0 is the outer equator
+	struct Torus
+	{
+		float ringRadius, tubeRadius;
+
+		Torus(float p_ringRadius, float p_tubeRadius) : ringRadius(p_ringRadius), tubeRadius(p_tubeRadius) {}
+
+		struct Row { float radius, height, normalRadius, normalHeight; };
+
+		Row MakeRow(double p_v) const
+		{
+			// the tube is walked downwards on the outside, like the rows of the sphere
+			const double angle = p_v * 2.0 * 3.14159265358979323846;
+			const double cosT = std::cos(angle);
+			const double sinT = -std::sin(angle);
+			return { static_cast<float>(ringRadius + tubeRadius * cosT), static_cast<float>(tubeRadius * sinT), static_cast<float>(cosT), static_cast<float>(sinT) };
+		}
+
+		template <typename T>
+		void Evaluate(const Row& p_row, T p_cosU, T p_sinU, T* p_position, T* p_normal) const
+		{
+			p_position[0] = T(p_row.radius) * p_cosU;
+			p_position[1] = T(p_row.height);
+			p_position[2] = T(p_row.radius) * p_sinU;
+			p_normal[0] = T(p_row.normalRadius) * p_cosU;
+			p_normal[1] = T(p_row.normalHeight);
+			p_normal[2] = T(p_row.normalRadius) * p_sinU;
+		}
+	};
+
+	// WGS84 reference ellipsoid. Rows are spaced by geodetic latitude (v = 0 at the north pole),
+	// so the normals are the geodetic up vectors. Positions are scaled by p_scale, the default
+	// maps the equatorial radius to 1.
+	struct Wgs84
+	{
+		static constexpr double SEMI_MAJOR_AXIS = 6378137.0;
+		static constexpr double FLATTENING = 1.0 / 298.257223563;
+
+		double scale;
+
+		Wgs84(double p_scale = 1.0 / SEMI_MAJOR_AXIS) : scale(p_scale) {}
+
+		struct Row { float radius, height, cosLatitude, sinLatitude; };
+
+		Row MakeRow(double p_v) const
+		{
+			const double eccentricitySquared = FLATTENING * (2.0 - FLATTENING);
+			const double latitude = (0.5 - p_v) * 3.14159265358979323846;
+			const double sinLatitude = std::sin(latitude);
+			const double cosLatitude = std::cos(latitude);
+			// prime vertical radius of curvature
+			const double n = SEMI_MAJOR_AXIS / std::sqrt(1.0 - eccentricitySquared * sinLatitude * sinLatitude);
+			return { static_cast<float>(n * cosLatitude * scale), static_cast<float>(n * (1.0 - eccentricitySquared) * sinLatitude * scale),
+				static_cast<float>(cosLatitude), static_cast<float>(sinLatitude) };
+		}
+
+		template <typename T>
+		void Evaluate(const Row& p_row, T p_cosU, T p_sinU, T* p_position, T* p_normal) const
+		{
+			p_position[0] = T(p_row.radius) * p_cosU;
+			p_position[1] = T(p_row.height);
+			p_position[2] = T(p_row.radius) * p_sinU;
+			p_normal[0] = T(p_row.cosLatitude) * p_cosU;
+			p_normal[1] = T(p_row.sinLatitude);
+			p_normal[2] = T(p_row.cosLatitude) * p_sinU;
+		}
+	};
+
+	inline size_t VertexCount(unsigned int p_noOfXSeg, unsigned int p_noOfYSeg)
+	{
+		return static_cast<size_t>(p_noOfXSeg + 1) * (p_noOfYSeg + 1);
+	}
+
+	inline size_t IndexCount(unsigned int p_noOfXSeg, unsigned int p_noOfYSeg)
+	{
+		return static_cast<size_t>(p_noOfXSeg) * p_noOfYSeg * 6;
+	}
+
+	// cos and sin of the angle around y and the texture u of every column
+	struct Columns
+	{
+		std::vector<float> cosU;
+		std::vector<float> sinU;
+		std::vector<float> texU;
+	};
+
+	void BuildColumns(unsigned int p_noOfXSeg, Columns& p_columns);
+
+	// Calls p_function(first, last) for chunks of [0, p_noOfRows) spread over the pool
+	void ForEachRowRange(unsigned int p_noOfRows, ThreadPool& p_pool, const std::function<void(unsigned int, unsigned int)>& p_function);
+
+	// Two triangles per grid cell, the same for every surface
+	void GenerateIndices(unsigned int p_noOfXSeg, unsigned int p_noOfYSeg, unsigned int* p_indices, ThreadPool& p_pool);
+
+	template <typename Surface>
+	void _writeRow(const Surface& p_surface, const typename Surface::Row& p_row, const Columns& p_columns, float p_texV, unsigned int p_noOfColumns, float* p_vertices)
+	{
+		unsigned int x = 0;
+
+#ifdef PARAMETRICSURFACE_SSE2
+		// four vertices per step, transposed into two 16 byte halves each. Non-temporal stores keep
+		// large meshes from evicting the cache and skip reading the destination first.
+		const bool aligned = (reinterpret_cast<uintptr_t>(p_vertices) & 15) == 0;
+		for (; x + 4 <= p_noOfColumns; x += 4)
+		{
+			Lanes position[3] = { 0.0f, 0.0f, 0.0f };
+			Lanes normal[3] = { 0.0f, 0.0f, 0.0f };
+			p_surface.Evaluate(p_row, Lanes(_mm_loadu_ps(&p_columns.cosU[x])), Lanes(_mm_loadu_ps(&p_columns.sinU[x])), position, normal);
+
+			__m128 first[4] = { position[0].value, position[1].value, position[2].value, normal[0].value };
+			__m128 second[4] = { normal[1].value, normal[2].value, _mm_loadu_ps(&p_columns.texU[x]), _mm_set1_ps(p_texV) };
+			_MM_TRANSPOSE4_PS(first[0], first[1], first[2], first[3]);
+			_MM_TRANSPOSE4_PS(second[0], second[1], second[2], second[3]);
+
+			float* out = p_vertices + static_cast<size_t>(x) * FLOATS_PER_VERTEX;
+			for (int i = 0; i < 4; ++i)
+			{
+				if (aligned)
+				{
+					_mm_stream_ps(out + i * FLOATS_PER_VERTEX, first[i]);
+					_mm_stream_ps(out + i * FLOATS_PER_VERTEX + 4, second[i]);
+				}
+				else
+				{
+					_mm_storeu_ps(out + i * FLOATS_PER_VERTEX, first[i]);
+					_mm_storeu_ps(out + i * FLOATS_PER_VERTEX + 4, second[i]);
+				}
+			}
+		}
+#endif
+
+		for (; x < p_noOfColumns; ++x)
+		{
+			float* out = p_vertices + static_cast<size_t>(x) * FLOATS_PER_VERTEX;
+			p_surface.Evaluate(p_row, p_columns.cosU[x], p_columns.sinU[x], out, out + 3);
+			out[6] = p_columns.texU[x];
+			out[7] = p_texV;
+		}
+	}
+
+	// p_vertices has to hold VertexCount floats times FLOATS_PER_VERTEX
+	template <typename Surface>
+	void GenerateVertices(const Surface& p_surface, unsigned int p_noOfXSeg, unsigned int p_noOfYSeg, float* p_vertices, ThreadPool& p_pool)
+	{
+		Columns columns;
+		BuildColumns(p_noOfXSeg, columns);
+
+		const size_t rowFloats = static_cast<size_t>(p_noOfXSeg + 1) * FLOATS_PER_VERTEX;
+		ForEachRowRange(p_noOfYSeg + 1, p_pool, [&](unsigned int p_first, unsigned int p_last)
+		{
+			for (unsigned int y = p_first; y < p_last; ++y)
+			{
+				const double v = static_cast<double>(y) / p_noOfYSeg;
+				_writeRow(p_surface, p_surface.MakeRow(v), columns, static_cast<float>(v), p_noOfXSeg + 1, p_vertices + y * rowFloats);
+			}
+#ifdef PARAMETRICSURFACE_SSE2
+			// make the non-temporal stores visible before the pool reports the chunk as done
+			_mm_sfence();
+#endif
+		});
+	}
+
+	// Sizes the vectors once and fills them in place. Vectors that already have the size are reused
+	// as they are, which skips the allocation and first touch of the pages.
+	template <typename Surface>
+	void Generate(const Surface& p_surface, unsigned int p_noOfXSeg, unsigned int p_noOfYSeg, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles,
+		ThreadPool& p_pool = ThreadPool::Shared())
+	{
+		p_vertices.resize(VertexCount(p_noOfXSeg, p_noOfYSeg) * FLOATS_PER_VERTEX);
+		p_triangles.resize(IndexCount(p_noOfXSeg, p_noOfYSeg));
+		GenerateVertices(p_surface, p_noOfXSeg, p_noOfYSeg, p_vertices.data(), p_pool);
+		GenerateIndices(p_noOfXSeg, p_noOfYSeg, p_triangles.data(), p_pool);
+	}
+}
\ No newline at end of file
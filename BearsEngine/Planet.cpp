@@ -0,0 +1,686 @@
+#include "Planet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "glad/glad.h"
+#include "glm/gtc/constants.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "Camera.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "Shader.h"
+#include "SphereMesh.h"
+#include "ResidencyManager.h"
+#include "ResourceManager.h"
+#include "ThreadPool.h"
+#include "VertexQuantizer.h"
+
+namespace
+{
+	constexpr unsigned int NONE = 0xFFFFFFFFu;
+
+	constexpr unsigned int GRID = Planet::PATCH_SEGMENTS + 1;
+	// grid, then one skirt vertex below every vertex of the border loop
+	constexpr unsigned int BORDER_VERTICES = 4 * Planet::PATCH_SEGMENTS;
+	constexpr unsigned int PATCH_VERTICES = GRID * GRID + BORDER_VERTICES;
+
+	// position and normal, uv, then position and normal on the parent patch
+	constexpr unsigned int FLOATS_PER_VERTEX = 14;
+
+	// a whole face around a pole would cover every longitude, so the trees start one level down
+	// where the equirectangular seam can still be unwrapped per patch
+	constexpr unsigned int ROOT_LEVEL = 1;
+	constexpr unsigned int NO_OF_ROOTS = 6 * 4;
+
+	// skirts reach this many errors of their own level down, enough for a neighbour one level coarser
+	constexpr double SKIRT_DEPTH = 8.0;
+
+	// Grid coordinates of border vertex p_index, counter-clockwise from the corner (0, 0)
+	void _borderVertex(unsigned int p_index, unsigned int& p_i, unsigned int& p_j)
+	{
+		const unsigned int side = p_index / Planet::PATCH_SEGMENTS;
+		const unsigned int step = p_index % Planet::PATCH_SEGMENTS;
+		switch (side)
+		{
+		case 0: p_i = step; p_j = 0; break;
+		case 1: p_i = Planet::PATCH_SEGMENTS; p_j = step; break;
+		case 2: p_i = Planet::PATCH_SEGMENTS - step; p_j = Planet::PATCH_SEGMENTS; break;
+		default: p_i = 0; p_j = Planet::PATCH_SEGMENTS - step; break;
+		}
+	}
+
+	// Texture u of the equirectangular mapping, see ParametricSurface::Sphere
+	double _texU(const glm::dvec3& p_direction)
+	{
+		double u = std::atan2(p_direction.z, p_direction.x) / (2.0 * glm::pi<double>());
+		return 1.0 - (u < 0.0 ? u + 1.0 : u);
+	}
+
+	bool _isPole(const glm::dvec3& p_direction)
+	{
+		return p_direction.x * p_direction.x + p_direction.z * p_direction.z < 1e-18;
+	}
+}
+
+uint64_t Planet::PatchId::Key() const
+{
+	return static_cast<uint64_t>(face) << 61 | static_cast<uint64_t>(level) << 56 | static_cast<uint64_t>(x) << 28 | y;
+}
+
+Planet::PatchId Planet::PatchId::Child(unsigned int p_index) const
+{
+	return PatchId{ face, level + 1, x * 2 + (p_index & 1), y * 2 + (p_index >> 1) };
+}
+
+Planet::Planet(const char* p_texturePath, const PlanetOptions& p_options)
+	: m_options(p_options)
+{
+	// keys hold 28 bits per coordinate
+	m_options.maxLevel = std::clamp(m_options.maxLevel, ROOT_LEVEL, 27u);
+	m_options.maxPatches = std::max(m_options.maxPatches, NO_OF_ROOTS + 4);
+
+	// worst cell sag of a corner and a center patch on each level; the spherified grid is not
+	// uniform, so this is measured rather than scaled down from the first level
+	m_levelError.resize(m_options.maxLevel + 1);
+	for (unsigned int level = 0; level <= m_options.maxLevel; ++level)
+	{
+		const uint32_t middle = level ? 1u << (level - 1) : 0u;
+		double error = 0.0;
+		for (const PatchId& id : { PatchId{ 0, level, 0, 0 }, PatchId{ 0, level, middle, middle } })
+		{
+			for (unsigned int j = 0; j < PATCH_SEGMENTS; ++j)
+			{
+				for (unsigned int i = 0; i < PATCH_SEGMENTS; ++i)
+				{
+					const glm::dvec3 diagonalMiddle = (_pointOnFace(id, i, j) + _pointOnFace(id, i + 1, j + 1)) * 0.5;
+					error = std::max(error, 1.0 - glm::length(diagonalMiddle));
+				}
+			}
+		}
+		m_levelError[level] = error;
+	}
+
+	if (m_options.elevationPath)
+	{
+		m_elevation = std::make_unique<ElevationCache>(m_options.elevationPath, m_options.elevationBudget);
+		if (m_elevation->IsOpen())
+		{
+			const ElevationPyramid& pyramid = m_elevation->Pyramid();
+			m_heightScale = m_options.heightScale / m_options.radius;
+			m_maxRaise = std::max(0.0, pyramid.maxHeight * m_heightScale);
+			m_maxSink = std::max(0.0, -pyramid.minHeight * m_heightScale);
+		}
+		else
+		{
+			m_elevation.reset();
+		}
+	}
+
+	glGenVertexArrays(1, &m_VAO);
+	glBindVertexArray(m_VAO);
+
+	glGenBuffers(1, &m_VBO);
+	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+	glBufferData(GL_ARRAY_BUFFER, PoolBytes(), nullptr, GL_DYNAMIC_DRAW);
+
+	const GLsizei stride = FLOATS_PER_VERTEX * sizeof(float);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+	// position and normal on the parent patch, blended in by uMorph
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)(8 * sizeof(float)));
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (void*)(11 * sizeof(float)));
+	glEnableVertexAttribArray(4);
+
+	_createIndexBuffer();
+	glBindVertexArray(0);
+
+	m_texture = ResourceManager::Shared().Texture(p_texturePath);
+	ResidencyManager::Shared().Track(this, PoolBytes());
+
+	// the roots are built right away and never evicted, so there is always something to draw
+	m_slots.resize(m_options.maxPatches);
+	for (unsigned int face = 0; face < 6; ++face)
+	{
+		for (unsigned int root = 0; root < 4; ++root)
+		{
+			m_requests.push_back(Request{ PatchId{ face, ROOT_LEVEL, root & 1, root >> 1 }, 0.0f, NONE });
+		}
+	}
+	const unsigned int patchesPerFrame = m_options.patchesPerFrame;
+	m_options.patchesPerFrame = NO_OF_ROOTS;
+	_buildRequested();
+	m_options.patchesPerFrame = patchesPerFrame;
+}
+
+Planet::~Planet()
+{
+	glDeleteVertexArrays(1, &m_VAO);
+	glDeleteBuffers(1, &m_VBO);
+	glDeleteBuffers(1, &m_EBO);
+	ResidencyManager::Shared().Untrack(this);
+}
+
+size_t Planet::PoolBytes() const
+{
+	return static_cast<size_t>(m_options.maxPatches) * PATCH_VERTICES * FLOATS_PER_VERTEX * sizeof(float);
+}
+
+void Planet::SetCamera(const Camera* p_camera, const glm::mat4& p_projection, float p_viewportHeight)
+{
+	m_camera = p_camera;
+	m_projection = p_projection;
+	m_viewportHeight = p_viewportHeight;
+}
+
+void Planet::SetModelMatrix(const glm::mat4& p_model)
+{
+	m_model = p_model;
+}
+
+void Planet::_createIndexBuffer()
+{
+	std::vector<uint16_t> indices;
+	indices.reserve(PATCH_SEGMENTS * PATCH_SEGMENTS * 6 + BORDER_VERTICES * 6);
+
+	// every cell split along the same diagonal, which the morph targets of _buildPatch rely on
+	for (unsigned int j = 0; j < PATCH_SEGMENTS; ++j)
+	{
+		for (unsigned int i = 0; i < PATCH_SEGMENTS; ++i)
+		{
+			const uint16_t v00 = static_cast<uint16_t>(j * GRID + i);
+			const uint16_t v10 = static_cast<uint16_t>(v00 + 1);
+			const uint16_t v01 = static_cast<uint16_t>(v00 + GRID);
+			const uint16_t v11 = static_cast<uint16_t>(v01 + 1);
+			indices.insert(indices.end(), { v00, v10, v11, v00, v11, v01 });
+		}
+	}
+
+	// skirt walls facing away from the patch, along the counter-clockwise border loop
+	for (unsigned int k = 0; k < BORDER_VERTICES; ++k)
+	{
+		unsigned int i, j, nextI, nextJ;
+		_borderVertex(k, i, j);
+		_borderVertex((k + 1) % BORDER_VERTICES, nextI, nextJ);
+		const uint16_t a = static_cast<uint16_t>(j * GRID + i);
+		const uint16_t b = static_cast<uint16_t>(nextJ * GRID + nextI);
+		const uint16_t skirtA = static_cast<uint16_t>(GRID * GRID + k);
+		const uint16_t skirtB = static_cast<uint16_t>(GRID * GRID + (k + 1) % BORDER_VERTICES);
+		indices.insert(indices.end(), { a, skirtA, skirtB, a, skirtB, b });
+	}
+
+	m_noOfIndices = static_cast<unsigned int>(indices.size());
+	glGenBuffers(1, &m_EBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+}
+
+glm::dvec3 Planet::_pointOnFace(const PatchId& p_id, double p_i, double p_j) const
+{
+	const SphereMesh::CubeFace& face = SphereMesh::CUBE_FACES[p_id.face];
+	const double size = 1.0 / static_cast<double>(1u << p_id.level);
+
+	glm::dvec3 cubePoint;
+	cubePoint[face.axis] = face.sign;
+	cubePoint[face.iAxis] = 2.0 * (p_id.x + p_i / PATCH_SEGMENTS) * size - 1.0;
+	cubePoint[face.jAxis] = 2.0 * (p_id.y + p_j / PATCH_SEGMENTS) * size - 1.0;
+	return SphereMesh::CubeToSphere(cubePoint, m_options.spherify);
+}
+
+void Planet::_bounds(const PatchId& p_id, glm::dvec3& p_center, double& p_radius) const
+{
+	const double half = PATCH_SEGMENTS / 2.0;
+	p_center = _pointOnFace(p_id, half, half);
+
+	// the patch bulges between its corners, the edge middles catch most of it
+	p_radius = 0.0;
+	const double samples[8][2] = { { 0, 0 }, { half, 0 }, { PATCH_SEGMENTS, 0 }, { 0, half }, { PATCH_SEGMENTS, half }, { 0, PATCH_SEGMENTS }, { half, PATCH_SEGMENTS }, { PATCH_SEGMENTS, PATCH_SEGMENTS } };
+	for (const double* sample : samples)
+	{
+		p_radius = std::max(p_radius, glm::length(_pointOnFace(p_id, sample[0], sample[1]) - p_center));
+	}
+	p_radius += SKIRT_DEPTH * m_levelError[p_id.level] + std::max(m_maxRaise, m_maxSink);
+}
+
+bool Planet::_isVisible(const glm::dvec3& p_center, double p_radius) const
+{
+	const glm::vec3 center = glm::vec3(p_center);
+	for (int i = 0; i < 6; ++i)
+	{
+		if (glm::dot(glm::vec3(m_planes[i]), center) + m_planes[i].w < -static_cast<float>(p_radius))
+		{
+			return false;
+		}
+	}
+
+	// points with dot(p, c) < r^2 lie behind the horizon of the sphere of radius r seen from c;
+	// the lowest terrain is the sphere nothing can be hidden behind
+	const double occluderRadius = 1.0 - m_maxSink;
+	const double cameraDistance = glm::length(m_cameraPosition);
+	if (cameraDistance > occluderRadius)
+	{
+		return glm::dot(p_center, m_cameraPosition) / cameraDistance + p_radius >= occluderRadius * occluderRadius / cameraDistance;
+	}
+	return true;
+}
+
+void Planet::_visit(const PatchId& p_id, float p_parentScreenError)
+{
+	glm::dvec3 center;
+	double radius;
+	_bounds(p_id, center, radius);
+	if (!_isVisible(center, radius))
+	{
+		return;
+	}
+
+	// terrain is rough at every scale, so half of the sag against the parent stays in the children
+	const unsigned int slot = m_slotOf.at(p_id.Key());
+	const double error = std::max(m_levelError[p_id.level], 0.5 * m_slots[slot].roughness);
+	const double distance = std::max(glm::length(center - m_cameraPosition) - radius, 1e-12);
+	const float screenError = static_cast<float>(error * m_screenScale / distance);
+
+	if (screenError > m_options.pixelError && p_id.level < m_options.maxLevel)
+	{
+		bool resident = true;
+		unsigned int children[4];
+		for (unsigned int c = 0; c < 4; ++c)
+		{
+			const PatchId child = p_id.Child(c);
+			auto found = m_slotOf.find(child.Key());
+			if (found == m_slotOf.end())
+			{
+				m_requests.push_back(Request{ child, screenError, NONE });
+				resident = false;
+			}
+			else
+			{
+				children[c] = found->second;
+			}
+		}
+
+		if (resident)
+		{
+			// keep all four from being evicted while the rest of the tree is walked
+			for (unsigned int childSlot : children)
+			{
+				m_slots[childSlot].lastFrame = m_frame;
+			}
+			for (unsigned int c = 0; c < 4; ++c)
+			{
+				_visit(p_id.Child(c), screenError);
+			}
+			return;
+		}
+	}
+
+	// a fresh split looks like the parent and turns into this level once the parent's error
+	// has doubled
+	const float morph = p_id.level == ROOT_LEVEL ? 0.0f : glm::clamp(2.0f - p_parentScreenError / m_options.pixelError, 0.0f, 1.0f);
+	_draw(slot, morph);
+	if (m_elevation)
+	{
+		_requestElevation(p_id, slot, static_cast<float>(distance), screenError);
+	}
+}
+
+unsigned int Planet::_elevationLevel(unsigned int p_level) const
+{
+	// tile samples about as far apart as the cells: a level L patch has 128 * 2^L cells around the
+	// equator, a level z tile row 512 * 2^z samples
+	return std::min(p_level > 2 ? p_level - 2 : 0u, m_elevation->Pyramid().levels - 1);
+}
+
+void Planet::_elevationTiles(unsigned int p_level, const glm::vec4& p_uvRect, std::vector<uint64_t>& p_keys) const
+{
+	unsigned int level = _elevationLevel(p_level);
+
+	// patches around a pole span every longitude, a coarser level keeps them to a few tiles
+	uint32_t x0, x1, y0, y1;
+	for (;; --level)
+	{
+		const unsigned int tilesX = ElevationCache::TilesX(level);
+		const unsigned int tilesY = ElevationCache::TilesY(level);
+		x0 = static_cast<uint32_t>(std::floor(p_uvRect.x * tilesX));
+		x1 = std::min(static_cast<uint32_t>(std::floor(p_uvRect.z * tilesX)), x0 + tilesX - 1);
+		y0 = std::min(static_cast<uint32_t>(p_uvRect.y * tilesY), tilesY - 1);
+		y1 = std::min(static_cast<uint32_t>(p_uvRect.w * tilesY), tilesY - 1);
+		if (level == 0 || (x1 - x0 + 1) * (y1 - y0 + 1) <= 8)
+		{
+			break;
+		}
+	}
+
+	p_keys.clear();
+	for (uint32_t y = y0; y <= y1; ++y)
+	{
+		for (uint32_t x = x0; x <= x1; ++x)
+		{
+			p_keys.push_back(ElevationCache::Key(level, x % ElevationCache::TilesX(level), y));
+		}
+	}
+}
+
+void Planet::_requestElevation(const PatchId& p_id, unsigned int p_slot, float p_distance, float p_screenError)
+{
+	const Slot& slot = m_slots[p_slot];
+	std::vector<uint64_t> keys;
+	_elevationTiles(slot.level, slot.uvRect, keys);
+
+	bool complete = true;
+	for (uint64_t key : keys)
+	{
+		m_tileRequests.push_back(ElevationTileRequest{ key, p_distance });
+		complete = complete && m_elevation->IsResident(key);
+	}
+
+	if (complete && !slot.elevationComplete)
+	{
+		m_requests.push_back(Request{ p_id, p_screenError, p_slot });
+	}
+}
+
+void Planet::_draw(unsigned int p_slot, float p_morph)
+{
+	m_drawList.push_back(Draw{ p_slot, p_morph });
+	m_slots[p_slot].lastFrame = m_frame;
+	m_deepestLevel = std::max(m_deepestLevel, m_slots[p_slot].level);
+}
+
+void Planet::_buildPatch(const PatchId& p_id, float* p_vertices, Slot& p_slot) const
+{
+	// the grid with a ring of vertices around it, so normals of displaced border vertices come
+	// from central differences and match the neighbouring patch
+	constexpr unsigned int APRON = GRID + 2;
+	const unsigned int elevationLevel = m_elevation ? _elevationLevel(p_id.level) : 0;
+	glm::dvec3 apron[APRON * APRON];
+	for (unsigned int j = 0; j < APRON; ++j)
+	{
+		for (unsigned int i = 0; i < APRON; ++i)
+		{
+			const glm::dvec3 direction = _pointOnFace(p_id, i - 1.0, j - 1.0);
+			double height = 0.0;
+			if (m_elevation)
+			{
+				height = m_elevation->Height(_texU(direction), std::acos(std::clamp(direction.y, -1.0, 1.0)) / glm::pi<double>(), elevationLevel) * m_heightScale;
+			}
+			apron[j * APRON + i] = direction * (1.0 + height);
+		}
+	}
+	auto at = [&](unsigned int p_i, unsigned int p_j) -> const glm::dvec3& { return apron[(p_j + 1) * APRON + p_i + 1]; };
+
+	// where a vertex lies on the parent, which only has the even rows and columns and splits its
+	// cells along the same diagonal
+	auto parentPosition = [&](unsigned int p_i, unsigned int p_j)
+	{
+		const bool oddI = p_i & 1, oddJ = p_j & 1;
+		if (oddI && oddJ)
+		{
+			return (at(p_i - 1, p_j - 1) + at(p_i + 1, p_j + 1)) * 0.5;
+		}
+		if (oddI)
+		{
+			return (at(p_i - 1, p_j) + at(p_i + 1, p_j)) * 0.5;
+		}
+		if (oddJ)
+		{
+			return (at(p_i, p_j - 1) + at(p_i, p_j + 1)) * 0.5;
+		}
+		return at(p_i, p_j);
+	};
+
+	const glm::dvec3 center = _pointOnFace(p_id, PATCH_SEGMENTS / 2.0, PATCH_SEGMENTS / 2.0);
+
+	glm::dvec3 direction[GRID * GRID];
+	glm::vec3 normal[GRID * GRID];
+	glm::dvec3 parent[GRID * GRID];
+	double roughness = 0.0;
+	for (unsigned int j = 0; j < GRID; ++j)
+	{
+		for (unsigned int i = 0; i < GRID; ++i)
+		{
+			const unsigned int v = j * GRID + i;
+			direction[v] = glm::normalize(at(i, j));
+			normal[v] = m_elevation ? glm::vec3(glm::normalize(glm::cross(at(i + 1, j) - at(i - 1, j), at(i, j + 1) - at(i, j - 1)))) : glm::vec3(direction[v]);
+			parent[v] = parentPosition(i, j);
+			roughness = std::max(roughness, glm::length(at(i, j) - parent[v]));
+		}
+	}
+
+	// texture u of every grid vertex; a patch across the u = 0 meridian is unwrapped past 1,
+	// which GL_REPEAT folds back, and a pole takes the u of the patch center
+	double texU[GRID * GRID];
+	double texV[GRID * GRID];
+	double smallest = 1.0, largest = 0.0;
+	for (unsigned int v = 0; v < GRID * GRID; ++v)
+	{
+		texU[v] = _isPole(direction[v]) ? _texU(center) : _texU(direction[v]);
+		texV[v] = std::acos(std::clamp(direction[v].y, -1.0, 1.0)) / glm::pi<double>();
+		smallest = std::min(smallest, texU[v]);
+		largest = std::max(largest, texU[v]);
+	}
+	if (largest - smallest > 0.5)
+	{
+		for (double& u : texU)
+		{
+			u = u < 0.5 ? u + 1.0 : u;
+		}
+	}
+
+	// the skirt hangs below the border by the curvature error and by how far the terrain moved
+	// against the parent, which bounds the step to a coarser neighbour
+	const double skirtDepth = SKIRT_DEPTH * m_levelError[p_id.level] + roughness;
+	auto write = [&](unsigned int p_vertex, unsigned int p_i, unsigned int p_j, double p_depth)
+	{
+		const unsigned int v = p_j * GRID + p_i;
+		const glm::vec3 position = glm::vec3(at(p_i, p_j) - direction[v] * p_depth - center);
+		const glm::vec3 parentPositionRelative = glm::vec3(parent[v] - direction[v] * p_depth - center);
+
+		// the parent normal follows the same averaging as the parent position
+		glm::vec3 parentNormal = normal[v];
+		if (p_i & 1)
+		{
+			parentNormal = (p_j & 1) ? normal[v - GRID - 1] + normal[v + GRID + 1] : normal[v - 1] + normal[v + 1];
+		}
+		else if (p_j & 1)
+		{
+			parentNormal = normal[v - GRID] + normal[v + GRID];
+		}
+		parentNormal = glm::normalize(parentNormal);
+
+		float* out = p_vertices + static_cast<size_t>(p_vertex) * FLOATS_PER_VERTEX;
+		const float vertex[FLOATS_PER_VERTEX] = { position.x, position.y, position.z, normal[v].x, normal[v].y, normal[v].z, static_cast<float>(texU[v]), static_cast<float>(texV[v]),
+			parentPositionRelative.x, parentPositionRelative.y, parentPositionRelative.z, parentNormal.x, parentNormal.y, parentNormal.z };
+		std::copy(vertex, vertex + FLOATS_PER_VERTEX, out);
+	};
+
+	for (unsigned int j = 0; j < GRID; ++j)
+	{
+		for (unsigned int i = 0; i < GRID; ++i)
+		{
+			write(j * GRID + i, i, j, 0.0);
+		}
+	}
+
+	for (unsigned int k = 0; k < BORDER_VERTICES; ++k)
+	{
+		unsigned int i, j;
+		_borderVertex(k, i, j);
+		write(GRID * GRID + k, i, j, skirtDepth);
+	}
+
+	p_slot.center = center;
+	p_slot.roughness = static_cast<float>(roughness);
+	p_slot.uvRect = glm::vec4(texU[0], texV[0], texU[0], texV[0]);
+	for (unsigned int v = 0; v < GRID * GRID; ++v)
+	{
+		p_slot.uvRect = glm::vec4(std::min<float>(p_slot.uvRect.x, static_cast<float>(texU[v])), std::min<float>(p_slot.uvRect.y, static_cast<float>(texV[v])),
+			std::max<float>(p_slot.uvRect.z, static_cast<float>(texU[v])), std::max<float>(p_slot.uvRect.w, static_cast<float>(texV[v])));
+	}
+
+	p_slot.elevationComplete = true;
+	if (m_elevation)
+	{
+		std::vector<uint64_t> keys;
+		_elevationTiles(p_id.level, p_slot.uvRect, keys);
+		for (uint64_t key : keys)
+		{
+			p_slot.elevationComplete = p_slot.elevationComplete && m_elevation->IsResident(key);
+		}
+	}
+}
+
+unsigned int Planet::_takeSlot()
+{
+	unsigned int oldest = NONE;
+	for (unsigned int slot = 0; slot < m_slots.size(); ++slot)
+	{
+		const Slot& candidate = m_slots[slot];
+		if (!candidate.used)
+		{
+			return slot;
+		}
+
+		// roots stay, and so does everything touched this frame
+		if (candidate.level != ROOT_LEVEL && candidate.lastFrame != m_frame && (oldest == NONE || candidate.lastFrame < m_slots[oldest].lastFrame))
+		{
+			oldest = slot;
+		}
+	}
+
+	if (oldest != NONE)
+	{
+		m_slotOf.erase(m_slots[oldest].key);
+		m_slots[oldest].used = false;
+	}
+	return oldest;
+}
+
+void Planet::_buildRequested()
+{
+	if (m_requests.empty())
+	{
+		return;
+	}
+
+	// largest screen error first; the rest ask again next frame
+	std::stable_sort(m_requests.begin(), m_requests.end(), [](const Request& p_a, const Request& p_b) { return p_a.priority > p_b.priority; });
+
+	// slots first, a full pool of patches in use this frame builds nothing; rebuilt patches keep theirs
+	std::vector<unsigned int> slots;
+	while (slots.size() < std::min<size_t>(m_requests.size(), m_options.patchesPerFrame))
+	{
+		unsigned int slot = m_requests[slots.size()].slot;
+		if (slot == NONE)
+		{
+			slot = _takeSlot();
+			if (slot == NONE)
+			{
+				break;
+			}
+			m_slots[slot].used = true;
+			m_slots[slot].lastFrame = m_frame;
+		}
+		slots.push_back(slot);
+	}
+	const size_t noOfPatches = slots.size();
+
+	const size_t patchFloats = static_cast<size_t>(PATCH_VERTICES) * FLOATS_PER_VERTEX;
+	m_staging.resize(noOfPatches * patchFloats);
+	ThreadPool::Shared().ParallelFor(noOfPatches, [&](size_t p_index)
+	{
+		_buildPatch(m_requests[p_index].id, m_staging.data() + p_index * patchFloats, m_slots[slots[p_index]]);
+	});
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+	for (size_t i = 0; i < noOfPatches; ++i)
+	{
+		Slot& target = m_slots[slots[i]];
+		target.key = m_requests[i].id.Key();
+		target.level = m_requests[i].id.level;
+		m_slotOf[target.key] = slots[i];
+
+		glBufferSubData(GL_ARRAY_BUFFER, slots[i] * patchFloats * sizeof(float), patchFloats * sizeof(float), m_staging.data() + i * patchFloats);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Planet::Render(Shader& shader)
+{
+	++m_frame;
+	m_drawList.clear();
+	m_requests.clear();
+	m_tileRequests.clear();
+	m_deepestLevel = 0;
+
+	if (m_elevation)
+	{
+		m_elevation->Poll();
+	}
+
+	if (m_camera)
+	{
+		// refine in object space, where the patches and their errors are
+		const glm::mat4 view = glm::lookAt(m_camera->Position, m_camera->Position + m_camera->Front, m_camera->Up);
+		MeshletBuilder::ExtractFrustum(m_projection * view * m_model, m_planes);
+		m_cameraPosition = glm::dvec3(glm::inverse(m_model) * glm::vec4(m_camera->Position, 1.0f));
+		m_screenScale = MeshSimplifier::PixelsPerUnit(1.0f, glm::radians(m_camera->Zoom), m_viewportHeight);
+
+		for (unsigned int face = 0; face < 6; ++face)
+		{
+			for (unsigned int root = 0; root < 4; ++root)
+			{
+				_visit(PatchId{ face, ROOT_LEVEL, root & 1, root >> 1 }, 0.0f);
+			}
+		}
+
+		if (m_elevation)
+		{
+			// the first level is what everything else falls back to
+			for (uint32_t x = 0; x < ElevationCache::TilesX(0); ++x)
+			{
+				m_tileRequests.push_back(ElevationTileRequest{ ElevationCache::Key(0, x, 0), -1.0f });
+			}
+			m_elevation->Request(m_tileRequests);
+		}
+		_buildRequested();
+	}
+	else
+	{
+		for (unsigned int slot = 0; slot < m_slots.size(); ++slot)
+		{
+			if (m_slots[slot].used && m_slots[slot].level == ROOT_LEVEL)
+			{
+				_draw(slot, 0.0f);
+			}
+		}
+	}
+
+	// the nearest point of the unit sphere decides how much of the texture is needed
+	const double surfaceDistance = glm::length(m_cameraPosition) - 1.0;
+	const bool outside = m_camera && surfaceDistance > 0.0;
+	ResidencyManager::Shared().TextureDrawn(m_texture.get(), outside ? static_cast<float>(2.0 * m_screenScale / surfaceDistance) : std::numeric_limits<float>::infinity());
+	glBindTexture(GL_TEXTURE_2D, m_texture->texture);
+
+	shader.Use();
+	shader.SetMat3("t_i_model", glm::transpose(glm::inverse(glm::mat3(m_model))));
+	shader.SetInt("uVertexFormat", static_cast<int>(VertexFormat::PlanetPatch));
+
+	glBindVertexArray(m_VAO);
+	for (const Draw& draw : m_drawList)
+	{
+		shader.SetMat4("model", glm::translate(m_model, glm::vec3(m_slots[draw.slot].center)));
+		shader.SetFloat("uMorph", draw.morph);
+		glDrawElementsBaseVertex(GL_TRIANGLES, m_noOfIndices, GL_UNSIGNED_SHORT, nullptr, static_cast<GLint>(draw.slot * PATCH_VERTICES));
+	}
+	glBindVertexArray(0);
+
+	m_renderedTriangles = static_cast<unsigned int>(m_drawList.size()) * (m_noOfIndices / 3);
+}
\ No newline at end of file
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "ElevationCache.h"
+#include "Renderable.h"
+
+class Camera;
+struct SharedTexture;
+
+struct PlanetOptions
+{
+	// largest on-screen error in pixels a patch may have before it is split into four
+	float pixelError = 2.0f;
+
+	// deepest quadtree level; a level 20 patch is about 10 m across on the earth
+	unsigned int maxLevel = 20;
+
+	// patches kept on the GPU at once, the 24 roots included. The vertex buffer is allocated for
+	// all of them up front, so memory stays the same however the camera moves.
+	unsigned int maxPatches = 512;
+
+	// new patches built and uploaded per frame; their parent is drawn until they are there
+	unsigned int patchesPerFrame = 16;
+
+	// cube to sphere mapping, see SphereMesh::CubeSphere
+	bool spherify = true;
+
+	// ElevationCache pyramid displacing the surface, none keeps the smooth sphere
+	const char* elevationPath = nullptr;
+	size_t elevationBudget = 64 * 1024 * 1024;
+	// meters per unit, and a factor on the heights to make the relief visible from orbit
+	double radius = 6371000.0;
+	float heightScale = 1.0f;
+};
+
+// Unit sphere drawn as chunked LOD: each cube face is split into quadtrees of patches with
+// PATCH_SEGMENTS x PATCH_SEGMENTS cells, all sharing one index buffer. The trees start at the
+// quarters of the faces, so no patch goes all the way around a pole. Every frame the trees are
+// walked from the roots and a patch is split while its geometric error covers more than
+// PlanetOptions::pixelError pixels from the camera.
+//
+// Vertices carry the position they have on the parent patch as well, and sphere.vs blends towards
+// it (VertexFormat::PlanetPatch) while the patch is close to the split distance, so levels fade in
+// instead of popping. Skirts around each patch hide the cracks between neighbours of different
+// levels. Patches live in a fixed pool of vertex buffer slots; the least recently drawn one is
+// reused when a new patch is needed.
+//
+// With an elevation pyramid every drawn patch asks for the height tiles matching its level,
+// nearest first, and is built again once they have all arrived. Until then it is displaced by
+// the deepest coarser tiles in the cache. Tiles load on the cache's own thread, so the frame
+// never waits for the disk.
+class Planet : public Renderable
+{
+public:
+	static constexpr unsigned int PATCH_SEGMENTS = 32;
+
+	Planet(const char* p_texturePath, const PlanetOptions& p_options = PlanetOptions());
+	~Planet();
+
+	Planet(const Planet&) = delete;
+	Planet& operator=(const Planet&) = delete;
+
+	void Render(Shader& shader) override;
+
+	// Refinement needs the camera, its projection and the viewport height in pixels; without a
+	// camera only the 24 roots are drawn
+	void SetCamera(const Camera* p_camera, const glm::mat4& p_projection, float p_viewportHeight);
+	// Object to world transformation, the planet is a unit sphere around the origin
+	void SetModelMatrix(const glm::mat4& p_model);
+
+	// Numbers of the last Render call
+	unsigned int RenderedTriangles() const { return m_renderedTriangles; }
+	unsigned int DrawnPatches() const { return static_cast<unsigned int>(m_drawList.size()); }
+	unsigned int DeepestLevel() const { return m_deepestLevel; }
+	size_t ResidentPatches() const { return m_slotOf.size(); }
+	size_t PoolBytes() const;
+	// null without an elevation pyramid
+	const ElevationCache* Elevation() const { return m_elevation.get(); }
+
+private:
+	// Quadtree node: cube face, level and position within the 2^level x 2^level grid of the face
+	struct PatchId
+	{
+		unsigned int face;
+		unsigned int level;
+		uint32_t x;
+		uint32_t y;
+
+		uint64_t Key() const;
+		PatchId Child(unsigned int p_index) const;
+	};
+
+	// Pool slot; the vertices are relative to center so they keep their precision deep down
+	struct Slot
+	{
+		uint64_t key = 0;
+		bool used = false;
+		unsigned int level = 0;
+		unsigned int lastFrame = 0;
+		glm::dvec3 center = glm::dvec3(0.0);
+		// largest distance between a vertex and the parent surface
+		float roughness = 0.0f;
+		// texture space rectangle (u min, v min, u max, v max); u may run past 1 across the seam
+		glm::vec4 uvRect = glm::vec4(0.0f);
+		// built with all the height tiles of its level
+		bool elevationComplete = true;
+	};
+
+	struct Draw
+	{
+		unsigned int slot;
+		float morph;
+	};
+
+	// patch missing for a split, built in order of the screen error of its parent, or a drawn
+	// patch rebuilt into its own slot once its height tiles are in
+	struct Request
+	{
+		PatchId id;
+		float priority;
+		unsigned int slot;
+	};
+
+	glm::dvec3 _pointOnFace(const PatchId& p_id, double p_i, double p_j) const;
+	// Bounding sphere of a patch that does not have to be built
+	void _bounds(const PatchId& p_id, glm::dvec3& p_center, double& p_radius) const;
+	bool _isVisible(const glm::dvec3& p_center, double p_radius) const;
+	void _visit(const PatchId& p_id, float p_parentScreenError);
+	void _draw(unsigned int p_slot, float p_morph);
+
+	// Fills PATCH_VERTICES vertices of FLOATS_PER_VERTEX floats and the patch fields of p_slot
+	void _buildPatch(const PatchId& p_id, float* p_vertices, Slot& p_slot) const;
+	// Builds the requested patches of this frame and uploads them into free or stale slots
+	void _buildRequested();
+	unsigned int _takeSlot();
+
+	// Pyramid level with samples about as dense as the vertices of a patch of p_level
+	unsigned int _elevationLevel(unsigned int p_level) const;
+	// Height tiles a patch of p_level covering p_uvRect is displaced with
+	void _elevationTiles(unsigned int p_level, const glm::vec4& p_uvRect, std::vector<uint64_t>& p_keys) const;
+	void _requestElevation(const PatchId& p_id, unsigned int p_slot, float p_distance, float p_screenError);
+
+	void _createIndexBuffer();
+
+	PlanetOptions m_options;
+	// object space error of a patch per level
+	std::vector<double> m_levelError;
+
+	unsigned int m_VAO = 0, m_VBO = 0, m_EBO = 0;
+	// shared with the other users of the same image, see ResourceManager
+	std::shared_ptr<const SharedTexture> m_texture;
+	unsigned int m_noOfIndices = 0;
+
+	std::vector<Slot> m_slots;
+	std::unordered_map<uint64_t, unsigned int> m_slotOf;
+	unsigned int m_frame = 0;
+
+	// filled by _visit, consumed in the same frame
+	std::vector<Draw> m_drawList;
+	std::vector<Request> m_requests;
+	std::vector<float> m_staging;
+	std::vector<ElevationTileRequest> m_tileRequests;
+
+	std::unique_ptr<ElevationCache> m_elevation;
+	// object space units per meter of height
+	double m_heightScale = 0.0;
+	// largest displacement above and below the unit sphere
+	double m_maxRaise = 0.0;
+	double m_maxSink = 0.0;
+
+	const Camera* m_camera = nullptr;
+	glm::mat4 m_projection = glm::mat4(1.0f);
+	float m_viewportHeight = 0.0f;
+	glm::mat4 m_model = glm::mat4(1.0f);
+
+	// camera and frustum in object space for the current frame
+	glm::dvec3 m_cameraPosition = glm::dvec3(0.0);
+	glm::vec4 m_planes[6];
+	// pixels per object space unit at distance 1
+	float m_screenScale = 0.0f;
+
+	unsigned int m_renderedTriangles = 0;
+	unsigned int m_deepestLevel = 0;
+};
\ No newline at end of file
@@ -4,5 +4,6 @@
 class Renderable
 {
 public:
+	virtual ~Renderable() = default;
 	virtual void Render(Shader& shader) = 0;
 };
\ No newline at end of file
@@ -0,0 +1,334 @@
+#include "ResidencyManager.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Mesh.h"
+#include "ResourceManager.h"
+#include "TextureLoader.h"
+
+namespace
+{
+	// Bytes of the chain starting at p_level, scaled from what is uploaded now
+	size_t _bytesAt(const TextureInfo& p_info, int p_level)
+	{
+		return static_cast<size_t>(static_cast<double>(p_info.bytes) * std::ldexp(1.0, 2 * (p_info.firstLevel - p_level)));
+	}
+
+	int _fallbackLevel(const TextureInfo& p_info)
+	{
+		int level = 0;
+		while (level < p_info.levels - 1 && (std::max(p_info.width, p_info.height) >> level) > ResidencyManager::FALLBACK_SIZE)
+		{
+			++level;
+		}
+		return level;
+	}
+}
+
+ResidencyManager& ResidencyManager::Shared()
+{
+	static ResidencyManager manager;
+	return manager;
+}
+
+void ResidencyManager::AddTexture(SharedTexture* p_texture)
+{
+	m_textures[p_texture].texture = p_texture;
+}
+
+void ResidencyManager::RemoveTexture(SharedTexture* p_texture)
+{
+	const auto found = m_textures.find(p_texture);
+	if (found == m_textures.end())
+	{
+		return;
+	}
+	TextureLoader::Shared().Delete(found->second.pending);
+	m_textures.erase(found);
+}
+
+void ResidencyManager::AddMesh(MeshGrid* p_mesh)
+{
+	m_meshes[p_mesh].mesh = p_mesh;
+}
+
+void ResidencyManager::RemoveMesh(MeshGrid* p_mesh)
+{
+	m_meshes.erase(p_mesh);
+}
+
+void ResidencyManager::Clear()
+{
+	for (auto& [key, entry] : m_textures)
+	{
+		TextureLoader::Shared().Delete(entry.pending);
+	}
+	m_textures.clear();
+	m_meshes.clear();
+	m_tracked.clear();
+}
+
+void ResidencyManager::Track(const void* p_owner, size_t p_bytes)
+{
+	m_tracked[p_owner] = p_bytes;
+}
+
+void ResidencyManager::Untrack(const void* p_owner)
+{
+	m_tracked.erase(p_owner);
+}
+
+void ResidencyManager::TextureDrawn(const SharedTexture* p_texture, float p_diameter)
+{
+	const auto found = m_textures.find(p_texture);
+	if (found == m_textures.end())
+	{
+		return;
+	}
+	TextureEntry& entry = found->second;
+	entry.diameter = entry.lastFrame == m_frame ? std::max(entry.diameter, p_diameter) : p_diameter;
+	entry.lastFrame = m_frame;
+}
+
+void ResidencyManager::MeshDrawn(const MeshGrid* p_mesh)
+{
+	const auto found = m_meshes.find(p_mesh);
+	if (found != m_meshes.end())
+	{
+		found->second.lastFrame = m_frame;
+	}
+}
+
+int ResidencyManager::_wantedLevel(const TextureEntry& p_entry) const
+{
+	const TextureInfo& info = *TextureLoader::Shared().Info(p_entry.texture->texture);
+	if (!std::isfinite(p_entry.diameter))
+	{
+		return 0;
+	}
+
+	// half of the texture faces the camera, spread over the diameter; of a cube map that is two faces
+	const float facing = info.faces > 1 ? 2.0f * info.width : 0.5f * std::max(info.width, info.height);
+	const float texelsPerPixel = facing / std::max(p_entry.diameter, 1.0f);
+	const int level = texelsPerPixel > 1.0f ? static_cast<int>(std::floor(std::log2(texelsPerPixel))) : 0;
+	return std::min(level, _fallbackLevel(info));
+}
+
+void ResidencyManager::_finishReloads()
+{
+	TextureLoader& loader = TextureLoader::Shared();
+	for (auto& [key, entry] : m_textures)
+	{
+		if (!entry.pending || loader.IsLoading(entry.pending))
+		{
+			continue;
+		}
+
+		// the handle keeps its object, only the name inside changes
+		const TextureInfo* info = loader.Info(entry.pending);
+		if (info && info->levels > 0)
+		{
+			loader.Delete(entry.texture->texture);
+			entry.texture->texture = entry.pending;
+			++m_reloads;
+		}
+		else
+		{
+			// the image is gone, keep what is there
+			loader.Delete(entry.pending);
+			entry.failed = true;
+		}
+		entry.pending = 0;
+	}
+}
+
+void ResidencyManager::Update()
+{
+	_finishReloads();
+
+	// the level the screen size asks for; textures out of view keep theirs
+	TextureLoader& loader = TextureLoader::Shared();
+	std::vector<TextureEntry*> textures;
+	size_t textureBytes = 0;
+	for (auto& [key, entry] : m_textures)
+	{
+		const TextureInfo* info = loader.Info(entry.texture->texture);
+		if (!info || info->levels == 0 || entry.failed)
+		{
+			textureBytes += info ? info->bytes : 0;
+			continue;
+		}
+		if (entry.pending)
+		{
+			// counts at the level it is reloading to and can change again once that is in
+			textureBytes += _bytesAt(*info, entry.target);
+			continue;
+		}
+		entry.target = entry.lastFrame == m_frame ? _wantedLevel(entry) : info->firstLevel;
+		textureBytes += _bytesAt(*info, entry.target);
+		textures.push_back(&entry);
+	}
+
+	size_t bytes = textureBytes + MeshBytes() + TrackedBytes();
+	const bool overBudget = m_budget && bytes > m_budget;
+	if (overBudget)
+	{
+		// what was not drawn this frame, least recently drawn first
+		struct Candidate
+		{
+			unsigned int lastFrame;
+			TextureEntry* texture;
+			MeshGrid* mesh;
+		};
+		std::vector<Candidate> candidates;
+		for (TextureEntry* entry : textures)
+		{
+			if (entry->lastFrame != m_frame)
+			{
+				candidates.push_back(Candidate{ entry->lastFrame, entry, nullptr });
+			}
+		}
+		for (auto& [key, entry] : m_meshes)
+		{
+			if (entry.lastFrame != m_frame && !entry.mesh->IsEvicted())
+			{
+				candidates.push_back(Candidate{ entry.lastFrame, nullptr, entry.mesh });
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const Candidate& p_a, const Candidate& p_b) { return p_a.lastFrame < p_b.lastFrame; });
+
+		for (const Candidate& candidate : candidates)
+		{
+			if (bytes <= m_budget)
+			{
+				break;
+			}
+			if (candidate.texture)
+			{
+				const TextureInfo& info = *loader.Info(candidate.texture->texture->texture);
+				const int fallback = _fallbackLevel(info);
+				if (candidate.texture->target < fallback)
+				{
+					bytes -= _bytesAt(info, candidate.texture->target) - _bytesAt(info, fallback);
+					candidate.texture->target = fallback;
+					++m_evictions;
+				}
+			}
+			else
+			{
+				const size_t before = candidate.mesh->GpuBytes();
+				if (candidate.mesh->Evict())
+				{
+					bytes -= std::min(bytes, before - std::min(before, candidate.mesh->GpuBytes()));
+					++m_evictions;
+				}
+			}
+		}
+
+		// then the largest textures in view give up a level each until it fits
+		while (bytes > m_budget)
+		{
+			TextureEntry* largest = nullptr;
+			size_t largestBytes = 0;
+			for (TextureEntry* entry : textures)
+			{
+				const TextureInfo& info = *loader.Info(entry->texture->texture);
+				if (entry->target < _fallbackLevel(info) && _bytesAt(info, entry->target) > largestBytes)
+				{
+					largest = entry;
+					largestBytes = _bytesAt(info, entry->target);
+				}
+			}
+			if (!largest)
+			{
+				break;
+			}
+			bytes -= largestBytes - _bytesAt(*loader.Info(largest->texture->texture), largest->target + 1);
+			++largest->target;
+		}
+	}
+
+	_startReloads(overBudget);
+	++m_frame;
+}
+
+void ResidencyManager::_startReloads(bool p_overBudget)
+{
+	// coarser levels free memory and go first, then the finer ones that gain the most
+	TextureLoader& loader = TextureLoader::Shared();
+	std::vector<std::pair<int, TextureEntry*>> reloads;
+	for (auto& [key, entry] : m_textures)
+	{
+		const TextureInfo* info = loader.Info(entry.texture->texture);
+		if (entry.pending || entry.failed || !info || info->levels == 0)
+		{
+			continue;
+		}
+
+		const int change = entry.target - info->firstLevel;
+		if (change <= 0)
+		{
+			entry.coarserSince = 0;
+		}
+		else if (!entry.coarserSince)
+		{
+			entry.coarserSince = m_frame;
+		}
+
+		// a texture that only got smaller on screen waits, in case it grows again
+		if (change < 0 || (change > 0 && (p_overBudget || m_frame - entry.coarserSince >= STREAM_OUT_FRAMES)))
+		{
+			reloads.push_back({ change, &entry });
+		}
+	}
+	std::sort(reloads.begin(), reloads.end(), [](const auto& p_a, const auto& p_b)
+	{
+		return (p_a.first > 0) != (p_b.first > 0) ? p_a.first > 0 : p_a.first < p_b.first;
+	});
+
+	for (size_t i = 0; i < reloads.size() && i < m_reloadsPerFrame; ++i)
+	{
+		TextureEntry& entry = *reloads[i].second;
+		entry.pending = loader.Reload(entry.texture->texture, entry.target);
+	}
+}
+
+size_t ResidencyManager::TextureBytes() const
+{
+	size_t bytes = 0;
+	for (const auto& [key, entry] : m_textures)
+	{
+		for (unsigned int texture : { entry.texture->texture, entry.pending })
+		{
+			const TextureInfo* info = TextureLoader::Shared().Info(texture);
+			bytes += info ? info->bytes : 0;
+		}
+	}
+	return bytes;
+}
+
+size_t ResidencyManager::MeshBytes() const
+{
+	size_t bytes = 0;
+	for (const auto& [key, entry] : m_meshes)
+	{
+		bytes += entry.mesh->GpuBytes();
+	}
+	return bytes;
+}
+
+size_t ResidencyManager::TrackedBytes() const
+{
+	size_t bytes = 0;
+	for (const auto& [owner, tracked] : m_tracked)
+	{
+		bytes += tracked;
+	}
+	return bytes;
+}
+
+size_t ResidencyManager::Bytes() const
+{
+	return TextureBytes() + MeshBytes() + TrackedBytes();
+}
\ No newline at end of file
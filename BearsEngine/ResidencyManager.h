@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+class MeshGrid;
+struct SharedTexture;
+
+// Keeps the GPU memory of the engine under a budget. Textures of ResourceManager and meshes
+// register themselves; fixed pools (planet patches, the virtual texture cache) are tracked so
+// they count against the budget, but never evicted.
+//
+// Textures follow their size on screen: level 0 of a texture drawn at a given pixel diameter
+// is the level of the chain with about one texel per pixel across the visible half of the
+// object (it is assumed to wrap around it once, as on the spheres). Finer levels stream in
+// right away, coarser ones only after STREAM_OUT_FRAMES, both by TextureLoader::Reload into
+// a new texture that replaces the old one in its handle once it is complete.
+//
+// Over budget, what was drawn least recently goes first: textures drop to a fallback of at
+// most FALLBACK_SIZE texels a side and meshes to their coarse placeholder until they are
+// drawn again. If that is not enough, the largest textures in view lose levels.
+// All calls belong to the GL thread.
+class ResidencyManager
+{
+public:
+	// frames a texture has to be wanted at a coarser level before it is reloaded at it
+	static constexpr unsigned int STREAM_OUT_FRAMES = 120;
+	static constexpr int FALLBACK_SIZE = 64;
+
+	static ResidencyManager& Shared();
+
+	// 0 means no limit
+	void SetBudget(size_t p_bytes) { m_budget = p_bytes; }
+	size_t Budget() const { return m_budget; }
+	// Texture reloads started per Update; their uploads are spread by TextureLoader::Update
+	void SetReloadsPerFrame(unsigned int p_reloads) { m_reloadsPerFrame = p_reloads; }
+
+	void AddTexture(SharedTexture* p_texture);
+	void RemoveTexture(SharedTexture* p_texture);
+	void AddMesh(MeshGrid* p_mesh);
+	void RemoveMesh(MeshGrid* p_mesh);
+	// Forgets every texture, mesh and tracked owner and deletes the reloads in flight, at shutdown
+	void Clear();
+	// Memory outside of textures and meshes, counted until Untrack
+	void Track(const void* p_owner, size_t p_bytes);
+	void Untrack(const void* p_owner);
+
+	// Reported while drawing: the texture covers p_diameter pixels, infinite when the camera
+	// is unknown or inside the object
+	void TextureDrawn(const SharedTexture* p_texture, float p_diameter);
+	void MeshDrawn(const MeshGrid* p_mesh);
+
+	// Once per frame after drawing: swaps in finished reloads, evicts and starts reloads
+	void Update();
+
+	size_t Bytes() const;
+	size_t TextureBytes() const;
+	size_t MeshBytes() const;
+	size_t TrackedBytes() const;
+	size_t Evictions() const { return m_evictions; }
+	size_t Reloads() const { return m_reloads; }
+
+private:
+	struct TextureEntry
+	{
+		SharedTexture* texture = nullptr;
+		unsigned int lastFrame = 0;
+		// largest diameter it was drawn at in the frame of lastFrame
+		float diameter = 0.0f;
+		// level to stream to, and since when it is coarser than the current one
+		int target = 0;
+		unsigned int coarserSince = 0;
+		// reload in flight
+		unsigned int pending = 0;
+		bool failed = false;
+	};
+
+	struct MeshEntry
+	{
+		MeshGrid* mesh = nullptr;
+		unsigned int lastFrame = 0;
+	};
+
+	ResidencyManager() = default;
+
+	// Level the texture needs for its last diameter, at most its fallback level
+	int _wantedLevel(const TextureEntry& p_entry) const;
+	void _finishReloads();
+	void _startReloads(bool p_overBudget);
+
+	size_t m_budget = 0;
+	unsigned int m_reloadsPerFrame = 1;
+	unsigned int m_frame = 1;
+	size_t m_evictions = 0;
+	size_t m_reloads = 0;
+
+	std::unordered_map<const SharedTexture*, TextureEntry> m_textures;
+	std::unordered_map<const MeshGrid*, MeshEntry> m_meshes;
+	std::unordered_map<const void*, size_t> m_tracked;
+};
\ No newline at end of file
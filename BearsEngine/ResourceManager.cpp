@@ -0,0 +1,149 @@
+#include "ResourceManager.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+#include "ResidencyManager.h"
+#include "TextureLoader.h"
+
+namespace
+{
+	// Same file, same key: absolute, dot segments and links resolved, and on Windows
+	// separators and case folded
+	std::string _canonical(const char* p_path)
+	{
+		std::error_code error;
+		std::filesystem::path path = std::filesystem::weakly_canonical(p_path, error);
+		if (error)
+		{
+			path = std::filesystem::absolute(p_path, error).lexically_normal();
+		}
+		std::string key = path.generic_string();
+#ifdef _WIN32
+		std::transform(key.begin(), key.end(), key.begin(), [](unsigned char p_c) { return static_cast<char>(std::tolower(p_c)); });
+#endif
+		return key;
+	}
+
+	std::string _textureKey(const char* p_path, bool p_cube)
+	{
+		const TextureLoader& loader = TextureLoader::Shared();
+		const MipOptions& mips = loader.GetMipOptions();
+		std::string key = _canonical(p_path);
+		key += loader.Compression() ? std::string(" ") + BlockCompressor::Name(loader.PreferredFormat()) : std::string(" rgb");
+		key += " mips " + std::to_string(static_cast<int>(mips.filter)) + (mips.srgb ? "s" : "") + (mips.wrapX ? "x" : "") + (mips.wrapY ? "y" : "");
+		if (p_cube)
+		{
+			key += " cube";
+		}
+		return key;
+	}
+
+	std::string _meshKey(const char* p_meshPath, const char* p_texturePath, const MeshOptions& p_options)
+	{
+		// meshes drawn with packed textures only have no texture path
+		std::string key = _canonical(p_meshPath) + " " + (p_texturePath ? _canonical(p_texturePath) : std::string("-"));
+		key += " " + std::to_string(p_options.weldVertices) + std::to_string(p_options.optimizeMesh) + std::to_string(p_options.compactVertices) +
+			std::to_string(p_options.generateLods) + std::to_string(p_options.buildMeshlets) + std::to_string(p_options.compressCache) +
+			std::to_string(p_options.loadAsync) + std::to_string(p_options.proceduralSphere) + std::to_string(p_options.cubeMapTexture) +
+			std::to_string(p_options.optimizeOverdraw);
+		key += " " + std::to_string(p_options.weldEpsilon) + " " + std::to_string(p_options.lodPixelError) + " " + std::to_string(p_options.importMemoryBudget);
+		return key;
+	}
+}
+
+ResourceManager& ResourceManager::Shared()
+{
+	static ResourceManager manager;
+	return manager;
+}
+
+TextureHandle ResourceManager::Texture(const char* p_path, bool p_cube)
+{
+	const std::string key = _textureKey(p_path, p_cube);
+	if (TextureHandle texture = m_textures[key].lock())
+	{
+		return texture;
+	}
+
+	std::shared_ptr<SharedTexture> texture(new SharedTexture{ p_cube ? TextureLoader::Shared().LoadCube(p_path) : TextureLoader::Shared().Load(p_path) }, [this, key](SharedTexture* p_texture)
+	{
+		ResidencyManager::Shared().RemoveTexture(p_texture);
+		TextureLoader::Shared().Delete(p_texture->texture);
+		delete p_texture;
+		m_textures.erase(key);
+	});
+	// the residency manager may swap the name for one with more or fewer levels
+	ResidencyManager::Shared().AddTexture(texture.get());
+	m_textures[key] = texture;
+	return texture;
+}
+
+MeshHandle ResourceManager::Mesh(const char* p_meshPath, const char* p_texturePath, const MeshOptions& p_options)
+{
+	const std::string key = _meshKey(p_meshPath, p_texturePath, p_options);
+	if (MeshHandle mesh = m_meshes[key].lock())
+	{
+		return mesh;
+	}
+
+	MeshHandle mesh(new MeshGrid(p_meshPath, p_texturePath, p_options), [this, key](MeshGrid* p_mesh)
+	{
+		delete p_mesh;
+		m_meshes.erase(key);
+	});
+	m_meshes[key] = mesh;
+	return mesh;
+}
+
+ShaderHandle ResourceManager::Program(const char* p_vertexPath, const char* p_fragmentPath)
+{
+	const std::string key = _canonical(p_vertexPath) + " " + _canonical(p_fragmentPath);
+	if (ShaderHandle program = m_programs[key].lock())
+	{
+		return program;
+	}
+
+	ShaderHandle program(new Shader(p_vertexPath, p_fragmentPath), [this, key](Shader* p_program)
+	{
+		delete p_program;
+		m_programs.erase(key);
+	});
+	m_programs[key] = program;
+	return program;
+}
+
+std::vector<ResourceInfo> ResourceManager::Resources() const
+{
+	// an entry lives exactly as long as its last handle, so every weak pointer here is valid
+	std::vector<ResourceInfo> resources;
+	for (const auto& [key, texture] : m_textures)
+	{
+		const unsigned int name = texture.lock()->texture;
+		const TextureInfo* info = TextureLoader::Shared().Info(name);
+		resources.push_back(ResourceInfo{ "texture", key, texture.use_count(), !TextureLoader::Shared().IsLoading(name), info ? info->bytes : 0 });
+	}
+	for (const auto& [key, mesh] : m_meshes)
+	{
+		const MeshHandle locked = mesh.lock();
+		resources.push_back(ResourceInfo{ "mesh", key, mesh.use_count() - 1, locked->IsLoaded() && !locked->IsEvicted(), locked->GpuBytes() });
+	}
+	for (const auto& [key, program] : m_programs)
+	{
+		resources.push_back(ResourceInfo{ "program", key, program.use_count(), true, 0 });
+	}
+
+	std::sort(resources.begin(), resources.end(), [](const ResourceInfo& p_a, const ResourceInfo& p_b) { return p_a.key < p_b.key; });
+	return resources;
+}
+
+size_t ResourceManager::Bytes() const
+{
+	size_t bytes = 0;
+	for (const ResourceInfo& resource : Resources())
+	{
+		bytes += resource.bytes;
+	}
+	return bytes;
+}
\ No newline at end of file
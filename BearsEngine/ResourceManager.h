@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Mesh.h"
+#include "Shader.h"
+
+// Texture of a TextureLoader load; a GL name stays valid while a handle to it exists, but
+// ResidencyManager may replace it, so it is read again every time it is bound
+struct SharedTexture
+{
+	unsigned int texture = 0;
+};
+
+using TextureHandle = std::shared_ptr<const SharedTexture>;
+using MeshHandle = std::shared_ptr<MeshGrid>;
+using ShaderHandle = std::shared_ptr<Shader>;
+
+// One loaded resource, as listed by ResourceManager::Resources
+struct ResourceInfo
+{
+	const char* type;
+	std::string key;
+	long handles;
+	// false while the texture or mesh is still streaming in
+	bool resident;
+	// GPU memory, 0 where it is not known (shader programs)
+	size_t bytes;
+};
+
+// Hands out refcounted handles to textures, meshes and shader programs. Each one is loaded
+// once per canonical path and load options, later requests get the same object, and the last
+// handle to go deletes it together with its GL objects.
+//
+// A mesh handle is the MeshGrid itself, so the model matrix and camera are whatever its user
+// set last; users that share one set them before every Render, as main.cpp does anyway.
+// All calls belong to the GL thread.
+class ResourceManager
+{
+public:
+	static ResourceManager& Shared();
+
+	// Texture streamed in through TextureLoader with its current compression and mip options,
+	// reprojected to a cube map with p_cube (TextureLoader::LoadCube)
+	TextureHandle Texture(const char* p_path, bool p_cube = false);
+	// .obj or .ply mesh, see MeshImporter
+	MeshHandle Mesh(const char* p_meshPath, const char* p_texturePath, const MeshOptions& p_options = MeshOptions());
+	ShaderHandle Program(const char* p_vertexPath, const char* p_fragmentPath);
+
+	std::vector<ResourceInfo> Resources() const;
+	size_t Bytes() const;
+
+private:
+	ResourceManager() = default;
+
+	std::unordered_map<std::string, std::weak_ptr<SharedTexture>> m_textures;
+	std::unordered_map<std::string, std::weak_ptr<MeshGrid>> m_meshes;
+	std::unordered_map<std::string, std::weak_ptr<Shader>> m_programs;
+};
\ No newline at end of file
@@ -9,12 +9,20 @@
 #include "Shader.h"
 
 Shader::Shader(const char* p_vertexPath, const char* p_fragmentPath)
+	: m_vertexPath(p_vertexPath), m_fragmentPath(p_fragmentPath)
 {
 	m_shaderProgramID = glCreateProgram();
 	//_loadShader2(p_vertexPath, p_fragmentPath);
 
 	_loadShader(p_vertexPath, GL_VERTEX_SHADER);
 	_loadShader(p_fragmentPath, GL_FRAGMENT_SHADER);
+	// only once it is linked, MeshGrid also creates programs in the middle of a frame
+	Use();
+}
+
+Shader::~Shader()
+{
+	glDeleteProgram(m_shaderProgramID);
 }
 
 void Shader::Use()
@@ -22,11 +30,60 @@ void Shader::Use()
 	glUseProgram(m_shaderProgramID);
 }
 
-// _loadShader() function should only be called after "m_shaderProgramID = glCreateProgram();"
-void Shader::_loadShader(const char* p_path, unsigned int p_shaderClass)
+void Shader::CopyUniforms(const Shader& p_source)
 {
 	Use();
 
+	int noOfUniforms = 0;
+	glGetProgramiv(p_source.m_shaderProgramID, GL_ACTIVE_UNIFORMS, &noOfUniforms);
+	for (int uniform = 0; uniform < noOfUniforms; ++uniform)
+	{
+		char name[256];
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(p_source.m_shaderProgramID, uniform, sizeof(name), &length, &size, &type, name);
+
+		// arrays are listed as their first element, the others are looked up one by one
+		std::string base(name, length);
+		if (size > 1 && base.size() > 3 && base.compare(base.size() - 3, 3, "[0]") == 0)
+		{
+			base.resize(base.size() - 3);
+		}
+		for (int element = 0; element < size; ++element)
+		{
+			const std::string elementName = size > 1 ? base + "[" + std::to_string(element) + "]" : base;
+			const int from = glGetUniformLocation(p_source.m_shaderProgramID, elementName.c_str());
+			const int to = glGetUniformLocation(m_shaderProgramID, elementName.c_str());
+			if (from < 0 || to < 0)
+			{
+				continue;
+			}
+
+			float floats[16];
+			int ints[4];
+			switch (type)
+			{
+			case GL_FLOAT: glGetUniformfv(p_source.m_shaderProgramID, from, floats); glUniform1fv(to, 1, floats); break;
+			case GL_FLOAT_VEC2: glGetUniformfv(p_source.m_shaderProgramID, from, floats); glUniform2fv(to, 1, floats); break;
+			case GL_FLOAT_VEC3: glGetUniformfv(p_source.m_shaderProgramID, from, floats); glUniform3fv(to, 1, floats); break;
+			case GL_FLOAT_VEC4: glGetUniformfv(p_source.m_shaderProgramID, from, floats); glUniform4fv(to, 1, floats); break;
+			case GL_FLOAT_MAT2: glGetUniformfv(p_source.m_shaderProgramID, from, floats); glUniformMatrix2fv(to, 1, GL_FALSE, floats); break;
+			case GL_FLOAT_MAT3: glGetUniformfv(p_source.m_shaderProgramID, from, floats); glUniformMatrix3fv(to, 1, GL_FALSE, floats); break;
+			case GL_FLOAT_MAT4: glGetUniformfv(p_source.m_shaderProgramID, from, floats); glUniformMatrix4fv(to, 1, GL_FALSE, floats); break;
+			case GL_INT_VEC2: case GL_BOOL_VEC2: glGetUniformiv(p_source.m_shaderProgramID, from, ints); glUniform2iv(to, 1, ints); break;
+			case GL_INT_VEC3: case GL_BOOL_VEC3: glGetUniformiv(p_source.m_shaderProgramID, from, ints); glUniform3iv(to, 1, ints); break;
+			case GL_INT_VEC4: case GL_BOOL_VEC4: glGetUniformiv(p_source.m_shaderProgramID, from, ints); glUniform4iv(to, 1, ints); break;
+			// int, bool and the texture units of samplers
+			default: glGetUniformiv(p_source.m_shaderProgramID, from, ints); glUniform1iv(to, 1, ints); break;
+			}
+		}
+	}
+}
+
+// _loadShader() function should only be called after "m_shaderProgramID = glCreateProgram();"
+void Shader::_loadShader(const char* p_path, unsigned int p_shaderClass)
+{
 	std::string shaderText;
 	std::ifstream shaderFile;
 
@@ -8,8 +8,18 @@ public:
 	unsigned int m_shaderProgramID;
 	
 	Shader(const char* p_vertexPath, const char* p_fragmentPath);
+	~Shader();
+	// owns the program, see ResourceManager::Program for sharing one
+	Shader(const Shader&) = delete;
+	Shader& operator=(const Shader&) = delete;
 	void Use();
 
+	const std::string& VertexPath() const { return m_vertexPath; }
+	const std::string& FragmentPath() const { return m_fragmentPath; }
+	// Sets the uniforms this program shares with p_source to their values there, for a variant
+	// linked with another vertex shader that has to draw like p_source (leaves this program in use)
+	void CopyUniforms(const Shader& p_source);
+
     // utility uniform functions
     // ------------------------------------------------------------------------
     void SetBool(const std::string& name, bool value) const;
@@ -34,6 +44,9 @@ public:
     void SetMat4(const std::string& name, const glm::mat4& mat) const;
 
 private:
+	std::string m_vertexPath;
+	std::string m_fragmentPath;
+
 	// _loadShader() function should only be called after "m_shaderProgramID = glCreateProgram();"
 	void _loadShader(const char* p_path, unsigned int p_shaderClass);
 	void _checkCompileErrors(unsigned int p_shader, bool p_errorType);
@@ -2,21 +2,87 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in vec3 aMorphPos;
+layout (location = 4) in vec3 aMorphNormal;
+// per instance with uInstanced, see MeshInstance
+layout (location = 5) in mat4 aInstanceModel;
+layout (location = 9) in vec4 aInstanceTextureRect;
+layout (location = 10) in float aInstanceTextureLayer;
+layout (location = 11) in mat3 aInstanceNormalMatrix;
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoord;
+// packed texture for sphere_packed.fs, see PackedTexture
+out vec4 TextureRect;
+flat out float TextureLayer;
+// object space position, the direction sphere_cube.fs looks its cube map up in
+out vec3 ObjectPos;
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 uniform mat3 t_i_model;
 
+// 0: float vertices, 1: quantized with octahedral normals, 2: quantized, normal == position,
+// 4: planet patch, blended by uMorph towards its position on the parent patch
+// (3, procedural spheres, are drawn with sphere_procedural.vs instead)
+uniform int uVertexFormat;
+uniform vec3 uPositionMin;
+uniform vec3 uPositionExtent;
+uniform float uMorph;
+
+// MeshGrid::RenderInstances: model matrix and packed texture come from the instance attributes,
+// otherwise from the uniforms
+uniform bool uInstanced;
+uniform vec4 uTextureRect;
+uniform float uTextureLayer;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+    {
+        vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(n.yx)) * signs;
+    }
+    return normalize(n);
+}
+
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = t_i_model * aNormal;
-    TexCoord = aTexCoord;
+    vec3 position = aPos;
+    vec3 normal = aNormal;
+    vec2 texCoord = aTexCoord;
+
+    if (uVertexFormat == 4)
+    {
+        position = mix(aPos, aMorphPos, uMorph);
+        normal = mix(aNormal, aMorphNormal, uMorph);
+    }
+    else if (uVertexFormat != 0)
+    {
+        // dequantize unorm16 positions relative to the mesh bounds
+        position = uPositionMin + aPos * uPositionExtent;
+        normal = uVertexFormat == 1 ? octDecode(clamp(aNormal.xy, -1.0, 1.0)) : position;
+    }
+
+    mat4 modelMatrix = model;
+    mat3 normalMatrix = t_i_model;
+    TextureRect = uTextureRect;
+    TextureLayer = uTextureLayer;
+    if (uInstanced)
+    {
+        modelMatrix = aInstanceModel;
+        normalMatrix = aInstanceNormalMatrix;
+        TextureRect = aInstanceTextureRect;
+        TextureLayer = aInstanceTextureLayer;
+    }
+
+    FragPos = vec3(modelMatrix * vec4(position, 1.0));
+    Normal = normalMatrix * normal;
+    TexCoord = texCoord;
+    ObjectPos = position;
     
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
\ No newline at end of file
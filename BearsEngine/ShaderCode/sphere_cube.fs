@@ -0,0 +1,41 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+
+in vec2 TexCoord;
+in vec3 ObjectPos;
+
+
+uniform vec3 lightPos; 
+uniform vec3 viewPos; 
+uniform vec3 lightColor;
+// equirectangular texture reprojected to a cube map, see CubeMap
+uniform samplerCube ourCubeTexture;
+
+void main()
+{
+    // Texture: by direction from the center, so there is no seam and no pinching at the poles
+    vec4 textureColor = texture(ourCubeTexture, ObjectPos);
+
+    // ambient
+    float ambientStrength = 0.1;
+    vec3 ambient = ambientStrength * lightColor;
+  	
+    // diffuse 
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = normalize(lightPos - FragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diff * lightColor;
+    
+    // specular
+    float specularStrength = 0.5;
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 reflectDir = reflect(-lightDir, norm);  
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+    vec3 specular = specularStrength * spec * lightColor;  
+        
+    vec4 result = vec4(ambient + diffuse + specular, 1.0);
+    FragColor = result * textureColor;
+} 
\ No newline at end of file
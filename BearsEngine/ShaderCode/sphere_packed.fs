@@ -0,0 +1,44 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+
+in vec2 TexCoord;
+in vec4 TextureRect;
+flat in float TextureLayer;
+
+
+uniform vec3 lightPos; 
+uniform vec3 viewPos; 
+uniform vec3 lightColor;
+// packed textures, see TexturePacker
+uniform sampler2DArray ourTextures;
+
+void main()
+{
+    // Texture: uvs repeat inside the rect of the image, with the gradients of the unwrapped uvs
+    // so the mip level does not jump where they wrap
+    vec2 uv = TextureRect.xy + fract(TexCoord) * TextureRect.zw;
+    vec4 textureColor = textureGrad(ourTextures, vec3(uv, TextureLayer), dFdx(TexCoord) * TextureRect.zw, dFdy(TexCoord) * TextureRect.zw);
+
+    // ambient
+    float ambientStrength = 0.1;
+    vec3 ambient = ambientStrength * lightColor;
+  	
+    // diffuse 
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = normalize(lightPos - FragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diff * lightColor;
+    
+    // specular
+    float specularStrength = 0.5;
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 reflectDir = reflect(-lightDir, norm);  
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+    vec3 specular = specularStrength * spec * lightColor;  
+        
+    vec4 result = vec4(ambient + diffuse + specular, 1.0);
+    FragColor = result * textureColor;
+} 
\ No newline at end of file
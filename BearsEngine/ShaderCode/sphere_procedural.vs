@@ -0,0 +1,67 @@
+#version 330 core
+// MeshGrid draws VertexFormat::Procedural meshes with this in place of sphere.vs, linked with
+// the fragment shader of the program it was given: no vertex buffer, the unit sphere grid of
+// uNoOfXSeg x uNoOfYSeg cells comes from gl_VertexID, drawn with glDrawArrays
+
+// per instance with uInstanced, see MeshInstance
+layout (location = 5) in mat4 aInstanceModel;
+layout (location = 9) in vec4 aInstanceTextureRect;
+layout (location = 10) in float aInstanceTextureLayer;
+layout (location = 11) in mat3 aInstanceNormalMatrix;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoord;
+// packed texture for sphere_packed.fs, see PackedTexture
+out vec4 TextureRect;
+flat out float TextureLayer;
+// object space position, the direction sphere_cube.fs looks its cube map up in
+out vec3 ObjectPos;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform mat3 t_i_model;
+
+uniform int uNoOfXSeg;
+uniform int uNoOfYSeg;
+
+// MeshGrid::RenderInstances: model matrix and packed texture come from the instance attributes,
+// otherwise from the uniforms
+uniform bool uInstanced;
+uniform vec4 uTextureRect;
+uniform float uTextureLayer;
+
+const float PI = 3.14159265358979;
+
+// corners of the two triangles of a cell, in the order of ParametricSurface::GenerateIndices
+const ivec2 CELL_CORNERS[6] = ivec2[6](ivec2(0, 0), ivec2(1, 0), ivec2(0, 1), ivec2(1, 0), ivec2(1, 1), ivec2(0, 1));
+
+void main()
+{
+    // same vertices as ParametricSurface::Sphere, six per cell
+    int cell = gl_VertexID / 6;
+    ivec2 grid = ivec2(cell % uNoOfXSeg, cell / uNoOfXSeg) + CELL_CORNERS[gl_VertexID - cell * 6];
+    vec2 uv = vec2(grid) / vec2(uNoOfXSeg, uNoOfYSeg);
+    float sinV = sin(uv.y * PI);
+    vec3 position = vec3(sinV * cos(uv.x * 2.0 * PI), cos(uv.y * PI), sinV * sin(uv.x * 2.0 * PI));
+
+    mat4 modelMatrix = model;
+    mat3 normalMatrix = t_i_model;
+    TextureRect = uTextureRect;
+    TextureLayer = uTextureLayer;
+    if (uInstanced)
+    {
+        modelMatrix = aInstanceModel;
+        normalMatrix = aInstanceNormalMatrix;
+        TextureRect = aInstanceTextureRect;
+        TextureLayer = aInstanceTextureLayer;
+    }
+
+    FragPos = vec3(modelMatrix * vec4(position, 1.0));
+    Normal = normalMatrix * position;
+    TexCoord = vec2(1.0 - uv.x, uv.y);
+    ObjectPos = position;
+    
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file
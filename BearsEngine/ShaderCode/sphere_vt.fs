@@ -0,0 +1,84 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+
+in vec2 TexCoord;
+
+
+uniform vec3 lightPos; 
+uniform vec3 viewPos; 
+uniform vec3 lightColor;
+
+// virtual texture, see VirtualTexture::Bind
+uniform sampler2D uPhysical;
+uniform sampler2D uIndirection;
+uniform vec2 uPages;
+uniform float uPageSize;
+uniform float uBorder;
+uniform vec2 uPhysicalSize;
+uniform float uMaxLevel;
+uniform float uLodBias;
+
+// Pyramid level for the screen space footprint of uv, ignoring the jump across the longitude seam
+float pageLod(vec2 uv)
+{
+    vec2 texels = uv * uPages * uPageSize;
+    vec2 seamless = vec2(fract(uv.x + 0.5), uv.y) * uPages * uPageSize;
+    vec2 dx = dFdx(texels);
+    vec2 dy = dFdy(texels);
+    vec2 seamlessDx = dFdx(seamless);
+    vec2 seamlessDy = dFdy(seamless);
+    float rho = min(max(dot(dx, dx), dot(dy, dy)), max(dot(seamlessDx, seamlessDx), dot(seamlessDy, seamlessDy)));
+    return clamp(0.5 * log2(max(rho, 1e-8)) + uLodBias, 0.0, uMaxLevel);
+}
+
+// Bilinear sample of a level, from the page itself or its finest resident ancestor
+vec4 samplePage(vec2 uv, int level)
+{
+    ivec2 page = min(ivec2(uv * uPages), ivec2(uPages) - 1) >> level;
+    vec3 entry = floor(texelFetch(uIndirection, page, level).xyz * 255.0 + 0.5);
+    vec2 inPage = fract(uv * uPages / exp2(entry.z));
+    vec2 physical = entry.xy * (uPageSize + 2.0 * uBorder) + uBorder + inPage * uPageSize;
+    return textureLod(uPhysical, physical / uPhysicalSize, 0.0);
+}
+
+vec4 virtualTexture(vec2 texCoord)
+{
+    vec2 uv = vec2(fract(texCoord.x), clamp(texCoord.y, 0.0, 0.99999));
+    float lod = pageLod(uv);
+    int level = int(lod);
+    vec4 color = samplePage(uv, level);
+    if (float(level) < uMaxLevel)
+    {
+        color = mix(color, samplePage(uv, level + 1), fract(lod));
+    }
+    return color;
+}
+
+void main()
+{
+    // Texture
+    vec4 textureColor = virtualTexture(TexCoord);
+
+    // ambient
+    float ambientStrength = 0.1;
+    vec3 ambient = ambientStrength * lightColor;
+  	
+    // diffuse 
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = normalize(lightPos - FragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diff * lightColor;
+    
+    // specular
+    float specularStrength = 0.5;
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 reflectDir = reflect(-lightDir, norm);  
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+    vec3 specular = specularStrength * spec * lightColor;  
+        
+    vec4 result = vec4(ambient + diffuse + specular, 1.0);
+    FragColor = result * textureColor;
+}
\ No newline at end of file
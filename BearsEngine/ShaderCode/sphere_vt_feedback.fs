@@ -0,0 +1,32 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+// same uniforms as sphere_vt.fs, see VirtualTexture::Bind
+uniform vec2 uPages;
+uniform float uPageSize;
+uniform float uMaxLevel;
+uniform float uLodBias;
+
+float pageLod(vec2 uv)
+{
+    vec2 texels = uv * uPages * uPageSize;
+    vec2 seamless = vec2(fract(uv.x + 0.5), uv.y) * uPages * uPageSize;
+    vec2 dx = dFdx(texels);
+    vec2 dy = dFdy(texels);
+    vec2 seamlessDx = dFdx(seamless);
+    vec2 seamlessDy = dFdy(seamless);
+    float rho = min(max(dot(dx, dx), dot(dy, dy)), max(dot(seamlessDx, seamlessDx), dot(seamlessDy, seamlessDy)));
+    return clamp(0.5 * log2(max(rho, 1e-8)) + uLodBias, 0.0, uMaxLevel);
+}
+
+// The page the pixel samples: x and y in 12 bits each over red, green and blue, level + 1 in
+// alpha so that cleared pixels read as no page
+void main()
+{
+    vec2 uv = vec2(fract(TexCoord.x), clamp(TexCoord.y, 0.0, 0.99999));
+    int level = int(pageLod(uv));
+    ivec2 page = min(ivec2(uv * uPages), ivec2(uPages) - 1) >> level;
+    FragColor = vec4(page.x & 255, page.y & 255, (page.x >> 8) | ((page.y >> 8) << 4), level + 1) / 255.0;
+}
\ No newline at end of file
@@ -0,0 +1,453 @@
+#include "SphereMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+#include "glm/glm.hpp"
+
+#include "ParametricSurface.h"
+
+namespace
+{
+	constexpr unsigned int NONE = 0xFFFFFFFFu;
+	constexpr double PI = 3.14159265358979323846;
+
+	// closer to the plane z = 0 or the y axis than this counts as on it
+	constexpr float SEAM_EPSILON = 1e-6f;
+	constexpr float POLE_EPSILON = 1e-6f;
+
+	int _side(const glm::vec3& p_position)
+	{
+		return p_position.z > SEAM_EPSILON ? 1 : (p_position.z < -SEAM_EPSILON ? -1 : 0);
+	}
+
+	bool _isPole(const glm::vec3& p_position)
+	{
+		return p_position.x * p_position.x + p_position.z * p_position.z < POLE_EPSILON * POLE_EPSILON;
+	}
+
+	bool _isOnSeam(const glm::vec3& p_position)
+	{
+		return _side(p_position) == 0 && p_position.x > 0.0f && !_isPole(p_position);
+	}
+
+	// Point where the edge crosses z = 0, from the lower index so both triangles of the edge agree
+	glm::vec3 _seamCrossing(const std::vector<glm::vec3>& p_positions, unsigned int p_a, unsigned int p_b)
+	{
+		const glm::vec3& a = p_positions[std::min(p_a, p_b)];
+		const glm::vec3& b = p_positions[std::max(p_a, p_b)];
+		const float t = a.z / (a.z - b.z);
+		return a + (b - a) * t;
+	}
+
+	// Splits the triangles crossing the u = 0 meridian along it. New vertices are shared by the two
+	// triangles of the split edge and pushed onto the sphere, so the mesh stays watertight.
+	void _splitSeam(std::vector<glm::vec3>& p_positions, std::vector<unsigned int>& p_triangles)
+	{
+		std::unordered_map<uint64_t, unsigned int> crossings;
+		auto crossing = [&](unsigned int p_a, unsigned int p_b)
+		{
+			const uint64_t key = static_cast<uint64_t>(std::min(p_a, p_b)) << 32 | std::max(p_a, p_b);
+			auto found = crossings.find(key);
+			if (found != crossings.end())
+			{
+				return found->second;
+			}
+
+			glm::vec3 position = glm::normalize(_seamCrossing(p_positions, p_a, p_b));
+			position.z = 0.0f;
+			p_positions.push_back(position);
+			const unsigned int index = static_cast<unsigned int>(p_positions.size() - 1);
+			crossings.emplace(key, index);
+			return index;
+		};
+
+		const size_t noOfTriangles = p_triangles.size() / 3;
+		for (size_t i = 0; i < noOfTriangles; ++i)
+		{
+			unsigned int corners[3] = { p_triangles[i * 3], p_triangles[i * 3 + 1], p_triangles[i * 3 + 2] };
+
+			bool crossesSeam = false;
+			for (int e = 0; e < 3; ++e)
+			{
+				const unsigned int a = corners[e];
+				const unsigned int b = corners[(e + 1) % 3];
+				if (_side(p_positions[a]) * _side(p_positions[b]) < 0 && _seamCrossing(p_positions, a, b).x > 0.0f)
+				{
+					crossesSeam = true;
+				}
+			}
+			if (!crossesSeam)
+			{
+				continue;
+			}
+
+			// clip into the parts on either side, keeping the winding
+			unsigned int above[4], below[4];
+			int noOfAbove = 0, noOfBelow = 0;
+			for (int e = 0; e < 3; ++e)
+			{
+				const unsigned int a = corners[e];
+				const unsigned int b = corners[(e + 1) % 3];
+				const int sideA = _side(p_positions[a]);
+				if (sideA >= 0)
+				{
+					above[noOfAbove++] = a;
+				}
+				if (sideA <= 0)
+				{
+					below[noOfBelow++] = a;
+				}
+				if (sideA * _side(p_positions[b]) < 0)
+				{
+					const unsigned int middle = crossing(a, b);
+					above[noOfAbove++] = middle;
+					below[noOfBelow++] = middle;
+				}
+			}
+
+			bool first = true;
+			for (const auto& [polygon, noOfCorners] : { std::make_pair(above, noOfAbove), std::make_pair(below, noOfBelow) })
+			{
+				for (int c = 1; c + 1 < noOfCorners; ++c)
+				{
+					const unsigned int triangle[3] = { polygon[0], polygon[c], polygon[c + 1] };
+					if (first)
+					{
+						// the first piece replaces the original triangle
+						std::copy(triangle, triangle + 3, p_triangles.begin() + i * 3);
+						first = false;
+					}
+					else
+					{
+						p_triangles.insert(p_triangles.end(), triangle, triangle + 3);
+					}
+				}
+			}
+		}
+	}
+
+	// Interleaved vertices with equirectangular texture coordinates, see the comment in SphereMesh.h
+	void _writeSphere(std::vector<glm::vec3>& p_positions, std::vector<unsigned int>& p_triangles, std::vector<float>& p_vertices)
+	{
+		_splitSeam(p_positions, p_triangles);
+
+		p_vertices.clear();
+		p_vertices.reserve(p_positions.size() * ParametricSurface::FLOATS_PER_VERTEX);
+		auto addVertex = [&](const glm::vec3& p_position, float p_texU)
+		{
+			const float texV = static_cast<float>(std::acos(std::clamp(p_position.y, -1.0f, 1.0f)) / PI);
+			const float vertex[ParametricSurface::FLOATS_PER_VERTEX] = { p_position.x, p_position.y, p_position.z, p_position.x, p_position.y, p_position.z, p_texU, texV };
+			p_vertices.insert(p_vertices.end(), vertex, vertex + ParametricSurface::FLOATS_PER_VERTEX);
+			return static_cast<unsigned int>(p_vertices.size() / ParametricSurface::FLOATS_PER_VERTEX - 1);
+		};
+
+		// seam vertices may be needed twice, once with u = 0 (texture u 1) and once with u = 1
+		std::vector<unsigned int> remap(p_positions.size(), NONE);
+		std::vector<unsigned int> seamRemap(p_positions.size(), NONE);
+
+		for (size_t i = 0; i < p_triangles.size(); i += 3)
+		{
+			enum { REGULAR, SEAM, POLE } kind[3];
+			float texU[3] = { 0.0f, 0.0f, 0.0f };
+			float zSum = 0.0f;
+			for (int c = 0; c < 3; ++c)
+			{
+				const glm::vec3& position = p_positions[p_triangles[i + c]];
+				kind[c] = _isPole(position) ? POLE : (_isOnSeam(position) ? SEAM : REGULAR);
+				if (kind[c] == REGULAR)
+				{
+					double u = std::atan2(position.z, position.x) / (2.0 * PI);
+					u = u < 0.0 ? u + 1.0 : u;
+					texU[c] = static_cast<float>(1.0 - u);
+					zSum += position.z;
+				}
+			}
+
+			// seam corners take the side of the rest of the triangle
+			float texUSum = 0.0f;
+			int noOfNonPoles = 0;
+			for (int c = 0; c < 3; ++c)
+			{
+				if (kind[c] == SEAM)
+				{
+					texU[c] = zSum > 0.0f ? 1.0f : 0.0f;
+				}
+				if (kind[c] != POLE)
+				{
+					texUSum += texU[c];
+					++noOfNonPoles;
+				}
+			}
+
+			for (int c = 0; c < 3; ++c)
+			{
+				const unsigned int index = p_triangles[i + c];
+				if (kind[c] == POLE)
+				{
+					p_triangles[i + c] = addVertex(p_positions[index], noOfNonPoles ? texUSum / noOfNonPoles : 0.5f);
+					continue;
+				}
+
+				std::vector<unsigned int>& slot = kind[c] == SEAM && texU[c] == 0.0f ? seamRemap : remap;
+				if (slot[index] == NONE)
+				{
+					slot[index] = addVertex(p_positions[index], texU[c]);
+				}
+				p_triangles[i + c] = slot[index];
+			}
+		}
+	}
+
+	// Canonical key of a point of an icosahedron face: the corner ids with their nonzero weights,
+	// sorted by id, 4 bits per id and 16 bits per weight
+	uint64_t _icosphereKey(const unsigned int* p_ids, const unsigned int* p_weights)
+	{
+		uint64_t key = 0;
+		for (int i = 0; i < 3; ++i)
+		{
+			if (p_weights[i])
+			{
+				key = key << 20 | static_cast<uint64_t>(p_ids[i]) << 16 | p_weights[i];
+			}
+		}
+		return key;
+	}
+}
+
+namespace SphereMesh
+{
+	void Icosphere(unsigned int p_frequency, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles)
+	{
+		const unsigned int n = std::max(1u, p_frequency);
+
+		// poles, a ring of five at +atan(1/2) latitude and one at -atan(1/2), turned by 36 degrees
+		glm::dvec3 corners[12];
+		corners[0] = glm::dvec3(0.0, 1.0, 0.0);
+		corners[11] = glm::dvec3(0.0, -1.0, 0.0);
+		const double ringHeight = 1.0 / std::sqrt(5.0);
+		const double ringRadius = 2.0 / std::sqrt(5.0);
+		for (int k = 0; k < 5; ++k)
+		{
+			const double upper = k * 2.0 * PI / 5.0;
+			const double lower = upper + PI / 5.0;
+			corners[1 + k] = glm::dvec3(ringRadius * std::cos(upper), ringHeight, ringRadius * std::sin(upper));
+			corners[6 + k] = glm::dvec3(ringRadius * std::cos(lower), -ringHeight, ringRadius * std::sin(lower));
+		}
+
+		unsigned int faces[20][3];
+		for (unsigned int k = 0; k < 5; ++k)
+		{
+			const unsigned int next = (k + 1) % 5;
+			const unsigned int face[4][3] = {
+				{ 0, 1 + next, 1 + k },
+				{ 1 + k, 1 + next, 6 + k },
+				{ 1 + next, 6 + next, 6 + k },
+				{ 11, 6 + k, 6 + next } };
+			std::copy(&face[0][0], &face[0][0] + 12, &faces[k * 4][0]);
+		}
+
+		std::vector<glm::vec3> positions;
+		std::vector<unsigned int> triangles;
+		triangles.reserve(static_cast<size_t>(20) * n * n * 3);
+		std::unordered_map<uint64_t, unsigned int> indexOf;
+		std::vector<unsigned int> facePoints((n + 1) * (n + 2) / 2);
+
+		for (const unsigned int* face : faces)
+		{
+			// points i steps towards the second and j towards the third corner, shared along edges
+			for (unsigned int j = 0, point = 0; j <= n; ++j)
+			{
+				for (unsigned int i = 0; i + j <= n; ++i, ++point)
+				{
+					unsigned int ids[3] = { face[0], face[1], face[2] };
+					unsigned int weights[3] = { n - i - j, i, j };
+					for (int a = 0; a < 2; ++a)
+					{
+						for (int b = 0; b < 2 - a; ++b)
+						{
+							if (ids[b] > ids[b + 1])
+							{
+								std::swap(ids[b], ids[b + 1]);
+								std::swap(weights[b], weights[b + 1]);
+							}
+						}
+					}
+
+					const uint64_t key = _icosphereKey(ids, weights);
+					auto found = indexOf.find(key);
+					if (found == indexOf.end())
+					{
+						const glm::dvec3 blended = corners[ids[0]] * double(weights[0]) + corners[ids[1]] * double(weights[1]) + corners[ids[2]] * double(weights[2]);
+						positions.push_back(glm::vec3(glm::normalize(blended)));
+						found = indexOf.emplace(key, static_cast<unsigned int>(positions.size() - 1)).first;
+					}
+					facePoints[point] = found->second;
+				}
+			}
+
+			// row j starts after the j rows above it, which hold n + 1, n, ... points
+			auto at = [n](unsigned int p_i, unsigned int p_j) { return p_j * (n + 1) - p_j * (p_j - 1) / 2 + p_i; };
+			for (unsigned int j = 0; j < n; ++j)
+			{
+				for (unsigned int i = 0; i + j < n; ++i)
+				{
+					const unsigned int up[3] = { facePoints[at(i, j)], facePoints[at(i + 1, j)], facePoints[at(i, j + 1)] };
+					triangles.insert(triangles.end(), up, up + 3);
+					if (i + j + 2 <= n)
+					{
+						const unsigned int down[3] = { facePoints[at(i + 1, j)], facePoints[at(i + 1, j + 1)], facePoints[at(i, j + 1)] };
+						triangles.insert(triangles.end(), down, down + 3);
+					}
+				}
+			}
+		}
+
+		_writeSphere(positions, triangles, p_vertices);
+		p_triangles.swap(triangles);
+	}
+
+	void CubeSphere(unsigned int p_noOfSeg, bool p_spherify, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles)
+	{
+		const unsigned int n = std::max(2u, (p_noOfSeg + 1) & ~1u);
+
+		std::vector<glm::vec3> positions;
+		std::vector<unsigned int> triangles;
+		triangles.reserve(static_cast<size_t>(12) * n * n * 3);
+		// points on the cube edges are shared by lattice coordinate
+		std::unordered_map<uint64_t, unsigned int> indexOf;
+		std::vector<unsigned int> facePoints(static_cast<size_t>(n + 1) * (n + 1));
+
+		for (const CubeFace& face : CUBE_FACES)
+		{
+			for (unsigned int j = 0; j <= n; ++j)
+			{
+				for (unsigned int i = 0; i <= n; ++i)
+				{
+					unsigned int lattice[3];
+					lattice[face.axis] = face.sign > 0 ? n : 0;
+					lattice[face.iAxis] = i;
+					lattice[face.jAxis] = j;
+
+					const uint64_t key = (static_cast<uint64_t>(lattice[0]) * (n + 1) + lattice[1]) * (n + 1) + lattice[2];
+					auto found = indexOf.find(key);
+					if (found == indexOf.end())
+					{
+						const glm::dvec3 point = glm::dvec3(lattice[0], lattice[1], lattice[2]) * (2.0 / n) - 1.0;
+						positions.push_back(glm::vec3(CubeToSphere(point, p_spherify)));
+						found = indexOf.emplace(key, static_cast<unsigned int>(positions.size() - 1)).first;
+					}
+					facePoints[static_cast<size_t>(j) * (n + 1) + i] = found->second;
+				}
+			}
+
+			for (unsigned int j = 0; j < n; ++j)
+			{
+				for (unsigned int i = 0; i < n; ++i)
+				{
+					const unsigned int p00 = facePoints[static_cast<size_t>(j) * (n + 1) + i];
+					const unsigned int p10 = facePoints[static_cast<size_t>(j) * (n + 1) + i + 1];
+					const unsigned int p01 = facePoints[static_cast<size_t>(j + 1) * (n + 1) + i];
+					const unsigned int p11 = facePoints[static_cast<size_t>(j + 1) * (n + 1) + i + 1];
+
+					// the shorter diagonal keeps the triangles closer to the sphere
+					const float diagonal = glm::length(positions[p11] - positions[p00]);
+					const float otherDiagonal = glm::length(positions[p01] - positions[p10]);
+					const unsigned int alongDiagonal[6] = { p00, p10, p11, p00, p11, p01 };
+					const unsigned int alongOther[6] = { p00, p10, p01, p10, p11, p01 };
+					const unsigned int* quad = diagonal <= otherDiagonal ? alongDiagonal : alongOther;
+					triangles.insert(triangles.end(), quad, quad + 6);
+				}
+			}
+		}
+
+		_writeSphere(positions, triangles, p_vertices);
+		p_triangles.swap(triangles);
+	}
+
+	glm::dvec3 CubeToSphere(const glm::dvec3& p_cubePoint, bool p_spherify)
+	{
+		if (!p_spherify)
+		{
+			return glm::normalize(p_cubePoint);
+		}
+
+		const glm::dvec3 squared = p_cubePoint * p_cubePoint;
+		return glm::dvec3(
+			p_cubePoint.x * std::sqrt(1.0 - squared.y / 2.0 - squared.z / 2.0 + squared.y * squared.z / 3.0),
+			p_cubePoint.y * std::sqrt(1.0 - squared.z / 2.0 - squared.x / 2.0 + squared.z * squared.x / 3.0),
+			p_cubePoint.z * std::sqrt(1.0 - squared.x / 2.0 - squared.y / 2.0 + squared.x * squared.y / 3.0));
+	}
+
+	void Generate(Tessellation p_tessellation, unsigned int p_resolution, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles)
+	{
+		const unsigned int resolution = std::max(1u, p_resolution);
+		switch (p_tessellation)
+		{
+		case Tessellation::UvSphere:
+			ParametricSurface::Generate(ParametricSurface::Sphere(), 2 * resolution, resolution, p_vertices, p_triangles);
+			break;
+		case Tessellation::Icosphere:
+			Icosphere(resolution, p_vertices, p_triangles);
+			break;
+		case Tessellation::NormalizedCube:
+			CubeSphere(resolution, false, p_vertices, p_triangles);
+			break;
+		case Tessellation::SpherifiedCube:
+			CubeSphere(resolution, true, p_vertices, p_triangles);
+			break;
+		}
+	}
+
+	double MaxError(const std::vector<float>& p_vertices, const std::vector<unsigned int>& p_triangles)
+	{
+		auto position = [&](unsigned int p_index)
+		{
+			const float* vertex = &p_vertices[static_cast<size_t>(p_index) * ParametricSurface::FLOATS_PER_VERTEX];
+			return glm::dvec3(vertex[0], vertex[1], vertex[2]);
+		};
+		// closest point of a segment to the origin
+		auto segmentDistance = [](const glm::dvec3& p_a, const glm::dvec3& p_b)
+		{
+			const glm::dvec3 edge = p_b - p_a;
+			const double t = std::clamp(-glm::dot(p_a, edge) / std::max(glm::dot(edge, edge), 1e-300), 0.0, 1.0);
+			return glm::length(p_a + edge * t);
+		};
+
+		double largestError = 0.0;
+		for (size_t i = 0; i + 2 < p_triangles.size(); i += 3)
+		{
+			const glm::dvec3 a = position(p_triangles[i]);
+			const glm::dvec3 b = position(p_triangles[i + 1]);
+			const glm::dvec3 c = position(p_triangles[i + 2]);
+			for (const glm::dvec3& corner : { a, b, c })
+			{
+				largestError = std::max(largestError, std::abs(glm::length(corner) - 1.0));
+			}
+
+			const glm::dvec3 normal = glm::cross(b - a, c - a);
+			const double lengthSquared = glm::dot(normal, normal);
+			if (lengthSquared < 1e-30)
+			{
+				continue;
+			}
+
+			// the point nearest to the center is the foot of the perpendicular if it lies inside,
+			// otherwise on an edge
+			const glm::dvec3 foot = normal * (glm::dot(normal, a) / lengthSquared);
+			double distance;
+			if (glm::dot(glm::cross(b - a, foot - a), normal) >= 0.0 && glm::dot(glm::cross(c - b, foot - b), normal) >= 0.0 && glm::dot(glm::cross(a - c, foot - c), normal) >= 0.0)
+			{
+				distance = glm::length(foot);
+			}
+			else
+			{
+				distance = std::min({ segmentDistance(a, b), segmentDistance(b, c), segmentDistance(c, a) });
+			}
+			largestError = std::max(largestError, 1.0 - distance);
+		}
+		return largestError;
+	}
+}
\ No newline at end of file
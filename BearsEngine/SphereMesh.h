@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+// Unit spheres with an even triangle density, in the MeshGrid vertex layout (3 float position,
+// 3 float normal, 2 float uv) and with front faces pointing outwards.
+//
+// Texture coordinates follow the equirectangular mapping of ParametricSurface::Sphere. Triangles
+// crossing the u = 0 meridian (the half plane z = 0, x > 0) are split there, and the vertices on
+// it are duplicated with u = 0 and u = 1, so every coordinate stays inside [0, 1]. Each triangle
+// touching a pole gets its own pole vertex with the u of the triangle's other corners.
+namespace SphereMesh
+{
+	enum class Tessellation
+	{
+		UvSphere,		// 2 p_resolution x p_resolution grid of ParametricSurface::Sphere
+		Icosphere,		// Icosphere with the frequency p_resolution
+		NormalizedCube,	// CubeSphere with p_resolution segments, projected straight out
+		SpherifiedCube	// CubeSphere with p_resolution segments, area preserving mapping
+	};
+
+	// Icosahedron with a vertex at each pole and every edge split into p_frequency segments,
+	// projected onto the sphere: 20 p_frequency^2 triangles before the seam split. A frequency
+	// of 2^k gives the same mesh as k rounds of recursive subdivision.
+	void Icosphere(unsigned int p_frequency, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles);
+
+	// Cube with p_noOfSeg x p_noOfSeg quads per face, each split along its shorter diagonal:
+	// 12 p_noOfSeg^2 triangles before the seam split. p_noOfSeg is rounded up to an even count
+	// so the poles are vertices. With p_spherify the cube is mapped with
+	//   x' = x sqrt(1 - y^2 / 2 - z^2 / 2 + y^2 z^2 / 3)
+	// (and y', z' alike), which keeps the cells near the corners from shrinking.
+	void CubeSphere(unsigned int p_noOfSeg, bool p_spherify, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles);
+
+	// Faces of the cube: the axis and sign of the normal, then the axes i and j grow along, with
+	// i x j pointing along the normal so (i, j) grids wind counter-clockwise from outside
+	struct CubeFace
+	{
+		int axis;
+		int sign;
+		int iAxis;
+		int jAxis;
+	};
+
+	inline constexpr CubeFace CUBE_FACES[6] = {
+		{ 0, 1, 1, 2 }, { 0, -1, 2, 1 },
+		{ 1, 1, 2, 0 }, { 1, -1, 0, 2 },
+		{ 2, 1, 0, 1 }, { 2, -1, 1, 0 } };
+
+	// Point of the [-1, 1] cube on the unit sphere, projected straight out or spherified like CubeSphere
+	glm::dvec3 CubeToSphere(const glm::dvec3& p_cubePoint, bool p_spherify);
+
+	void Generate(Tessellation p_tessellation, unsigned int p_resolution, std::vector<float>& p_vertices, std::vector<unsigned int>& p_triangles);
+
+	// Largest distance between the flat triangles and the unit sphere
+	double MaxError(const std::vector<float>& p_vertices, const std::vector<unsigned int>& p_triangles);
+}
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "MappedFile.h"
+
+namespace
+{
+	constexpr unsigned char IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	// key of the source hash in the key/value data, followed by the hash as 8 little endian bytes
+	constexpr char SOURCE_HASH_KEY[] = "BearsEngine.sourceHash";
+
+	struct Ktx2Header
+	{
+		unsigned char identifier[12];
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+		uint32_t dfdByteOffset;
+		uint32_t dfdByteLength;
+		uint32_t kvdByteOffset;
+		uint32_t kvdByteLength;
+		uint64_t sgdByteOffset;
+		uint64_t sgdByteLength;
+	};
+
+	struct Ktx2Level
+	{
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	static_assert(sizeof(Ktx2Header) == 80, "KTX2 header layout");
+	static_assert(sizeof(Ktx2Level) == 24, "KTX2 level index layout");
+
+	// VK_FORMAT_BC1_RGB_UNORM_BLOCK, BC3_UNORM, BC7_UNORM and ETC2_R8G8B8_UNORM
+	uint32_t _vkFormat(BlockFormat p_format)
+	{
+		switch (p_format)
+		{
+		case BlockFormat::BC1:
+			return 131;
+		case BlockFormat::BC3:
+			return 137;
+		case BlockFormat::BC7:
+			return 145;
+		default:
+			return 147;
+		}
+	}
+
+	// Basic data format descriptor of a block compressed format in linear BT.709
+	std::vector<uint32_t> _formatDescriptor(BlockFormat p_format)
+	{
+		// color model, then channel id, first bit and bit count of every sample
+		uint32_t model;
+		std::vector<uint32_t> samples;
+		switch (p_format)
+		{
+		case BlockFormat::BC1:
+			model = 128;
+			samples = { 0, 0, 64 };
+			break;
+		case BlockFormat::BC3:
+			model = 130;
+			samples = { 15, 0, 64, 0, 64, 64 };
+			break;
+		case BlockFormat::BC7:
+			model = 134;
+			samples = { 0, 0, 128 };
+			break;
+		default:
+			model = 161;
+			samples = { 2, 0, 64 };
+			break;
+		}
+
+		const uint32_t sampleCount = static_cast<uint32_t>(samples.size() / 3);
+		const uint32_t blockSize = 24 + 16 * sampleCount;
+		const uint32_t blockBytes = static_cast<uint32_t>(BlockCompressor::BlockBytes(p_format));
+
+		std::vector<uint32_t> words = { 4 + blockSize, 0, 2u | (blockSize << 16), model | (1u << 8) | (1u << 16), 3u | (3u << 8), blockBytes, 0 };
+		for (uint32_t i = 0; i < sampleCount; ++i)
+		{
+			words.push_back(samples[i * 3 + 1] | ((samples[i * 3 + 2] - 1) << 16) | (samples[i * 3] << 24));
+			words.push_back(0);
+			words.push_back(0);
+			words.push_back(UINT32_MAX);
+		}
+		return words;
+	}
+
+	// Levels of a full chain down to 1 x 1, 1 + floor(log2(max(width, height)))
+	uint32_t _fullChainLevels(uint32_t p_width, uint32_t p_height)
+	{
+		uint32_t levels = 1;
+		for (uint32_t size = std::max(p_width, p_height); size > 1; size >>= 1)
+		{
+			++levels;
+		}
+		return levels;
+	}
+
+	inline uint64_t _alignUp(uint64_t p_value, uint64_t p_alignment)
+	{
+		return (p_value + p_alignment - 1) / p_alignment * p_alignment;
+	}
+}
+
+std::string TextureCache::PathFor(const char* p_imagePath, bool p_cube)
+{
+	return std::string(p_imagePath) + (p_cube ? ".cube.ktx2" : ".ktx2");
+}
+
+bool TextureCache::Write(const char* p_cachePath, uint64_t p_sourceHash, const CompressedImage& p_image)
+{
+	const uint32_t levelCount = static_cast<uint32_t>(p_image.levels.size());
+	const std::vector<uint32_t> descriptor = _formatDescriptor(p_image.format);
+
+	std::vector<unsigned char> keyValues(4 + sizeof(SOURCE_HASH_KEY) + sizeof(p_sourceHash));
+	const uint32_t keyValueLength = static_cast<uint32_t>(keyValues.size() - 4);
+	memcpy(keyValues.data(), &keyValueLength, 4);
+	memcpy(keyValues.data() + 4, SOURCE_HASH_KEY, sizeof(SOURCE_HASH_KEY));
+	memcpy(keyValues.data() + 4 + sizeof(SOURCE_HASH_KEY), &p_sourceHash, sizeof(p_sourceHash));
+	keyValues.resize(_alignUp(keyValues.size(), 4), 0);
+
+	Ktx2Header header = {};
+	memcpy(header.identifier, IDENTIFIER, sizeof(IDENTIFIER));
+	header.vkFormat = _vkFormat(p_image.format);
+	header.typeSize = 1;
+	header.pixelWidth = p_image.width;
+	header.pixelHeight = p_image.height;
+	header.faceCount = p_image.faces;
+	header.levelCount = levelCount;
+	header.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2Header) + levelCount * sizeof(Ktx2Level));
+	header.dfdByteLength = static_cast<uint32_t>(descriptor.size() * sizeof(uint32_t));
+	header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+	header.kvdByteLength = static_cast<uint32_t>(keyValues.size());
+
+	// level data is stored smallest level first, each aligned to a block
+	std::vector<Ktx2Level> index(levelCount);
+	const uint64_t dataOffset = _alignUp(header.kvdByteOffset + header.kvdByteLength, BlockCompressor::BlockBytes(p_image.format));
+	uint64_t offset = dataOffset;
+	for (uint32_t level = levelCount; level-- > 0;)
+	{
+		index[level] = Ktx2Level{ offset, p_image.levels[level].size(), p_image.levels[level].size() };
+		offset += p_image.levels[level].size();
+	}
+
+	// write to a temporary file first so a crash never leaves a half written cache behind
+	std::string temporaryPath = std::string(p_cachePath) + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		const char padding[16] = { 0 };
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(Ktx2Level));
+		file.write(reinterpret_cast<const char*>(descriptor.data()), header.dfdByteLength);
+		file.write(reinterpret_cast<const char*>(keyValues.data()), keyValues.size());
+		file.write(padding, dataOffset - header.kvdByteOffset - header.kvdByteLength);
+		for (uint32_t level = levelCount; level-- > 0;)
+		{
+			file.write(reinterpret_cast<const char*>(p_image.levels[level].data()), p_image.levels[level].size());
+		}
+
+		if (!file.good())
+		{
+			file.close();
+			std::remove(temporaryPath.c_str());
+			return false;
+		}
+	}
+
+	std::remove(p_cachePath);
+	return std::rename(temporaryPath.c_str(), p_cachePath) == 0;
+}
+
+bool TextureCache::Read(const char* p_cachePath, uint64_t p_sourceHash, BlockFormat p_format, CompressedImage& p_image)
+{
+	MappedFile file(p_cachePath);
+	if (!file.IsOpen() || file.Size() < sizeof(Ktx2Header))
+	{
+		return false;
+	}
+
+	Ktx2Header header;
+	memcpy(&header, file.Data(), sizeof(header));
+	if (memcmp(header.identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0 || header.vkFormat != _vkFormat(p_format) || header.supercompressionScheme != 0 ||
+		header.levelCount == 0 || header.pixelWidth == 0 || header.pixelHeight == 0 || header.levelCount > _fullChainLevels(header.pixelWidth, header.pixelHeight) || header.layerCount > 1 || (header.faceCount != 1 && header.faceCount != 6) ||
+		sizeof(Ktx2Header) + header.levelCount * sizeof(Ktx2Level) > file.Size() || static_cast<uint64_t>(header.kvdByteOffset) + header.kvdByteLength > file.Size())
+	{
+		return false;
+	}
+
+	// the source hash has to be among the key/value pairs
+	bool current = false;
+	const char* keyValue = file.Data() + header.kvdByteOffset;
+	const char* keyValueEnd = keyValue + header.kvdByteLength;
+	while (keyValue + 4 <= keyValueEnd && !current)
+	{
+		uint32_t length;
+		memcpy(&length, keyValue, 4);
+		if (length > static_cast<size_t>(keyValueEnd - keyValue - 4))
+		{
+			break;
+		}
+		uint64_t hash;
+		if (length == sizeof(SOURCE_HASH_KEY) + sizeof(hash) && memcmp(keyValue + 4, SOURCE_HASH_KEY, sizeof(SOURCE_HASH_KEY)) == 0)
+		{
+			memcpy(&hash, keyValue + 4 + sizeof(SOURCE_HASH_KEY), sizeof(hash));
+			current = hash == p_sourceHash;
+		}
+		keyValue += 4 + _alignUp(length, 4);
+	}
+	if (!current)
+	{
+		return false;
+	}
+
+	p_image.format = p_format;
+	p_image.width = header.pixelWidth;
+	p_image.height = header.pixelHeight;
+	p_image.faces = header.faceCount;
+	p_image.levels.assign(header.levelCount, {});
+	for (uint32_t level = 0; level < header.levelCount; ++level)
+	{
+		Ktx2Level entry;
+		memcpy(&entry, file.Data() + sizeof(Ktx2Header) + level * sizeof(Ktx2Level), sizeof(entry));
+
+		const int width = std::max(1, p_image.width >> level);
+		const int height = std::max(1, p_image.height >> level);
+		if (entry.byteLength != BlockCompressor::CompressedSize(p_format, width, height) * p_image.faces || entry.byteOffset > file.Size() || entry.byteLength > file.Size() - entry.byteOffset)
+		{
+			return false;
+		}
+		p_image.levels[level].assign(file.Data() + entry.byteOffset, file.Data() + entry.byteOffset + entry.byteLength);
+	}
+	return true;
+}
\ No newline at end of file
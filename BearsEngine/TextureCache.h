@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BlockCompressor.h"
+
+// Block compressed mip chain, level 0 first
+struct CompressedImage
+{
+	BlockFormat format = BlockFormat::BC1;
+	int width = 0;
+	int height = 0;
+	// 6 for cube maps, whose levels hold the blocks of the faces one after another (see CubeMap)
+	int faces = 1;
+	std::vector<std::vector<unsigned char>> levels;
+};
+
+// Precompressed textures stored as KTX2 next to the source image. Besides the levels the file
+// carries a hash of the source bytes in its key/value data, so an edited image is compressed
+// again instead of loading stale blocks.
+namespace TextureCache
+{
+	// Path of the cache file for an image, the image path plus ".ktx2", or ".cube.ktx2" for the
+	// cube map reprojected from it
+	std::string PathFor(const char* p_imagePath, bool p_cube = false);
+
+	// Writes a new cache file, replacing any existing one
+	bool Write(const char* p_cachePath, uint64_t p_sourceHash, const CompressedImage& p_image);
+	// Reads a cache file in p_format built from the same source; false if it is missing,
+	// stale, in another format or damaged
+	bool Read(const char* p_cachePath, uint64_t p_sourceHash, BlockFormat p_format, CompressedImage& p_image);
+}
\ No newline at end of file
@@ -0,0 +1,463 @@
+#include "TextureLoader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "glad/glad.h"
+
+#include "CubeMap.h"
+#include "JpegDecoder.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "TextureCache.h"
+#include "ThreadPool.h"
+#include "stb_image.h"
+
+namespace
+{
+	// The image target of a face, or of the whole texture for 2D ones
+	GLenum _faceTarget(bool p_cube, int p_face)
+	{
+		return p_cube ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + p_face : GL_TEXTURE_2D;
+	}
+
+	bool _hasExtension(const char* p_name)
+	{
+		int count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (int i = 0; i < count; ++i)
+		{
+			const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+			if (extension && std::strcmp(extension, p_name) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+TextureLoader& TextureLoader::Shared()
+{
+	// the pixel buffer is not deleted at exit, the GL context is gone by then
+	static TextureLoader loader;
+	return loader;
+}
+
+void TextureLoader::SetCompression(bool p_enabled, BlockFormat p_preferred)
+{
+	m_compress = p_enabled;
+	m_preferred = p_preferred;
+	m_formatChosen = false;
+}
+
+void TextureLoader::_chooseFormat()
+{
+	m_formatChosen = true;
+	m_compressedFormat = 0;
+	if (!m_compress)
+	{
+		return;
+	}
+
+	const bool bptc = _hasExtension("GL_ARB_texture_compression_bptc") || _hasExtension("GL_EXT_texture_compression_bptc");
+	const bool s3tc = _hasExtension("GL_EXT_texture_compression_s3tc");
+	const bool etc2 = _hasExtension("GL_ARB_ES3_compatibility");
+	auto supported = [&](BlockFormat p_format)
+	{
+		return p_format == BlockFormat::BC7 ? bptc : p_format == BlockFormat::ETC2 ? etc2 : s3tc;
+	};
+
+	for (BlockFormat format : { m_preferred, BlockFormat::BC7, BlockFormat::BC1, BlockFormat::ETC2 })
+	{
+		if (supported(format))
+		{
+			m_format = format;
+			m_compressedFormat = BlockCompressor::GlFormat(format);
+			return;
+		}
+	}
+}
+
+TextureLoader::Texture TextureLoader::_source(const char* p_path, bool p_cube)
+{
+	if (!m_formatChosen)
+	{
+		_chooseFormat();
+	}
+
+	Texture source;
+	source.path = p_path;
+	source.compressedFormat = m_compressedFormat;
+	source.format = m_format;
+	source.mipOptions = m_mipOptions;
+	source.cube = p_cube;
+	return source;
+}
+
+unsigned int TextureLoader::Load(const char* p_path, int p_firstLevel)
+{
+	return _load(_source(p_path, false), p_firstLevel);
+}
+
+unsigned int TextureLoader::LoadCube(const char* p_path, int p_firstLevel)
+{
+	return _load(_source(p_path, true), p_firstLevel);
+}
+
+unsigned int TextureLoader::Reload(unsigned int p_texture, int p_firstLevel)
+{
+	const auto found = m_textures.find(p_texture);
+	if (found == m_textures.end())
+	{
+		return 0;
+	}
+	const Texture source = found->second;
+	return _load(source, p_firstLevel);
+}
+
+unsigned int TextureLoader::_load(const Texture& p_source, int p_firstLevel)
+{
+	const GLenum target = p_source.cube ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+	const int faces = p_source.cube ? CubeMap::FACES : 1;
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(target, texture);
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, p_source.cube ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, p_source.cube ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	if (p_source.cube)
+	{
+		// filtering carries on into the next face instead of clamping at the edge
+		glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+	}
+
+	// mid grey until the first level is in, and for textures that fail to load
+	const unsigned char grey[3] = { 128, 128, 128 };
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (int face = 0; face < faces; ++face)
+	{
+		glTexImage2D(_faceTarget(p_source.cube, face), 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, grey);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	Texture& entry = m_textures[texture];
+	entry = p_source;
+	entry.info = TextureInfo();
+	entry.info.bytes = sizeof(grey) * faces;
+	entry.info.faces = faces;
+
+	std::shared_ptr<Job> job = std::make_shared<Job>();
+	job->texture = texture;
+	job->compressedFormat = p_source.compressedFormat;
+	job->format = p_source.format;
+	job->mipOptions = p_source.mipOptions;
+	job->cube = p_source.cube;
+	job->firstLevel = std::max(0, p_firstLevel);
+	m_jobs.push_back(job);
+
+	// the task keeps its own reference, so a texture deleted meanwhile only wastes the decode
+	const std::string path = p_source.path;
+	ThreadPool::Shared().Enqueue([job, path]() { _decode(path.c_str(), *job); });
+	return texture;
+}
+
+void TextureLoader::Delete(unsigned int& p_texture)
+{
+	if (!p_texture)
+	{
+		return;
+	}
+
+	m_jobs.erase(std::remove_if(m_jobs.begin(), m_jobs.end(), [p_texture](const std::shared_ptr<Job>& p_job) { return p_job->texture == p_texture; }), m_jobs.end());
+	m_textures.erase(p_texture);
+	glDeleteTextures(1, &p_texture);
+	p_texture = 0;
+}
+
+bool TextureLoader::IsLoading(unsigned int p_texture) const
+{
+	return std::any_of(m_jobs.begin(), m_jobs.end(), [p_texture](const std::shared_ptr<Job>& p_job) { return p_job->texture == p_texture; });
+}
+
+const TextureInfo* TextureLoader::Info(unsigned int p_texture) const
+{
+	const auto found = m_textures.find(p_texture);
+	return found != m_textures.end() ? &found->second.info : nullptr;
+}
+
+void TextureLoader::_decode(const char* p_path, Job& p_job)
+{
+	_decodeLevels(p_path, p_job);
+
+	// the finer levels were needed to filter the chain, not for the upload
+	if (!p_job.levels.empty())
+	{
+		p_job.sourceWidth = p_job.levels[0].width;
+		p_job.sourceHeight = p_job.levels[0].height / (p_job.cube ? CubeMap::FACES : 1);
+		p_job.sourceLevels = static_cast<int>(p_job.levels.size());
+		p_job.firstLevel = std::min(p_job.firstLevel, p_job.sourceLevels - 1);
+		p_job.levels.erase(p_job.levels.begin(), p_job.levels.begin() + p_job.firstLevel);
+	}
+	p_job.decoded.store(true, std::memory_order_release);
+}
+
+void TextureLoader::_decodeLevels(const char* p_path, Job& p_job)
+{
+	MappedFile file(p_path);
+	if (!file.IsOpen())
+	{
+		std::cout << "Failed to load texture" << std::endl;
+		return;
+	}
+
+	const std::string cachePath = TextureCache::PathFor(p_path, p_job.cube);
+	const int faces = p_job.cube ? CubeMap::FACES : 1;
+	// the mip options are part of the hash, so changing the filter builds the cache again
+	const MipOptions& mips = p_job.mipOptions;
+	const uint64_t optionBits = static_cast<uint64_t>(mips.filter) | (mips.srgb ? 4u : 0u) | (mips.wrapX ? 8u : 0u) | (mips.wrapY ? 16u : 0u) | (p_job.cube ? 32u : 0u);
+	const uint64_t sourceHash = p_job.compressedFormat ? MeshCache::HashBytes(file.Data(), file.Size(), optionBits) : 0;
+	if (p_job.compressedFormat)
+	{
+		CompressedImage image;
+		if (TextureCache::Read(cachePath.c_str(), sourceHash, p_job.format, image) && image.faces == faces)
+		{
+			for (size_t level = 0; level < image.levels.size(); ++level)
+			{
+				p_job.levels.push_back(MipLevel{ std::max(1, image.width >> level), std::max(1, image.height >> level) * faces, std::move(image.levels[level]) });
+			}
+			return;
+		}
+	}
+
+	// BC3 is the only format here that keeps alpha
+	const int channels = p_job.compressedFormat && p_job.format == BlockFormat::BC3 ? 4 : 3;
+	MipLevel decoded;
+	if (!DecodeImage(reinterpret_cast<const unsigned char*>(file.Data()), file.Size(), channels, decoded))
+	{
+		std::cout << "Failed to load texture" << std::endl;
+		return;
+	}
+	if (p_job.cube)
+	{
+		decoded = CubeMap::FromEquirect(decoded, channels, CubeMap::FaceSize(decoded.width), p_job.mipOptions);
+	}
+	const int width = decoded.width, height = decoded.height / faces;
+	p_job.levels.push_back(std::move(decoded));
+
+	if (p_job.cube)
+	{
+		CubeMap::GenerateMips(p_job.levels, channels, p_job.mipOptions);
+	}
+	else
+	{
+		MipGenerator::Generate(p_job.levels, channels, p_job.mipOptions);
+	}
+
+	if (p_job.compressedFormat)
+	{
+		CompressedImage image{ p_job.format, width, height, faces, {} };
+		for (MipLevel& level : p_job.levels)
+		{
+			// face by face, so no block takes rows of two faces
+			const int faceHeight = level.height / faces;
+			const size_t faceBlocks = BlockCompressor::CompressedSize(p_job.format, level.width, faceHeight);
+			const size_t faceTexels = static_cast<size_t>(level.width) * faceHeight * channels;
+			std::vector<unsigned char> blocks(faceBlocks * faces);
+			for (int face = 0; face < faces; ++face)
+			{
+				BlockCompressor::Compress(p_job.format, level.texels.data() + face * faceTexels, level.width, faceHeight, channels, blocks.data() + face * faceBlocks);
+			}
+			level.texels = std::move(blocks);
+			image.levels.push_back(level.texels);
+		}
+		if (!TextureCache::Write(cachePath.c_str(), sourceHash, image))
+		{
+			std::cout << "Failed to write texture cache " << cachePath << std::endl;
+		}
+	}
+}
+
+bool TextureLoader::DecodeImage(const unsigned char* p_data, size_t p_size, int p_channels, MipLevel& p_image)
+{
+	// JPEGs decode across the pool; other formats, and JPEGs JpegDecoder leaves out, go to stb_image
+	if (JpegDecoder::Decode(p_data, p_size, p_channels, p_image.width, p_image.height, p_image.texels))
+	{
+		return true;
+	}
+	int nrChannels;
+	unsigned char* decoded = stbi_load_from_memory(p_data, static_cast<int>(p_size), &p_image.width, &p_image.height, &nrChannels, p_channels);
+	if (!decoded)
+	{
+		return false;
+	}
+	p_image.texels.assign(decoded, decoded + static_cast<size_t>(p_image.width) * p_image.height * p_channels);
+	stbi_image_free(decoded);
+	return true;
+}
+
+bool TextureLoader::BuildCache(const char* p_path, BlockFormat p_format, const MipOptions& p_mipOptions, bool p_cube)
+{
+	Job job;
+	job.cube = p_cube;
+	job.compressedFormat = BlockCompressor::GlFormat(p_format);
+	job.format = p_format;
+	job.mipOptions = p_mipOptions;
+	_decode(p_path, job);
+	return !job.levels.empty();
+}
+
+bool TextureLoader::_upload(Job& p_job, size_t& p_budget)
+{
+	const GLenum target = p_job.cube ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+	const int faces = p_job.cube ? CubeMap::FACES : 1;
+	glBindTexture(target, p_job.texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	if (!p_job.allocated)
+	{
+		// every level at its final size, sampling limited to the smallest one uploaded right below
+		const int last = static_cast<int>(p_job.levels.size()) - 1;
+		TextureInfo& info = m_textures[p_job.texture].info;
+		info.width = p_job.sourceWidth;
+		info.height = p_job.sourceHeight;
+		info.levels = p_job.sourceLevels;
+		info.firstLevel = p_job.firstLevel;
+		size_t& bytes = info.bytes;
+		bytes = 0;
+		for (int level = 0; level <= last; ++level)
+		{
+			const MipLevel& levelData = p_job.levels[level];
+			const int faceHeight = levelData.height / faces;
+			bytes += levelData.texels.size();
+			for (int face = 0; face < faces; ++face)
+			{
+				if (p_job.compressedFormat)
+				{
+					glCompressedTexImage2D(_faceTarget(p_job.cube, face), level, p_job.compressedFormat, levelData.width, faceHeight, 0, static_cast<GLsizei>(levelData.texels.size() / faces), nullptr);
+				}
+				else
+				{
+					glTexImage2D(_faceTarget(p_job.cube, face), level, GL_RGB, levelData.width, faceHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+				}
+			}
+		}
+		glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, last);
+		glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, last);
+		p_job.level = last;
+		p_job.allocated = true;
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_PBO);
+	while (p_job.level >= 0 && p_budget > 0)
+	{
+		// a row of a compressed level is a row of 4 x 4 blocks; a cube map goes up face by face
+		const MipLevel& level = p_job.levels[p_job.level];
+		const int faceHeight = level.height / faces;
+		const int faceRows = p_job.compressedFormat ? (faceHeight + 3) / 4 : faceHeight;
+		const int levelRows = faceRows * faces;
+		const size_t rowBytes = level.texels.size() / levelRows;
+		const int face = p_job.uploadedRows / faceRows;
+		const int faceRow = p_job.uploadedRows - face * faceRows;
+		const int rows = static_cast<int>(std::min<size_t>(faceRows - faceRow, std::max<size_t>(1, p_budget / rowBytes)));
+		const size_t bytes = rows * rowBytes;
+
+		// orphaned every time, so the copy never waits for the GPU to finish reading the last one
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+		void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (!staging)
+		{
+			break;
+		}
+		memcpy(staging, level.texels.data() + p_job.uploadedRows * rowBytes, bytes);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		if (p_job.compressedFormat)
+		{
+			const int y = faceRow * 4;
+			glCompressedTexSubImage2D(_faceTarget(p_job.cube, face), p_job.level, 0, y, level.width, std::min(rows * 4, faceHeight - y), p_job.compressedFormat, static_cast<GLsizei>(bytes), nullptr);
+		}
+		else
+		{
+			glTexSubImage2D(_faceTarget(p_job.cube, face), p_job.level, 0, faceRow, level.width, rows, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+		}
+
+		p_job.uploadedRows += rows;
+		p_budget -= std::min(p_budget, bytes);
+
+		if (p_job.uploadedRows == levelRows)
+		{
+			glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, p_job.level);
+			--p_job.level;
+			p_job.uploadedRows = 0;
+		}
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	return p_job.level < 0;
+}
+
+void TextureLoader::Update(size_t p_budget)
+{
+	if (m_jobs.empty())
+	{
+		return;
+	}
+	if (!m_PBO)
+	{
+		glGenBuffers(1, &m_PBO);
+	}
+
+	size_t budget = p_budget ? p_budget : SIZE_MAX;
+	for (size_t i = 0; i < m_jobs.size() && budget > 0;)
+	{
+		Job& job = *m_jobs[i];
+		if (!job.decoded.load(std::memory_order_acquire))
+		{
+			++i;
+			continue;
+		}
+
+		// a texture that failed to decode stays grey
+		if (job.levels.empty() || _upload(job, budget))
+		{
+			m_jobs.erase(m_jobs.begin() + i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+void TextureLoader::Finish()
+{
+	for (const std::shared_ptr<Job>& job : m_jobs)
+	{
+		while (!job->decoded.load(std::memory_order_acquire))
+		{
+			std::this_thread::yield();
+		}
+	}
+	Update(0);
+}
+
+void TextureLoader::Release()
+{
+	// decode tasks still running keep their own reference to the job
+	m_jobs.clear();
+	for (const auto& [texture, source] : m_textures)
+	{
+		glDeleteTextures(1, &texture);
+	}
+	m_textures.clear();
+	if (m_PBO)
+	{
+		glDeleteBuffers(1, &m_PBO);
+		m_PBO = 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "BlockCompressor.h"
+#include "MipGenerator.h"
+
+// What TextureLoader knows about a texture it created
+struct TextureInfo
+{
+	// GPU memory, every uploaded level at its final size once they are known
+	size_t bytes = 0;
+	// size and number of levels of the full chain of the source image, 0 until it is decoded
+	int width = 0;
+	int height = 0;
+	int levels = 0;
+	// level of the full chain that is level 0 of the texture, see Load
+	int firstLevel = 0;
+	// 6 for cube maps, whose size is the size of a face
+	int faces = 1;
+};
+
+// Loads RGB textures without stalling the frame. Decoding (JpegDecoder, stb_image for anything
+// else) and the mip chain (see MipGenerator) are computed on ThreadPool::Shared, and Update copies the levels into a pixel buffer object and on into the
+// texture with glTexSubImage2D, a few rows per frame within a byte budget.
+//
+// Where the GL supports a block compression format the levels are compressed once and kept in
+// a KTX2 file next to the image (see TextureCache). Later loads read the blocks straight from
+// there, skipping the image decode, and upload them with glCompressedTexSubImage2D.
+//
+// Levels arrive smallest first and GL_TEXTURE_BASE_LEVEL follows them down, so a texture is
+// complete at every point: mid grey, then a blurry version that sharpens until level 0 is in.
+// All calls belong to the GL thread.
+class TextureLoader
+{
+public:
+	static TextureLoader& Shared();
+
+	// Creates a GL_REPEAT, trilinear texture with one grey texel and queues the decode.
+	// The name can be bound right away. With p_firstLevel the texture starts that many levels
+	// down the chain, at most the 1 x 1 one, for a smaller footprint with the same uvs.
+	unsigned int Load(const char* p_path, int p_firstLevel = 0);
+	// Same for a GL_TEXTURE_CUBE_MAP reprojected from an equirectangular image (see CubeMap),
+	// sampled by direction with seamless filtering across the faces. The decode task does the
+	// reprojection; compressed faces are cached next to the image like 2D textures.
+	unsigned int LoadCube(const char* p_path, int p_firstLevel = 0);
+	// Loads the image of p_texture again into a new texture, with the options p_texture was
+	// loaded with and another first level; 0 if p_texture is not known here. Swapping the
+	// new texture in once it is loaded is up to the caller.
+	unsigned int Reload(unsigned int p_texture, int p_firstLevel);
+	// Compression of textures loaded from now on. The preferred format is used if the GL has
+	// it, otherwise the first supported one of BC7, BC1 and ETC2, otherwise none. On by default.
+	void SetCompression(bool p_enabled, BlockFormat p_preferred = BlockFormat::BC7);
+	// Filtering of the mip chains of textures loaded from now on. Defaults to Kaiser in linear
+	// light, wrapping only around the longitude seam of equirectangular maps.
+	void SetMipOptions(const MipOptions& p_options) { m_mipOptions = p_options; }
+	bool Compression() const { return m_compress; }
+	BlockFormat PreferredFormat() const { return m_preferred; }
+	const MipOptions& GetMipOptions() const { return m_mipOptions; }
+	// Drops whatever is still queued for the texture and deletes it
+	void Delete(unsigned int& p_texture);
+
+	// Uploads decoded levels, at most p_budget bytes plus one row (0 means no limit)
+	void Update(size_t p_budget);
+	// Waits for every decode and uploads everything, for tools that need the final texels
+	void Finish();
+	// Deletes every texture still known here and the pixel buffer, at shutdown before the context goes
+	void Release();
+
+	size_t PendingTextures() const { return m_jobs.size(); }
+	// True until level 0 of the texture is uploaded or its load failed
+	bool IsLoading(unsigned int p_texture) const;
+	// nullptr for textures not loaded here
+	const TextureInfo* Info(unsigned int p_texture) const;
+
+	// Writes the compressed cache of an image ahead of time; needs no GL context. The mip
+	// options have to match the loader's for the cache to be used.
+	static bool BuildCache(const char* p_path, BlockFormat p_format, const MipOptions& p_mipOptions = MipOptions(), bool p_cube = false);
+	// Decodes an image file in memory into 3 or 4 channel texels, JPEGs across ThreadPool::Shared;
+	// needs no GL context
+	static bool DecodeImage(const unsigned char* p_data, size_t p_size, int p_channels, MipLevel& p_image);
+
+private:
+	struct Job
+	{
+		unsigned int texture = 0;
+		// internal format of the blocks, 0 for uncompressed RGB
+		unsigned int compressedFormat = 0;
+		BlockFormat format = BlockFormat::BC1;
+		MipOptions mipOptions;
+		bool cube = false;
+		// level of the full chain uploaded as level 0, clamped by the decode task
+		int firstLevel = 0;
+		// written by the decode task, read once decoded is set; RGB texels or compressed blocks,
+		// of a cube map the six faces one after another with the height of all of them
+		std::vector<MipLevel> levels;
+		int sourceWidth = 0;
+		int sourceHeight = 0;
+		int sourceLevels = 0;
+		std::atomic<bool> decoded = false;
+
+		// upload progress, the level in flight and its rows already copied
+		bool allocated = false;
+		int level = 0;
+		int uploadedRows = 0;
+	};
+
+	// Source and options of a texture, kept for Reload
+	struct Texture
+	{
+		TextureInfo info;
+		std::string path;
+		unsigned int compressedFormat = 0;
+		BlockFormat format = BlockFormat::BC1;
+		MipOptions mipOptions;
+		bool cube = false;
+	};
+
+	TextureLoader() = default;
+
+	// Resolves m_format against the extensions of the current context
+	void _chooseFormat();
+	// Source with the current compression and mip options
+	Texture _source(const char* p_path, bool p_cube);
+	unsigned int _load(const Texture& p_source, int p_firstLevel);
+	// Decodes or reads the chain from the cache and drops the levels above firstLevel
+	static void _decode(const char* p_path, Job& p_job);
+	static void _decodeLevels(const char* p_path, Job& p_job);
+	// Copies rows of the current level of p_job; returns true once level 0 is complete
+	bool _upload(Job& p_job, size_t& p_budget);
+
+	std::vector<std::shared_ptr<Job>> m_jobs;
+	std::unordered_map<unsigned int, Texture> m_textures;
+	unsigned int m_PBO = 0;
+
+	bool m_compress = true;
+	BlockFormat m_preferred = BlockFormat::BC7;
+	// chosen on the first load after a change; m_compressedFormat stays 0 without a usable format
+	bool m_formatChosen = false;
+	BlockFormat m_format = BlockFormat::BC7;
+	unsigned int m_compressedFormat = 0;
+	MipOptions m_mipOptions;
+};
\ No newline at end of file
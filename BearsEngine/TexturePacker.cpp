@@ -0,0 +1,261 @@
+#include "TexturePacker.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "glad/glad.h"
+
+#include "MappedFile.h"
+#include "ResidencyManager.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+
+// imgui_draw.cpp compiles its copy as static functions, so this file needs its own
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imgui/imstb_rectpack.h"
+
+namespace
+{
+	const int CHANNELS = 3;
+	// rects start and end on multiples of this, so they stay whole texels down to the last atlas level
+	const int ATLAS_ALIGN = 1 << (TexturePacker::ATLAS_LEVELS - 1);
+
+	int _alignUp(int p_value)
+	{
+		return (p_value + ATLAS_ALIGN - 1) / ATLAS_ALIGN * ATLAS_ALIGN;
+	}
+
+	int _edge(int p_coordinate, int p_size, bool p_wrap)
+	{
+		return p_wrap ? (p_coordinate % p_size + p_size) % p_size : std::clamp(p_coordinate, 0, p_size - 1);
+	}
+
+	// Copies p_image into p_page with its top left texel at p_x, p_y and p_padding texels around it
+	void _blit(const MipLevel& p_image, int p_padding, const MipOptions& p_options, MipLevel& p_page, int p_x, int p_y)
+	{
+		const size_t rowBytes = static_cast<size_t>(p_image.width) * CHANNELS;
+		for (int y = -p_padding; y < p_image.height + p_padding; ++y)
+		{
+			const unsigned char* source = &p_image.texels[_edge(y, p_image.height, p_options.wrapY) * rowBytes];
+			unsigned char* row = &p_page.texels[(static_cast<size_t>(p_y + y) * p_page.width + p_x) * CHANNELS];
+			std::memcpy(row, source, rowBytes);
+			for (int x = 1; x <= p_padding; ++x)
+			{
+				std::memcpy(row - x * CHANNELS, source + _edge(-x, p_image.width, p_options.wrapX) * CHANNELS, CHANNELS);
+				std::memcpy(row + rowBytes + (x - 1) * CHANNELS, source + _edge(p_image.width + x - 1, p_image.width, p_options.wrapX) * CHANNELS, CHANNELS);
+			}
+		}
+	}
+}
+
+TexturePacker::TexturePacker(const MipOptions& p_mipOptions)
+	: m_mipOptions(p_mipOptions)
+{
+}
+
+TexturePacker::~TexturePacker()
+{
+	ResidencyManager::Shared().Untrack(this);
+	if (!m_textures.empty())
+	{
+		glDeleteTextures(static_cast<GLsizei>(m_textures.size()), m_textures.data());
+	}
+}
+
+size_t TexturePacker::Add(const char* p_path)
+{
+	Image image;
+	image.path = p_path;
+	m_images.push_back(std::move(image));
+	return m_images.size() - 1;
+}
+
+size_t TexturePacker::Add(MipLevel p_image)
+{
+	Image image;
+	image.levels.push_back(std::move(p_image));
+	m_images.push_back(std::move(image));
+	return m_images.size() - 1;
+}
+
+bool TexturePacker::Build()
+{
+	std::vector<size_t> pending;
+	for (size_t i = 0; i < m_images.size(); ++i)
+	{
+		if (!m_images[i].built)
+		{
+			pending.push_back(i);
+		}
+	}
+
+	// one image per index, each of them spreading its decode and filtering over the pool as well
+	ThreadPool::Shared().ParallelFor(pending.size(), [this, &pending](size_t p_index)
+	{
+		Image& image = m_images[pending[p_index]];
+		if (!image.path.empty())
+		{
+			MappedFile file(image.path.c_str());
+			MipLevel decoded;
+			if (!file.IsOpen() || !TextureLoader::DecodeImage(reinterpret_cast<const unsigned char*>(file.Data()), file.Size(), CHANNELS, decoded))
+			{
+				return;
+			}
+			image.levels.push_back(std::move(decoded));
+		}
+		if (!image.levels.empty())
+		{
+			MipGenerator::Generate(image.levels, CHANNELS, m_mipOptions);
+		}
+	});
+
+	bool loaded = true;
+	std::vector<size_t> small, large;
+	for (size_t index : pending)
+	{
+		Image& image = m_images[index];
+		image.built = true;
+		if (image.levels.empty())
+		{
+			std::cout << "Failed to load texture " << image.path << std::endl;
+			loaded = false;
+			continue;
+		}
+		(std::max(image.levels[0].width, image.levels[0].height) <= ATLAS_MAX_IMAGE ? small : large).push_back(index);
+	}
+
+	GLint maxLayers = 256;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	_buildArrays(large, maxLayers);
+	_buildAtlases(small, maxLayers);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	ResidencyManager::Shared().Track(this, m_bytes);
+	return loaded;
+}
+
+unsigned int TexturePacker::_createArray(int p_width, int p_height, int p_levels, int p_layers, bool p_repeat)
+{
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, p_repeat ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, p_repeat ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, p_levels - 1);
+
+	for (int level = 0; level < p_levels; ++level)
+	{
+		const int width = std::max(1, p_width >> level);
+		const int height = std::max(1, p_height >> level);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGB, width, height, p_layers, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+		m_bytes += static_cast<size_t>(width) * height * p_layers * CHANNELS;
+	}
+	m_textures.push_back(texture);
+	return texture;
+}
+
+void TexturePacker::_buildArrays(const std::vector<size_t>& p_images, int p_maxLayers)
+{
+	// images of the same size next to each other, every run one array
+	std::vector<size_t> images = p_images;
+	std::sort(images.begin(), images.end(), [this](size_t p_a, size_t p_b)
+	{
+		const MipLevel& a = m_images[p_a].levels[0];
+		const MipLevel& b = m_images[p_b].levels[0];
+		return a.width != b.width ? a.width < b.width : a.height < b.height;
+	});
+
+	for (size_t first = 0; first < images.size();)
+	{
+		const int width = m_images[images[first]].levels[0].width;
+		const int height = m_images[images[first]].levels[0].height;
+		size_t last = first + 1;
+		while (last < images.size() && last - first < static_cast<size_t>(p_maxLayers) &&
+			m_images[images[last]].levels[0].width == width && m_images[images[last]].levels[0].height == height)
+		{
+			++last;
+		}
+
+		const int levels = static_cast<int>(m_images[images[first]].levels.size());
+		const unsigned int texture = _createArray(width, height, levels, static_cast<int>(last - first), true);
+		for (size_t i = first; i < last; ++i)
+		{
+			Image& image = m_images[images[i]];
+			const int layer = static_cast<int>(i - first);
+			for (int level = 0; level < levels; ++level)
+			{
+				const MipLevel& texels = image.levels[level];
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, texels.width, texels.height, 1, GL_RGB, GL_UNSIGNED_BYTE, texels.texels.data());
+			}
+			image.packed = PackedTexture{ texture, layer, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f) };
+			std::vector<MipLevel>().swap(image.levels);
+		}
+		first = last;
+	}
+}
+
+void TexturePacker::_buildAtlases(const std::vector<size_t>& p_images, int p_maxLayers)
+{
+	std::vector<stbrp_rect> rects(p_images.size());
+	for (size_t i = 0; i < p_images.size(); ++i)
+	{
+		const MipLevel& image = m_images[p_images[i]].levels[0];
+		rects[i] = stbrp_rect{};
+		rects[i].id = static_cast<int>(i);
+		rects[i].w = _alignUp(image.width + 2 * ATLAS_PADDING);
+		rects[i].h = _alignUp(image.height + 2 * ATLAS_PADDING);
+	}
+
+	// every page takes what did not fit on the ones before; an empty page fits any image
+	std::vector<std::vector<stbrp_rect>> pages;
+	std::vector<stbrp_node> nodes(ATLAS_SIZE);
+	while (!rects.empty())
+	{
+		stbrp_context context;
+		stbrp_init_target(&context, ATLAS_SIZE, ATLAS_SIZE, nodes.data(), static_cast<int>(nodes.size()));
+		stbrp_pack_rects(&context, rects.data(), static_cast<int>(rects.size()));
+		const auto unpacked = std::stable_partition(rects.begin(), rects.end(), [](const stbrp_rect& p_rect) { return p_rect.was_packed != 0; });
+		pages.emplace_back(rects.begin(), unpacked);
+		rects.erase(rects.begin(), unpacked);
+	}
+
+	const float scale = 1.0f / ATLAS_SIZE;
+	MipLevel page;
+	for (size_t first = 0; first < pages.size(); first += p_maxLayers)
+	{
+		const size_t last = std::min(pages.size(), first + p_maxLayers);
+		const unsigned int texture = _createArray(ATLAS_SIZE, ATLAS_SIZE, ATLAS_LEVELS, static_cast<int>(last - first), false);
+		for (size_t p = first; p < last; ++p)
+		{
+			const int layer = static_cast<int>(p - first);
+			for (int level = 0; level < ATLAS_LEVELS; ++level)
+			{
+				page.width = page.height = ATLAS_SIZE >> level;
+				page.texels.assign(static_cast<size_t>(page.width) * page.height * CHANNELS, 0);
+				const int padding = ATLAS_PADDING >> level;
+				for (const stbrp_rect& rect : pages[p])
+				{
+					// images smaller than the page levels repeat their last level
+					const std::vector<MipLevel>& levels = m_images[p_images[rect.id]].levels;
+					const MipLevel& image = levels[std::min(level, static_cast<int>(levels.size()) - 1)];
+					_blit(image, padding, m_mipOptions, page, (rect.x >> level) + padding, (rect.y >> level) + padding);
+				}
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, page.width, page.height, 1, GL_RGB, GL_UNSIGNED_BYTE, page.texels.data());
+			}
+
+			for (const stbrp_rect& rect : pages[p])
+			{
+				Image& image = m_images[p_images[rect.id]];
+				const glm::vec4 uvRect((rect.x + ATLAS_PADDING) * scale, (rect.y + ATLAS_PADDING) * scale, image.levels[0].width * scale, image.levels[0].height * scale);
+				image.packed = PackedTexture{ texture, layer, uvRect };
+				std::vector<MipLevel>().swap(image.levels);
+			}
+		}
+	}
+	m_atlasPages += pages.size();
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "MipGenerator.h"
+
+// Where an image of a TexturePacker ended up
+struct PackedTexture
+{
+	// GL_TEXTURE_2D_ARRAY holding the image, 0 before Build or if the image failed to load
+	unsigned int texture = 0;
+	int layer = 0;
+	// uv offset (xy) and scale (zw) of the image inside its layer, the whole layer for (0, 0, 1, 1).
+	// Shaders repeat uvs inside the rect themselves, see sphere_packed.fs.
+	glm::vec4 rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+};
+
+// Packs many RGB images into a few GL_TEXTURE_2D_ARRAY textures, so objects with different
+// images can share a texture binding and be drawn together (see MeshBatch):
+// - images of the same size become layers of one array, with their full mip chain
+// - images up to ATLAS_MAX_IMAGE texels a side are packed into atlas pages with stb_rect_pack,
+//   and the pages become the layers of one more array. Every image is surrounded by
+//   ATLAS_PADDING texels repeated from its opposite edges (or its own edge where the mip options
+//   do not wrap), so filtering at the rect border and the ATLAS_LEVELS levels of the pages
+//   never pick up the neighbours.
+//
+// Images decode and filter across ThreadPool::Shared; Build uploads on the GL thread. The
+// arrays are counted against the budget of ResidencyManager, but never evicted.
+class TexturePacker
+{
+public:
+	static constexpr int ATLAS_MAX_IMAGE = 256;
+	static constexpr int ATLAS_SIZE = 2048;
+	static constexpr int ATLAS_PADDING = 8;
+	// levels 0 to 3 still keep one texel of padding
+	static constexpr int ATLAS_LEVELS = 4;
+
+	explicit TexturePacker(const MipOptions& p_mipOptions = MipOptions());
+	~TexturePacker();
+	TexturePacker(const TexturePacker&) = delete;
+	TexturePacker& operator=(const TexturePacker&) = delete;
+
+	// Queues an image file or RGB texels for the next Build and returns the index for Get
+	size_t Add(const char* p_path);
+	size_t Add(MipLevel p_image);
+
+	// Decodes and packs everything added since the last Build into new textures. False if
+	// an image could not be loaded; the others are packed anyway.
+	bool Build();
+
+	const PackedTexture& Get(size_t p_index) const { return m_images[p_index].packed; }
+	const std::vector<unsigned int>& Textures() const { return m_textures; }
+	size_t AtlasPages() const { return m_atlasPages; }
+	size_t Bytes() const { return m_bytes; }
+
+private:
+	struct Image
+	{
+		std::string path;
+		// the mip chain until Build uploads it
+		std::vector<MipLevel> levels;
+		PackedTexture packed;
+		bool built = false;
+	};
+
+	// Allocates an array of p_layers layers with p_levels levels and counts its bytes
+	unsigned int _createArray(int p_width, int p_height, int p_levels, int p_layers, bool p_repeat);
+	void _buildArrays(const std::vector<size_t>& p_images, int p_maxLayers);
+	void _buildAtlases(const std::vector<size_t>& p_images, int p_maxLayers);
+
+	MipOptions m_mipOptions;
+	std::vector<Image> m_images;
+	std::vector<unsigned int> m_textures;
+	size_t m_atlasPages = 0;
+	size_t m_bytes = 0;
+};
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int p_noOfWorkers)
+{
+	m_workers.reserve(p_noOfWorkers);
+	for (unsigned int i = 0; i < p_noOfWorkers; ++i)
+	{
+		m_workers.emplace_back(&ThreadPool::_workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_condition.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::Enqueue(std::function<void()> p_task)
+{
+	if (m_workers.empty())
+	{
+		p_task();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push(std::move(p_task));
+	}
+	m_condition.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t p_count, const std::function<void(size_t)>& p_function)
+{
+	if (p_count == 0)
+	{
+		return;
+	}
+
+	// shared with the helper tasks, which may start after this call already returned
+	struct State
+	{
+		std::atomic<size_t> next{ 0 };
+		std::atomic<size_t> done{ 0 };
+		size_t count = 0;
+		const std::function<void(size_t)>* function = nullptr;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+
+	std::shared_ptr<State> state = std::make_shared<State>();
+	state->count = p_count;
+	state->function = &p_function;
+
+	auto work = [](State& p_state)
+	{
+		size_t index;
+		while ((index = p_state.next.fetch_add(1)) < p_state.count)
+		{
+			(*p_state.function)(index);
+			if (p_state.done.fetch_add(1) + 1 == p_state.count)
+			{
+				std::lock_guard<std::mutex> lock(p_state.mutex);
+				p_state.finished.notify_all();
+			}
+		}
+	};
+
+	size_t noOfHelpers = p_count - 1 < m_workers.size() ? p_count - 1 : m_workers.size();
+	for (size_t i = 0; i < noOfHelpers; ++i)
+	{
+		Enqueue([state, work]() { work(*state); });
+	}
+
+	work(*state);
+
+	// wait for indices still being processed by helpers, not for the helper tasks themselves
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&state]() { return state->done.load() == state->count; });
+}
+
+ThreadPool& ThreadPool::Shared()
+{
+	static ThreadPool pool(std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 1);
+	return pool;
+}
+
+void ThreadPool::_workerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+			if (m_stopping && m_tasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(m_tasks.front());
+			m_tasks.pop();
+		}
+
+		task();
+	}
+}
\ No newline at end of file
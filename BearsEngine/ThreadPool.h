@@ -0,0 +1,42 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads consuming a FIFO of tasks.
+class ThreadPool
+{
+public:
+	// A pool without workers is allowed: Enqueue() then runs the task immediately
+	// and ParallelFor() runs everything on the calling thread.
+	ThreadPool(unsigned int p_noOfWorkers);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Enqueue(std::function<void()> p_task);
+
+	// Calls p_function(i) for every i in [0, p_count) and returns once all calls finished.
+	// The calling thread takes part, so it is safe to call from inside a task.
+	void ParallelFor(size_t p_count, const std::function<void(size_t)>& p_function);
+
+	unsigned int NoOfWorkers() const { return static_cast<unsigned int>(m_workers.size()); }
+
+	// Engine wide pool with one worker per hardware thread (minus the main thread)
+	static ThreadPool& Shared();
+
+private:
+	void _workerLoop();
+
+	std::vector<std::thread> m_workers;
+	std::queue<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stopping = false;
+};
\ No newline at end of file
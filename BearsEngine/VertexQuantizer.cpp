@@ -0,0 +1,147 @@
+#include "VertexQuantizer.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	constexpr size_t FLOATS_PER_VERTEX = 8;
+
+	// normals this close to the position mean the mesh is a unit sphere around the origin
+	constexpr float NORMAL_FROM_POSITION_TOLERANCE = 1e-4f;
+
+	inline uint16_t _toUnorm16(float p_value)
+	{
+		float clamped = p_value < 0.0f ? 0.0f : (p_value > 1.0f ? 1.0f : p_value);
+		return static_cast<uint16_t>(clamped * 65535.0f + 0.5f);
+	}
+
+	inline int16_t _toSnorm16(float p_value)
+	{
+		float clamped = p_value < -1.0f ? -1.0f : (p_value > 1.0f ? 1.0f : p_value);
+		return static_cast<int16_t>(std::lround(clamped * 32767.0f));
+	}
+
+	inline float _signNotZero(float p_value)
+	{
+		return p_value >= 0.0f ? 1.0f : -1.0f;
+	}
+}
+
+namespace VertexQuantizer
+{
+	void OctEncode(const glm::vec3& p_normal, int16_t* p_encoded)
+	{
+		float length = std::fabs(p_normal.x) + std::fabs(p_normal.y) + std::fabs(p_normal.z);
+		glm::vec2 projected = length > 0.0f ? glm::vec2(p_normal.x, p_normal.y) / length : glm::vec2(0.0f);
+
+		// fold the lower hemisphere over the diagonals
+		if (p_normal.z < 0.0f)
+		{
+			projected = glm::vec2((1.0f - std::fabs(projected.y)) * _signNotZero(projected.x),
+				(1.0f - std::fabs(projected.x)) * _signNotZero(projected.y));
+		}
+
+		p_encoded[0] = _toSnorm16(projected.x);
+		p_encoded[1] = _toSnorm16(projected.y);
+	}
+
+	glm::vec3 OctDecode(const int16_t* p_encoded)
+	{
+		glm::vec2 projected(std::fmax(p_encoded[0] / 32767.0f, -1.0f), std::fmax(p_encoded[1] / 32767.0f, -1.0f));
+		glm::vec3 normal(projected.x, projected.y, 1.0f - std::fabs(projected.x) - std::fabs(projected.y));
+
+		if (normal.z < 0.0f)
+		{
+			normal.x = (1.0f - std::fabs(projected.y)) * _signNotZero(projected.x);
+			normal.y = (1.0f - std::fabs(projected.x)) * _signNotZero(projected.y);
+		}
+
+		return glm::normalize(normal);
+	}
+
+	bool Quantize(const float* p_vertices, size_t p_noOfVertices, const unsigned int* p_indices, size_t p_noOfIndices, QuantizedMesh& p_mesh)
+	{
+		glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX);
+		bool normalIsPosition = true;
+
+		for (size_t i = 0; i < p_noOfVertices; ++i)
+		{
+			const float* vertex = p_vertices + i * FLOATS_PER_VERTEX;
+			glm::vec3 position(vertex[0], vertex[1], vertex[2]);
+			glm::vec3 normal(vertex[3], vertex[4], vertex[5]);
+
+			minimum = glm::min(minimum, position);
+			maximum = glm::max(maximum, position);
+
+			if (normalIsPosition && glm::length(normal - position) > NORMAL_FROM_POSITION_TOLERANCE)
+			{
+				normalIsPosition = false;
+			}
+
+			if (vertex[6] < 0.0f || vertex[6] > 1.0f || vertex[7] < 0.0f || vertex[7] > 1.0f)
+			{
+				return false;
+			}
+		}
+
+		if (p_noOfVertices == 0)
+		{
+			minimum = maximum = glm::vec3(0.0f);
+		}
+
+		p_mesh.format = normalIsPosition ? VertexFormat::QuantizedNoNormal : VertexFormat::Quantized;
+		p_mesh.positionMin = minimum;
+		p_mesh.positionExtent = maximum - minimum;
+
+		// position is padded to 8 bytes so the following attributes stay 4 byte aligned
+		p_mesh.normalOffset = 4 * sizeof(uint16_t);
+		p_mesh.texCoordOffset = normalIsPosition ? p_mesh.normalOffset : p_mesh.normalOffset + 2 * sizeof(int16_t);
+		p_mesh.stride = p_mesh.texCoordOffset + 2 * sizeof(uint16_t);
+		p_mesh.noOfVertices = p_noOfVertices;
+		p_mesh.vertices.assign(p_noOfVertices * p_mesh.stride, 0);
+
+		glm::vec3 inverseExtent;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			inverseExtent[axis] = p_mesh.positionExtent[axis] > 0.0f ? 1.0f / p_mesh.positionExtent[axis] : 0.0f;
+		}
+
+		for (size_t i = 0; i < p_noOfVertices; ++i)
+		{
+			const float* vertex = p_vertices + i * FLOATS_PER_VERTEX;
+			uint8_t* out = p_mesh.vertices.data() + i * p_mesh.stride;
+
+			uint16_t position[4];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				position[axis] = _toUnorm16((vertex[axis] - minimum[axis]) * inverseExtent[axis]);
+			}
+			position[3] = 0;
+			memcpy(out, position, sizeof(position));
+
+			if (!normalIsPosition)
+			{
+				int16_t normal[2];
+				OctEncode(glm::vec3(vertex[3], vertex[4], vertex[5]), normal);
+				memcpy(out + p_mesh.normalOffset, normal, sizeof(normal));
+			}
+
+			uint16_t texCoord[2] = { _toUnorm16(vertex[6]), _toUnorm16(vertex[7]) };
+			memcpy(out + p_mesh.texCoordOffset, texCoord, sizeof(texCoord));
+		}
+
+		p_mesh.indices16.clear();
+		if (p_noOfVertices <= 0x10000)
+		{
+			p_mesh.indices16.resize(p_noOfIndices);
+			for (size_t i = 0; i < p_noOfIndices; ++i)
+			{
+				p_mesh.indices16[i] = static_cast<uint16_t>(p_indices[i]);
+			}
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+// Vertex formats understood by sphere.vs (uniform uVertexFormat)
+enum class VertexFormat : int
+{
+	Float = 0,				// 3 float position, 3 float normal, 2 float uv (32 bytes)
+	Quantized = 1,			// unorm16 position, octahedral snorm16 normal, unorm16 uv (16 bytes)
+	QuantizedNoNormal = 2,	// unorm16 position, unorm16 uv, normal == position (12 bytes)
+	Procedural = 3,			// no vertex buffer, unit sphere grid vertex computed from gl_VertexID (sphere_procedural.vs)
+	PlanetPatch = 4			// Planet patch: float position, normal and uv, then position and normal on the parent (56 bytes)
+};
+
+// Compact copy of an interleaved pos/normal/uv float mesh
+struct QuantizedMesh
+{
+	VertexFormat format = VertexFormat::Quantized;
+	unsigned int stride = 0;
+	unsigned int normalOffset = 0;
+	unsigned int texCoordOffset = 0;
+	size_t noOfVertices = 0;
+	std::vector<uint8_t> vertices;
+
+	// position = positionMin + quantized * positionExtent
+	glm::vec3 positionMin = glm::vec3(0.0f);
+	glm::vec3 positionExtent = glm::vec3(1.0f);
+
+	// filled instead of the 32 bit indices when every index fits into 16 bits
+	std::vector<uint16_t> indices16;
+};
+
+namespace VertexQuantizer
+{
+	// Quantizes the float vertices (8 floats per vertex). Fails if a texture coordinate lies
+	// outside [0, 1], since unorm16 cannot hold it; the caller then keeps the float layout.
+	bool Quantize(const float* p_vertices, size_t p_noOfVertices, const unsigned int* p_indices, size_t p_noOfIndices, QuantizedMesh& p_mesh);
+
+	// Octahedral normal encoding into two snorm16 values and back
+	void OctEncode(const glm::vec3& p_normal, int16_t* p_encoded);
+	glm::vec3 OctDecode(const int16_t* p_encoded);
+}
\ No newline at end of file
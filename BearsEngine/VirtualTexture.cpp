@@ -0,0 +1,600 @@
+#include "VirtualTexture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "glad/glad.h"
+
+#include "JpegDecoder.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "ResidencyManager.h"
+#include "Shader.h"
+#include "ThreadPool.h"
+#include "stb_image.h"
+
+namespace
+{
+	constexpr unsigned int NO_SLOT = UINT32_MAX;
+	// slot coordinates are stored in 8 bit channels of the indirection texture
+	constexpr unsigned int MAX_SLOTS_PER_SIDE = 256;
+
+	// Texels of a page with its border out of a level, wrapping in x and clamped in y
+	void _gatherPage(const MipLevel& p_level, uint32_t p_pageX, uint32_t p_pageY, unsigned char* p_out)
+	{
+		const int stride = VirtualTexture::PAGE_SIZE + 2 * VirtualTexture::PAGE_BORDER;
+		const int left = static_cast<int>(p_pageX * VirtualTexture::PAGE_SIZE) - static_cast<int>(VirtualTexture::PAGE_BORDER);
+		const int top = static_cast<int>(p_pageY * VirtualTexture::PAGE_SIZE) - static_cast<int>(VirtualTexture::PAGE_BORDER);
+		for (int y = 0; y < stride; ++y)
+		{
+			const int sourceY = std::clamp(top + y, 0, p_level.height - 1);
+			const unsigned char* row = p_level.texels.data() + static_cast<size_t>(sourceY) * p_level.width * 3;
+			for (int x = 0; x < stride; ++x, p_out += 3)
+			{
+				const int sourceX = ((left + x) % p_level.width + p_level.width) % p_level.width;
+				memcpy(p_out, row + sourceX * 3, 3);
+			}
+		}
+	}
+}
+
+VirtualTexture::VirtualTexture(const char* p_pageFilePath, const VirtualTextureOptions& p_options)
+	: m_file(p_pageFilePath), m_options(p_options)
+{
+	if (!m_file.IsOpen() || m_file.Size() < sizeof(VirtualTextureHeader))
+	{
+		std::cout << "Cannot open page file " << p_pageFilePath << std::endl;
+		return;
+	}
+	memcpy(&m_header, m_file.Data(), sizeof(m_header));
+
+	const bool valid = m_header.magic == VirtualTextureHeader::MAGIC && m_header.version == VirtualTextureHeader::VERSION && m_header.pageSize != 0 &&
+		m_header.width % m_header.pageSize == 0 && m_header.height % m_header.pageSize == 0 && m_header.levels != 0 && m_header.levels <= 16 && m_header.format <= 4;
+	if (!valid || _pagesX(m_header.levels - 1) == 0 || _pagesY(m_header.levels - 1) == 0)
+	{
+		std::cout << "Invalid page file " << p_pageFilePath << std::endl;
+		return;
+	}
+
+	uint32_t noOfPages = 0;
+	for (uint32_t level = 0; level < m_header.levels; ++level)
+	{
+		m_levelFirstPage.push_back(noOfPages);
+		noOfPages += _pagesX(level) * _pagesY(level);
+	}
+	if (m_file.Size() < sizeof(VirtualTextureHeader) + noOfPages * m_header.pageBytes)
+	{
+		std::cout << "Truncated page file " << p_pageFilePath << std::endl;
+		return;
+	}
+	m_slotOfPage.assign(noOfPages, NO_SLOT);
+
+	// as many slots as the budget pays for, at least the pinned coarsest level and one more
+	const unsigned int stride = m_header.pageSize + 2 * m_header.border;
+	int maxTextureSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	const unsigned int slotsPerSide = std::min(MAX_SLOTS_PER_SIDE, static_cast<unsigned int>(maxTextureSize) / stride);
+	const size_t pinnedPages = static_cast<size_t>(_pagesX(m_header.levels - 1)) * _pagesY(m_header.levels - 1);
+	const size_t noOfSlots = std::clamp<size_t>(m_options.cacheBytes / m_header.pageBytes, pinnedPages + 1, static_cast<size_t>(slotsPerSide) * slotsPerSide);
+	m_slotsX = std::min(slotsPerSide, static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<double>(noOfSlots)))));
+	m_slotsY = static_cast<unsigned int>((noOfSlots + m_slotsX - 1) / m_slotsX);
+	m_slots.resize(static_cast<size_t>(m_slotsX) * m_slotsY);
+
+	if (m_header.format != 0)
+	{
+		m_compressedFormat = BlockCompressor::GlFormat(static_cast<BlockFormat>(m_header.format - 1));
+	}
+
+	glGenTextures(1, &m_physicalTexture);
+	glBindTexture(GL_TEXTURE_2D, m_physicalTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	while (glGetError() != GL_NO_ERROR)
+	{
+	}
+	const int physicalWidth = m_slotsX * stride;
+	const int physicalHeight = m_slotsY * stride;
+	if (m_compressedFormat)
+	{
+		const size_t bytes = BlockCompressor::CompressedSize(static_cast<BlockFormat>(m_header.format - 1), physicalWidth, physicalHeight);
+		glCompressedTexImage2D(GL_TEXTURE_2D, 0, m_compressedFormat, physicalWidth, physicalHeight, 0, static_cast<GLsizei>(bytes), nullptr);
+	}
+	else
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, physicalWidth, physicalHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+	}
+	if (glGetError() != GL_NO_ERROR)
+	{
+		std::cout << "The page format of " << p_pageFilePath << " is not supported" << std::endl;
+		glDeleteTextures(1, &m_physicalTexture);
+		m_physicalTexture = 0;
+		return;
+	}
+
+	glGenTextures(1, &m_indirectionTexture);
+	glBindTexture(GL_TEXTURE_2D, m_indirectionTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_header.levels - 1);
+	m_indirection.resize(m_header.levels);
+	for (uint32_t level = 0; level < m_header.levels; ++level)
+	{
+		m_indirection[level].resize(static_cast<size_t>(_pagesX(level)) * _pagesY(level));
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, _pagesX(level), _pagesY(level), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+
+	// the coarsest level is the fallback of every page, read right away and kept
+	const uint32_t top = m_header.levels - 1;
+	for (uint32_t page = m_levelFirstPage[top]; page < noOfPages; ++page)
+	{
+		const unsigned int slot = _takeSlot();
+		_upload(slot, reinterpret_cast<const unsigned char*>(m_file.Data()) + sizeof(VirtualTextureHeader) + page * m_header.pageBytes);
+		m_slots[slot] = Slot{ page, 0, true };
+		m_slotOfPage[page] = slot;
+		++m_residentPages;
+	}
+	_updateIndirection();
+	ResidencyManager::Shared().Track(this, CacheBytes() + static_cast<size_t>(_pagesX(0)) * _pagesY(0) * 4 * 4 / 3);
+
+	m_loader = std::thread(&VirtualTexture::_loaderLoop, this);
+}
+
+VirtualTexture::~VirtualTexture()
+{
+	if (m_loader.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_condition.notify_one();
+		m_loader.join();
+	}
+
+	ResidencyManager::Shared().Untrack(this);
+	glDeleteTextures(1, &m_physicalTexture);
+	glDeleteTextures(1, &m_indirectionTexture);
+	if (m_feedbackFBO)
+	{
+		glDeleteFramebuffers(1, &m_feedbackFBO);
+		glDeleteRenderbuffers(1, &m_feedbackColor);
+		glDeleteRenderbuffers(1, &m_feedbackDepth);
+		glDeleteBuffers(2, m_feedbackPBOs);
+	}
+}
+
+uint32_t VirtualTexture::_page(uint32_t p_level, uint32_t p_x, uint32_t p_y) const
+{
+	return m_levelFirstPage[p_level] + p_y * _pagesX(p_level) + p_x;
+}
+
+void VirtualTexture::_pageCoordinates(uint32_t p_page, uint32_t& p_level, uint32_t& p_x, uint32_t& p_y) const
+{
+	p_level = static_cast<uint32_t>(std::upper_bound(m_levelFirstPage.begin(), m_levelFirstPage.end(), p_page) - m_levelFirstPage.begin()) - 1;
+	const uint32_t index = p_page - m_levelFirstPage[p_level];
+	p_x = index % _pagesX(p_level);
+	p_y = index / _pagesX(p_level);
+}
+
+void VirtualTexture::Bind(Shader& p_shader, bool p_feedback) const
+{
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, m_physicalTexture);
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, m_indirectionTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	const float stride = static_cast<float>(m_header.pageSize + 2 * m_header.border);
+	p_shader.Use();
+	p_shader.SetInt("uPhysical", 1);
+	p_shader.SetInt("uIndirection", 2);
+	p_shader.SetVec2("uPages", static_cast<float>(_pagesX(0)), static_cast<float>(_pagesY(0)));
+	p_shader.SetFloat("uPageSize", static_cast<float>(m_header.pageSize));
+	p_shader.SetFloat("uBorder", static_cast<float>(m_header.border));
+	p_shader.SetVec2("uPhysicalSize", m_slotsX * stride, m_slotsY * stride);
+	p_shader.SetFloat("uMaxLevel", static_cast<float>(m_header.levels - 1));
+	// the feedback pass is smaller, so its derivatives are larger by the divisor
+	p_shader.SetFloat("uLodBias", p_feedback ? -std::log2(static_cast<float>(m_options.feedbackDivisor)) : 0.0f);
+}
+
+void VirtualTexture::BeginFeedback(int p_viewportWidth, int p_viewportHeight)
+{
+	m_viewportWidth = p_viewportWidth;
+	m_viewportHeight = p_viewportHeight;
+	const int width = std::max(1, p_viewportWidth / static_cast<int>(m_options.feedbackDivisor));
+	const int height = std::max(1, p_viewportHeight / static_cast<int>(m_options.feedbackDivisor));
+
+	if (!m_feedbackFBO)
+	{
+		glGenFramebuffers(1, &m_feedbackFBO);
+		glGenRenderbuffers(1, &m_feedbackColor);
+		glGenRenderbuffers(1, &m_feedbackDepth);
+		glGenBuffers(2, m_feedbackPBOs);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, m_feedbackFBO);
+	if (width != m_feedbackWidth || height != m_feedbackHeight)
+	{
+		glBindRenderbuffer(GL_RENDERBUFFER, m_feedbackColor);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, m_feedbackDepth);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_feedbackColor);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_feedbackDepth);
+		m_feedbackWidth = width;
+		m_feedbackHeight = height;
+		// readbacks in flight have the old size
+		m_feedbackPixels[0] = m_feedbackPixels[1] = 0;
+	}
+
+	glViewport(0, 0, width, height);
+	// alpha 0 marks pixels without a page
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void VirtualTexture::EndFeedback()
+{
+	++m_frame;
+
+	// this frame's feedback goes into one buffer while the other, a frame old, is read
+	const unsigned int current = m_frame & 1;
+	const size_t noOfPixels = static_cast<size_t>(m_feedbackWidth) * m_feedbackHeight;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_feedbackPBOs[current]);
+	glBufferData(GL_PIXEL_PACK_BUFFER, noOfPixels * 4, nullptr, GL_STREAM_READ);
+	glReadPixels(0, 0, m_feedbackWidth, m_feedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	m_feedbackPixels[current] = noOfPixels;
+
+	const unsigned int previous = current ^ 1;
+	if (m_feedbackPixels[previous])
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_feedbackPBOs[previous]);
+		const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, m_feedbackPixels[previous] * 4, GL_MAP_READ_BIT);
+		if (pixels)
+		{
+			_readFeedback(static_cast<const unsigned char*>(pixels), m_feedbackPixels[previous]);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+}
+
+void VirtualTexture::_readFeedback(const unsigned char* p_pixels, size_t p_noOfPixels)
+{
+	// pixels per page, each page adding to its ancestors so they are loaded as fallbacks
+	std::unordered_map<uint32_t, float> coverage;
+	const uint32_t top = m_header.levels - 1;
+	for (size_t i = 0; i < p_noOfPixels; ++i)
+	{
+		const unsigned char* pixel = p_pixels + i * 4;
+		if (pixel[3] == 0)
+		{
+			continue;
+		}
+		const uint32_t level = pixel[3] - 1u;
+		const uint32_t x = pixel[0] | (pixel[2] & 15u) << 8;
+		const uint32_t y = pixel[1] | (pixel[2] >> 4) << 8;
+		if (level > top || x >= _pagesX(level) || y >= _pagesY(level))
+		{
+			continue;
+		}
+		for (uint32_t ancestor = level; ancestor <= top; ++ancestor)
+		{
+			coverage[_page(ancestor, x >> (ancestor - level), y >> (ancestor - level))] += 1.0f;
+		}
+	}
+	m_wanted = coverage.size();
+
+	// coarse levels first, then the pages covering most of the screen
+	std::vector<PageRequest> requests;
+	requests.reserve(coverage.size());
+	for (const auto& [page, pixels] : coverage)
+	{
+		uint32_t level, x, y;
+		_pageCoordinates(page, level, x, y);
+		requests.push_back(PageRequest{ page, -static_cast<float>(level) - pixels / (p_noOfPixels + 1.0f) });
+	}
+	std::sort(requests.begin(), requests.end(), [](const PageRequest& p_a, const PageRequest& p_b) { return p_a.priority < p_b.priority; });
+
+	// more pages than slots would only evict each other
+	size_t capacity = m_slots.size();
+	std::vector<PageRequest> pending;
+	for (const PageRequest& request : requests)
+	{
+		if (capacity == 0)
+		{
+			break;
+		}
+		--capacity;
+
+		const uint32_t slot = m_slotOfPage[request.page];
+		if (slot != NO_SLOT)
+		{
+			m_slots[slot].lastFrame = m_frame;
+		}
+		else
+		{
+			pending.push_back(request);
+		}
+	}
+	std::reverse(pending.begin(), pending.end());
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::unordered_set<uint32_t> inFlight;
+		for (const Loaded& loaded : m_loaded)
+		{
+			inFlight.insert(loaded.page);
+		}
+		inFlight.insert(m_loading);
+		pending.erase(std::remove_if(pending.begin(), pending.end(), [&inFlight](const PageRequest& p_request) { return inFlight.count(p_request.page) != 0; }), pending.end());
+		m_pending.swap(pending);
+	}
+	m_condition.notify_one();
+}
+
+void VirtualTexture::_loaderLoop()
+{
+	for (;;)
+	{
+		Loaded page;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_loading = UINT32_MAX;
+			m_condition.wait(lock, [this] { return m_stopping || !m_pending.empty(); });
+			if (m_stopping)
+			{
+				return;
+			}
+			page.page = m_pending.back().page;
+			m_pending.pop_back();
+			m_loading = page.page;
+		}
+
+		// copying out of the mapping is where the page is actually read from disk
+		const char* data = m_file.Data() + sizeof(VirtualTextureHeader) + page.page * m_header.pageBytes;
+		page.data.assign(data, data + m_header.pageBytes);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_loaded.push_back(std::move(page));
+	}
+}
+
+size_t VirtualTexture::PendingPages()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pending.size() + m_loaded.size() + (m_loading != UINT32_MAX ? 1 : 0);
+}
+
+unsigned int VirtualTexture::_takeSlot()
+{
+	unsigned int oldest = NO_SLOT;
+	for (unsigned int i = 0; i < m_slots.size(); ++i)
+	{
+		const Slot& slot = m_slots[i];
+		if (slot.page == UINT32_MAX)
+		{
+			return i;
+		}
+		if (!slot.pinned && slot.lastFrame < m_frame && (oldest == NO_SLOT || slot.lastFrame < m_slots[oldest].lastFrame))
+		{
+			oldest = i;
+		}
+	}
+
+	if (oldest != NO_SLOT)
+	{
+		m_slotOfPage[m_slots[oldest].page] = NO_SLOT;
+		m_slots[oldest].page = UINT32_MAX;
+		--m_residentPages;
+		m_indirectionDirty = true;
+	}
+	return oldest;
+}
+
+void VirtualTexture::_upload(unsigned int p_slot, const unsigned char* p_data)
+{
+	const int stride = m_header.pageSize + 2 * m_header.border;
+	const int x = (p_slot % m_slotsX) * stride;
+	const int y = (p_slot / m_slotsX) * stride;
+
+	glBindTexture(GL_TEXTURE_2D, m_physicalTexture);
+	if (m_compressedFormat)
+	{
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, x, y, stride, stride, m_compressedFormat, static_cast<GLsizei>(m_header.pageBytes), p_data);
+	}
+	else
+	{
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, stride, stride, GL_RGB, GL_UNSIGNED_BYTE, p_data);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+}
+
+void VirtualTexture::Update()
+{
+	if (!IsOpen())
+	{
+		return;
+	}
+
+	std::vector<Loaded> loaded;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const size_t count = std::min<size_t>(m_loaded.size(), m_options.uploadsPerFrame);
+		loaded.assign(std::make_move_iterator(m_loaded.begin()), std::make_move_iterator(m_loaded.begin() + count));
+		m_loaded.erase(m_loaded.begin(), m_loaded.begin() + count);
+	}
+
+	for (const Loaded& page : loaded)
+	{
+		if (m_slotOfPage[page.page] != NO_SLOT)
+		{
+			continue;
+		}
+		// every slot is in use by this frame; the page is asked for again if it is still needed
+		const unsigned int slot = _takeSlot();
+		if (slot == NO_SLOT)
+		{
+			break;
+		}
+		_upload(slot, page.data.data());
+		m_slots[slot] = Slot{ page.page, m_frame, false };
+		m_slotOfPage[page.page] = slot;
+		++m_residentPages;
+		m_indirectionDirty = true;
+	}
+
+	if (m_indirectionDirty)
+	{
+		_updateIndirection();
+	}
+}
+
+void VirtualTexture::_updateIndirection()
+{
+	m_indirectionDirty = false;
+	glBindTexture(GL_TEXTURE_2D, m_indirectionTexture);
+
+	// from the coarsest level down, a missing page inherits the entry of its parent
+	for (int level = static_cast<int>(m_header.levels) - 1; level >= 0; --level)
+	{
+		const uint32_t pagesX = _pagesX(level);
+		const uint32_t pagesY = _pagesY(level);
+		std::vector<uint32_t>& entries = m_indirection[level];
+		for (uint32_t y = 0; y < pagesY; ++y)
+		{
+			for (uint32_t x = 0; x < pagesX; ++x)
+			{
+				const uint32_t slot = m_slotOfPage[_page(level, x, y)];
+				if (slot != NO_SLOT)
+				{
+					entries[y * pagesX + x] = (slot % m_slotsX) | (slot / m_slotsX) << 8 | static_cast<uint32_t>(level) << 16 | 0xFF000000u;
+				}
+				else
+				{
+					entries[y * pagesX + x] = m_indirection[level + 1][(y / 2) * _pagesX(level + 1) + x / 2];
+				}
+			}
+		}
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, pagesX, pagesY, GL_RGBA, GL_UNSIGNED_BYTE, entries.data());
+	}
+}
+
+bool VirtualTexture::BuildPageFile(const char* p_imagePath, const char* p_pageFilePath, bool p_compress, BlockFormat p_format)
+{
+	int width = 0, height = 0;
+	std::vector<unsigned char> texels;
+	{
+		MappedFile image(p_imagePath);
+		if (image.IsOpen() && !JpegDecoder::Decode(reinterpret_cast<const unsigned char*>(image.Data()), image.Size(), 3, width, height, texels))
+		{
+			int nrChannels;
+			unsigned char* decoded = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(image.Data()), static_cast<int>(image.Size()), &width, &height, &nrChannels, 3);
+			if (decoded)
+			{
+				texels.assign(decoded, decoded + static_cast<size_t>(width) * height * 3);
+				stbi_image_free(decoded);
+			}
+		}
+	}
+	if (texels.empty())
+	{
+		std::cout << "Cannot load " << p_imagePath << std::endl;
+		return false;
+	}
+	if (width % PAGE_SIZE != 0 || height % PAGE_SIZE != 0)
+	{
+		std::cout << "The sides of " << p_imagePath << " have to be multiples of " << PAGE_SIZE << std::endl;
+		return false;
+	}
+
+	std::vector<MipLevel> levels;
+	levels.push_back(MipLevel{ width, height, std::move(texels) });
+
+	// down to the last level that still consists of whole pages
+	while ((levels.back().width / 2) % PAGE_SIZE == 0 && (levels.back().height / 2) % PAGE_SIZE == 0 && levels.back().height / 2 >= static_cast<int>(PAGE_SIZE))
+	{
+		MipLevel level = MipGenerator::Downsample(levels.back(), 3, MipOptions());
+		levels.push_back(std::move(level));
+	}
+
+	const int stride = PAGE_SIZE + 2 * PAGE_BORDER;
+	VirtualTextureHeader header = {};
+	header.magic = VirtualTextureHeader::MAGIC;
+	header.version = VirtualTextureHeader::VERSION;
+	header.width = width;
+	header.height = height;
+	header.pageSize = PAGE_SIZE;
+	header.border = PAGE_BORDER;
+	header.levels = static_cast<uint32_t>(levels.size());
+	header.format = p_compress ? static_cast<uint32_t>(p_format) + 1 : 0;
+	header.pageBytes = p_compress ? BlockCompressor::CompressedSize(p_format, stride, stride) : static_cast<uint64_t>(stride) * stride * 3;
+
+	// write to a temporary file first so a crash never leaves a half written page file behind
+	std::string temporaryPath = std::string(p_pageFilePath) + ".tmp";
+	size_t noOfPages = 0;
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cout << "Cannot write " << p_pageFilePath << std::endl;
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		// one row of pages at a time, its pages cut and compressed in parallel
+		for (const MipLevel& level : levels)
+		{
+			const uint32_t pagesX = level.width / PAGE_SIZE;
+			const uint32_t pagesY = level.height / PAGE_SIZE;
+			std::vector<unsigned char> row(pagesX * header.pageBytes);
+			for (uint32_t y = 0; y < pagesY; ++y)
+			{
+				ThreadPool::Shared().ParallelFor(pagesX, [&](size_t p_x)
+				{
+					unsigned char* out = row.data() + p_x * header.pageBytes;
+					if (!p_compress)
+					{
+						_gatherPage(level, static_cast<uint32_t>(p_x), y, out);
+						return;
+					}
+					std::vector<unsigned char> page(static_cast<size_t>(stride) * stride * 3);
+					_gatherPage(level, static_cast<uint32_t>(p_x), y, page.data());
+					BlockCompressor::Compress(p_format, page.data(), stride, stride, 3, out);
+				});
+				file.write(reinterpret_cast<const char*>(row.data()), row.size());
+			}
+			noOfPages += static_cast<size_t>(pagesX) * pagesY;
+		}
+
+		if (!file.good())
+		{
+			file.close();
+			std::remove(temporaryPath.c_str());
+			std::cout << "Cannot write " << p_pageFilePath << std::endl;
+			return false;
+		}
+	}
+
+	std::remove(p_pageFilePath);
+	if (std::rename(temporaryPath.c_str(), p_pageFilePath) != 0)
+	{
+		return false;
+	}
+	std::cout << noOfPages << " pages in " << levels.size() << " levels, " << noOfPages * header.pageBytes / (1024.0 * 1024.0) << " MB" << std::endl;
+	return true;
+}
\ No newline at end of file
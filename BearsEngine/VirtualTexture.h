@@ -0,0 +1,177 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BlockCompressor.h"
+#include "MappedFile.h"
+
+class Shader;
+
+// Header of a page file. The pages follow it without gaps: level 0 row by row, then level 1
+// and so on, every page pageBytes long.
+struct VirtualTextureHeader
+{
+	static constexpr uint32_t MAGIC = 0x58545642; // "BVTX"
+	static constexpr uint32_t VERSION = 1;
+
+	uint32_t magic;
+	uint32_t version;
+	// texels of level 0, multiples of pageSize
+	uint32_t width;
+	uint32_t height;
+	// texels of a page without its border, and border texels on each side
+	uint32_t pageSize;
+	uint32_t border;
+	uint32_t levels;
+	// 0 for RGB8, otherwise BlockFormat + 1
+	uint32_t format;
+	uint64_t pageBytes;
+};
+
+struct VirtualTextureOptions
+{
+	// memory of the physical page cache texture; the number of page slots follows from it
+	size_t cacheBytes = 32 * 1024 * 1024;
+	// pages copied into the cache per Update, to keep the frame time flat
+	unsigned int uploadsPerFrame = 8;
+	// the feedback pass renders at the viewport size divided by this
+	unsigned int feedbackDivisor = 8;
+};
+
+// Texture far larger than GL_MAX_TEXTURE_SIZE, equirectangular like earth.jpg, streamed in
+// pages. The page file holds the mip pyramid cut into pages with a border copied from their
+// neighbours (wrapping around the longitude seam), so bilinear filtering never needs a second page.
+//
+// Only the pages in use sit in the physical cache, one texture of page slots sized to a fixed
+// budget. The indirection texture has one texel per page and a mip level per pyramid level;
+// a texel names the slot of the page, or of its finest resident ancestor until the page
+// itself has arrived. sphere_vt.fs looks pages up through it.
+//
+// Which pages are in use comes from a feedback pass: the scene drawn small with
+// sphere_vt_feedback.fs, which writes the page each pixel needs. It is read back a frame late
+// through pixel buffers, so it never stalls. Missing pages and their ancestors are read on a
+// loader thread, coarse levels first, and Update copies a few of them per frame into the least
+// recently used slots. The pages of the coarsest level are loaded up front and never evicted.
+// All calls belong to the GL thread.
+class VirtualTexture
+{
+public:
+	static constexpr uint32_t PAGE_SIZE = 128;
+	// 4 keeps the page content on the block grid of compressed formats
+	static constexpr uint32_t PAGE_BORDER = 4;
+
+	VirtualTexture(const char* p_pageFilePath, const VirtualTextureOptions& p_options = VirtualTextureOptions());
+	~VirtualTexture();
+
+	VirtualTexture(const VirtualTexture&) = delete;
+	VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+	bool IsOpen() const { return m_physicalTexture != 0; }
+
+	// Binds the physical cache and the indirection texture to units 1 and 2 and sets the
+	// uniforms of sphere_vt.fs, or of sphere_vt_feedback.fs for the feedback pass
+	void Bind(Shader& p_shader, bool p_feedback) const;
+
+	// Binds and clears the feedback framebuffer; the scene is drawn next with the feedback shader
+	void BeginFeedback(int p_viewportWidth, int p_viewportHeight);
+	// Starts reading back this frame's feedback, requests the pages the previous one asked for
+	// and restores the default framebuffer and viewport
+	void EndFeedback();
+
+	// Moves loaded pages into the cache, at most uploadsPerFrame, and updates the indirection
+	void Update();
+
+	size_t ResidentPages() const { return m_residentPages; }
+	size_t CachePages() const { return m_slots.size(); }
+	size_t CacheBytes() const { return m_slots.size() * m_header.pageBytes; }
+	size_t PendingPages();
+	// pages the last feedback asked for, ancestors included
+	size_t WantedPages() const { return m_wanted; }
+
+	// Cuts an image, any size stb_image reads with both sides multiples of PAGE_SIZE, into a
+	// page file. RGB8 pages without p_compress, otherwise blocks of p_format.
+	static bool BuildPageFile(const char* p_imagePath, const char* p_pageFilePath, bool p_compress, BlockFormat p_format);
+
+private:
+	struct Slot
+	{
+		uint32_t page = UINT32_MAX;
+		unsigned int lastFrame = 0;
+		bool pinned = false;
+	};
+
+	struct PageRequest
+	{
+		uint32_t page;
+		// lower values are loaded first
+		float priority;
+	};
+
+	struct Loaded
+	{
+		uint32_t page;
+		std::vector<unsigned char> data;
+	};
+
+	// Page index within the file and back
+	uint32_t _page(uint32_t p_level, uint32_t p_x, uint32_t p_y) const;
+	void _pageCoordinates(uint32_t p_page, uint32_t& p_level, uint32_t& p_x, uint32_t& p_y) const;
+	uint32_t _pagesX(uint32_t p_level) const { return (m_header.width / m_header.pageSize) >> p_level; }
+	uint32_t _pagesY(uint32_t p_level) const { return (m_header.height / m_header.pageSize) >> p_level; }
+
+	void _upload(unsigned int p_slot, const unsigned char* p_data);
+	// Slot for a new page: a free one, else the least recently used one not needed this frame
+	unsigned int _takeSlot();
+	void _readFeedback(const unsigned char* p_pixels, size_t p_noOfPixels);
+	void _updateIndirection();
+
+	void _loaderLoop();
+
+	MappedFile m_file;
+	VirtualTextureHeader m_header = {};
+	VirtualTextureOptions m_options;
+	std::vector<uint32_t> m_levelFirstPage;
+
+	unsigned int m_physicalTexture = 0;
+	unsigned int m_indirectionTexture = 0;
+	unsigned int m_slotsX = 0;
+	unsigned int m_slotsY = 0;
+	// internal format of the physical cache, 0 for RGB8
+	unsigned int m_compressedFormat = 0;
+
+	// render thread only
+	std::vector<Slot> m_slots;
+	// slot of every page of the file, UINT32_MAX while it is not resident
+	std::vector<uint32_t> m_slotOfPage;
+	size_t m_residentPages = 0;
+	unsigned int m_frame = 0;
+	bool m_indirectionDirty = true;
+	// RGBA8 texels of every indirection level: slot x, slot y, resident level
+	std::vector<std::vector<uint32_t>> m_indirection;
+	size_t m_wanted = 0;
+
+	// feedback framebuffer and the two pixel buffers it is read back through
+	unsigned int m_feedbackFBO = 0;
+	unsigned int m_feedbackColor = 0;
+	unsigned int m_feedbackDepth = 0;
+	unsigned int m_feedbackPBOs[2] = { 0, 0 };
+	size_t m_feedbackPixels[2] = { 0, 0 };
+	int m_feedbackWidth = 0;
+	int m_feedbackHeight = 0;
+	int m_viewportWidth = 0;
+	int m_viewportHeight = 0;
+
+	// shared with the loader; m_pending is sorted by descending priority and read from the back
+	std::thread m_loader;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::vector<PageRequest> m_pending;
+	std::vector<Loaded> m_loaded;
+	uint32_t m_loading = UINT32_MAX;
+	bool m_stopping = false;
+};
\ No newline at end of file
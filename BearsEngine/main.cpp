@@ -4,11 +4,23 @@
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <memory>
 
 #include "Shader.h"
 #include "Mesh.h"
+#include "Planet.h"
+#include "ResidencyManager.h"
+#include "ResourceManager.h"
+#include "TextureLoader.h"
+#include "VirtualTexture.h"
 #include "Camera.h"
+#include "ElevationCache.h"
+#include "Benchmark.h"
+#include "JpegDecoder.h"
 #include "imgui/imgui.h"
 #include "imgui/backends/imgui_impl_glfw.h"
 #include "imgui/backends/imgui_impl_opengl3.h"
@@ -19,8 +31,71 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 const unsigned int SCR_WIDTH = 1200;
 const unsigned int SCR_HEIGHT = 900;
 
+// Bytes of finished mesh loads copied to the GPU per frame
+const size_t UPLOAD_BUDGET = 4 * 1024 * 1024;
+// Bytes of decoded texture levels copied to the GPU per frame
+const size_t TEXTURE_UPLOAD_BUDGET = 2 * 1024 * 1024;
+// GPU memory for textures, meshes and pools before the least recently drawn are evicted
+const size_t VRAM_BUDGET = 256 * 1024 * 1024;
+
 int main(int argc, char* argv[])
 {
+	if (argc > 1 && std::strcmp(argv[1], "--bench") == 0)
+	{
+		return Benchmark::Run(argc, argv);
+	}
+
+	// --elevation <16 bit heightmap> <pyramid directory> [lowest height] [highest height], in meters
+	if (argc > 3 && std::strcmp(argv[1], "--elevation") == 0)
+	{
+		const float minHeight = argc > 4 ? static_cast<float>(std::atof(argv[4])) : -11000.0f;
+		const float maxHeight = argc > 5 ? static_cast<float>(std::atof(argv[5])) : 9000.0f;
+		return ElevationCache::BuildPyramid(argv[2], argv[3], 0, minHeight, maxHeight) ? 0 : 1;
+	}
+
+	// --compress <image> [bc1|bc3|bc7|etc2], writes the KTX2 cache TextureLoader reads
+	if (argc > 2 && std::strcmp(argv[1], "--compress") == 0)
+	{
+		BlockFormat format = BlockFormat::BC7;
+		if (argc > 3 && !BlockCompressor::FromName(argv[3], format))
+		{
+			std::cout << "Unknown block format " << argv[3] << std::endl;
+			return 1;
+		}
+		return TextureLoader::BuildCache(argv[2], format) ? 0 : 1;
+	}
+
+	// --cubemap <image> [bc1|bc3|bc7|etc2], reprojects an equirectangular image to the cube map cache TextureLoader::LoadCube reads
+	if (argc > 2 && std::strcmp(argv[1], "--cubemap") == 0)
+	{
+		BlockFormat format = BlockFormat::BC7;
+		if (argc > 3 && !BlockCompressor::FromName(argv[3], format))
+		{
+			std::cout << "Unknown block format " << argv[3] << std::endl;
+			return 1;
+		}
+		return TextureLoader::BuildCache(argv[2], format, MipOptions(), true) ? 0 : 1;
+	}
+
+	// --vtex <image> <page file> [rgb|bc1|bc3|bc7|etc2], cuts an image into the pages VirtualTexture streams
+	if (argc > 3 && std::strcmp(argv[1], "--vtex") == 0)
+	{
+		BlockFormat format = BlockFormat::BC1;
+		const bool compress = argc <= 4 || std::strcmp(argv[4], "rgb") != 0;
+		if (compress && argc > 4 && !BlockCompressor::FromName(argv[4], format))
+		{
+			std::cout << "Unknown block format " << argv[4] << std::endl;
+			return 1;
+		}
+		return VirtualTexture::BuildPageFile(argv[2], argv[3], compress, format) ? 0 : 1;
+	}
+
+	// --jpeg-restart <image> <output> [MCUs per interval], so the JPEG decodes in parallel; by default every MCU row
+	if (argc > 3 && std::strcmp(argv[1], "--jpeg-restart") == 0)
+	{
+		return JpegDecoder::RestartFile(argv[2], argv[3], argc > 4 ? std::atoi(argv[4]) : 0) ? 0 : 1;
+	}
+
 	if (!glfwInit())
 	{
 		std::cout << "init fail on GLFW." << std::endl;
@@ -67,118 +142,274 @@ int main(int argc, char* argv[])
 		return -3;
 	}
 
-	// Camera
-	Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
-
-	// Lighting
-	glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
-
-	// Sphere shader
-	Shader lightingShader("ShaderCode\\sphere.vs", "ShaderCode\\sphere.fs");
-	lightingShader.Use();
-
-	// Spherical mesh grid
-	//MeshGrid firstSphere = MeshGrid("vertices.txt", "triangles.txt", "Textures\\earth.jpg");
-	MeshGrid firstSphere = MeshGrid(50, 50, "Textures\\earth.jpg");
+	ResidencyManager::Shared().SetBudget(VRAM_BUDGET);
 
-	// Prospective projection handling
-	float zNear = 0.1f;
-	float zFar = 100.0f;
-	const float aspectRatio = (float)SCR_WIDTH / (float)SCR_HEIGHT;
-
-	// Don't render "rear" faces
-	glEnable(GL_CULL_FACE);
-	glFrontFace(GL_CCW);
-
-	// Frametime
-	float deltaTime = 0.0f;
-	float lastFrame = 0.0f;
-
-	// Rotation
-	float theta_Y_in_degree = 0.0f;
-
-	while (!glfwWindowShouldClose(m_mainWindow))
+	// Everything owning GL objects lives in this block, so it is gone before the context
 	{
-
-		float currentFrame = static_cast<float>(glfwGetTime());
-		deltaTime = currentFrame - lastFrame;
-		lastFrame = currentFrame;
-
-		ImGui_ImplOpenGL3_NewFrame();
-		ImGui_ImplGlfw_NewFrame();
-		ImGui::NewFrame();
-
-		ImGui::Begin("Control");
-		ImGui::Text("Camera Control");
-
-		if (ImGui::Button("Forward"))
-		{
-			camera.ProcessKeyboard(FORWARD, deltaTime);
-		}
-
-		if (ImGui::Button("Back"))
-		{
-			camera.ProcessKeyboard(BACKWARD, deltaTime);
-		}
-
-		if (ImGui::Button("Left"))
+		// Camera
+		Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+
+		// Lighting
+		glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
+
+		// Sphere shader
+		ShaderHandle lightingShader = ResourceManager::Shared().Program("ShaderCode\\sphere.vs", "ShaderCode\\sphere.fs");
+		lightingShader->Use();
+
+		// Spherical mesh grid
+		//MeshGrid firstSphere = MeshGrid("vertices.txt", "triangles.txt", "Textures\\earth.jpg");
+		MeshOptions sphereOptions;
+		sphereOptions.generateLods = true;
+		sphereOptions.buildMeshlets = true;
+		sphereOptions.loadAsync = true;
+		// frequency 12 icosphere: less geometric error than a 50 x 50 UV grid with 58% of its triangles
+		MeshGrid firstSphere = MeshGrid(SphereMesh::Tessellation::Icosphere, 12, "Textures\\earth.jpg", sphereOptions);
+
+		// Same earth as quadtree patches that refine towards the camera, with relief from the
+		// pyramid built by --elevation if there is one
+		PlanetOptions planetOptions;
+		planetOptions.elevationPath = "Textures\\elevation";
+		planetOptions.heightScale = 20.0f;
+		Planet planet("Textures\\earth.jpg", planetOptions);
+		bool drawPlanet = false;
+
+		// Earth imagery beyond the texture size limit, from the page file built by --vtex if there is one
+		const char* pageFilePath = "Textures\\earth.vtex";
+		std::unique_ptr<VirtualTexture> virtualTexture;
+		if (std::filesystem::exists(pageFilePath))
 		{
-			camera.ProcessKeyboard(LEFT, deltaTime);
+			virtualTexture = std::make_unique<VirtualTexture>(pageFilePath);
+			if (!virtualTexture->IsOpen())
+			{
+				virtualTexture.reset();
+			}
 		}
+		ShaderHandle virtualTextureShader = ResourceManager::Shared().Program("ShaderCode\\sphere.vs", "ShaderCode\\sphere_vt.fs");
+		ShaderHandle feedbackShader = ResourceManager::Shared().Program("ShaderCode\\sphere.vs", "ShaderCode\\sphere_vt_feedback.fs");
+		bool drawVirtualTexture = virtualTexture != nullptr;
 
-		if (ImGui::Button("Right"))
-		{
-			camera.ProcessKeyboard(RIGHT, deltaTime);
-		}
-
-		ImGui::Text("Sphere Control");
-		if (ImGui::Button("Rotate counterclockwise"))
-		{
-			theta_Y_in_degree += 5.0f;
-		}
-
-		if (ImGui::Button("Rotate clockwise"))
-		{
-			theta_Y_in_degree -= 5.0f;
-		}
-
-		ImGui::End();
-
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		// Shader properties
-		lightingShader.Use();
-		lightingShader.SetVec3("lightColor", 1.0f, 1.0f, 1.0f);
-		lightingShader.SetVec3("lightPos", lightPos);
-		lightingShader.SetVec3("viewPos", camera.Position);
+		// Same earth reprojected to a cube map and looked up by direction, loaded the first time it is shown
+		ShaderHandle cubeMapShader = ResourceManager::Shared().Program("ShaderCode\\sphere.vs", "ShaderCode\\sphere_cube.fs");
+		std::unique_ptr<MeshGrid> cubeMapSphere;
+		bool drawCubeMap = false;
 
-		// view/prospective projection transformations
-		glm::mat4 projection =
-			glm::perspective(glm::radians(camera.Zoom), aspectRatio, zNear, zFar);
-		glm::mat4 view = camera.GetViewMatrix();
-		lightingShader.SetMat4("projection", projection);
-		lightingShader.SetMat4("view", view);
+		// Prospective projection handling
+		float zNear = 0.1f;
+		float zFar = 100.0f;
+		const float aspectRatio = (float)SCR_WIDTH / (float)SCR_HEIGHT;
 
-		// world transformation
-		glm::mat4 model = glm::mat4(1.0f);
-		model = glm::rotate(model, glm::radians(theta_Y_in_degree), glm::vec3(0.0f, 1.0f, 0.0f));
-		lightingShader.SetMat4("model", model);
-		glm::mat3 model_3 = glm::mat3(model); // get the upper left part
-		model_3 = glm::transpose(glm::inverse(model_3));
-		lightingShader.SetMat3("t_i_model", model_3);
+		// Don't render "rear" faces
+		glEnable(GL_CULL_FACE);
+		glFrontFace(GL_CCW);
 
-		// Rendering
-		firstSphere.Render(lightingShader);
+		// Frametime
+		float deltaTime = 0.0f;
+		float lastFrame = 0.0f;
 
-		ImGui::Render();
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		// Rotation
+		float theta_Y_in_degree = 0.0f;
 
-		glfwSwapBuffers(m_mainWindow);
+		while (!glfwWindowShouldClose(m_mainWindow))
+		{
 
-		glfwPollEvents();
+			float currentFrame = static_cast<float>(glfwGetTime());
+			deltaTime = currentFrame - lastFrame;
+			lastFrame = currentFrame;
+
+			MeshGrid::BeginFrame(UPLOAD_BUDGET);
+			TextureLoader::Shared().Update(TEXTURE_UPLOAD_BUDGET);
+
+			ImGui_ImplOpenGL3_NewFrame();
+			ImGui_ImplGlfw_NewFrame();
+			ImGui::NewFrame();
+
+			ImGui::Begin("Control");
+			ImGui::Text("Camera Control");
+
+			if (ImGui::Button("Forward"))
+			{
+				camera.ProcessKeyboard(FORWARD, deltaTime);
+			}
+
+			if (ImGui::Button("Back"))
+			{
+				camera.ProcessKeyboard(BACKWARD, deltaTime);
+			}
+
+			if (ImGui::Button("Left"))
+			{
+				camera.ProcessKeyboard(LEFT, deltaTime);
+			}
+
+			if (ImGui::Button("Right"))
+			{
+				camera.ProcessKeyboard(RIGHT, deltaTime);
+			}
+
+			ImGui::Text("Sphere Control");
+			if (ImGui::Button("Rotate counterclockwise"))
+			{
+				theta_Y_in_degree += 5.0f;
+			}
+
+			if (ImGui::Button("Rotate clockwise"))
+			{
+				theta_Y_in_degree -= 5.0f;
+			}
+
+			// values of the previous frame
+			ImGui::Checkbox("Quadtree planet", &drawPlanet);
+			if (drawPlanet)
+			{
+				ImGui::Text("%u patches, level %u, %u triangles", planet.DrawnPatches(), planet.DeepestLevel(), planet.RenderedTriangles());
+				ImGui::Text("%zu resident patches, %.1f MB pool", planet.ResidentPatches(), planet.PoolBytes() / (1024.0 * 1024.0));
+				if (planet.Elevation())
+				{
+					ImGui::Text("%zu height tiles, %.1f MB", planet.Elevation()->ResidentTiles(), planet.Elevation()->ResidentBytes() / (1024.0 * 1024.0));
+				}
+			}
+			else
+			{
+				ImGui::Text("LOD %d, %u triangles", static_cast<int>(firstSphere.CurrentLod()), firstSphere.RenderedTriangles());
+				if (!firstSphere.IsLoaded())
+				{
+					ImGui::Text("Loading...");
+				}
+				ImGui::Checkbox("Cube map texture", &drawCubeMap);
+			}
+			if (virtualTexture)
+			{
+				ImGui::Checkbox("Virtual texture", &drawVirtualTexture);
+				if (drawVirtualTexture)
+				{
+					ImGui::Text("%zu / %zu pages, %.1f MB cache", virtualTexture->ResidentPages(), virtualTexture->CachePages(), virtualTexture->CacheBytes() / (1024.0 * 1024.0));
+					ImGui::Text("%zu pages wanted, %zu loading", virtualTexture->WantedPages(), virtualTexture->PendingPages());
+				}
+			}
+			if (TextureLoader::Shared().PendingTextures())
+			{
+				ImGui::Text("Streaming %zu textures", TextureLoader::Shared().PendingTextures());
+			}
+
+			ImGui::End();
+
+			// everything loaded through ResourceManager, textures of the meshes included
+			ImGui::Begin("Resources");
+			const ResidencyManager& residency = ResidencyManager::Shared();
+			ImGui::Text("%.1f of %.1f MB: textures %.1f, meshes %.1f, pools %.1f", residency.Bytes() / (1024.0 * 1024.0), residency.Budget() / (1024.0 * 1024.0),
+				residency.TextureBytes() / (1024.0 * 1024.0), residency.MeshBytes() / (1024.0 * 1024.0), residency.TrackedBytes() / (1024.0 * 1024.0));
+			ImGui::Text("%zu evictions, %zu texture reloads", residency.Evictions(), residency.Reloads());
+			if (ImGui::BeginTable("resources", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable))
+			{
+				ImGui::TableSetupColumn("Type");
+				ImGui::TableSetupColumn("Path and options");
+				ImGui::TableSetupColumn("Handles");
+				ImGui::TableSetupColumn("Resident");
+				ImGui::TableSetupColumn("KB");
+				ImGui::TableHeadersRow();
+				for (const ResourceInfo& resource : ResourceManager::Shared().Resources())
+				{
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::TextUnformatted(resource.type);
+					ImGui::TableNextColumn();
+					ImGui::TextUnformatted(resource.key.c_str());
+					ImGui::TableNextColumn();
+					ImGui::Text("%ld", resource.handles);
+					ImGui::TableNextColumn();
+					ImGui::TextUnformatted(resource.resident ? "yes" : "streaming");
+					ImGui::TableNextColumn();
+					ImGui::Text("%.1f", resource.bytes / 1024.0);
+				}
+				ImGui::EndTable();
+			}
+			ImGui::End();
+
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			// view/prospective projection transformations
+			glm::mat4 projection =
+				glm::perspective(glm::radians(camera.Zoom), aspectRatio, zNear, zFar);
+			glm::mat4 view = camera.GetViewMatrix();
+
+			// Shader properties
+			const bool useVirtualTexture = virtualTexture && drawVirtualTexture;
+			const bool useCubeMap = drawCubeMap && !drawPlanet && !useVirtualTexture;
+			if (useCubeMap && !cubeMapSphere)
+			{
+				MeshOptions cubeMapOptions = sphereOptions;
+				cubeMapOptions.cubeMapTexture = true;
+				cubeMapSphere = std::make_unique<MeshGrid>(SphereMesh::Tessellation::Icosphere, 12, "Textures\\earth.jpg", cubeMapOptions);
+			}
+			MeshGrid& sphere = useCubeMap ? *cubeMapSphere : firstSphere;
+			Shader& sphereShader = useVirtualTexture ? *virtualTextureShader : useCubeMap ? *cubeMapShader : *lightingShader;
+			for (Shader* shader : { &sphereShader, feedbackShader.get() })
+			{
+				shader->Use();
+				shader->SetVec3("lightColor", 1.0f, 1.0f, 1.0f);
+				shader->SetVec3("lightPos", lightPos);
+				shader->SetVec3("viewPos", camera.Position);
+				shader->SetMat4("projection", projection);
+				shader->SetMat4("view", view);
+			}
+
+			// world transformation, the mesh uploads it together with its normal matrix
+			glm::mat4 model = glm::mat4(1.0f);
+			model = glm::rotate(model, glm::radians(theta_Y_in_degree), glm::vec3(0.0f, 1.0f, 0.0f));
+			sphere.SetModelMatrix(model);
+			planet.SetModelMatrix(model);
+
+			// level of detail follows the on-screen size, hidden meshlets are skipped
+			int framebufferWidth, framebufferHeight;
+			glfwGetFramebufferSize(m_mainWindow, &framebufferWidth, &framebufferHeight);
+			sphere.SetCamera(&camera, projection, static_cast<float>(framebufferHeight));
+			planet.SetCamera(&camera, projection, static_cast<float>(framebufferHeight));
+
+			// Rendering; with the virtual texture a small feedback pass first tells it which pages to stream
+			if (useVirtualTexture)
+			{
+				virtualTexture->BeginFeedback(framebufferWidth, framebufferHeight);
+				virtualTexture->Bind(*feedbackShader, true);
+				if (drawPlanet)
+				{
+					planet.Render(*feedbackShader);
+				}
+				else
+				{
+					firstSphere.Render(*feedbackShader);
+				}
+				virtualTexture->EndFeedback();
+				virtualTexture->Update();
+				virtualTexture->Bind(sphereShader, false);
+			}
+
+			if (drawPlanet)
+			{
+				planet.Render(sphereShader);
+			}
+			else
+			{
+				sphere.Render(sphereShader);
+			}
+
+			// textures follow what was just drawn, within the budget
+			ResidencyManager::Shared().Update();
+
+			ImGui::Render();
+			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+			glfwSwapBuffers(m_mainWindow);
+
+			glfwPollEvents();
+		}
 	}
 
+	// ResourceManager entries went with the last handles above; what the loader and the residency
+	// manager still hold is deleted while the context is current
+	ResidencyManager::Shared().Clear();
+	TextureLoader::Shared().Release();
+
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();